@@ -6,6 +6,7 @@
  * Driver functions for Analog Devices ADXL345 triple-axis accelerometer.
  *
  * The ADXL345 register descriptions below are taken from the data sheet.
+ * The slave address and register addresses are in adxl345.h.
  *
  * This file is free software; you can redistribute it and/or modify
  * it under the terms of either the GNU General Public License version 3
@@ -21,14 +22,12 @@
  * The SDO/Alt Adrs pin is pulled low on the breakout board, therefore the 
  * alternate address of 0x53 is used.  Left shift 1 bit: 0xa6
  */
-#define ADXL345SlaveAdrs 0x53
 
 /*******************************************************************************
  * Device ID
  *
  * The DEVID register holds a fixed device ID code of 0xE5 (345 octal).
  */
-#define ADXL_DEVID 0x00
 
 /*******************************************************************************
  * Tap Threshold
@@ -39,7 +38,6 @@
  * (that is, 0xFF = +16 g). A value of 0 may result in undesirable behavior if 
  * tap/ double tap interrupts are enabled.
  */
-#define ADXL_THRESH_TAP 0x1d
 
 /*******************************************************************************
  * Offset
@@ -48,9 +46,6 @@
  * offset adjustments in twos complement format with a scale factor of 
  * 15.6 mg/LSB (that is, 0x7F = +2 g).
  */
-#define ADXL_OFSX 0x1e
-#define ADXL_OFSY 0x1f
-#define ADXL_OFSZ 0x20
 
 /*******************************************************************************
  * Tap Duration
@@ -60,7 +55,6 @@
  * threshold to qualify as a tap event. The scale factor is 625 μs/LSB. A value 
  * of 0 disables the tap/double tap functions
  */
-#define ADXL_DUR 0x21
 
 /*******************************************************************************
  * Tap Latency
@@ -71,7 +65,6 @@
  * second tap event can be detected. The scale factor is 1.25 ms/LSB. A value of
  * 0 disables the double tap function.
  */
-#define ADXL_LATENT 0x22
 
 /*******************************************************************************
  * Tap Window
@@ -82,7 +75,6 @@
  * begin. The scale factor is 1.25 ms/LSB.  A value of 0 disables the double tap
  * function.
  */
-#define ADXL_WINDOW 0x23
 
 /*******************************************************************************
  * Activity Threshold
@@ -93,7 +85,6 @@
  * scale factor is 62.5 mg/LSB. A value of 0 may result in undesirable behavior 
  * if the activity interrupt is enabled.
  */
-#define ADXL_THRESH_ACT 0x24
 
 /*******************************************************************************
  * Inactivity Threshold
@@ -104,7 +95,6 @@
  * scale factor is 62.5 mg/LSB.  A value of 0 mg may result in undesirable 
  * behavior if the inactivity interrupt is enabled.
  */
-#define ADXL_THRESH_INACT 0x25
 
 /*******************************************************************************
  * Inactivity Time
@@ -120,7 +110,6 @@
  * constant of the output data rate. A value of 0 results in an interrupt when 
  * the output data is less than the value in the THRESH_INACT register.
  */
-#define ADXL_TIME_INACT 0x26
 
 /*******************************************************************************
  * Activity/Inactivity Control
@@ -157,7 +146,6 @@
  * or inactivity. A setting of 0 excludes the selected axis from participation. 
  * If all axes are excluded, the function is disabled.
  */
-#define ADXL_ACT_INACT_CTL  0x27
 
 #define ADXL_ACT_INACT_CTL_ACT_DC   0b00000000
 #define ADXL_ACT_INACT_CTL_ACT_AC   0b10000000
@@ -181,7 +169,6 @@
  * value of 0 mg may result in undesirable behavior if the free-fall interrupt 
  * is enabled. Values between 300 mg and 600 mg (0x05 to 0x09) are recommended.
  */
-#define ADXL_THRESH_FF 0x28
 
 /*******************************************************************************
  * Free-Fall Time
@@ -193,7 +180,6 @@
  * interrupt is enabled. Values between 100 ms and 350 ms (0x14 to 0x46) are 
  * recommended.
  */
-#define ADXL_TIME_FF 0x29
 
 /*******************************************************************************
  * Tap Access Enable Bits
@@ -213,7 +199,6 @@
  * x-, y-, or z-axis participation in tap detection. A setting of 0 excludes the
  * selected axis from participation in tap detection.
 */
-#define ADXL_TAP_AXES 0x2a
 
 /*******************************************************************************
  * Activity Tap Status
@@ -240,7 +225,6 @@
  * setting of 0 indicates that the part is not asleep. See the Register 
  * 0x2D—POWER_CTL (Read/Write) section for more information on auto-sleep mode.
  */
-#define ADXL_ACT_TAP_STATUS 0x2b
 
 /*******************************************************************************
  * Data Rate and Power Control
@@ -275,7 +259,6 @@
  *    12.5  | 0111
  *     6.25 | 0110
  */
-#define ADXL_BW_RATE 0x2c
 
 /*******************************************************************************
  * Power Control
@@ -349,7 +332,6 @@
  *  1    0 |     2
  *  1    1 |     1
  */
-#define ADXL_POWER_CTL 0x2d
 
 /*******************************************************************************
  * Interrupt Enable
@@ -366,7 +348,6 @@
  * enable only the interrupt output; the functions are always enabled. It is 
  * recommended that interrupts be configured before enabling their outputs.
  */
-#define ADXL_INT_ENABLE 0x2e
 
 /*******************************************************************************
  * Interrupt Map
@@ -381,7 +362,6 @@
  * INT1 pin, whereas bits set to 1 send their respective interrupts to the INT2 
  * pin. All selected interrupts for a given pin are OR’ed.
  */
-#define ADXL_INT_MAP 0x2f
 
 /*******************************************************************************
  * Interrupt Source
@@ -402,7 +382,6 @@
  * bits, and the corresponding interrupts, are cleared by reading the INT_SOURCE
  * register.
  */
-#define ADXL_INT_SOURCE 0x30
 
 /*******************************************************************************
  * Data Format
@@ -454,7 +433,6 @@
  * 1  | 0  | ±8 g
  * 1  | 1  | ±16 g
  */
-#define ADXL_DATA_FORMAT 0x31
 
 /*******************************************************************************
  * Output Registers
@@ -469,16 +447,6 @@
  * the data. It is recommended that a multiple-byte read of all registers be 
  * performed to prevent a change in data between reads of sequential registers.
  */
-#define ADXL_ACCEL_DATA 0x32
-#define ADXL_DATAX0     0x32
-#define ADXL_DATAX1     0x33
-#define ADXL_DATAX      0x32
-#define ADXL_DATAY0     0x34
-#define ADXL_DATAY1     0x35
-#define ADXL_DATAY      0x34
-#define ADXL_DATAZ0     0x36
-#define ADXL_DATAZ1     0x37
-#define ADXL_DATAZ      0x36
 
 /*******************************************************************************
  * FIFO Control
@@ -522,7 +490,6 @@
  *  Trigger  | Specifies how many FIFO samples are retained in the FIFO buffer 
  *           | before a trigger event.
  */
-#define ADXL_FIFO_CTL 0x38
 
 /*******************************************************************************
  * FIFO Status
@@ -545,7 +512,6 @@
  * available at any given time because an additional entry is available at the 
  * output filter of the device.
  */
-#define ADXL_FIFO_STATUS 0x39
 
 /*
  * adxl345_setPowerControl()
@@ -670,48 +636,62 @@ void adxl345_setMap(uint8_t map)
 
 }/* end adxl345_setMap() */
 
+/* X, Y, Z acceleration from the last adxl345_update() */
+int16_t adxl345_data[3] = {0, 0, 0};
+
+/*
+ * adxl345_update()
+ *
+ * Read the acceleration data of all three axes in one transaction and keep it
+ * for adxl345_getXData(), adxl345_getYData() and adxl345_getZData().  Returns
+ * the I2C result code, the last data is kept on an error.
+ *
+ * See the description of the ADXL_DATAX, ADXL_DATAY, or ADXL_DATAZ registers.
+ */
+uint8_t adxl345_update(void)
+{
+  uint8_t buf[6], i, err;
+
+  err = i2c_read(ADXL345SlaveAdrs, 6, ADXL_ACCEL_DATA, buf);
+  if(err == I2C_OK)
+  {
+    for(i = 0; i < 3; i++)
+    {
+      adxl345_data[i] = (int16_t)buf[2 * i + 1]<<8;
+      adxl345_data[i] += (int16_t)buf[2 * i];
+    }
+  }
+
+  return(err);
+
+}/* end adxl345_update() */
+
 /*
  * adxl345_getXData()
  * adxl345_getYData()
  * adxl345_getZData()
  *
- * Read the acceleration data from the X, Y, or Z axis.
- *
- * See the description of the ADXL_DATAX, ADXL_DATAY, or ADXL_DATAZ registers.
+ * Return the acceleration data of the X, Y, or Z axis read by the last
+ * adxl345_update().
  */
 int16_t adxl345_getXData(void)
 {
-  int16_t data;
-  uint8_t buf[2];
 
-  i2c_read(ADXL345SlaveAdrs, 2, ADXL_DATAX, buf);
-  data = (int16_t)buf[1]<<8;
-  data += (int16_t)buf[0];
-  return(data);
+  return(adxl345_data[0]);
 
 }/* end adxl345_getXData() */
 
 int16_t adxl345_getYData(void)
 {
-  int16_t data;
-  uint8_t buf[2];
-  
-  i2c_read(ADXL345SlaveAdrs, 2, ADXL_DATAY, buf);
-  data = (int16_t)buf[1]<<8;
-  data += (int16_t)buf[0];
-  return(data);
+
+  return(adxl345_data[1]);
 
 }/* end adxl345_getYData() */
 
 int16_t adxl345_getZData(void)
-{  
-  int16_t data;
-  uint8_t buf[2];
-  
-  i2c_read(ADXL345SlaveAdrs, 2, ADXL_DATAZ, buf);
-  data = (int16_t)buf[1]<<8;
-  data += (int16_t)buf[0];
-  return(data);
+{
+
+  return(adxl345_data[2]);
 
 }/* end adxl345_getZData() */
 
@@ -730,3 +710,107 @@ void adxl345_getAccelData(uint8_t buf[])
   i2c_read(ADXL345SlaveAdrs, 6, ADXL_ACCEL_DATA, buf);
 
 }/* end adxl345_getAccelData() */
+
+/*
+ * adxl345_setFifo()
+ *
+ * Set the FIFO mode and the samples value.  mode is one of ADXL_FIFO_CTL_BYPASS,
+ * _FIFO, _STREAM or _TRIGGER, optionally with ADXL_FIFO_CTL_TRIG_BIT to take the
+ * trigger from INT2.  samples (0 - 31) is the watermark level, or in trigger
+ * mode the number of samples kept from before the trigger.
+ *
+ * See the description of the ADXL_FIFO_CTL register.
+ */
+void adxl345_setFifo(uint8_t mode, uint8_t samples)
+{
+  uint8_t data;
+
+  data = (mode & ~ADXL_FIFO_CTL_SAMPLES) | (samples & ADXL_FIFO_CTL_SAMPLES);
+  i2c_write(ADXL345SlaveAdrs, 1, ADXL_FIFO_CTL, &data);
+
+}/* end adxl345_setFifo() */
+
+/*
+ * adxl345_getFifoStatus()
+ *
+ * Read the FIFO status register and return the value.  The number of entries
+ * waiting is (value & ADXL_FIFO_STATUS_ENTRIES).  If the read fails 0 is
+ * returned, no entries.
+ *
+ * See the description of the ADXL_FIFO_STATUS register.
+ */
+uint8_t adxl345_getFifoStatus(void)
+{
+  uint8_t data;
+
+  if(i2c_read(ADXL345SlaveAdrs, 1, ADXL_FIFO_STATUS, &data) != I2C_OK)
+  {
+    data = 0;
+  }
+  return(data);
+
+}/* end adxl345_getFifoStatus() */
+
+/*
+ * adxl345_initFifo()
+ *
+ * Setup the FIFO with adxl345_setFifo() and enable the watermark interrupt,
+ * so the MCU only needs to be woken every watermark samples.  map is
+ * ADXL_INT_MAP_WATER_INT1 or ADXL_INT_MAP_WATER_INT2 to pick the pin.  The
+ * other interrupt enables and mappings are left as they are.
+ *
+ * When the interrupt fires, read the samples with adxl345_drainFifo(), that
+ * also clears the watermark interrupt once the FIFO is below the level again.
+ */
+void adxl345_initFifo(uint8_t mode, uint8_t watermark, uint8_t map)
+{
+  uint8_t data;
+
+  adxl345_setFifo(mode, watermark);
+
+  i2c_read(ADXL345SlaveAdrs, 1, ADXL_INT_MAP, &data);
+  data = (data & ~ADXL_INT_MAP_WATER_INT2) | (map & ADXL_INT_MAP_WATER_INT2);
+  i2c_write(ADXL345SlaveAdrs, 1, ADXL_INT_MAP, &data);
+
+  i2c_read(ADXL345SlaveAdrs, 1, ADXL_INT_ENABLE, &data);
+  data |= ADXL_INT_ENABLE_WATER_MK;
+  i2c_write(ADXL345SlaveAdrs, 1, ADXL_INT_ENABLE, &data);
+
+}/* end adxl345_initFifo() */
+
+/*
+ * adxl345_drainFifo()
+ *
+ * Read the entries waiting in the FIFO, up to max of them, into samples[][]
+ * as X, Y, Z.  Returns the number of entries read.
+ *
+ * Each entry needs its own 6 byte burst read of the data registers, the FIFO
+ * moves on to the next entry once the last of them has been read.  The reads
+ * are done back to back, the Start and address bytes of the next read give
+ * well over the 5us the device needs between entries.
+ */
+uint8_t adxl345_drainFifo(int16_t samples[][3], uint8_t max)
+{
+  uint8_t n, i, buf[6];
+
+  n = adxl345_getFifoStatus() & ADXL_FIFO_STATUS_ENTRIES;
+  if(n > max)
+  {
+    n = max;
+  }
+
+  for(i = 0; i < n; i++)
+  {
+    if(i2c_read(ADXL345SlaveAdrs, 6, ADXL_ACCEL_DATA, buf) != I2C_OK)
+    {
+      break;
+    }
+    samples[i][0] = (int16_t)((buf[1] << 8) | buf[0]);
+    samples[i][1] = (int16_t)((buf[3] << 8) | buf[2]);
+    samples[i][2] = (int16_t)((buf[5] << 8) | buf[4]);
+
+  }/* end for(i = 0; i < n; i++) */
+
+  return(i);
+
+}/* end adxl345_drainFifo() */
@@ -10,6 +10,46 @@
 #ifndef _ADXL345_H_
 #define _ADXL345_H_ 1
 
+/*
+ * Slave address and register addresses, the registers are described in
+ * adxl345.c.
+ */
+#define ADXL345SlaveAdrs    0x53
+#define ADXL_DEVID          0x00
+#define ADXL_THRESH_TAP     0x1d
+#define ADXL_OFSX           0x1e
+#define ADXL_OFSY           0x1f
+#define ADXL_OFSZ           0x20
+#define ADXL_DUR            0x21
+#define ADXL_LATENT         0x22
+#define ADXL_WINDOW         0x23
+#define ADXL_THRESH_ACT     0x24
+#define ADXL_THRESH_INACT   0x25
+#define ADXL_TIME_INACT     0x26
+#define ADXL_ACT_INACT_CTL  0x27
+#define ADXL_THRESH_FF      0x28
+#define ADXL_TIME_FF        0x29
+#define ADXL_TAP_AXES       0x2a
+#define ADXL_ACT_TAP_STATUS 0x2b
+#define ADXL_BW_RATE        0x2c
+#define ADXL_POWER_CTL      0x2d
+#define ADXL_INT_ENABLE     0x2e
+#define ADXL_INT_MAP        0x2f
+#define ADXL_INT_SOURCE     0x30
+#define ADXL_DATA_FORMAT    0x31
+#define ADXL_ACCEL_DATA     0x32
+#define ADXL_DATAX0         0x32
+#define ADXL_DATAX1         0x33
+#define ADXL_DATAX          0x32
+#define ADXL_DATAY0         0x34
+#define ADXL_DATAY1         0x35
+#define ADXL_DATAY          0x34
+#define ADXL_DATAZ0         0x36
+#define ADXL_DATAZ1         0x37
+#define ADXL_DATAZ          0x36
+#define ADXL_FIFO_CTL       0x38
+#define ADXL_FIFO_STATUS    0x39
+
 /*******************************************************************************
  * 0x27 - Activity/Inactivity Control
  *
@@ -437,7 +477,7 @@
 
 #define ADXL_FIFO_CTL_TRIG_BIT 0b00100000
 
-#define ADXL_FIFO_CTL_SAMPLES  0b00001111
+#define ADXL_FIFO_CTL_SAMPLES  0b00011111
 
 /*******************************************************************************
  * 0x39 - FIFO Status
@@ -462,7 +502,12 @@
  */
 #define ADXL_FIFO_STATUS_TRIG 0b10000000
 
-#define ADXL_FIFO_STATUS_ENTRIES 0b00011111
+#define ADXL_FIFO_STATUS_ENTRIES 0b00111111
+
+/* Most entries adxl345_drainFifo() can find: 32 in the FIFO plus one more in
+ * the output filter.
+ */
+#define ADXL_FIFO_DEPTH 33
 
 void adxl345_setPowerControl(uint8_t data);
 void adxl345_setDataFormat(uint8_t data);
@@ -472,9 +517,14 @@ void adxl345_initDTap(uint8_t thresh, uint8_t dur, uint8_t latent, uint8_t windo
 uint8_t adxl345_getIntrpt(void);
 void adxl345_setIntrpt(uint8_t data);
 void adxl345_setMap(uint8_t data);
+uint8_t adxl345_update(void);
 int16_t adxl345_getXData(void);
 int16_t adxl345_getYData(void);
 int16_t adxl345_getZData(void);
 void adxl345_getAccelData(uint8_t *buf);
+void adxl345_setFifo(uint8_t mode, uint8_t samples);
+uint8_t adxl345_getFifoStatus(void);
+void adxl345_initFifo(uint8_t mode, uint8_t watermark, uint8_t map);
+uint8_t adxl345_drainFifo(int16_t samples[][3], uint8_t max);
 
 #endif /* _ADXL345_H */
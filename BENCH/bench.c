@@ -0,0 +1,354 @@
+/*
+ * File:    bench.c
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Common parts of the benchmark programs.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <stdlib.h>
+#include "uart/uart.h"
+#include "prof/prof.h"
+#include "bench.h"
+
+/* transfer for the next report, see bench_transfer() */
+uint16_t bench_bytes = 0;
+uint32_t bench_byte_cycles;
+uint8_t bench_isr_id;
+
+/* ids with pairs nested in the runs of the next report, one bit each, and the
+   cycles one nested pair adds to a run */
+uint16_t bench_nested_ids = 0;
+uint32_t bench_nested_cycles = 0;
+
+/* touched field of the next report, see bench_touched() */
+uint8_t bench_touched_set = 0;
+uint32_t bench_touched_bytes;
+
+#ifdef BENCH_SIM
+#include <stdio.h>
+#include "sim.h"
+
+/* simulated cycles in each bench_idle() */
+#define BENCH_IDLE_CYCLES 16
+
+/* 1 to drop the UART output */
+uint8_t bench_muted = 0;
+
+/*
+ * bench_sink()
+ *
+ * Simulated UART output to stdout, without the carriage returns, unless it
+ * is muted.
+ */
+void bench_sink(uint8_t c)
+{
+
+  if((c != '\r') && (bench_muted == 0))
+  {
+    putchar(c);
+  }
+
+}/* end bench_sink() */
+#endif
+
+/*
+ * bench_init()
+ *
+ * Start the simulation if there is one, the UART, interrupts and the
+ * profiler, and print the CSV header.
+ */
+void bench_init(void)
+{
+  PROF_ENTRY_TYPE entry;
+  uint8_t i;
+
+#ifdef BENCH_SIM
+  sim_init();
+  sim_uart_set_sink(bench_sink);
+#endif
+
+  uart_init(BENCH_BAUD, USART_CHAR_SZ_EIGHT, USART_PARITY_NONE,
+            USART_STOP_BIT_ONE);
+  sei();
+  prof_init();
+
+/* what a pair nested in a run adds to it, before the UART is busy */
+  for(i = 0; i < 4; i++)
+  {
+    PROF_BEGIN(BENCH_ID);
+    PROF_BEGIN(BENCH_CALL_ID);
+    PROF_END(BENCH_CALL_ID);
+    PROF_END(BENCH_ID);
+  }
+  prof_get(BENCH_ID, &entry);
+  bench_nested_cycles = entry.min;
+  prof_reset();
+
+  uart_putstr_P(PSTR("bench,case,arg,runs,min,max,avg,"
+                     "bytes,bytes_per_s,overhead,cpu_free_pct,touched\r\n"));
+
+}/* end bench_init() */
+
+/*
+ * bench_put_field()
+ *
+ * Print a number and a comma.
+ */
+void bench_put_field(uint32_t n)
+{
+  char buf[12];
+
+  ultoa(n, buf, 10);
+  uart_putstr(buf);
+  uart_putchar(',');
+
+}/* end bench_put_field() */
+
+/*
+ * bench_transfer()
+ *
+ * Make the next report one of a transfer.
+ */
+void bench_transfer(uint16_t bytes, uint32_t byteCycles, uint8_t isrId)
+{
+
+  bench_bytes = bytes;
+  bench_byte_cycles = byteCycles;
+  bench_isr_id = isrId;
+
+}/* end bench_transfer() */
+
+/*
+ * bench_nested()
+ *
+ * Take the cost of id's pairs off the next report.
+ */
+void bench_nested(uint8_t id)
+{
+
+  bench_nested_ids |= (1 << id);
+
+}/* end bench_nested() */
+
+/*
+ * bench_touched()
+ *
+ * Make the next report show bytes as the RAM a run wrote.
+ */
+void bench_touched(uint32_t bytes)
+{
+
+  bench_touched_bytes = bytes;
+  bench_touched_set = 1;
+
+}/* end bench_touched() */
+
+/*
+ * bench_take_nested()
+ *
+ * Take the cost of the nested pairs off the runs in entry.
+ */
+void bench_take_nested(PROF_ENTRY_TYPE *entry)
+{
+  PROF_ENTRY_TYPE nested;
+  uint32_t pairs = 0, cost;
+  uint8_t id;
+
+  for(id = 0; id < PROF_MAX_IDS; id++)
+  {
+    if(bench_nested_ids & (1 << id))
+    {
+      prof_get(id, &nested);
+      pairs += nested.count;
+    }
+  }
+  bench_nested_ids = 0;
+
+  cost = (pairs * bench_nested_cycles) / entry->count;
+  entry->min = (entry->min > cost) ? entry->min - cost : 0;
+  entry->max = (entry->max > cost) ? entry->max - cost : 0;
+  cost *= entry->count;
+  entry->total = (entry->total > cost) ? entry->total - cost : 0;
+
+}/* end bench_take_nested() */
+
+/*
+ * bench_idle()
+ *
+ * Called while waiting for a transfer.
+ */
+void bench_idle(void)
+{
+
+#ifdef BENCH_SIM
+  sim_run(BENCH_IDLE_CYCLES);
+#endif
+
+}/* end bench_idle() */
+
+/*
+ * bench_mute()
+ *
+ * Drop the simulated UART output while mute is 1.
+ */
+void bench_mute(uint8_t mute)
+{
+
+#ifdef BENCH_SIM
+  bench_muted = mute;
+#else
+  (void)mute;
+#endif
+
+}/* end bench_mute() */
+
+/*
+ * bench_put_transfer()
+ *
+ * Print the transfer fields from the runs of id BENCH_ID in entry.
+ */
+void bench_put_transfer(PROF_ENTRY_TYPE *entry, uint32_t avg)
+{
+  PROF_ENTRY_TYPE call, isr;
+  uint32_t busy, idle = 0;
+  int32_t overhead;
+  char buf[12];
+
+  prof_get(BENCH_CALL_ID, &call);
+  busy = call.total;
+  if(bench_isr_id != BENCH_NO_ISR)
+  {
+    prof_get(bench_isr_id, &isr);
+    busy += isr.total;
+  }
+  if(busy < entry->total)
+  {
+    idle = entry->total - busy;
+  }
+  overhead = (int32_t)avg - (int32_t)(bench_bytes * bench_byte_cycles);
+
+  bench_put_field(bench_bytes);
+  bench_put_field(avg ? ((uint32_t)bench_bytes * F_CPU) / avg : 0);
+  ltoa(overhead, buf, 10);
+  uart_putstr(buf);
+  uart_putchar(',');
+  ultoa(entry->total ? ((uint64_t)idle * 100) / entry->total : 0, buf, 10);
+  uart_putstr(buf);
+
+}/* end bench_put_transfer() */
+
+/*
+ * bench_put_line()
+ *
+ * Print the CSV line for the runs timed since the last report, then clear
+ * them.  The name is in program memory if flash is 1.
+ */
+void bench_put_line(const char *bench, const char *name, uint8_t flash,
+                    uint32_t arg)
+{
+  PROF_ENTRY_TYPE entry;
+  uint32_t avg = 0;
+  char buf[12];
+
+  prof_get(BENCH_ID, &entry);
+  if(entry.count == 0)
+  {
+    entry.min = 0; /* nothing timed */
+  }
+  else
+  {
+    if(bench_nested_ids != 0)
+    {
+      bench_take_nested(&entry);
+    }
+    avg = entry.total / entry.count;
+  }
+  bench_nested_ids = 0;
+
+  uart_putstr_P(bench);
+  uart_putchar(',');
+  if(flash)
+  {
+    uart_putstr_P(name);
+  }
+  else
+  {
+    uart_putstr((char *)name);
+  }
+  uart_putchar(',');
+  bench_put_field(arg);
+  bench_put_field(entry.count);
+  bench_put_field(entry.min);
+  bench_put_field(entry.max);
+  ultoa(avg, buf, 10);
+  uart_putstr(buf);
+  uart_putchar(',');
+  if(bench_bytes != 0)
+  {
+    bench_put_transfer(&entry, avg);
+    bench_bytes = 0;
+  }
+  else
+  {
+    uart_putstr_P(PSTR(",,,"));
+  }
+  uart_putchar(',');
+  if(bench_touched_set)
+  {
+    ultoa(bench_touched_bytes, buf, 10);
+    uart_putstr(buf);
+    bench_touched_set = 0;
+  }
+  uart_putstr_P(PSTR("\r\n"));
+
+  prof_reset();
+
+}/* end bench_put_line() */
+
+/*
+ * bench_report()
+ * bench_report_P()
+ *
+ * Print the CSV line for the runs timed since the last report, with the name
+ * in RAM or in program memory.
+ */
+void bench_report(const char *bench, char name[], uint32_t arg)
+{
+
+  bench_put_line(bench, name, 0, arg);
+
+}/* end bench_report() */
+
+void bench_report_P(const char *bench, const char *name, uint32_t arg)
+{
+
+  bench_put_line(bench, name, 1, arg);
+
+}/* end bench_report_P() */
+
+/*
+ * bench_done()
+ *
+ * Wait for the UART to finish, then end the program.
+ */
+void bench_done(void)
+{
+
+#ifdef BENCH_SIM
+  sim_run(F_CPU / 100); /* the last characters out of the UART */
+  fflush(stdout);
+#else
+  for(;;)
+  {
+  }
+#endif
+
+}/* end bench_done() */
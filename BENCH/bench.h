@@ -0,0 +1,153 @@
+/*
+ * File:    bench.h
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Common parts of the benchmark programs.
+ *
+ * A benchmark times each case BENCH_RUNS times with the TC1 profiler, then
+ * prints one CSV line out the UART:
+ *
+ *   bench,case,arg,runs,min,max,avg,bytes,bytes_per_s,overhead,cpu_free_pct,
+ *   touched
+ *
+ * with the times in CPU cycles.  bytes to cpu_free_pct are only filled in for
+ * a transfer (see bench_transfer()): the bytes moved in a run, the rate they
+ * were moved at, the cycles a run took on top of the time the bytes need on
+ * the wire, and how much of the run the CPU was free to do other work,
+ * outside the call that started it and the interrupts that carried it.
+ * touched is only filled in when the benchmark measures it (see
+ * bench_touched()): the bytes of RAM a run wrote.
+ *
+ * The PROF_BEGIN()/PROF_END() pairs built into the drivers with PROF_ENABLE
+ * run inside the timed runs too.  A benchmark names the ones in a case with
+ * bench_nested() and their cost is taken off.
+ *
+ * The same program runs on the part and on the host simulation in ../SIM
+ * (built with BENCH_SIM defined), where the UART output goes to stdout.  On
+ * the simulation only register accesses, bus transfers and interrupts take
+ * time.  Code that only works in RAM comes out at 0 cycles there, so for
+ * those cases a benchmark reports the RAM they touched instead.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#ifndef _BENCH_H_
+#define _BENCH_H_ 1
+
+#include <stdint.h>
+#include "prof/prof.h"
+
+#ifndef PROF_ENABLE
+#error "the benchmarks need the profiler, build with -DPROF_ENABLE"
+#endif
+
+/* Runs of each case. */
+#ifndef BENCH_RUNS
+#define BENCH_RUNS 16
+#endif
+
+/* UART bit rate for the results. */
+#ifndef BENCH_BAUD
+#define BENCH_BAUD 115200UL
+#endif
+
+/* Profiler id the cases are timed with. */
+#define BENCH_ID PROF_ID_USER
+
+/* Profiler id for the part of a run spent in the call that starts it. */
+#define BENCH_CALL_ID (PROF_ID_USER + 1)
+
+/* No interrupt, for bench_transfer(). */
+#define BENCH_NO_ISR PROF_MAX_IDS
+
+/* Time one run of a statement. */
+#define BENCH_TIME(stmt) \
+  do { PROF_BEGIN(BENCH_ID); stmt; PROF_END(BENCH_ID); } while(0)
+
+/* Time the call in a run that has the CPU busy, everything for a blocking
+   call. */
+#define BENCH_CALL(stmt) \
+  do { PROF_BEGIN(BENCH_CALL_ID); stmt; PROF_END(BENCH_CALL_ID); } while(0)
+
+/*
+ * bench_init()
+ *
+ * Start the simulation if there is one, the UART, interrupts and the
+ * profiler, and print the CSV header.
+ */
+void bench_init(void);
+
+/*
+ * bench_report()
+ * bench_report_P()
+ *
+ * Print the CSV line for the runs timed since the last report, then clear
+ * them.  bench is a string in program memory, name is in RAM for
+ * bench_report() and in program memory for bench_report_P().
+ */
+void bench_report(const char *bench, char name[], uint32_t arg);
+void bench_report_P(const char *bench, const char *name, uint32_t arg);
+
+/*
+ * bench_transfer()
+ *
+ * Make the next report one of a transfer of bytes in each run, each byte
+ * taking byteCycles on the wire, carried by the interrupt timed with profiler
+ * id isrId (BENCH_NO_ISR for none).  The CPU is counted as free for the time
+ * not in BENCH_CALL() or the interrupt.  The interrupt's entry and exit are
+ * outside its timing, so this comes out a little high.
+ */
+void bench_transfer(uint16_t bytes, uint32_t byteCycles, uint8_t isrId);
+
+/*
+ * bench_nested()
+ *
+ * Make the next report take off the cost of the PROF_BEGIN()/PROF_END() pairs
+ * of profiler id id, a driver's own, that ran inside its runs.  Can be called
+ * for more than one id.
+ */
+void bench_nested(uint8_t id);
+
+/*
+ * bench_touched()
+ *
+ * Make the next report show bytes in the touched field, the bytes of RAM a
+ * run wrote.
+ */
+void bench_touched(uint32_t bytes);
+
+/*
+ * bench_idle()
+ *
+ * Called in the loops waiting for a transfer to finish, on the simulation it
+ * lets time pass.
+ */
+void bench_idle(void);
+
+/*
+ * bench_mute()
+ *
+ * On the simulation, drop what the UART sends while mute is 1, for the cases
+ * timing the UART itself.
+ */
+void bench_mute(uint8_t mute);
+
+/*
+ * bench_put_field()
+ *
+ * Print a number and a comma.
+ */
+void bench_put_field(uint32_t n);
+
+/*
+ * bench_done()
+ *
+ * Wait for the UART to finish, then end the program.  On the part it is left
+ * in a loop.
+ */
+void bench_done(void);
+
+#endif /* _BENCH_H_ */
@@ -0,0 +1,413 @@
+/*
+ * File:    bus_bench.c
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Benchmark of the I2C, SPI and UART drivers: the rate each way of moving
+ * data achieves, the cycles a transfer takes on top of the time its bytes
+ * need on the wire at the rate actually programmed (TWBR, UBRR0), and how
+ * much of the transfer the CPU is free.
+ *
+ * Cases, arg in brackets:
+ *
+ *   i2c_read_S, i2c_write_S,
+ *   i2c_read_async_S,
+ *   i2c_write_async_S   (bytes, 1 to 64) blocking calls, and the
+ *                       transaction engine waited on, at S = 100k and 400k
+ *   spi_transfer,
+ *   spi_buffer,
+ *   spi_async           (divisor) 64 bytes by spi_transfer(), by
+ *                       spi_transfer_buffer() and by spi_transfer_async(),
+ *                       _2x on the case for the SPI2X dividers
+ *   uart_putstr_B,
+ *   uart_write_B,
+ *   uart_send_B,
+ *   uart_put_at_B       (bytes) a 48 byte line by uart_putstr(), uart_write(),
+ *                       uart_send() and uart_tx_put_at()/uart_tx_commit(), at
+ *                       B bits per second
+ *
+ * The I2C reads are from the ADXL345 (0x53) and the writes go to the display
+ * RAM of an SSD1306 (0x3c).  The SPI bytes go out with nothing selected.  On
+ * the part the UART cases are sent to the terminal at the rate being timed,
+ * so they show as noise between the results, the simulation drops them.  Each
+ * run is timed until its last byte is on the wire, the interrupt driven ones
+ * waiting in a loop the CPU counts as free.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <util/delay.h>
+#include <string.h>
+#include "i2c/i2c.h"
+#include "spi/spi.h"
+#include "uart/uart.h"
+#include "bench.h"
+
+/* I2C devices */
+#define BUS_BENCH_READ_SLAVE  0x53 /* ADXL345, registers from 0x00 */
+#define BUS_BENCH_READ_ADRS   0x00
+#define BUS_BENCH_WRITE_SLAVE 0x3c /* SSD1306, control byte for data */
+#define BUS_BENCH_WRITE_ADRS  0x40
+
+/* largest I2C payload, and the SPI and UART ones */
+#define BUS_BENCH_I2C_MAX 64
+#define BUS_BENCH_SPI_LEN 64
+#define BUS_BENCH_UART_LEN 48
+
+/* An SPI clock rate.
+ *
+ * spcr: SPI_SPCR_DIV* bits
+ * spsr: SPI_SPSR_SPI1X or SPI_SPSR_SPI2X
+ * div : what F_CPU is divided by
+ */
+typedef struct
+{
+  uint8_t spcr;
+  uint8_t spsr;
+  uint8_t div;
+
+} BUS_BENCH_SPI_RATE_TYPE;
+
+const BUS_BENCH_SPI_RATE_TYPE bus_bench_spi_rates[] PROGMEM =
+{
+  {SPI_SPCR_DIV4, SPI_SPSR_SPI1X, 4},
+  {SPI_SPCR_DIV16, SPI_SPSR_SPI1X, 16},
+  {SPI_SPCR_DIV64, SPI_SPSR_SPI1X, 64},
+  {SPI_SPCR_DIV128, SPI_SPSR_SPI1X, 128},
+  {SPI_SPCR_DIV2, SPI_SPSR_SPI2X, 2},
+  {SPI_SPCR_DIV8, SPI_SPSR_SPI2X, 8},
+  {SPI_SPCR_DIV32, SPI_SPSR_SPI2X, 32},
+  {SPI_SPCR_DIV64X, SPI_SPSR_SPI2X, 64}
+};
+
+const char bus_bench_name[] PROGMEM = "bus";
+
+uint8_t bus_bench_buf[BUS_BENCH_SPI_LEN];
+
+/* the UART line, BUS_BENCH_UART_LEN bytes */
+char bus_bench_line[] = "$IMU,-00123,+00456,-00789,+01234,-05678,1234*5A\n";
+
+/*
+ * bus_bench_name_for()
+ *
+ * Put the case name made of a base and a suffix in name.
+ */
+void bus_bench_name_for(char name[], const char *base, const char *suffix)
+{
+
+  strcpy_P(name, base);
+  strcat_P(name, suffix);
+
+}/* end bus_bench_name_for() */
+
+/*
+ * bus_bench_i2c_async()
+ *
+ * Post a transaction and wait for it to finish.
+ */
+void bus_bench_i2c_async(uint8_t dir, uint8_t len)
+{
+  I2C_TRANSACTION_TYPE trans;
+
+  trans.slvAdrs = (dir == I2C_DIR_READ) ? BUS_BENCH_READ_SLAVE :
+                                          BUS_BENCH_WRITE_SLAVE;
+  trans.adrs = (dir == I2C_DIR_READ) ? BUS_BENCH_READ_ADRS :
+                                       BUS_BENCH_WRITE_ADRS;
+  trans.len = len;
+  trans.dir = dir;
+  trans.buf = bus_bench_buf;
+  trans.callback = 0;
+
+  BENCH_CALL(i2c_transaction(&trans));
+  while(trans.status == I2C_BUSY)
+  {
+    bench_idle();
+  }
+
+}/* end bus_bench_i2c_async() */
+
+/*
+ * bus_bench_i2c()
+ *
+ * The I2C cases at one bus speed.
+ */
+void bus_bench_i2c(uint32_t speed, const char *suffix)
+{
+  uint8_t len, i;
+  uint32_t byteCycles;
+  char name[24];
+
+  i2c_init(speed);
+  byteCycles = 9 * (16 + 2 * (uint32_t)TWBR * (1 << (2 * (TWSR & 3))));
+
+  for(len = 1; len <= BUS_BENCH_I2C_MAX; len *= 2)
+  {
+    for(i = 0; i < BENCH_RUNS; i++)
+    {
+      BENCH_TIME(BENCH_CALL(i2c_read(BUS_BENCH_READ_SLAVE, len,
+                                     BUS_BENCH_READ_ADRS, bus_bench_buf)));
+    }
+    bus_bench_name_for(name, PSTR("i2c_read_"), suffix);
+    bench_transfer(len, byteCycles, PROF_ID_TWI_ISR);
+    bench_report(bus_bench_name, name, len);
+
+    for(i = 0; i < BENCH_RUNS; i++)
+    {
+      BENCH_TIME(bus_bench_i2c_async(I2C_DIR_READ, len));
+    }
+    bus_bench_name_for(name, PSTR("i2c_read_async_"), suffix);
+    bench_transfer(len, byteCycles, PROF_ID_TWI_ISR);
+    bench_report(bus_bench_name, name, len);
+
+    for(i = 0; i < BENCH_RUNS; i++)
+    {
+      BENCH_TIME(BENCH_CALL(i2c_write(BUS_BENCH_WRITE_SLAVE, len,
+                                      BUS_BENCH_WRITE_ADRS, bus_bench_buf)));
+    }
+    bus_bench_name_for(name, PSTR("i2c_write_"), suffix);
+    bench_transfer(len, byteCycles, PROF_ID_TWI_ISR);
+    bench_report(bus_bench_name, name, len);
+
+    for(i = 0; i < BENCH_RUNS; i++)
+    {
+      BENCH_TIME(bus_bench_i2c_async(I2C_DIR_WRITE, len));
+    }
+    bus_bench_name_for(name, PSTR("i2c_write_async_"), suffix);
+    bench_transfer(len, byteCycles, PROF_ID_TWI_ISR);
+    bench_report(bus_bench_name, name, len);
+  }
+
+}/* end bus_bench_i2c() */
+
+/*
+ * bus_bench_spi_bytes()
+ * bus_bench_spi_async()
+ *
+ * Send the SPI payload a byte at a time, or in the background and wait for
+ * it to finish.
+ */
+void bus_bench_spi_bytes(void)
+{
+  uint8_t i;
+
+  for(i = 0; i < BUS_BENCH_SPI_LEN; i++)
+  {
+    bus_bench_buf[i] = spi_transfer(bus_bench_buf[i]);
+  }
+
+}/* end bus_bench_spi_bytes() */
+
+void bus_bench_spi_async(void)
+{
+  SPI_TRANSFER_TYPE xfer;
+
+  xfer.tx = bus_bench_buf;
+  xfer.rx = bus_bench_buf;
+  xfer.len = BUS_BENCH_SPI_LEN;
+  xfer.csPort = 0;
+  xfer.csMask = 0;
+  xfer.callback = 0;
+
+  BENCH_CALL(spi_transfer_async(&xfer));
+  while(xfer.status == SPI_BUSY)
+  {
+    bench_idle();
+  }
+
+}/* end bus_bench_spi_async() */
+
+/*
+ * bus_bench_spi()
+ *
+ * The SPI cases at each clock rate.
+ */
+void bus_bench_spi(void)
+{
+  uint8_t r, i;
+  BUS_BENCH_SPI_RATE_TYPE rate;
+  char name[24];
+
+  for(r = 0; r < sizeof(bus_bench_spi_rates) / sizeof(rate); r++)
+  {
+    memcpy_P(&rate, &bus_bench_spi_rates[r], sizeof(rate));
+    spi_init(SPI_SPCR_SPE | SPI_SPCR_MSTR | SPI_SPCR_MODE0 | rate.spcr,
+             rate.spsr);
+
+    for(i = 0; i < BENCH_RUNS; i++)
+    {
+      BENCH_TIME(BENCH_CALL(bus_bench_spi_bytes()));
+    }
+    bus_bench_name_for(name, PSTR("spi_transfer"),
+                       rate.spsr ? PSTR("_2x") : PSTR(""));
+    bench_transfer(BUS_BENCH_SPI_LEN, 8 * rate.div, PROF_ID_SPI_ISR);
+    bench_report(bus_bench_name, name, rate.div);
+
+    for(i = 0; i < BENCH_RUNS; i++)
+    {
+      BENCH_TIME(BENCH_CALL(spi_transfer_buffer(bus_bench_buf, bus_bench_buf,
+                                                BUS_BENCH_SPI_LEN)));
+    }
+    bus_bench_name_for(name, PSTR("spi_buffer"),
+                       rate.spsr ? PSTR("_2x") : PSTR(""));
+    bench_transfer(BUS_BENCH_SPI_LEN, 8 * rate.div, PROF_ID_SPI_ISR);
+    bench_report(bus_bench_name, name, rate.div);
+
+    for(i = 0; i < BENCH_RUNS; i++)
+    {
+      BENCH_TIME(bus_bench_spi_async());
+    }
+    bus_bench_name_for(name, PSTR("spi_async"),
+                       rate.spsr ? PSTR("_2x") : PSTR(""));
+    bench_transfer(BUS_BENCH_SPI_LEN, 8 * rate.div, PROF_ID_SPI_ISR);
+    bench_report(bus_bench_name, name, rate.div);
+  }
+
+  spi_end();
+
+}/* end bus_bench_spi() */
+
+/*
+ * bus_bench_uart_wait()
+ *
+ * Wait for the transmit interrupt to finish, it turns itself off after the
+ * last byte, and for that byte to be sent.
+ */
+void bus_bench_uart_wait(void)
+{
+
+  while((UCSR0B & _BV(UDRIE0)) || !(UCSR0A & _BV(TXC0)))
+  {
+    bench_idle();
+  }
+
+}/* end bus_bench_uart_wait() */
+
+/*
+ * bus_bench_uart_putstr()
+ * bus_bench_uart_write()
+ * bus_bench_uart_send()
+ * bus_bench_uart_put_at()
+ *
+ * Send the UART line a byte at a time, through the transmit buffer, straight
+ * from the line, or built in place in the transmit buffer, and wait for it to
+ * go.
+ */
+void bus_bench_uart_putstr(void)
+{
+
+  BENCH_CALL(uart_putstr(bus_bench_line));
+  bus_bench_uart_wait();
+
+}/* end bus_bench_uart_putstr() */
+
+void bus_bench_uart_write(void)
+{
+
+  BENCH_CALL(uart_write(BUS_BENCH_UART_LEN, bus_bench_line));
+  bus_bench_uart_wait();
+
+}/* end bus_bench_uart_write() */
+
+void bus_bench_uart_send(void)
+{
+  UART_TX_DESC_TYPE desc;
+
+  desc.buf = bus_bench_line;
+  desc.len = BUS_BENCH_UART_LEN;
+  desc.mem = UART_MEM_RAM;
+  desc.callback = 0;
+
+  BENCH_CALL(uart_send(&desc));
+  while(desc.status == UART_TX_BUSY)
+  {
+    bench_idle();
+  }
+  bus_bench_uart_wait();
+
+}/* end bus_bench_uart_send() */
+
+void bus_bench_uart_put_at(void)
+{
+  uint8_t i;
+
+  PROF_BEGIN(BENCH_CALL_ID);
+  for(i = 0; i < BUS_BENCH_UART_LEN; i++)
+  {
+    uart_tx_put_at(i, bus_bench_line[i]);
+  }
+  uart_tx_commit(BUS_BENCH_UART_LEN);
+  PROF_END(BENCH_CALL_ID);
+  bus_bench_uart_wait();
+
+}/* end bus_bench_uart_put_at() */
+
+/*
+ * bus_bench_uart_case()
+ *
+ * Time run at a bit rate, then go back to the results rate and report.
+ */
+void bus_bench_uart_case(void (*run)(void), const char *base,
+                         const char *suffix, uint32_t baud)
+{
+  uint8_t i;
+  uint32_t byteCycles;
+  char name[24];
+
+  _delay_ms(1); /* the results out at BENCH_BAUD first */
+  uart_init(baud, USART_CHAR_SZ_EIGHT, USART_PARITY_NONE, USART_STOP_BIT_ONE);
+  bench_mute(1);
+  for(i = 0; i < BENCH_RUNS; i++)
+  {
+    UCSR0A = (UCSR0A & _BV(U2X0)) | _BV(TXC0); /* writing 1 clears it */
+    BENCH_TIME(run());
+  }
+  bench_mute(0);
+  byteCycles = 10 * ((UCSR0A & _BV(U2X0)) ? 8 : 16) * ((uint32_t)UBRR0 + 1);
+
+  uart_init(BENCH_BAUD, USART_CHAR_SZ_EIGHT, USART_PARITY_NONE,
+            USART_STOP_BIT_ONE);
+  bus_bench_name_for(name, base, suffix);
+  bench_transfer(BUS_BENCH_UART_LEN, byteCycles, PROF_ID_UART_UDRE_ISR);
+  bench_report(bus_bench_name, name, BUS_BENCH_UART_LEN);
+
+}/* end bus_bench_uart_case() */
+
+/*
+ * bus_bench_uart()
+ *
+ * The UART cases at one bit rate.
+ */
+void bus_bench_uart(uint32_t baud, const char *suffix)
+{
+
+  bus_bench_uart_case(bus_bench_uart_putstr, PSTR("uart_putstr_"), suffix,
+                      baud);
+  bus_bench_uart_case(bus_bench_uart_write, PSTR("uart_write_"), suffix, baud);
+  bus_bench_uart_case(bus_bench_uart_send, PSTR("uart_send_"), suffix, baud);
+  bus_bench_uart_case(bus_bench_uart_put_at, PSTR("uart_put_at_"), suffix,
+                      baud);
+
+}/* end bus_bench_uart() */
+
+int main(void)
+{
+
+  bench_init();
+
+  bus_bench_i2c(100000, PSTR("100k"));
+  bus_bench_i2c(400000, PSTR("400k"));
+
+  bus_bench_spi();
+
+  bus_bench_uart(9600, PSTR("9600"));
+  bus_bench_uart(38400, PSTR("38400"));
+  bus_bench_uart(115200, PSTR("115200"));
+
+  bench_done();
+  return(0);
+
+}/* end main() */
@@ -0,0 +1,351 @@
+/*
+ * File:    graphics_bench.c
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Benchmark of the graphics primitives and of sending the frame to an
+ * SSD1306 on the I2C bus at 400kHz.
+ *
+ * Cases, arg in brackets:
+ *
+ *   plot_pixel        (colour)
+ *   line_h, line_v,
+ *   line_diag         (length)
+ *   circle            (radius)
+ *   filled_rect       (side of the square)
+ *   putChar_sN_rR,
+ *   putStr_sN_rR      (text size N, rotation R, arg is the characters)
+ *   clear             (0)
+ *   update_full       (bytes of frame)
+ *   update_dirty_none, update_dirty_char,
+ *   update_dirty_all  (0, nothing, one character or all of it changed)
+ *
+ * The putChar and putStr times have the cost of graphics_putChar()'s own
+ * profiler pair taken off, the update times those of
+ * ssd1306_i2c_graphics_update() and the TWI interrupt.
+ *
+ * The simulation doesn't charge for CPU time spent working in RAM, so there
+ * the drawing cases, putChar, putStr and clear come out at 0 cycles.  In
+ * their touched field it reports instead how many bytes of the frame a run
+ * wrote.  It finds them by running the call on a frame of all 0s and again on
+ * one of all 1s, a byte written is different from the fill in one or other.
+ * The update cases on the simulation also check that the display RAM ended
+ * up the same as the frame, a mismatch prints a "verify" line.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <string.h>
+#include "i2c/i2c.h"
+#include "uart/uart.h"
+#include "graphics/graphics.h"
+#include "ssd1306/ssd1306_i2c.h"
+#include "bench.h"
+
+#ifdef BENCH_SIM
+#include "sim.h"
+#endif
+
+/* not in graphics.h, the primitive everything else is drawn with */
+void plot_pixel(uint8_t x, uint8_t y, uint8_t colour);
+
+const char graphics_bench_name[] PROGMEM = "graphics";
+
+/* text drawn by putStr */
+char graphics_bench_string[] = "Hello";
+
+#ifdef BENCH_SIM
+/* bytes in the frame */
+#define GRAPHICS_BENCH_FRAME (SSD1306_GRAPHICS_MAX_X * SSD1306_GRAPHICS_MAX_Y / 8)
+
+/* the frame while the touched bytes are found, the frame after the run on
+   0s, and the sum of the touched bytes over the runs */
+uint8_t graphics_bench_saved[GRAPHICS_BENCH_FRAME],
+        graphics_bench_zeros[GRAPHICS_BENCH_FRAME];
+uint32_t graphics_bench_touched = 0;
+
+/*
+ * graphics_bench_fill()
+ * graphics_bench_refill()
+ * graphics_bench_count()
+ *
+ * Find the bytes a run writes: graphics_bench_fill() saves the frame and fills
+ * it with 0s, graphics_bench_refill() keeps what the run left and fills it with
+ * 1s, graphics_bench_count() adds up the bytes either run wrote and puts the
+ * frame back.
+ */
+void graphics_bench_fill(void)
+{
+
+  memcpy(graphics_bench_saved, graphics_get_frame(), graphics_frame_size());
+  memset(graphics_get_frame(), 0x00, graphics_frame_size());
+
+}/* end graphics_bench_fill() */
+
+void graphics_bench_refill(void)
+{
+
+  memcpy(graphics_bench_zeros, graphics_get_frame(), graphics_frame_size());
+  memset(graphics_get_frame(), 0xff, graphics_frame_size());
+
+}/* end graphics_bench_refill() */
+
+void graphics_bench_count(void)
+{
+  uint8_t *frame = graphics_get_frame();
+  uint16_t i;
+
+  for(i = 0; i < graphics_frame_size(); i++)
+  {
+    if((graphics_bench_zeros[i] != 0x00) || (frame[i] != 0xff))
+    {
+      graphics_bench_touched++;
+    }
+  }
+  memcpy(frame, graphics_bench_saved, graphics_frame_size());
+
+}/* end graphics_bench_count() */
+
+/*
+ * graphics_bench_touched_report()
+ *
+ * Give the next report the bytes touched by a run, averaged over the runs,
+ * and clear the profiler table of the runs made to find them.
+ */
+void graphics_bench_touched_report(void)
+{
+
+  bench_touched(graphics_bench_touched / BENCH_RUNS);
+  graphics_bench_touched = 0;
+  prof_reset();
+
+}/* end graphics_bench_touched_report() */
+
+/* Find the bytes a run of the case writes, see GRAPHICS_BENCH_CASE(). */
+#define GRAPHICS_BENCH_TOUCHES(setup, stmt) \
+  do { \
+    for(i = 0; i < BENCH_RUNS; i++) \
+    { \
+      graphics_bench_fill(); setup; stmt; \
+      graphics_bench_refill(); setup; stmt; \
+      graphics_bench_count(); \
+    } \
+    graphics_bench_touched_report(); \
+  } while(0)
+
+#else
+
+#define GRAPHICS_BENCH_TOUCHES(setup, stmt)
+
+#endif /* BENCH_SIM */
+
+/* BENCH_RUNS timed runs of a drawing case, with the case's uint8_t i as the
+   run, and on the simulation the bytes they touch.  setup puts back the state
+   a run changes (the cursor) before each one and can be empty. */
+#define GRAPHICS_BENCH_CASE(setup, stmt) \
+  do { \
+    GRAPHICS_BENCH_TOUCHES(setup, stmt); \
+    for(i = 0; i < BENCH_RUNS; i++) \
+    { \
+      setup; \
+      BENCH_TIME(stmt); \
+    } \
+  } while(0)
+
+/*
+ * graphics_bench_verify()
+ *
+ * On the simulation, check the display RAM is the same as the frame.
+ */
+void graphics_bench_verify(const char *name)
+{
+#ifdef BENCH_SIM
+
+  if(memcmp(sim_ssd1306_ram(SIM_SSD1306_I2C_3C), graphics_get_frame(),
+            graphics_frame_size()) != 0)
+  {
+    uart_putstr_P(PSTR("verify,"));
+    uart_putstr_P(name);
+    uart_putstr_P(PSTR(",display RAM differs from the frame\r\n"));
+  }
+
+#else
+  (void)name;
+#endif
+
+}/* end graphics_bench_verify() */
+
+/*
+ * graphics_bench_pixels()
+ *
+ * plot_pixel() in each colour, over a diagonal so each run is a new byte.
+ */
+void graphics_bench_pixels(void)
+{
+  uint8_t colour, i;
+
+  for(colour = GRAPHICS_COLOUR_BLACK; colour < GRAPHICS_COLOUR_MAX; colour++)
+  {
+    GRAPHICS_BENCH_CASE(, plot_pixel(i * 3, i * 2, colour));
+    bench_report_P(graphics_bench_name, PSTR("plot_pixel"), colour);
+  }
+
+}/* end graphics_bench_pixels() */
+
+/*
+ * graphics_bench_shapes()
+ *
+ * Lines, circles and filled rectangles of a few sizes.
+ */
+void graphics_bench_shapes(void)
+{
+  uint8_t len, i;
+
+  for(len = 8; len <= 64; len *= 2)
+  {
+    GRAPHICS_BENCH_CASE(, graphics_draw_line(0, i, len - 1, i));
+    bench_report_P(graphics_bench_name, PSTR("line_h"), len);
+
+    GRAPHICS_BENCH_CASE(, graphics_draw_line(i, 0, i, len - 1));
+    bench_report_P(graphics_bench_name, PSTR("line_v"), len);
+
+    GRAPHICS_BENCH_CASE(, graphics_draw_line(i, 0, i + len - 1, len - 1));
+    bench_report_P(graphics_bench_name, PSTR("line_diag"), len);
+  }
+
+  for(len = 4; len <= 31; len = len * 2 - 1)
+  {
+    GRAPHICS_BENCH_CASE(, graphics_draw_circle(64, 32, len));
+    bench_report_P(graphics_bench_name, PSTR("circle"), len);
+  }
+
+  for(len = 8; len <= 64; len *= 2)
+  {
+    GRAPHICS_BENCH_CASE(, graphics_draw_filled_rectangle(i, 0, i + len - 1,
+                                                        len - 1));
+    bench_report_P(graphics_bench_name, PSTR("filled_rect"), len);
+  }
+
+}/* end graphics_bench_shapes() */
+
+/*
+ * graphics_bench_text()
+ *
+ * putChar and putStr at each text size and rotation, from the middle of the
+ * frame so every rotation has room.
+ */
+void graphics_bench_text(void)
+{
+  uint8_t size, rot, i;
+  char chr[] = "putChar_s1_r0",
+       str[] = "putStr_s1_r0";
+
+  for(size = 1; size <= 4; size++)
+  {
+    for(rot = GRAPHICS_ROTATION_0; rot < GRAPHICS_ROTATION_MAX; rot++)
+    {
+      graphics_set_text_size(size);
+      graphics_set_rotation(rot);
+      chr[9] = str[8] = '0' + size;
+      chr[12] = str[11] = '0' + rot;
+
+      GRAPHICS_BENCH_CASE(graphics_set_cursor(40, 24),
+                          graphics_putChar('A' + i));
+        bench_nested(PROF_ID_PUTCHAR);
+      bench_report(graphics_bench_name, chr, 1);
+
+      GRAPHICS_BENCH_CASE(graphics_set_cursor(40, 24),
+                          graphics_putStr(graphics_bench_string));
+        bench_nested(PROF_ID_PUTCHAR);
+      bench_report(graphics_bench_name, str,
+                   sizeof(graphics_bench_string) - 1);
+    }
+  }
+
+  graphics_set_text_size(1);
+  graphics_set_rotation(GRAPHICS_ROTATION_0);
+
+}/* end graphics_bench_text() */
+
+/*
+ * graphics_bench_update()
+ *
+ * graphics_clear(), and sending the whole frame against sending just what
+ * changed.
+ */
+void graphics_bench_update(void)
+{
+  uint8_t i;
+
+  GRAPHICS_BENCH_CASE(, graphics_clear());
+  bench_report_P(graphics_bench_name, PSTR("clear"), 0);
+
+  for(i = 0; i < BENCH_RUNS; i++)
+  {
+    plot_pixel(i, i, GRAPHICS_COLOUR_INVERSE);
+    BENCH_TIME(ssd1306_i2c_graphics_update());
+  }
+  bench_nested(PROF_ID_SSD1306_UPDATE);
+  bench_nested(PROF_ID_TWI_ISR);
+  bench_report_P(graphics_bench_name, PSTR("update_full"),
+                 graphics_frame_size());
+  graphics_bench_verify(PSTR("update_full"));
+
+  for(i = 0; i < BENCH_RUNS; i++)
+  {
+    BENCH_TIME(ssd1306_i2c_graphics_update_dirty());
+  }
+  bench_nested(PROF_ID_TWI_ISR);
+  bench_report_P(graphics_bench_name, PSTR("update_dirty_none"), 0);
+
+  for(i = 0; i < BENCH_RUNS; i++)
+  {
+    graphics_set_cursor(6 * i, 8 * (i & 7));
+    graphics_putChar('0' + i);
+    BENCH_TIME(ssd1306_i2c_graphics_update_dirty());
+  }
+  bench_nested(PROF_ID_TWI_ISR);
+  bench_report_P(graphics_bench_name, PSTR("update_dirty_char"), 0);
+  graphics_bench_verify(PSTR("update_dirty_char"));
+
+  for(i = 0; i < BENCH_RUNS; i++)
+  {
+    graphics_set_bg_colour((i & 1) ? GRAPHICS_COLOUR_BLACK :
+                                     GRAPHICS_COLOUR_WHITE);
+    graphics_clear();
+    BENCH_TIME(ssd1306_i2c_graphics_update_dirty());
+  }
+  bench_nested(PROF_ID_TWI_ISR);
+  bench_report_P(graphics_bench_name, PSTR("update_dirty_all"), 0);
+  graphics_bench_verify(PSTR("update_dirty_all"));
+
+}/* end graphics_bench_update() */
+
+int main(void)
+{
+
+  bench_init();
+  i2c_init(400000);
+  if(graphics_init(SSD1306_GRAPHICS_MAX_X, SSD1306_GRAPHICS_MAX_Y) != 0)
+  {
+    uart_putstr_P(PSTR("no memory for the frame\r\n"));
+    bench_done();
+    return(1);
+  }
+  ssd1306_i2c_init();
+  graphics_set_fg_colour(GRAPHICS_COLOUR_WHITE);
+  graphics_set_bg_colour(GRAPHICS_COLOUR_BLACK);
+
+  graphics_bench_pixels();
+  graphics_bench_shapes();
+  graphics_bench_text();
+  graphics_bench_update();
+
+  bench_done();
+  return(0);
+
+}/* end main() */
@@ -6,6 +6,7 @@
  * Driver functions for Honeywell HMC5883L triple-axis magnetometer.
  *
  * The register descriptions are take from the data sheet for the magnetometer.
+ * The slave address and register addresses are in hmc5883.h.
  *
  * This file is free software; you can redistribute it and/or modify
  * it under the terms of either the GNU General Public License version 3
@@ -13,13 +14,13 @@
  * published by the Free Software Foundation.
  */
 #include <i2c/i2c.h>
+#include <hmc5883/hmc5883.h>
 
 /*******************************************************************************
  * device slave address = 0x1e
  *
  * shifted 1 bit left: 0x3c
  */
-#define HMC5883SlaveAdrs 0x1e
 
 /*******************************************************************************
  * Configuration Register A
@@ -61,7 +62,6 @@
  *            | load for all three axes.
  *         11 | reserved
  */
-#define HMC5883_CRA 0x00
 
 /*******************************************************************************
  * Configuration Register B
@@ -96,7 +96,6 @@
  *  110  |  ± 5.6 Ga   |   330  |    3.03    | 0xF800–0x07FF (-2048–2047)
  *  111  |  ± 8.1 Ga   |   230  |    4.35    | 0xF800–0x07FF (-2048–2047)
  */
-#define HMC5883_CRB 0x01
 
 /*******************************************************************************
  * Mode Register
@@ -127,7 +126,6 @@
  *       - 11 Idle Mode.
  *
  */
-#define HMC5883_MODE 0x02
 #define HMC_MODE_CONT 0b00000000
 #define HMC_MODE_SNGL 0b00000001
 #define HMC_MODE_IDLE 0b00000011
@@ -147,9 +145,6 @@
  * read. This requirement also impacts DRDY pin and RDY bit in the Status register,
 *  which cannot be cleared until new data is placed in all the output registers.
  */
-#define HMC5883_DATAX 0x03
-#define HMC5883_DATAY 0x05
-#define HMC5883_DATAZ 0x07
 
 /*******************************************************************************
  * Status Register
@@ -179,7 +174,6 @@
  *        remain cleared for a 250 µs. DRDY pin can be used as an alternative to 
  *        the status register for monitoring the device for measurement data.
  */
-#define HMC5883_STATUS 0x09
 
 /*******************************************************************************
  * Identification Registers
@@ -191,9 +185,6 @@
  * B - 00110100
  * C - 00110011
  */
-#define HMC5883_IDA 0x0a
-#define HMC5883_IDB 0x0b
-#define HMC5883_IDC 0x0c
 
 /*
  * hmc5883_init()
@@ -246,49 +237,63 @@ uint8_t hmc5883_getStatus(void)
 
 }/* end hmc5883_getStatus() */
 
+/* X, Y, Z magnetometer data from the last hmc5883_update() */
+int16_t hmc5883_data[3] = {0, 0, 0};
+
+/*
+ * hmc5883_update()
+ *
+ * Read the magnetometer data of all three axes in one transaction and keep it
+ * for hmc5883_getXData(), hmc5883_getYData() and hmc5883_getZData().  Reading
+ * all six data registers at once also lets the device put new data in them.
+ * Returns the I2C result code, the last data is kept on an error.
+ */
+uint8_t hmc5883_update(void)
+{
+  uint8_t buf[6], err;
+
+  err = i2c_read(HMC5883SlaveAdrs, 6, HMC5883_DATAX, buf);
+  if(err == I2C_OK)
+  {
+    /* the device sends X, Z, Y */
+    hmc5883_data[0] = (int16_t)buf[0]<<8;
+    hmc5883_data[0] += (int16_t)buf[1];
+    hmc5883_data[2] = (int16_t)buf[2]<<8;
+    hmc5883_data[2] += (int16_t)buf[3];
+    hmc5883_data[1] = (int16_t)buf[4]<<8;
+    hmc5883_data[1] += (int16_t)buf[5];
+  }
+
+  return(err);
+
+}/* end hmc5883_update() */
+
 /*
  * hmc5883_getXData()
  * hmc5883_getYData()
  * hmc5883_getZData()
  *
- * Return the magnetometer data (2 bytes) from each of the three axes.
+ * Return the magnetometer data of each of the three axes read by the last
+ * hmc5883_update().
  */
 int16_t hmc5883_getXData(void)
 {
-  int16_t data;
-  uint8_t buf[2];
-
-  i2c_read(HMC5883SlaveAdrs, 2, HMC5883_DATAX, buf);
-  data = (int16_t)buf[0]<<8;
-  data += (int16_t)buf[1];
 
-  return(data);
+  return(hmc5883_data[0]);
 
 }/* end hmc5883_getXData() */
 
 int16_t hmc5883_getYData(void)
 {
-  int16_t data;
-  uint8_t buf[2];
 
-  i2c_read(HMC5883SlaveAdrs, 2, HMC5883_DATAY, buf);
-  data = (int16_t)buf[0]<<8;
-  data += (int16_t)buf[1];
-
-  return(data);
+  return(hmc5883_data[1]);
 
 }/* end hmc5883_getYData() */
 
 int16_t hmc5883_getZData(void)
 {
-  int16_t data;
-  uint8_t buf[2];
-
-  i2c_read(HMC5883SlaveAdrs, 2, HMC5883_DATAZ, buf);
-  data = (int16_t)buf[0]<<8;
-  data += (int16_t)buf[1];
 
-  return(data);
+  return(hmc5883_data[2]);
 
 }/* end hmc5883_getZData() */
 
@@ -296,7 +301,7 @@ int16_t hmc5883_getZData(void)
  * hmc5883_getMagData()
  *
  * Write the magnetometer data (6 bytes) of all three axes into the buffer
- * pointed to by buf.
+ * pointed to by buf.  The device stores them in the order X, Z, Y.
  *
  * Note: ensure the buffer is large enough to hold 6 bytes of data.
  */
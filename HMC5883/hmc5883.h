@@ -15,6 +15,26 @@
 #ifndef _HMC5883_H_
 #define _HMC5883_H_ 1
 
+/*
+ * Slave address and register addresses, the registers are described in
+ * hmc5883.c.
+ */
+#define HMC5883SlaveAdrs 0x1e
+#define HMC5883_CRA      0x00
+#define HMC5883_CRB      0x01
+#define HMC5883_MODE     0x02
+#define HMC5883_DATAX    0x03
+#define HMC5883_DATAZ    0x05
+#define HMC5883_DATAY    0x07
+#define HMC5883_STATUS   0x09
+#define HMC5883_IDA      0x0a
+#define HMC5883_IDB      0x0b
+#define HMC5883_IDC      0x0c
+
+/* Status register bits. */
+#define HMC5883_STATUS_LOCK 0b00000010
+#define HMC5883_STATUS_RDY  0b00000001
+
 /*********************************************************************************
  * Configuration Register A
  *
@@ -153,8 +173,9 @@
 /* function prototypes */
 void hmc5883_init(uint8_t cra, uint8_t crb, uint8_t mode);
 
-char hmc5883_getStatus(void);
+uint8_t hmc5883_getStatus(void);
 
+uint8_t hmc5883_update(void);
 int16_t hmc5883_getXData(void);
 int16_t hmc5883_getYData(void);
 int16_t hmc5883_getZData(void);
@@ -0,0 +1,313 @@
+/*
+ * File:      hmc5883_drdy.c
+ * Date:      October 14, 2026
+ * Author:    Craig Hollinger
+ *
+ * Data ready driven acquisition for the Honeywell HMC5883L triple-axis
+ * magnetometer.
+ *
+ * The DRDY pin is pulled low for 250us when the device has placed a new
+ * measurement in the data output registers.  The falling edge on INT0 or INT1
+ * queues an I2C read of all six of them, and the transaction callback
+ * calibrates the sample and puts it in the ring.  Everything after the edge
+ * runs from interrupts, the bus only carries the data reads.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <i2c/i2c.h>
+#include <hmc5883/hmc5883.h>
+#include <hmc5883/hmc5883_drdy.h>
+
+#if (HMC5883_DRDY_RING & (HMC5883_DRDY_RING - 1)) != 0 || HMC5883_DRDY_RING > 128
+#error "HMC5883_DRDY_RING must be a power of 2, no more than 128"
+#endif
+
+/* The external interrupt and pin DRDY is wired to. */
+#if HMC5883_DRDY_INT == 0
+#define HMC5883_DRDY_vect INT0_vect
+#define HMC5883_DRDY_MASK (1<<INT0)
+#define HMC5883_DRDY_ISC  (1<<ISC01)
+#define HMC5883_DRDY_ISCM ((1<<ISC01) | (1<<ISC00))
+#define HMC5883_DRDY_PIN  PD2
+#elif HMC5883_DRDY_INT == 1
+#define HMC5883_DRDY_vect INT1_vect
+#define HMC5883_DRDY_MASK (1<<INT1)
+#define HMC5883_DRDY_ISC  (1<<ISC11)
+#define HMC5883_DRDY_ISCM ((1<<ISC11) | (1<<ISC10))
+#define HMC5883_DRDY_PIN  PD3
+#else
+#error "HMC5883_DRDY_INT must be 0 or 1"
+#endif
+
+I2C_TRANSACTION_TYPE hmc5883_drdy_trans;
+uint8_t hmc5883_drdy_raw[6];
+
+int16_t hmc5883_ring[HMC5883_DRDY_RING][3];
+volatile uint8_t hmc5883_ring_head = 0,
+                 hmc5883_ring_tail = 0;
+volatile uint8_t hmc5883_drdy_errors = 0;
+
+/* calibration: 0 = none, 1 = offset only, 2 = offset and matrix */
+uint8_t hmc5883_cal_mode = 0;
+int16_t hmc5883_cal_offset[3];
+int16_t hmc5883_cal_matrix[3][3];
+
+/*
+ * hmc5883_drdy_calibrate()
+ *
+ * Apply the hard-iron offset and soft-iron matrix to sample in place.
+ */
+void hmc5883_drdy_calibrate(int16_t sample[3])
+{
+  int16_t v[3];
+  int32_t sum;
+  uint8_t i, j;
+
+  for(i = 0; i < 3; i++)
+  {
+    v[i] = sample[i] - hmc5883_cal_offset[i];
+  }
+
+  if(hmc5883_cal_mode < 2)
+  {
+    for(i = 0; i < 3; i++)
+    {
+      sample[i] = v[i];
+    }
+    return;
+  }
+
+  for(i = 0; i < 3; i++)
+  {
+    sum = 0;
+    for(j = 0; j < 3; j++)
+    {
+      sum += (int32_t)hmc5883_cal_matrix[i][j] * v[j];
+    }
+    sum /= HMC5883_CAL_ONE;
+    if(sum > INT16_MAX)
+    {
+      sum = INT16_MAX;
+    }
+    else if(sum < INT16_MIN)
+    {
+      sum = INT16_MIN;
+    }
+    sample[i] = (int16_t)sum;
+  }
+
+}/* end hmc5883_drdy_calibrate() */
+
+/*
+ * hmc5883_drdy_done()
+ *
+ * Callback of the data read: put the sample, X, Y, Z, in the ring.
+ */
+void hmc5883_drdy_done(I2C_TRANSACTION_TYPE *trans)
+{
+  int16_t *sample;
+  uint8_t head;
+
+  head = (hmc5883_ring_head + 1) & (HMC5883_DRDY_RING - 1);
+  if(trans->status != I2C_OK || head == hmc5883_ring_tail)
+  {
+    hmc5883_drdy_errors++;
+    return;
+  }
+
+  /* the device sends X, Z, Y */
+  sample = hmc5883_ring[hmc5883_ring_head];
+  sample[0] = (int16_t)(((uint16_t)hmc5883_drdy_raw[0] << 8) | hmc5883_drdy_raw[1]);
+  sample[2] = (int16_t)(((uint16_t)hmc5883_drdy_raw[2] << 8) | hmc5883_drdy_raw[3]);
+  sample[1] = (int16_t)(((uint16_t)hmc5883_drdy_raw[4] << 8) | hmc5883_drdy_raw[5]);
+
+  if(hmc5883_cal_mode != 0)
+  {
+    hmc5883_drdy_calibrate(sample);
+  }
+
+  hmc5883_ring_head = head;
+
+}/* end hmc5883_drdy_done() */
+
+/*
+ * hmc5883_drdy_read()
+ *
+ * Queue a read of the data registers, unless the last one is still going.
+ */
+void hmc5883_drdy_read(void)
+{
+
+  if(hmc5883_drdy_trans.status == I2C_BUSY ||
+     i2c_transaction(&hmc5883_drdy_trans) != 0)
+  {
+    hmc5883_drdy_errors++;
+  }
+
+}/* end hmc5883_drdy_read() */
+
+/*
+ * ISR(HMC5883_DRDY_vect)
+ *
+ * DRDY has gone low, a new sample is in the data registers.
+ */
+ISR(HMC5883_DRDY_vect)
+{
+
+  hmc5883_drdy_read();
+
+}/* end ISR(HMC5883_DRDY_vect) */
+
+/*
+ * hmc5883_initDrdy()
+ *
+ * Start data ready driven acquisition.  Set the magnetometer up for
+ * continuous-measurement mode first with hmc5883_init(), and the I2C bus with
+ * i2c_init().  Global interrupts must be enabled.
+ *
+ * The data registers are read once straight away, in case the device was
+ * holding a sample (it won't measure again until it has been read).
+ */
+void hmc5883_initDrdy(void)
+{
+  uint8_t sreg;
+
+  hmc5883_drdy_trans.slvAdrs = HMC5883SlaveAdrs;
+  hmc5883_drdy_trans.adrs = HMC5883_DATAX;
+  hmc5883_drdy_trans.len = 6;
+  hmc5883_drdy_trans.dir = I2C_DIR_READ;
+  hmc5883_drdy_trans.buf = hmc5883_drdy_raw;
+  hmc5883_drdy_trans.callback = hmc5883_drdy_done;
+  hmc5883_drdy_trans.status = I2C_OK;
+
+  /* DRDY is an input with the pull-up on */
+  DDRD &= ~(1<<HMC5883_DRDY_PIN);
+  PORTD |= (1<<HMC5883_DRDY_PIN);
+
+  sreg = SREG;
+  cli();
+  hmc5883_ring_head = 0;
+  hmc5883_ring_tail = 0;
+  hmc5883_drdy_errors = 0;
+
+  /* interrupt on the falling edge */
+  EICRA = (EICRA & ~HMC5883_DRDY_ISCM) | HMC5883_DRDY_ISC;
+  EIFR = HMC5883_DRDY_MASK;
+  EIMSK |= HMC5883_DRDY_MASK;
+
+  hmc5883_drdy_read();
+  SREG = sreg;
+
+}/* end hmc5883_initDrdy() */
+
+/*
+ * hmc5883_stopDrdy()
+ *
+ * Stop taking samples.  Samples already in the ring can still be read.
+ */
+void hmc5883_stopDrdy(void)
+{
+
+  EIMSK &= ~HMC5883_DRDY_MASK;
+
+}/* end hmc5883_stopDrdy() */
+
+/*
+ * hmc5883_samplesReady()
+ *
+ * Returns the number of samples waiting in the ring.
+ */
+uint8_t hmc5883_samplesReady(void)
+{
+
+  return((hmc5883_ring_head - hmc5883_ring_tail) & (HMC5883_DRDY_RING - 1));
+
+}/* end hmc5883_samplesReady() */
+
+/*
+ * hmc5883_getSample()
+ *
+ * Take the oldest sample from the ring and write it to sample as X, Y, Z.
+ * Returns 1 if there was one, 0 if the ring was empty.
+ */
+uint8_t hmc5883_getSample(int16_t sample[3])
+{
+  uint8_t tail, i;
+
+  tail = hmc5883_ring_tail;
+  if(tail == hmc5883_ring_head)
+  {
+    return(0);
+  }
+
+  for(i = 0; i < 3; i++)
+  {
+    sample[i] = hmc5883_ring[tail][i];
+  }
+  hmc5883_ring_tail = (tail + 1) & (HMC5883_DRDY_RING - 1);
+
+  return(1);
+
+}/* end hmc5883_getSample() */
+
+/*
+ * hmc5883_getDrdyErrors()
+ *
+ * Returns the number of samples lost since the last call, because the ring
+ * was full, the last read hadn't finished or the read failed.
+ */
+uint8_t hmc5883_getDrdyErrors(void)
+{
+  uint8_t sreg, errors;
+
+  sreg = SREG;
+  cli();
+  errors = hmc5883_drdy_errors;
+  hmc5883_drdy_errors = 0;
+  SREG = sreg;
+
+  return(errors);
+
+}/* end hmc5883_getDrdyErrors() */
+
+/*
+ * hmc5883_setCalibration()
+ *
+ * Set the hard-iron offset (raw units) and soft-iron matrix (HMC5883_CAL_ONE
+ * is 1.0) applied to each new sample.  matrix can be 0 for the offset only.
+ */
+void hmc5883_setCalibration(const int16_t offset[3], const int16_t matrix[3][3])
+{
+  uint8_t sreg, i, j;
+
+  sreg = SREG;
+  cli();
+  for(i = 0; i < 3; i++)
+  {
+    hmc5883_cal_offset[i] = offset[i];
+    for(j = 0; matrix != 0 && j < 3; j++)
+    {
+      hmc5883_cal_matrix[i][j] = matrix[i][j];
+    }
+  }
+  hmc5883_cal_mode = (matrix != 0) ? 2 : 1;
+  SREG = sreg;
+
+}/* end hmc5883_setCalibration() */
+
+/*
+ * hmc5883_clearCalibration()
+ *
+ * Put raw samples in the ring from now on.
+ */
+void hmc5883_clearCalibration(void)
+{
+
+  hmc5883_cal_mode = 0;
+
+}/* end hmc5883_clearCalibration() */
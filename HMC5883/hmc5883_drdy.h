@@ -0,0 +1,100 @@
+/*
+ * File:      hmc5883_drdy.h
+ * Date:      October 14, 2026
+ * Author:    Craig Hollinger
+ *
+ * Public interface for the data ready driven acquisition of the Honeywell
+ * HMC5883L triple-axis magnetometer.
+ *
+ * The DRDY pin of the magnetometer is wired to INT0 (PD2) or INT1 (PD3), set
+ * by HMC5883_DRDY_INT.  Each falling edge queues a read of the six data
+ * registers on the interrupt driven I2C engine, and the sample lands in a
+ * small ring.  There is no polling of the Status register, and a sample is
+ * available at most one conversion period after it was measured.
+ *
+ * A hard-iron offset and a soft-iron matrix can be applied to each sample as
+ * it arrives:
+ *
+ *   sample = matrix * (raw - offset) / HMC5883_CAL_ONE
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#ifndef _HMC5883_DRDY_H_
+#define _HMC5883_DRDY_H_ 1
+
+#include <stdint.h>
+
+/* External interrupt the DRDY pin is wired to, 0 (PD2) or 1 (PD3). */
+#ifndef HMC5883_DRDY_INT
+#define HMC5883_DRDY_INT 0
+#endif
+
+/* Number of samples the ring holds, must be a power of 2. */
+#ifndef HMC5883_DRDY_RING
+#define HMC5883_DRDY_RING 4
+#endif
+
+/* Soft-iron matrix entries are fixed point, this is 1.0. */
+#define HMC5883_CAL_ONE 4096
+
+/*
+ * hmc5883_initDrdy()
+ *
+ * Start data ready driven acquisition.  Set the magnetometer up for
+ * continuous-measurement mode first with hmc5883_init(), and the I2C bus with
+ * i2c_init().  Global interrupts must be enabled.
+ *
+ * The data registers are read once straight away, in case the device was
+ * holding a sample (it won't measure again until it has been read).
+ */
+void hmc5883_initDrdy(void);
+
+/*
+ * hmc5883_stopDrdy()
+ *
+ * Stop taking samples.  Samples already in the ring can still be read.
+ */
+void hmc5883_stopDrdy(void);
+
+/*
+ * hmc5883_samplesReady()
+ *
+ * Returns the number of samples waiting in the ring.
+ */
+uint8_t hmc5883_samplesReady(void);
+
+/*
+ * hmc5883_getSample()
+ *
+ * Take the oldest sample from the ring and write it to sample as X, Y, Z.
+ * Returns 1 if there was one, 0 if the ring was empty.
+ */
+uint8_t hmc5883_getSample(int16_t sample[3]);
+
+/*
+ * hmc5883_getDrdyErrors()
+ *
+ * Returns the number of samples lost since the last call, because the ring
+ * was full, the last read hadn't finished or the read failed.
+ */
+uint8_t hmc5883_getDrdyErrors(void);
+
+/*
+ * hmc5883_setCalibration()
+ *
+ * Set the hard-iron offset (raw units) and soft-iron matrix (HMC5883_CAL_ONE
+ * is 1.0) applied to each new sample.  matrix can be 0 for the offset only.
+ */
+void hmc5883_setCalibration(const int16_t offset[3], const int16_t matrix[3][3]);
+
+/*
+ * hmc5883_clearCalibration()
+ *
+ * Put raw samples in the ring from now on.
+ */
+void hmc5883_clearCalibration(void);
+
+#endif /* _HMC5883_DRDY_H_ */
@@ -6,8 +6,27 @@
  * Description:
  *
  * This file contains driver routines to control the processor's peripheral I2C
- * interface.  All these functions are blocking, they won't return until the
- * TWI has completed it's current function, or an error has occurred.
+ * interface.  The single byte functions are blocking, they won't return until
+ * the TWI has completed it's current function, or an error has occurred.
+ *
+ * Complete transactions are run by a state machine in the TWI interrupt.  The
+ * caller fills in a transaction descriptor, hands it to i2c_transaction() and
+ * carries on.  The interrupt walks through the Start, slave address, register
+ * address, data and Stop steps one at a time as the TWI finishes each of them,
+ * then reports the result through the descriptor.  i2c_read() and i2c_write()
+ * are built on top of this and simply wait for their transaction to finish.
+ *
+ * Transactions posted while the bus is in use wait in a small queue and are
+ * started by the interrupt one after the other, so several drivers can share
+ * the bus without waiting on each other.
+ *
+ * The single byte functions drive the TWI directly.  They are used between
+ * i2c_claim() and i2c_release(), which keep the transaction engine off the bus
+ * in the meantime.
+ *
+ * None of the waits are open ended.  If the TWI doesn't finish a step within
+ * I2C_TIMEOUT_LOOPS passes the bus is assumed stuck: i2c_recover() clocks it
+ * free and the caller gets I2C_ERR_TIMEOUT.
  * 
  * Some of these functions are based on ideas from example software included
  * with the WinAVR compiler.
@@ -19,81 +38,221 @@
  */
 
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include <util/twi.h>
+#include <util/delay.h>
+#include "i2c/i2c.h"
+#include "prof/prof.h"
+#include "prof/trace.h"
 
 #define MAX_RESTARTS 20
 
+/* Number of times a wait loop checks the TWI before giving up.  Each pass takes
+   about 8 CPU cycles so the default is about 1ms, much longer than one byte
+   takes at 100kHz. */
+#ifndef I2C_TIMEOUT_LOOPS
+#define I2C_TIMEOUT_LOOPS (F_CPU / 8000UL)
+#endif
+
+/* Pins used by the TWI, needed to clear the pull ups in i2c_init() and to
+   clock the bus by hand in i2c_recover().  They are fixed by the part, the
+   registers and bits are constants so these compile to in, out, sbi and cbi. */
+#ifndef I2C_PORT
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+#define I2C_PORT PORTD
+#define I2C_DDR  DDRD
+#define I2C_PIN  PIND
+#define I2C_SDA  PORTD1
+#define I2C_SCL  PORTD0
+#elif defined(__AVR_ATmega644P__) || defined(__AVR_ATmega1284P__)
+#define I2C_PORT PORTC
+#define I2C_DDR  DDRC
+#define I2C_PIN  PINC
+#define I2C_SDA  PORTC1
+#define I2C_SCL  PORTC0
+#else /* ATmega48/88/168/328 */
+#define I2C_PORT PORTC
+#define I2C_DDR  DDRC
+#define I2C_PIN  PINC
+#define I2C_SDA  PORTC4
+#define I2C_SCL  PORTC5
+#endif
+#endif
+
+/* Half of one SCL period in microseconds while recovering the bus (100kHz). */
+#define I2C_RECOVER_DELAY 5
+
+/* TWCR value to carry on with the next step of a transaction, the interrupt
+   stays enabled. */
+#define I2C_TWCR_NEXT (_BV(TWINT) | _BV(TWEN) | _BV(TWIE))
+
+/* Mask for the transaction queue indices, I2C_QUEUE_LENGTH is a power of 2. */
+#define I2C_QUEUE_MASK (I2C_QUEUE_LENGTH - 1)
+
+/* Local variables for the interrupt driven transaction engine. */
+I2C_TRANSACTION_TYPE * volatile i2c_current = 0;/* transaction being run */
+volatile uint8_t i2c_index = 0,/* count of data bytes transferred */
+                 i2c_restarts = 0,/* retries left before giving up */
+                 i2c_read_phase = 0,/* 1 once the repeated Start of a read is sent */
+                 i2c_progress = 0,/* counts the steps taken by the state machine */
+                 i2c_watch_progress = 0,/* i2c_progress at the last i2c_watchdog() */
+                 i2c_claimed = 0;/* 1 between i2c_claim() and i2c_release() */
+
+/* First error seen by the single byte functions since the last i2c_start(). */
+uint8_t i2c_error = I2C_OK;
+
+/* Queue of transactions waiting for the bus.  The indices are free running, the
+   number of entries in the queue is head - tail. */
+I2C_TRANSACTION_TYPE * volatile i2c_queue[I2C_QUEUE_LENGTH];
+volatile uint8_t i2c_queue_head = 0,/* where the next transaction is put */
+                 i2c_queue_tail = 0;/* where the next transaction is taken */
+
 /*
  * i2c_init()
  *
  * Set up the TWI module in the processor for I2C master mode.  SCL rate will 
  * be a maximum of 400kHz if the CPU frequency is > 1.6MHz.
+ *
+ * The bit rate is worked out here with a 32-bit division, when the speed is a
+ * constant i2c_init_twbr(I2C_TWBR(speed)) does it at compile time instead.
  */
 
 void i2c_init(unsigned long i2c_speed)
 {
 
-  DDRC &= 0b11001111; /* make SDA and SCL inputs */
-  PORTC &= 0b11001111;/* disable internal pullups on SDA and SCL */
-  
-  TWSR = 0; /*clear the prescaler bits: prescale = 1 */
-
 #if F_CPU < 1600000UL
-  TWBR = 0;
+  (void)i2c_speed;
+  i2c_init_twbr(0);
 #else
-  TWBR = ((F_CPU / i2c_speed) - 16) / 2;
+  i2c_init_twbr(((F_CPU / i2c_speed) - 16) / 2);
 #endif
 
+}/* end i2c_init() */
+
+/*
+ * i2c_init_twbr()
+ *
+ * Set up the TWI module in the processor for I2C master mode with twbr in the
+ * bit rate register, see I2C_TWBR().
+ */
+void i2c_init_twbr(uint8_t twbr)
+{
+
+  I2C_DDR &= ~(_BV(I2C_SDA) | _BV(I2C_SCL)); /* make SDA and SCL inputs */
+  I2C_PORT &= ~(_BV(I2C_SDA) | _BV(I2C_SCL));/* disable internal pullups */
+  
+  TWSR = 0; /*clear the prescaler bits: prescale = 1 */
+  TWBR = twbr;
+
   TWCR = _BV(TWEN); /* enable the TWI */
 
-}/* end i2c_init() */
+  i2c_current = 0;
+  i2c_queue_head = 0;
+  i2c_queue_tail = 0;
+
+}/* end i2c_init_twbr() */
+
+/*
+ * i2c_wait_twint()
+ *
+ * Wait for the TWI to finish its current step.  Returns I2C_ERR_TIMEOUT if it
+ * hasn't finished in time, in which case the bus is recovered.
+ */
+uint8_t i2c_wait_twint(void)
+{
+  uint16_t budget = I2C_TIMEOUT_LOOPS;
+
+  while((TWCR & _BV(TWINT)) == 0) /* wait for transmission */
+  {
+    if(--budget == 0)
+    {
+      i2c_recover();
+      return(I2C_ERR_TIMEOUT);
+    }
+  }
+
+  return(I2C_OK);
+
+}/* end i2c_wait_twint() */
+
+/*
+ * i2c_set_error()
+ *
+ * Keep the first error seen since the last i2c_start(), it is returned by
+ * i2c_stop().  Returns err.
+ */
+uint8_t i2c_set_error(uint8_t err)
+{
+
+  if(i2c_error == I2C_OK)
+  {
+    i2c_error = err;
+  }
+
+  return(err);
+
+}/* end i2c_set_error() */
 
 /*
  * i2c_start()
  *
- * Generate a Start condition on the I2C bus.  Returns an error code if the bus 
- * is not idle.
+ * Generate a Start condition on the I2C bus.  Returns I2C_OK, I2C_ERR_START if
+ * the bus is not idle, or I2C_ERR_TIMEOUT if the TWI didn't respond in time.
  */
 uint8_t i2c_start(void)
 {
 
+  i2c_error = I2C_OK;
+
   TWCR = _BV(TWINT) | _BV(TWSTA) | _BV(TWEN); /* send start condition */
 
-  while ((TWCR & _BV(TWINT)) == 0) /* wait for transmission */
+  if(i2c_wait_twint() != I2C_OK)
   {
-  }   
-  
+    return(i2c_set_error(I2C_ERR_TIMEOUT));
+  }
+
   switch(TW_STATUS)
   {
     case TW_START:
     case TW_REP_START:
-      return(0);        /* START condition was accepted, no error */
+      return(I2C_OK);        /* START condition was accepted, no error */
 
     default:
-      return(1);  /* bus collision, return error code */
+      return(i2c_set_error(I2C_ERR_START));  /* bus collision, return error code */
   }
 }/* end i2c_start() */
 
 /*
  * i2c_stop()
  *
- * Generate a Stop condition on the I2C bus.
+ * Generate a Stop condition on the I2C bus.  Returns the first error seen by
+ * the single byte functions since i2c_start(), or I2C_ERR_TIMEOUT if the Stop
+ * couldn't be applied.
  */
 
-void i2c_stop(void){
+uint8_t i2c_stop(void){
+  uint16_t budget = I2C_TIMEOUT_LOOPS;
 
   TWCR = _BV(TWINT) | _BV(TWSTO) | _BV(TWEN); /* send stop condition */
 
   while (TWCR & _BV(TWSTO)) /* wait for stop to be applied */
   {
+    if(--budget == 0)
+    {
+      i2c_recover();
+      return(i2c_set_error(I2C_ERR_TIMEOUT));
+    }
   }
 
+  return(i2c_error);
+
 }/* end i2c_stop() */
 
 /*
  * i2c_putchar()
  *
- * Put a byte on the I2C bus.  Returns an error code if the bus is not idle.
+ * Put a byte on the I2C bus.  Returns I2C_OK if the byte was acknowledged,
+ * otherwise an error code.
  */
 uint8_t i2c_putchar(uint8_t c)
 {
@@ -101,8 +260,9 @@ uint8_t i2c_putchar(uint8_t c)
   TWDR = c;
   TWCR = _BV(TWINT) | _BV(TWEN);
 
-  while ((TWCR & _BV(TWINT)) == 0)
+  if(i2c_wait_twint() != I2C_OK)
   {
+    return(i2c_set_error(I2C_ERR_TIMEOUT));
   }
 
   switch(TW_STATUS)
@@ -111,18 +271,18 @@ uint8_t i2c_putchar(uint8_t c)
     case TW_MT_DATA_ACK:
     case TW_MR_SLA_ACK:
     case TW_MR_DATA_ACK:
-      return(0);
+      return(I2C_OK);
 
-    case TW_BUS_ERROR:
     case TW_MT_SLA_NACK:
-    case TW_MT_DATA_NACK:
-    case TW_MT_ARB_LOST:
     case TW_MR_SLA_NACK:
+      return(i2c_set_error(I2C_ERR_SLA_NACK));
+
+    case TW_MT_DATA_NACK:
     case TW_MR_DATA_NACK:
-	    return(1);
-		
+      return(i2c_set_error(I2C_ERR_DATA_NACK));
+
     default:
-      return(2);
+      return(i2c_set_error(I2C_ERR_BUS));
 
   }/* end switch(TW_STATUS) */
 
@@ -131,15 +291,18 @@ uint8_t i2c_putchar(uint8_t c)
 /*
  * i2c_getchar_ack()
  *
- * Receive a byte from then put an Acknowledge on the I2C bus.
+ * Receive a byte from then put an Acknowledge on the I2C bus.  On a timeout
+ * 0xff is returned and the error is reported by i2c_stop().
  */
 uint8_t i2c_getchar_ack(void)
 {
 
   TWCR = _BV(TWINT) | _BV(TWEA) | _BV(TWEN);
 
-  while ((TWCR & _BV(TWINT)) == 0)
+  if(i2c_wait_twint() != I2C_OK)
   {
+    i2c_set_error(I2C_ERR_TIMEOUT);
+    return(0xff);
   }
 
   return(TWDR);
@@ -149,15 +312,18 @@ uint8_t i2c_getchar_ack(void)
 /*
  * i2c_getchar_nack()
  *
- * Receive a byte from then put a Not Acknowledge on the I2C bus.
+ * Receive a byte from then put a Not Acknowledge on the I2C bus.  On a timeout
+ * 0xff is returned and the error is reported by i2c_stop().
  */
 uint8_t i2c_getchar_nack(void)
 {
 
   TWCR = _BV(TWINT) | _BV(TWEN);
 
-  while ((TWCR & _BV(TWINT)) == 0)
+  if(i2c_wait_twint() != I2C_OK)
   {
+    i2c_set_error(I2C_ERR_TIMEOUT);
+    return(0xff);
   }
 
   return(TWDR);
@@ -165,176 +331,650 @@ uint8_t i2c_getchar_nack(void)
 }/* end i2c_getchar_nack() */
 
 /*
- * i2c_write()
+ * i2c_recover()
  *
- * Write a number of data bytes the I2C slave device.
+ * Free a bus that is stuck, usually by a slave holding SDA low part way through
+ * a byte.  The TWI is disabled and SCL is clocked by hand up to 9 times until
+ * the slave lets go of SDA, then a Stop is applied and the TWI is enabled
+ * again.  Returns I2C_OK if SDA is free afterwards, otherwise I2C_ERR_BUS.
  *
- * The steps below are followed:
- *
- *       1. Apply a Start condition on the bus
- *       2. Put the slave device address with bit-0 = 0 onto the bus
- *       3. Put the byte address to write to on the bus 
- *       4. Put a data byte onto the bus 
- *       5. Repeat step 5 for all data bytes 
- *       6. Apply a Stop condition on the bus 
+ * The pins are driven open drain: low by making them outputs, high by making
+ * them inputs and letting the pull-ups do the work.
  */
-uint8_t i2c_write(uint8_t SlvAdrs, /* device slave address */
-                  uint8_t len,     /* number of bytes to read */
-                  uint8_t adrs,    /* device register to start reading from */
-                  uint8_t *buf)    /* RAM address of where to put read bytes */
+uint8_t i2c_recover(void)
 {
+  uint8_t i,
+          port = I2C_PORT & (_BV(I2C_SDA) | _BV(I2C_SCL)),
+          ddr = I2C_DDR & (_BV(I2C_SDA) | _BV(I2C_SCL));
 
-  uint8_t restarts = MAX_RESTARTS;
+  TWCR = 0; /* disable the TWI, the pins go back to the port */
 
-/* do nothing if there is no data to write */
-  if(len <= 0)
+  I2C_DDR &= ~(_BV(I2C_SDA) | _BV(I2C_SCL));
+  I2C_PORT &= ~(_BV(I2C_SDA) | _BV(I2C_SCL));
+
+/* clock SCL until the slave releases SDA */
+  for(i = 0; i < 9; i++)
   {
-    return(0);
+    if(I2C_PIN & _BV(I2C_SDA))
+    {
+      break;
+    }
+    I2C_DDR |= _BV(I2C_SCL);
+    _delay_us(I2C_RECOVER_DELAY);
+    I2C_DDR &= ~_BV(I2C_SCL);
+    _delay_us(I2C_RECOVER_DELAY);
   }
 
-WriteRestart:
-/* Loop here until the bus accepts Start condition */
+/* Stop condition: SDA goes high while SCL is high */
+  I2C_DDR |= _BV(I2C_SCL);
+  _delay_us(I2C_RECOVER_DELAY);
+  I2C_DDR |= _BV(I2C_SDA);
+  _delay_us(I2C_RECOVER_DELAY);
+  I2C_DDR &= ~_BV(I2C_SCL);
+  _delay_us(I2C_RECOVER_DELAY);
+  I2C_DDR &= ~_BV(I2C_SDA);
+  _delay_us(I2C_RECOVER_DELAY);
+
+  i = I2C_PIN & _BV(I2C_SDA);
 
-  if(i2c_start())
+/* put the pins back the way they were and enable the TWI */
+  I2C_PORT = (I2C_PORT & ~(_BV(I2C_SDA) | _BV(I2C_SCL))) | port;
+  I2C_DDR = (I2C_DDR & ~(_BV(I2C_SDA) | _BV(I2C_SCL))) | ddr;
+  TWCR = _BV(TWEN);
+
+  if(i == 0)
   {
-    if(restarts-- == 0)
-    {
-      i2c_stop();
-      return(1);
-    }
-    goto WriteRestart;
+    return(I2C_ERR_BUS);
   }
 
-/* Write the Control Byte to the bus.  If the slave device is busy 
-   a NACK will be returned.  Loop here issuing Start and Control Byte until 
-   slave device accepts the byte (ACK returned).  Count the number of retries
-   and if a maximum is exceeded, exit so the processor won't hang.
+  return(I2C_OK);
+
+}/* end i2c_recover() */
+
+/*
+ * i2c_begin()
+ *
+ * Make trans the current transaction and send a Start condition, the interrupt
+ * takes it from there.  ctrl holds any extra TWCR bits, _BV(TWSTO) applies the
+ * Stop of the previous transaction first.
+ */
+void i2c_begin(I2C_TRANSACTION_TYPE *trans, uint8_t ctrl)
+{
+
+  i2c_current = trans;
+  i2c_restarts = MAX_RESTARTS;
+  i2c_read_phase = 0;
+
+  TWCR = I2C_TWCR_NEXT | _BV(TWSTA) | ctrl;
+
+}/* end i2c_begin() */
+
+/*
+ * i2c_finish()
+ *
+ * Report the result of the current transaction.  If another transaction is
+ * waiting in the queue, apply a Stop followed by a Start and carry on with it
+ * straight away.  Otherwise apply a Stop and disable the TWI interrupt.
+ *
+ * The callback is made while the transaction is still current so that anything
+ * it posts goes to the back of the queue.
  */
-  if(i2c_putchar((SlvAdrs<<1)|TW_WRITE))
+void i2c_finish(uint8_t status)
+{
+  I2C_TRANSACTION_TYPE *trans = i2c_current;
+
+  if(status != I2C_OK)
   {
-    if(restarts-- == 0)
-    {
-      i2c_stop();
-      return(2); /* count exceeded, exit with an error code */
+    TRACE(TRACE_ID_I2C_ERROR, ((uint16_t)trans->slvAdrs << 8) | status);
+  }
+  trans->status = status;
 
-    } /* end if(Restarts-- == 0) */
+  if(trans->callback != 0)
+  {
+    trans->callback(trans);
+  }
 
-    goto WriteRestart; /* count not exceeded, retry */
+  if(i2c_queue_head != i2c_queue_tail)
+  {
+    trans = i2c_queue[i2c_queue_tail & I2C_QUEUE_MASK];
+    i2c_queue_tail++;
+    i2c_begin(trans, _BV(TWSTO));
+  }
+  else
+  {
+    i2c_current = 0;
+    TWCR = _BV(TWINT) | _BV(TWSTO) | _BV(TWEN); /* send stop condition */
+
+  }/* end if(i2c_queue_head != i2c_queue_tail) */
 
-  }/* end if(i2c_putchar((SlvAdrs<<1)|TW_WRITE)) */
+}/* end i2c_finish() */
 
-/* Write the byte address to the slave device */
-  if(i2c_putchar(adrs))
+/*
+ * i2c_service()
+ *
+ * Carry out the next step of the current transaction.  This is called by the
+ * TWI interrupt each time the TWI has finished a step (TWINT set).  The step
+ * just completed is determined by TW_STATUS.
+ */
+void i2c_service(void)
+{
+  I2C_TRANSACTION_TYPE *trans = i2c_current;
+
+  if(trans == 0)
   {
-    return(3);
+    TWCR = _BV(TWEN); /* nothing to do, leave the interrupt off */
+    return;
   }
 
-/* Write the data from the buffer to the slave device */
-  for(; len > 0; len--)
+  i2c_progress++;
+
+  switch(TW_STATUS)
   {
-    if(i2c_putchar(*buf++))
-    {
-      return(4);
-    }      
-  }/* end for(; len > 0; len--) */
+  /* Start condition was accepted.  Send the slave address with write to begin
+     a transaction, or with read after the repeated Start of a read. */
+    case TW_START:
+    case TW_REP_START:
+      if(i2c_read_phase == 0)
+      {
+        i2c_index = 0;
+        TWDR = (trans->slvAdrs<<1) | TW_WRITE;
+      }
+      else
+      {
+        TWDR = (trans->slvAdrs<<1) | TW_READ;
+      }
+      TWCR = I2C_TWCR_NEXT;
+      break;
+
+  /* Slave accepted the address, send the register address. */
+    case TW_MT_SLA_ACK:
+      TWDR = trans->adrs;
+      TWCR = I2C_TWCR_NEXT;
+      break;
 
-/* Apply a Stop condition on the bus */
+  /* Slave accepted the register address or a data byte.  A read continues with
+     a repeated Start, a write continues with the next data byte. */
+    case TW_MT_DATA_ACK:
+      if(trans->dir == I2C_DIR_READ)
+      {
+        i2c_read_phase = 1;
+        TWCR = I2C_TWCR_NEXT | _BV(TWSTA);
+      }
+      else if(i2c_index < trans->len)
+      {
+        TWDR = trans->buf[i2c_index++];
+        TWCR = I2C_TWCR_NEXT;
+      }
+      else
+      {
+        i2c_finish(I2C_OK);
+      }/* end if(trans->dir == I2C_DIR_READ) */
+      break;
+
+  /* Slave accepted the address with read.  Send ACK for all bytes but the
+     last. */
+    case TW_MR_SLA_ACK:
+      if(trans->len > 1)
+      {
+        TWCR = I2C_TWCR_NEXT | _BV(TWEA);
+      }
+      else
+      {
+        TWCR = I2C_TWCR_NEXT;
+      }
+      break;
+
+  /* A data byte was received and acknowledged. */
+    case TW_MR_DATA_ACK:
+      trans->buf[i2c_index++] = TWDR;
+      if(i2c_index < (trans->len - 1))
+      {
+        TWCR = I2C_TWCR_NEXT | _BV(TWEA);
+      }
+      else
+      {
+        TWCR = I2C_TWCR_NEXT;/* NACK the last byte */
+      }
+      break;
+
+  /* The last data byte was received. */
+    case TW_MR_DATA_NACK:
+      trans->buf[i2c_index] = TWDR;
+      i2c_finish(I2C_OK);
+      break;
 
-  i2c_stop();
+  /* The slave did not respond to its address, it may be busy.  Apply a Stop
+     and Start and try again until the maximum number of retries. */
+    case TW_MT_SLA_NACK:
+    case TW_MR_SLA_NACK:
+      if(i2c_restarts-- == 0)
+      {
+        i2c_finish(I2C_ERR_SLA_NACK);
+      }
+      else
+      {
+        TRACE(TRACE_ID_I2C_RETRY, trans->slvAdrs);
+        i2c_read_phase = 0;
+        TWCR = I2C_TWCR_NEXT | _BV(TWSTO) | _BV(TWSTA);
+      }
+      break;
+
+  /* The slave did not accept the register address or a data byte. */
+    case TW_MT_DATA_NACK:
+      if((trans->dir == I2C_DIR_READ) || (i2c_index == 0))
+      {
+        i2c_finish(I2C_ERR_ADRS_NACK);
+      }
+      else
+      {
+        i2c_finish(I2C_ERR_DATA_NACK);
+      }
+      break;
+
+  /* Another master won the bus, start again when the bus is free. */
+    case TW_MT_ARB_LOST:
+      if(i2c_restarts-- == 0)
+      {
+        i2c_finish(I2C_ERR_BUS);
+      }
+      else
+      {
+        i2c_read_phase = 0;
+        TWCR = I2C_TWCR_NEXT | _BV(TWSTA);
+      }
+      break;
 
-  return(0);
-  
-}/* end i2c_write() */
+    default:
+      i2c_finish(I2C_ERR_BUS);
+      break;
+
+  }/* end switch(TW_STATUS) */
+
+}/* end i2c_service() */
 
 /*
- * i2c_read()
+ * TWI interrupt
  *
- * Random read.  Read len data bytes from the I2C slave device to buf starting at
- * the device word address.
+ * The TWI has finished the current step of a transaction.
+ */
+ISR(TWI_vect)
+{
+
+  PROF_BEGIN(PROF_ID_TWI_ISR);
+  TRACE(TRACE_ID_TWI_ISR, TW_STATUS);
+  i2c_service();
+  PROF_END(PROF_ID_TWI_ISR);
+
+}/* end ISR(TWI_vect) */
+
+/*
+ * i2c_transaction()
  *
- * The steps below are followed:
+ * Post the transaction described by trans and return without waiting for it
+ * to finish.  If the bus is idle the transaction is started straight away,
+ * otherwise it is put at the back of the queue and is started by the TWI
+ * interrupt as soon as the ones ahead of it have finished.  Returns I2C_BUSY
+ * if the queue is full, otherwise 0.
  *
- *   1.  Apply a Start condition on the bus
- *   2.  Put the Slave Device address with bit0 = 0 (write) onto the bus
- *   3.  Put the byte address to read from on the bus
- *   4.  Apply a Repeated Start condition on the bus
- *   5.  Receive a data byte from the bus and apply an Acknowledge
- *   6.  Repeat step 5 for all data bytes except last one
- *   7.  Receive the last data byte from the bus and apply a Not Acknowledge
- *   8.  Apply a Stop condition on the bus 
+ * Completion is signalled by trans->status changing from I2C_BUSY to the result
+ * code and by a call to trans->callback (if not 0) from the TWI interrupt.
+ * Global interrupts must be enabled for the transaction to progress.
+ *
+ * This may be called from an interrupt, including from a transaction callback.
  */
-uint8_t i2c_read(uint8_t SlvAdrs, /* device slave address */
-                 uint8_t len,     /* number of bytes to read */
-                 uint8_t adrs,    /* device register to start reading from */
-                 uint8_t *buf)    /* RAM address of where to put read bytes */
+uint8_t i2c_transaction(I2C_TRANSACTION_TYPE *trans)
 {
-  uint8_t restarts = MAX_RESTARTS;
+  uint8_t sreg;
+  uint16_t budget;
 
-/* do nothing if there is no data to read */
-  if(len == 0)
+/* do nothing if there is no data to transfer */
+  if(trans->len == 0)
   {
+    trans->status = I2C_OK;
+    if(trans->callback != 0)
+    {
+      trans->callback(trans);
+    }
     return(0);
   }
 
-ReadRRestart:
-/* Loop here until the bus accepts Start condition */
+  sreg = SREG;
+  cli();
 
-  if(i2c_start())
+  if((i2c_current == 0) && (i2c_claimed == 0))
   {
-    if(--restarts == 0)
+    trans->status = I2C_BUSY;
+
+  /* wait for the Stop condition of a previous transaction to be applied */
+    budget = I2C_TIMEOUT_LOOPS;
+    while(TWCR & _BV(TWSTO))
     {
-      return(1);
-    }/* end if(--restarts == 0) */
+      if(--budget == 0)
+      {
+        i2c_recover();
+        break;
+      }
+    }
+
+    i2c_begin(trans, 0);
+  }
+  else
+  {
+    if((uint8_t)(i2c_queue_head - i2c_queue_tail) >= I2C_QUEUE_LENGTH)
+    {
+      SREG = sreg;
+      return(I2C_BUSY);/* queue is full */
+    }
+
+    trans->status = I2C_BUSY;
+    i2c_queue[i2c_queue_head & I2C_QUEUE_MASK] = trans;
+    i2c_queue_head++;
+
+  }/* end if(i2c_current == 0) */
+
+  SREG = sreg;
+
+  return(0);
 
-    goto ReadRRestart;
+}/* end i2c_transaction() */
 
-  }/* end if(i2c_start()) */
+/*
+ * i2c_busy()
+ *
+ * Return non-zero if a transaction is running or waiting in the queue, which
+ * they can be while the bus is claimed.
+ */
+uint8_t i2c_busy(void)
+{
+
+  uint8_t sreg = SREG, busy;
 
-/* Write the Control Byte to the bus.  If the slave device is busy 
-   a NACK will be returned.  Loop here issuing Start and Control Device until 
-   slave device accepts the byte (ACK returned).  Count the number of retries
-   and if a maximum is exceeded, exit so the processor won't hang.
+  cli();
+  busy = (i2c_current != 0) || (i2c_queue_head != i2c_queue_tail);
+  SREG = sreg;
+
+  return(busy);
+
+}/* end i2c_busy() */
+
+/*
+ * i2c_queue_free()
+ *
+ * Return the number of transactions i2c_transaction() would accept now, one
+ * more than the room in the queue if the bus is idle and not claimed.
  */
-  if(i2c_putchar((SlvAdrs<<1)|TW_WRITE))
+uint8_t i2c_queue_free(void)
+{
+  uint8_t sreg = SREG, n;
+
+  cli();
+  n = I2C_QUEUE_LENGTH - (uint8_t)(i2c_queue_head - i2c_queue_tail);
+  if((i2c_current == 0) && (i2c_claimed == 0))
   {
-    if(--restarts == 0)
-    {
-      i2c_stop();
-      return(2);/* return error code */
+    n++;
+  }
+  SREG = sreg;
 
-    }/* end if(--restarts == 0) */
+  return(n);
 
-    goto ReadRRestart;
+}/* end i2c_queue_free() */
 
-  }/* end if(i2c_putchar((SlvAdrs<<1)|TW_WRITE)) */
+/*
+ * i2c_claim()
+ *
+ * Wait for the transaction engine to finish what it is doing, then keep it off
+ * the bus until i2c_release() so the single byte functions can be used.
+ * Transactions posted in the meantime, from interrupts or callbacks, wait in
+ * the queue.  The wait is bounded the same way as i2c_wait(): a transaction
+ * that stops making progress is aborted.
+ *
+ * Don't use i2c_read(), i2c_write() or i2c_wait() while the bus is claimed,
+ * they would wait for ever.
+ */
+void i2c_claim(void)
+{
+  uint8_t sreg,
+          progress = i2c_progress;
+  uint16_t budget = I2C_TIMEOUT_LOOPS;
 
-/* write the device address to read from */
-  if(i2c_putchar(adrs))
+  for(;;)
   {
-    return(3);
-  }  
-  
-/* apply a repeated start then the slave address with read */
-  if(i2c_start()) // repeated Start
+    sreg = SREG;
+    cli();
+    if(i2c_current == 0)
+    {
+      i2c_claimed = 1;
+      SREG = sreg;
+      break;
+    }
+    SREG = sreg;
+
+  /* if global interrupts are disabled step the state machine from here */
+    if(((sreg & _BV(SREG_I)) == 0) && (TWCR & _BV(TWINT)))
+    {
+      i2c_service();
+    }
+
+    if(progress != i2c_progress)
+    {
+      progress = i2c_progress;
+      budget = I2C_TIMEOUT_LOOPS;
+    }
+    else if(--budget == 0)
+    {
+      i2c_abort();
+      budget = I2C_TIMEOUT_LOOPS;
+    }
+  }/* end for(;;) */
+
+/* wait for the Stop condition of the last transaction to be applied */
+  budget = I2C_TIMEOUT_LOOPS;
+  while(TWCR & _BV(TWSTO))
   {
-    return(4);
+    if(--budget == 0)
+    {
+      i2c_recover();
+      break;
+    }
   }
-  if(i2c_putchar((SlvAdrs<<1)|TW_READ))
+
+}/* end i2c_claim() */
+
+/*
+ * i2c_release()
+ *
+ * Let the transaction engine have the bus again after i2c_claim(), and start
+ * the first transaction that was queued in the meantime.  The single byte
+ * transfer must have been finished with i2c_stop().
+ */
+void i2c_release(void)
+{
+  uint8_t sreg = SREG;
+  I2C_TRANSACTION_TYPE *trans;
+
+  cli();
+  i2c_claimed = 0;
+  if((i2c_current == 0) && (i2c_queue_head != i2c_queue_tail))
   {
-    return(5);
+    trans = i2c_queue[i2c_queue_tail & I2C_QUEUE_MASK];
+    i2c_queue_tail++;
+    i2c_begin(trans, 0);
   }
-  
-/* receive the data bytes from slave device and put them into the buffer */
-  for(; len > 1; len--)
+  SREG = sreg;
+
+}/* end i2c_release() */
+
+/*
+ * i2c_abort()
+ *
+ * Give up on the current transaction: recover the bus, finish the transaction
+ * with I2C_ERR_TIMEOUT and carry on with the next one in the queue.
+ */
+void i2c_abort(void)
+{
+  uint8_t sreg = SREG;
+
+  cli();
+
+  if(i2c_current != 0)
   {
-    *(buf++) = i2c_getchar_ack();/* send ACK for all bytes but the last */
+    i2c_recover();
+    i2c_finish(I2C_ERR_TIMEOUT);
   }
 
-  *(buf++) = i2c_getchar_nack();/* send NACK for last byte */
+  SREG = sreg;
 
-/* Apply a Stop condition on the bus and return 0 */
-  i2c_stop();
+}/* end i2c_abort() */
 
-  return(0);
+/*
+ * i2c_watchdog()
+ *
+ * Call this at a regular interval, longer than the time taken to transfer one
+ * byte (a few ms is fine).  If the state machine hasn't moved on since the last
+ * call the current transaction is aborted.  Returns I2C_ERR_TIMEOUT if a
+ * transaction was aborted, otherwise I2C_OK.
+ */
+uint8_t i2c_watchdog(void)
+{
+  uint8_t progress = i2c_progress;
+
+  if((i2c_current != 0) && (progress == i2c_watch_progress))
+  {
+    i2c_abort();
+    i2c_watch_progress = i2c_progress;
+    return(I2C_ERR_TIMEOUT);
+  }
+
+  i2c_watch_progress = progress;
+
+  return(I2C_OK);
+
+}/* end i2c_watchdog() */
+
+/*
+ * i2c_wait()
+ *
+ * Start the transaction and wait for it to finish, then return the result.
+ * If the state machine stops making progress, because a slave is holding the
+ * bus, the transaction being run is aborted and the wait carries on.  So the
+ * time spent here is bounded by the transactions queued ahead of this one.
+ *
+ * If global interrupts are disabled (i.e. this is called before sei() or from
+ * inside another interrupt) the TWI interrupt can't run, so the state machine
+ * is stepped from here instead.
+ */
+uint8_t i2c_wait(I2C_TRANSACTION_TYPE *trans)
+{
+  uint8_t posted = 0,
+          progress = i2c_progress;
+  uint16_t budget = I2C_TIMEOUT_LOOPS;
+
+  for(;;)
+  {
+  /* wait for room in the queue, then for this transaction to finish */
+    if(posted == 0)
+    {
+      posted = (i2c_transaction(trans) == 0);
+    }
+    else if(trans->status != I2C_BUSY)
+    {
+      break;
+    }
+
+    if(((SREG & _BV(SREG_I)) == 0) && (TWCR & _BV(TWINT)))
+    {
+      i2c_service();
+    }
+
+    if(progress != i2c_progress)
+    {
+      progress = i2c_progress;
+      budget = I2C_TIMEOUT_LOOPS;
+    }
+    else if(--budget == 0)
+    {
+      i2c_abort();
+      budget = I2C_TIMEOUT_LOOPS;
+    }
+
+  }/* end for(;;) */
+
+  return(trans->status);
+
+}/* end i2c_wait() */
+
+/*
+ * i2c_write()
+ *
+ * Write a number of data bytes the I2C slave device.
+ *
+ * The steps below are followed:
+ *
+ *       1. Apply a Start condition on the bus
+ *       2. Put the slave device address with bit-0 = 0 onto the bus
+ *       3. Put the byte address to write to on the bus 
+ *       4. Put a data byte onto the bus 
+ *       5. Repeat step 5 for all data bytes 
+ *       6. Apply a Stop condition on the bus 
+ *
+ * If the slave device is busy a NACK will be returned for its address.  The
+ * Start and slave address are repeated until the slave device accepts the byte
+ * (ACK returned) or a maximum number of retries is exceeded so the processor
+ * won't hang.
+ *
+ * This waits for the transaction to finish and returns the result code.
+ */
+uint8_t i2c_write(uint8_t SlvAdrs, /* device slave address */
+                  uint8_t len,     /* number of bytes to write */
+                  uint8_t adrs,    /* device register to start writing to */
+                  uint8_t *buf)    /* RAM address of the bytes to write */
+{
+  I2C_TRANSACTION_TYPE trans;
+
+  trans.slvAdrs = SlvAdrs;
+  trans.adrs = adrs;
+  trans.len = len;
+  trans.dir = I2C_DIR_WRITE;
+  trans.buf = buf;
+  trans.callback = 0;
+
+  return(i2c_wait(&trans));
+
+}/* end i2c_write() */
+
+/*
+ * i2c_read()
+ *
+ * Random read.  Read len data bytes from the I2C slave device to buf starting at
+ * the device word address.
+ *
+ * The steps below are followed:
+ *
+ *   1.  Apply a Start condition on the bus
+ *   2.  Put the Slave Device address with bit0 = 0 (write) onto the bus
+ *   3.  Put the byte address to read from on the bus
+ *   4.  Apply a Repeated Start condition on the bus
+ *   5.  Receive a data byte from the bus and apply an Acknowledge
+ *   6.  Repeat step 5 for all data bytes except last one
+ *   7.  Receive the last data byte from the bus and apply a Not Acknowledge
+ *   8.  Apply a Stop condition on the bus 
+ *
+ * This waits for the transaction to finish and returns the result code.
+ */
+uint8_t i2c_read(uint8_t SlvAdrs, /* device slave address */
+                 uint8_t len,     /* number of bytes to read */
+                 uint8_t adrs,    /* device register to start reading from */
+                 uint8_t *buf)    /* RAM address of where to put read bytes */
+{
+  I2C_TRANSACTION_TYPE trans;
+
+  trans.slvAdrs = SlvAdrs;
+  trans.adrs = adrs;
+  trans.len = len;
+  trans.dir = I2C_DIR_READ;
+  trans.buf = buf;
+  trans.callback = 0;
+
+  return(i2c_wait(&trans));
 
 }/* end i2c_read() */
@@ -6,8 +6,13 @@
  * Public interface for i2c.c.  
  *
  * The .c file contains driver routines to control the processor's peripheral
- * I2C interface.  All these functions are blocking, they won't return until
- * the TWI has completed it's current function, or an error has occurred.
+ * I2C interface.  The single byte functions are blocking, they won't return
+ * until the TWI has completed it's current function, or an error has occurred.
+ *
+ * Complete transactions (register address plus a block of data) are run by an
+ * interrupt driven state machine.  i2c_transaction() posts one and returns
+ * immediately, i2c_read() and i2c_write() post one then wait for it to finish.
+ * Transactions posted while the bus is busy are queued and run back-to-back.
  *
  * Some of these functions are based on ideas from example software included
  * with the WinAVR compiler.
@@ -22,6 +27,55 @@
 
 #include <stdint.h>
 
+/* Maximum number of transactions waiting for the bus, must be a power of 2. */
+#ifndef I2C_QUEUE_LENGTH
+#define I2C_QUEUE_LENGTH 8
+#endif
+
+/* Direction of the data in an I2C transaction. */
+#define I2C_DIR_WRITE 0
+#define I2C_DIR_READ  1
+
+/* Result codes returned by i2c_read(), i2c_write() and the single byte
+   functions, also left in the status field of a transaction when it has
+   finished. */
+enum
+{
+  I2C_OK,            /* transaction completed without error */
+  I2C_ERR_START,     /* bus would not accept a Start condition */
+  I2C_ERR_SLA_NACK,  /* slave did not acknowledge its address */
+  I2C_ERR_ADRS_NACK, /* slave did not acknowledge the register address */
+  I2C_ERR_DATA_NACK, /* slave did not acknowledge a data byte */
+  I2C_ERR_BUS,       /* bus error or arbitration lost */
+  I2C_ERR_TIMEOUT,   /* bus stuck, the TWI didn't finish a step in time */
+  I2C_BUSY,          /* transaction has not finished yet */
+  I2C_STATUS_MAX
+};
+
+/* Descriptor for one I2C transaction.  The memory pointed to by buf and the
+ * descriptor itself must stay valid until the transaction has finished.
+ *
+ * slvAdrs : device slave address (7-bit, not shifted)
+ * adrs    : device register to start reading from or writing to
+ * len     : number of data bytes to read or write
+ * dir     : I2C_DIR_WRITE or I2C_DIR_READ
+ * buf     : RAM address of the data
+ * callback: called from the TWI interrupt when the transaction has finished,
+ *           can be 0 if not needed
+ * status  : I2C_BUSY while the transaction is running, then the result code
+ */
+typedef struct I2C_TRANSACTION
+{
+  uint8_t slvAdrs;
+  uint8_t adrs;
+  uint8_t len;
+  uint8_t dir;
+  uint8_t *buf;
+  void (*callback)(struct I2C_TRANSACTION *trans);
+  volatile uint8_t status;
+
+} I2C_TRANSACTION_TYPE;
+
 /*
  * i2c_init()
  *
@@ -30,42 +84,152 @@
  */
 void i2c_init(unsigned long i2c_speed);
 
+/*
+ * I2C_TWBR()
+ * i2c_init_twbr()
+ *
+ * I2C_TWBR() is the bit rate register value for an SCL rate of speed Hz with
+ * the prescaler at 1, the same as i2c_init() works out.  With a constant speed
+ * it is a constant, so i2c_init_twbr(I2C_TWBR(400000)) sets up the TWI the
+ * same as i2c_init(400000) without a division at run time.  It is 0 if the CPU
+ * is too slow for the speed.
+ */
+#define I2C_TWBR(speed) \
+  ((F_CPU / (speed)) > 16 ? (uint8_t)(((F_CPU / (speed)) - 16) / 2) : 0)
+
+void i2c_init_twbr(uint8_t twbr);
+
 /*
  * i2c_start()
  *
- * Generate a Start condition on the I2C bus.  Returns an error code if the bus 
- * is not idle.
+ * Generate a Start condition on the I2C bus.  Returns I2C_OK, I2C_ERR_START if
+ * the bus is not idle, or I2C_ERR_TIMEOUT if the TWI didn't respond in time.
  */
 uint8_t i2c_start(void);
 
 /*
  * i2c_stop()
  *
- * Generate a Stop condition on the I2C bus.
+ * Generate a Stop condition on the I2C bus.  Returns the first error seen by
+ * the single byte functions since i2c_start(), or I2C_ERR_TIMEOUT if the Stop
+ * couldn't be applied.
  */
-void i2c_stop(void);
+uint8_t i2c_stop(void);
 
 /*
  * i2c_putchar()
  *
- * Put a byte on the I2C bus.  Returns an error code if the bus is not idle.
+ * Put a byte on the I2C bus.  Returns I2C_OK if the byte was acknowledged,
+ * otherwise an error code.
  */
 uint8_t i2c_putchar(uint8_t c);
 
 /*
  * i2c_getchar_ack()
  *
- * Receive a byte from then put an Acknowledge on the I2C bus.
+ * Receive a byte from then put an Acknowledge on the I2C bus.  On a timeout
+ * 0xff is returned and the error is reported by i2c_stop().
  */
 uint8_t i2c_getchar_ack(void);
 
 /*
  * i2c_getchar_nack()
  *
- * Receive a byte from then put a Not Acknowledge on the I2C bus.
+ * Receive a byte from then put a Not Acknowledge on the I2C bus.  On a timeout
+ * 0xff is returned and the error is reported by i2c_stop().
  */
 uint8_t i2c_getchar_nack(void);
 
+/*
+ * i2c_recover()
+ *
+ * Free a bus that is stuck, usually by a slave holding SDA low part way through
+ * a byte.  The TWI is disabled and SCL is clocked by hand up to 9 times until
+ * the slave lets go of SDA, then a Stop is applied and the TWI is enabled
+ * again.  Returns I2C_OK if SDA is free afterwards, otherwise I2C_ERR_BUS.
+ */
+uint8_t i2c_recover(void);
+
+/*
+ * i2c_transaction()
+ *
+ * Post the transaction described by trans and return without waiting for it
+ * to finish.  If the bus is idle the transaction is started straight away,
+ * otherwise it is put at the back of the queue and is started by the TWI
+ * interrupt as soon as the ones ahead of it have finished.  Returns I2C_BUSY
+ * if the queue is full, otherwise 0.
+ *
+ * Completion is signalled by trans->status changing from I2C_BUSY to the result
+ * code and by a call to trans->callback (if not 0) from the TWI interrupt.
+ * Global interrupts must be enabled for the transaction to progress.
+ *
+ * This may be called from an interrupt, including from a transaction callback.
+ */
+uint8_t i2c_transaction(I2C_TRANSACTION_TYPE *trans);
+
+/*
+ * i2c_wait()
+ *
+ * Post the transaction described by trans, waiting for room in the queue if
+ * need be, then wait for it to finish and return trans->status.  A transaction
+ * that stops making progress is aborted, so the wait is bounded.  This works
+ * with global interrupts disabled, the state machine is then stepped from here.
+ * It is what i2c_read() and i2c_write() use, for other transactions that must
+ * be finished before carrying on.
+ */
+uint8_t i2c_wait(I2C_TRANSACTION_TYPE *trans);
+
+/*
+ * i2c_busy()
+ *
+ * Return non-zero if a transaction is running or waiting in the queue.  The
+ * single byte functions must not be used while this is the case, use
+ * i2c_claim() first.
+ */
+uint8_t i2c_busy(void);
+
+/*
+ * i2c_claim()
+ * i2c_release()
+ *
+ * i2c_claim() waits for the transaction engine to finish and keeps it off the
+ * bus, so the single byte functions (i2c_start() to i2c_stop()) can be used.
+ * Transactions posted meanwhile are queued and i2c_release() starts them.
+ * i2c_read(), i2c_write() and i2c_wait() must not be used in between.
+ */
+void i2c_claim(void);
+void i2c_release(void);
+
+/*
+ * i2c_queue_free()
+ *
+ * Return the number of transactions i2c_transaction() would accept now.  To
+ * post several that must all go or none, call this and i2c_transaction() with
+ * interrupts off.
+ */
+uint8_t i2c_queue_free(void);
+
+/*
+ * i2c_abort()
+ *
+ * Give up on the current transaction: recover the bus, finish the transaction
+ * with I2C_ERR_TIMEOUT and carry on with the next one in the queue.
+ */
+void i2c_abort(void);
+
+/*
+ * i2c_watchdog()
+ *
+ * Call this at a regular interval, longer than the time taken to transfer one
+ * byte (a few ms is fine).  If the state machine hasn't moved on since the last
+ * call the current transaction is aborted.  Returns I2C_ERR_TIMEOUT if a
+ * transaction was aborted, otherwise I2C_OK.
+ *
+ * Only needed for transactions nobody is waiting on, i2c_read() and i2c_write()
+ * time out by themselves.
+ */
+uint8_t i2c_watchdog(void);
+
 /*
  * i2c_write()
  *
@@ -79,6 +243,9 @@ uint8_t i2c_getchar_nack(void);
  *       4. Put a data byte onto the bus 
  *       5. Repeat step 5 for all data bytes 
  *       6. Apply a Stop condition on the bus 
+ *
+ * This waits for the transaction to finish and returns the result code.  A
+ * stuck bus is recovered and reported as I2C_ERR_TIMEOUT.
  */
 uint8_t i2c_write(uint8_t SlvAdrs, uint8_t len, uint8_t adrs, uint8_t *buf);
 
@@ -98,6 +265,9 @@ uint8_t i2c_write(uint8_t SlvAdrs, uint8_t len, uint8_t adrs, uint8_t *buf);
  *   6.  Repeat step 5 for all data bytes except last one
  *   7.  Receive the last data byte from the bus and apply a Not Acknowledge
  *   8.  Apply a Stop condition on the bus 
+ *
+ * This waits for the transaction to finish and returns the result code.  A
+ * stuck bus is recovered and reported as I2C_ERR_TIMEOUT.
  */
 uint8_t i2c_read(uint8_t SlvAdrs, uint8_t len, uint8_t adrs, uint8_t *buf);
 
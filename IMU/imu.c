@@ -0,0 +1,306 @@
+/*
+ * File:      imu.c
+ * Date:      October 14, 2026
+ * Author:    Craig Hollinger
+ *
+ * 9-DOF sampler for the ADXL345 accelerometer, ITG3205 gyroscope and HMC5883L
+ * magnetometer on one I2C bus.
+ *
+ * Each sensor is read into a single raw buffer, status register included
+ * where the part has one:
+ *
+ *   ITG3205  9 bytes from INT_STAT: status, temperature, X, Y, Z (MSB first)
+ *   HMC5883L 1 byte from Status, then 6 bytes from DATA X: X, Z, Y (MSB first)
+ *   ADXL345  6 bytes from DATAX0:   X, Y, Z (LSB first)
+ *
+ * The HMC5883L's register pointer goes from the last data register back to
+ * the first, so its Status register takes a read of its own.  Reading doesn't
+ * clear RDY either, that only happens when the part starts writing the next
+ * measurement, so the same one reads as ready until then.  The magnetometer
+ * is taken as fresh when RDY is set and the data differs from the last taken.
+ * A new measurement exactly the same as the last one is missed, the sample
+ * holds the same values either way.
+ *
+ * The four reads are chained, each transaction's callback queues the next so
+ * only one I2C queue slot is used.  When the last one finishes the raw buffer
+ * is converted to the sample in one pass.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <i2c/i2c.h>
+#include <adxl345/adxl345.h>
+#include <hmc5883/hmc5883.h>
+#include <itg3205/itg3205.h>
+#include <imu/imu.h>
+
+/* Where each block goes in the raw buffer. */
+#define IMU_RAW_GYRO     0
+#define IMU_RAW_MAG_STAT 9
+#define IMU_RAW_MAG      10
+#define IMU_RAW_ACCEL    16
+#define IMU_RAW_SIZE     22
+
+/* Reads in the chain. */
+#define IMU_READS 4
+
+I2C_TRANSACTION_TYPE imu_trans[IMU_READS];
+uint8_t imu_raw[IMU_RAW_SIZE];
+uint8_t imu_mag_last[6];/* magnetometer data last taken */
+uint8_t imu_mag_valid = 0;/* 1 once imu_mag_last[] has been filled in */
+IMU_SAMPLE_TYPE imu_sample;
+volatile uint8_t imu_running = 0;
+uint16_t imu_time = 0;
+uint16_t (*imu_tick)(void) = 0;
+void (*imu_done)(IMU_SAMPLE_TYPE *sample) = 0;
+
+/*
+ * imu_be16()
+ *
+ * Return the signed 16-bit value stored MSB first at p.
+ */
+int16_t imu_be16(uint8_t *p)
+{
+
+  return((int16_t)(((uint16_t)p[0] << 8) | p[1]));
+
+}/* end imu_be16() */
+
+/*
+ * imu_le16()
+ *
+ * Return the signed 16-bit value stored LSB first at p.
+ */
+int16_t imu_le16(uint8_t *p)
+{
+
+  return((int16_t)(((uint16_t)p[1] << 8) | p[0]));
+
+}/* end imu_le16() */
+
+/*
+ * imu_convert()
+ *
+ * Turn the raw buffer into the sample.  The gyro and magnetometer are only
+ * taken if their ready bits are set, the magnetometer also only if its data
+ * has changed since it was last taken.
+ */
+void imu_convert(void)
+{
+  uint8_t *p, i, fresh, changed;
+
+  fresh = IMU_FRESH_ACCEL;
+
+  p = &imu_raw[IMU_RAW_ACCEL];
+  for(i = 0; i < 3; i++)
+  {
+    imu_sample.accel[i] = imu_le16(p);
+    p += 2;
+  }
+
+  p = &imu_raw[IMU_RAW_GYRO];
+  if(p[0] & ITG3205_INT_STAT_RAW_DATA_RDY)
+  {
+    imu_sample.temp = imu_be16(&p[1]);
+    p += 3;
+    for(i = 0; i < 3; i++)
+    {
+      imu_sample.gyro[i] = imu_be16(p);
+      p += 2;
+    }
+    fresh |= IMU_FRESH_GYRO;
+  }
+
+  /* the magnetometer sends Z before Y */
+  p = &imu_raw[IMU_RAW_MAG];
+  changed = (imu_mag_valid == 0);
+  for(i = 0; i < 6; i++)
+  {
+    if(p[i] != imu_mag_last[i])
+    {
+      changed = 1;
+    }
+  }
+  if((imu_raw[IMU_RAW_MAG_STAT] & HMC5883_STATUS_RDY) && changed)
+  {
+    for(i = 0; i < 6; i++)
+    {
+      imu_mag_last[i] = p[i];
+    }
+    imu_mag_valid = 1;
+    imu_sample.mag[0] = imu_be16(&p[0]);
+    imu_sample.mag[2] = imu_be16(&p[2]);
+    imu_sample.mag[1] = imu_be16(&p[4]);
+    fresh |= IMU_FRESH_MAG;
+  }
+
+  imu_sample.fresh = fresh;
+
+}/* end imu_convert() */
+
+/*
+ * imu_finish()
+ *
+ * End of a sample, good or bad: record the result and tell the caller.
+ */
+void imu_finish(uint8_t status)
+{
+
+  imu_sample.time = imu_time;
+  imu_sample.status = status;
+  if(status != I2C_OK)
+  {
+    imu_sample.fresh = 0;
+  }
+  imu_running = 0;
+  if(imu_done != 0)
+  {
+    imu_done(&imu_sample);
+  }
+
+}/* end imu_finish() */
+
+/*
+ * imu_read_done()
+ *
+ * Callback of each read in the chain: queue the next one, or convert the
+ * sample once the last has finished.  Gives up on the first error.
+ */
+void imu_read_done(I2C_TRANSACTION_TYPE *trans)
+{
+
+  if(trans->status != I2C_OK)
+  {
+    imu_finish(trans->status);
+    return;
+  }
+
+  if(trans == &imu_trans[IMU_READS - 1])
+  {
+    imu_convert();
+    imu_finish(I2C_OK);
+    return;
+  }
+
+  if(i2c_transaction(trans + 1) != 0)
+  {
+    imu_finish(I2C_BUSY);
+  }
+
+}/* end imu_read_done() */
+
+/*
+ * imu_init()
+ *
+ * Set up the sampler.  tick is called at the start of each sample for its
+ * time stamp, it can be 0 if time stamps aren't needed.  The I2C bus must be
+ * set up with i2c_init().
+ */
+void imu_init(uint16_t (*tick)(void))
+{
+  uint8_t i;
+
+  imu_tick = tick;
+
+  imu_trans[0].slvAdrs = ITG3205SlaveAdrs;
+  imu_trans[0].adrs = ITG3205_INT_STAT;
+  imu_trans[0].len = IMU_RAW_MAG_STAT - IMU_RAW_GYRO;
+  imu_trans[0].buf = &imu_raw[IMU_RAW_GYRO];
+
+  imu_trans[1].slvAdrs = HMC5883SlaveAdrs;
+  imu_trans[1].adrs = HMC5883_STATUS;
+  imu_trans[1].len = IMU_RAW_MAG - IMU_RAW_MAG_STAT;
+  imu_trans[1].buf = &imu_raw[IMU_RAW_MAG_STAT];
+
+  imu_trans[2].slvAdrs = HMC5883SlaveAdrs;
+  imu_trans[2].adrs = HMC5883_DATAX;
+  imu_trans[2].len = IMU_RAW_ACCEL - IMU_RAW_MAG;
+  imu_trans[2].buf = &imu_raw[IMU_RAW_MAG];
+
+  imu_trans[3].slvAdrs = ADXL345SlaveAdrs;
+  imu_trans[3].adrs = ADXL_ACCEL_DATA;
+  imu_trans[3].len = IMU_RAW_SIZE - IMU_RAW_ACCEL;
+  imu_trans[3].buf = &imu_raw[IMU_RAW_ACCEL];
+
+  for(i = 0; i < IMU_READS; i++)
+  {
+    imu_trans[i].dir = I2C_DIR_READ;
+    imu_trans[i].callback = imu_read_done;
+    imu_trans[i].status = I2C_OK;
+  }
+
+  imu_sample.status = I2C_BUSY;
+  imu_sample.fresh = 0;
+  imu_mag_valid = 0;
+
+}/* end imu_init() */
+
+/*
+ * imu_start()
+ *
+ * Start reading one sample in the background and return straight away.  done
+ * is called from the TWI interrupt with the sample once all three sensors have
+ * been read, or on the first error (sample->status tells which).  done can be
+ * 0, the sample can be picked up later with imu_get_sample().
+ *
+ * Returns 0 if the read was started, IMU_BUSY if the last one hasn't finished,
+ * or I2C_BUSY if the I2C queue is full.
+ */
+uint8_t imu_start(void (*done)(IMU_SAMPLE_TYPE *sample))
+{
+  uint8_t err;
+
+  if(imu_running)
+  {
+    return(IMU_BUSY);
+  }
+
+  imu_running = 1;
+  imu_done = done;
+  if(imu_tick != 0)
+  {
+    imu_time = imu_tick();
+  }
+
+  err = i2c_transaction(&imu_trans[0]);
+  if(err != 0)
+  {
+    imu_running = 0;
+  }
+
+  return(err);
+
+}/* end imu_start() */
+
+/*
+ * imu_busy()
+ *
+ * Returns non-zero while a sample is being read.
+ */
+uint8_t imu_busy(void)
+{
+
+  return(imu_running);
+
+}/* end imu_busy() */
+
+/*
+ * imu_get_sample()
+ *
+ * Copy the last complete sample to sample.  Safe to call while the next one
+ * is being read.
+ */
+void imu_get_sample(IMU_SAMPLE_TYPE *sample)
+{
+  uint8_t sreg;
+
+  sreg = SREG;
+  cli();
+  *sample = imu_sample;
+  SREG = sreg;
+
+}/* end imu_get_sample() */
@@ -0,0 +1,106 @@
+/*
+ * File:      imu.h
+ * Date:      October 14, 2026
+ * Author:    Craig Hollinger
+ *
+ * 9-DOF sampler for the ADXL345 accelerometer, ITG3205 gyroscope and HMC5883L
+ * magnetometer on one I2C bus.
+ *
+ * imu_start() reads all three sensors in the background as one chain of I2C
+ * transactions, each queued by the TWI interrupt as the one before it
+ * finishes, and fills in a time-stamped imu sample.  Call it at a fixed rate
+ * (from a timer tick, for instance) to sample the sensors in lock step.
+ *
+ * The sensors are set up with their own drivers first.  The gyro and
+ * magnetometer data is only taken when the part says it is new:
+ *
+ *   - ITG3205: set ITG3205_INT_CNFG_EI_DATA (and ITG3205_INT_CNFG_LCHCLR_ANYRD
+ *     so the read clears it) with itg3205_setInterruptConfig(), otherwise
+ *     INT_STAT never shows RAW_DATA_RDY and the gyro is never fresh
+ *   - HMC5883L: the Status register is read just before the data.  Reading
+ *     doesn't clear RDY, so the data is only taken as fresh when RDY is set
+ *     and the data has changed since it was last taken.  Sampling faster than
+ *     the output rate set with the magnetometer driver gives a fresh
+ *     magnetometer reading only once per measurement
+ *
+ * The ADXL345 is taken every time.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#ifndef _IMU_H_
+#define _IMU_H_ 1
+
+#include <stdint.h>
+
+/* imu_start() return value while a sample is already being read. */
+#define IMU_BUSY 1
+
+/* Bits in the fresh field of a sample, set for each sensor read this time. */
+#define IMU_FRESH_ACCEL 0b00000001
+#define IMU_FRESH_GYRO  0b00000010
+#define IMU_FRESH_MAG   0b00000100
+
+/* One sample of all three sensors, in the sensors' own units and axis order
+ * X, Y, Z.  Parts that weren't fresh keep their last value.
+ *
+ * time  : value of the tick function when the sample was started
+ * status: I2C result code of the read, the rest is only valid when I2C_OK
+ * fresh : IMU_FRESH_... bits for the parts read this time
+ * accel : ADXL345 acceleration
+ * gyro  : ITG3205 angular rate
+ * temp  : ITG3205 temperature
+ * mag   : HMC5883L magnetic field
+ */
+typedef struct IMU_SAMPLE
+{
+  uint16_t time;
+  uint8_t status;
+  uint8_t fresh;
+  int16_t accel[3];
+  int16_t gyro[3];
+  int16_t temp;
+  int16_t mag[3];
+
+} __attribute__((packed)) IMU_SAMPLE_TYPE;
+
+/*
+ * imu_init()
+ *
+ * Set up the sampler.  tick is called at the start of each sample for its
+ * time stamp, it can be 0 if time stamps aren't needed.  The I2C bus must be
+ * set up with i2c_init().
+ */
+void imu_init(uint16_t (*tick)(void));
+
+/*
+ * imu_start()
+ *
+ * Start reading one sample in the background and return straight away.  done
+ * is called from the TWI interrupt with the sample once all three sensors have
+ * been read, or on the first error (sample->status tells which).  done can be
+ * 0, the sample can be picked up later with imu_get_sample().
+ *
+ * Returns 0 if the read was started, IMU_BUSY if the last one hasn't finished,
+ * or I2C_BUSY if the I2C queue is full.
+ */
+uint8_t imu_start(void (*done)(IMU_SAMPLE_TYPE *sample));
+
+/*
+ * imu_busy()
+ *
+ * Returns non-zero while a sample is being read.
+ */
+uint8_t imu_busy(void);
+
+/*
+ * imu_get_sample()
+ *
+ * Copy the last complete sample to sample.  Safe to call while the next one
+ * is being read.
+ */
+void imu_get_sample(IMU_SAMPLE_TYPE *sample);
+
+#endif /* _IMU_H_ */
@@ -7,6 +7,7 @@
  *
  * The register descriptions are taken directly from the InvenSense document:
  * ITG-3205 Product Specification Revision 1.0
+ * The slave address and register addresses are in itg3205.h.
  *
  * This file is free software; you can redistribute it and/or modify
  * it under the terms of either the GNU General Public License version 3
@@ -14,6 +15,7 @@
  * published by the Free Software Foundation.
  */
 #include <i2c/i2c.h>
+#include <itg3205/itg3205.h>
 
 /*
  * Device slave address
@@ -21,7 +23,6 @@
  * The ADO pin is pulled low on the breakout board so the address is 0x68.
  * left shift 1 bit: 0xd0
  */
-#define ITG3205SlaveAdrs 0x68
 
 /*
  * Register 0 – Who Am I
@@ -36,7 +37,6 @@
  *      writing to this register. The Bit7 should always be set to “0”.
  *      The Power-On-Reset value of Bit6: Bit1 is 110 100.
  */
-#define ITG3205_WHOAMI 0x00
 
 uint8_t itg3205_getWhoAmI(void)
 {
@@ -63,7 +63,6 @@ uint8_t itg3205_getWhoAmI(void)
  *
  *  Fsample = 1kHz / (7 + 1) = 125Hz, or 8ms per sample
  */
-#define ITG3205_SMPLRT_DIV 0x15
 
 void itg3205_setSampleRate(uint8_t rate)
 {
@@ -108,7 +107,6 @@ void itg3205_setSampleRate(uint8_t rate)
  *      6    |            5Hz            |         1kHz
  *      7    |         Reserved          |       Reserved
  */
-#define ITG3205_DLPF_SCALE 0x16
 
 void itg3205_setDlpfScale(uint8_t data)
 {
@@ -140,7 +138,6 @@ void itg3205_setDlpfScale(uint8_t data)
  * EI_DEV      Enable interrupt when device is ready (PLL ready after changing clock source)
  * EI_DATA     Enable interrupt when data is available
  */
-#define ITG3205_INT_CNFG 0x17
 
 void itg3205_setInterruptConfig(uint8_t data)
 {
@@ -171,7 +168,6 @@ void itg3205_setInterruptConfig(uint8_t data)
  * Interrupt Status bits get cleared as determined by LATCH_CLEAR in the
  * interrupt configuration register (23).
  */
-#define ITG3205_INT_STAT 0x1a
 
 uint8_t itg3205_getInterruptStatus(void)
 {
@@ -191,57 +187,65 @@ uint8_t itg3205_getInterruptStatus(void)
  *
  * Note: Data is in big endian format.
  */
-#define ITG3205_TEMP_OUT 0x1b
-#define ITG3205_GYRO_DATA 0x1d
-#define ITG3205_GYRO_XOUT 0x1d
-#define ITG3205_GYRO_YOUT 0x1f
-#define ITG3205_GYRO_ZOUT 0x21
+
+/* temperature then X, Y, Z gyro data from the last itg3205_update() */
+int16_t itg3205_data[4] = {0, 0, 0, 0};
+
+/*
+ * itg3205_update()
+ *
+ * Read the temperature and the X, Y, and Z gyroscope data in one transaction,
+ * the registers are contiguous from TEMP_OUT_H to GYRO_ZOUT_L.  The values
+ * are kept for itg3205_getXData(), itg3205_getYData(), itg3205_getZData() and
+ * itg3205_getTempData().  Returns the I2C result code, the last data is kept
+ * on an error.
+ */
+uint8_t itg3205_update(void)
+{
+  uint8_t buf[8], i, err;
+
+  err = i2c_read(ITG3205SlaveAdrs, 8, ITG3205_TEMP_OUT, buf);
+  if(err == I2C_OK)
+  {
+    for(i = 0; i < 4; i++)
+    {
+      itg3205_data[i] = (int16_t)buf[2 * i]<<8;
+      itg3205_data[i] += (int16_t)buf[2 * i + 1];
+    }
+  }
+
+  return(err);
+
+}/* end itg3205_update() */
 
 /*
-  itg3205_getXGyroData()
-  itg3205_getYGyroData()
-  itg3205_getZGyroData()
+  itg3205_getXData()
+  itg3205_getYData()
+  itg3205_getZData()
 
-Read the values of the X, Y, and Z gyroscope data.
+Return the values of the X, Y, and Z gyroscope data read by the last
+itg3205_update().
 */
 int16_t itg3205_getXData(void)
 {
-  int16_t data;
-  uint8_t buf[2];
-  
-  i2c_read(ITG3205SlaveAdrs, 2, ITG3205_GYRO_XOUT, buf);
-  data = (int16_t)buf[0]<<8;
-  data += (int16_t)buf[1];
 
-  return(data);
+  return(itg3205_data[1]);
 
-}/* end itg3205_getXGyroData() */
+}/* end itg3205_getXData() */
 
 int16_t itg3205_getYData(void)
 {
-  int16_t data;
-  uint8_t buf[2];
 
-  i2c_read(ITG3205SlaveAdrs, 2, ITG3205_GYRO_YOUT, buf);
-  data = (int16_t)buf[0]<<8;
-  data += (int16_t)buf[1];
-
-  return(data);
+  return(itg3205_data[2]);
 
-}/* end itg3205_getYGyroData() */
+}/* end itg3205_getYData() */
 
 int16_t itg3205_getZData(void)
 {
-  int16_t data;
-  uint8_t buf[2];
 
-  i2c_read(ITG3205SlaveAdrs, 2, ITG3205_GYRO_ZOUT, buf);
-  data = (int16_t)buf[0]<<8;
-  data += (int16_t)buf[1];
+  return(itg3205_data[3]);
 
-  return(data);
-
-}/* end itg3205_getZGyroData() */
+}/* end itg3205_getZData() */
 
 /*
  * itg3205_getGyroData()
@@ -258,18 +262,12 @@ void itg3205_getGyroData(uint8_t *buf)
 /*
  * itg3205_getTempData()
  *
- * Read the values of the temperature data.
+ * Return the temperature data read by the last itg3205_update().
  */
 int16_t itg3205_getTempData(void)
 {
-  int16_t data;
-  uint8_t buf[2];
 
-  i2c_read(ITG3205SlaveAdrs, 2, ITG3205_TEMP_OUT, buf);
-  data = (int16_t)buf[0]<<8;
-  data += (int16_t)buf[1];
-
-  return(data);
+  return(itg3205_data[0]);
 
 }/* end itg3205_getTempData() */
 
@@ -313,7 +311,6 @@ int16_t itg3205_getTempData(void)
  * STBY_ZG Put gyro Z in standby mode (1=standby, 0=normal)
  * CLK_SEL Select device clock source
  */
-#define ITG3205_PWR_MGMT 0x3e
 
 void itg3205_setPowerMgmt(uint8_t data)
 {
@@ -16,6 +16,27 @@
 #ifndef _ITG3205_H_
 #define _ITG3205_H_ 1
 
+/*
+ * Slave address and register addresses, the registers are described in
+ * itg3205.c.
+ */
+#define ITG3205SlaveAdrs   0x68
+#define ITG3205_WHOAMI     0x00
+#define ITG3205_SMPLRT_DIV 0x15
+#define ITG3205_DLPF_SCALE 0x16
+#define ITG3205_INT_CNFG   0x17
+#define ITG3205_INT_STAT   0x1a
+#define ITG3205_TEMP_OUT   0x1b
+#define ITG3205_GYRO_DATA  0x1d
+#define ITG3205_GYRO_XOUT  0x1d
+#define ITG3205_GYRO_YOUT  0x1f
+#define ITG3205_GYRO_ZOUT  0x21
+#define ITG3205_PWR_MGMT   0x3e
+
+/* Interrupt Status register bits. */
+#define ITG3205_INT_STAT_ITG_RDY      0b00000100
+#define ITG3205_INT_STAT_RAW_DATA_RDY 0b00000001
+
 /*
  * Register 0 – Who Am I
  */
@@ -66,6 +87,7 @@ uint8_t itg3205_getInterruptStatus(void);
 /*
  * Registers 27 to 34 – Sensor Registers
  */
+uint8_t itg3205_update(void);
 int16_t itg3205_getXData(void);
 int16_t itg3205_getYData(void);
 int16_t itg3205_getZData(void);
@@ -0,0 +1,245 @@
+/*
+ * keyEvents.c
+ *
+ * Created: 2026-10-14
+ * Author : Craig Hollinger
+ *
+ * Background keypad scanning.  A Timer/Counter compare match interrupt runs
+ * the scan function of the keypad driver picked by KEY_EVENTS_DRIVER at a
+ * fixed rate, and the driver's event callback puts each press, hold and
+ * release into a ring.  The driver is picked at compile time so the others
+ * aren't linked in.
+ *
+ * The interrupt only writes keyEventHead and the application only writes
+ * keyEventTail.  Both are single bytes, so neither side needs to disable
+ * interrupts to use the ring.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <timer/tc0.h>
+#include <timer/tc2.h>
+#include <keypad/keyEvents.h>
+
+#if KEY_EVENTS_DRIVER == KEY_EVENTS_MATRIX
+#include <keypad/matrixKeypad.h>
+#define KEY_EVENTS_SCAN()            matrix_keypad_scan_keys()
+#define KEY_EVENTS_SET_CALLBACK(f)   matrix_keypad_set_callback(f)
+#elif KEY_EVENTS_DRIVER == KEY_EVENTS_PBMX
+#include <keypad/pbmxkeys.h>
+#define KEY_EVENTS_SCAN()            pbmxkeys_run()
+#define KEY_EVENTS_SET_CALLBACK(f)   pbmxkeys_set_callback(f)
+#elif KEY_EVENTS_DRIVER == KEY_EVENTS_MATRIX_VC
+#include <keypad/matrixKeypadVC.h>
+#define KEY_EVENTS_SCAN()            matrix_keypad_vc_scan_keys()
+#define KEY_EVENTS_SET_CALLBACK(f)   matrix_keypad_vc_set_callback(f)
+#else
+#error "KEY_EVENTS_DRIVER must be one of the KEY_EVENTS_ drivers"
+#endif
+
+#if (KEY_EVENTS_QUEUE_LENGTH & (KEY_EVENTS_QUEUE_LENGTH - 1)) != 0 || KEY_EVENTS_QUEUE_LENGTH > 128
+#error "KEY_EVENTS_QUEUE_LENGTH must be a power of 2, no more than 128"
+#endif
+
+#if KEY_EVENTS_TIMER == 0
+#define KEY_EVENTS_vect TIMER0_COMPA_vect
+#elif KEY_EVENTS_TIMER == 2
+#define KEY_EVENTS_vect TIMER2_COMPA_vect
+#else
+#error "KEY_EVENTS_TIMER must be 0 or 2"
+#endif
+
+/* **** Local variables **** */
+
+KEY_EVENT_TYPE keyEventQueue[KEY_EVENTS_QUEUE_LENGTH];
+volatile uint8_t keyEventHead = 0,
+                 keyEventTail = 0;
+volatile uint8_t keyEventOverflows = 0;
+
+/* scan counter, the time stamp of the events */
+volatile uint16_t keyEventTime = 0;
+
+/*
+ * key_events_push()
+ *
+ * Driver callback, called from the scan interrupt: put an event in the ring.
+ */
+void key_events_push(uint8_t code, uint8_t type)
+{
+  uint8_t head, next;
+
+  head = keyEventHead;
+  next = (head + 1) & (KEY_EVENTS_QUEUE_LENGTH - 1);
+  if(next == keyEventTail)
+  {
+    keyEventOverflows++;
+    return;
+  }
+
+  keyEventQueue[head].type = type;
+  keyEventQueue[head].code = code;
+  keyEventQueue[head].time = keyEventTime;
+  keyEventHead = next;
+
+}/* end key_events_push() */
+
+/*
+ * ISR(KEY_EVENTS_vect)
+ *
+ * Run one scan of the keypad.
+ */
+ISR(KEY_EVENTS_vect)
+{
+
+  keyEventTime++;
+  KEY_EVENTS_SCAN();
+
+}/* end ISR(KEY_EVENTS_vect) */
+
+/*
+ * key_events_init()
+ *
+ * Start scanning the KEY_EVENTS_DRIVER keypad driver in the background.  The
+ * driver must be initialized first.  The timer is put in CTC mode with clock select clk
+ * (TC0_TCCR0B_CLK_... or TC2_TCCR2B_CLK_...) and OCRxA = top, so it
+ * interrupts at F_CPU / prescale / (top + 1).  Pick 1ms for the matrix
+ * keypads and 10ms for pbmxkeys, the rates their debounce and hold times are
+ * based on.
+ *
+ * Once started, read the keys only with key_events_get(), not with the
+ * driver's own flag functions.
+ */
+void key_events_init(uint8_t clk, uint8_t top)
+{
+#if KEY_EVENTS_TIMER == 0
+  TIMER_COUNTER0_TYPE timer;
+#else
+  TIMER_COUNTER2_TYPE timer;
+#endif
+
+  key_events_stop();
+
+  keyEventHead = 0;
+  keyEventTail = 0;
+  keyEventOverflows = 0;
+  keyEventTime = 0;
+
+  KEY_EVENTS_SET_CALLBACK(key_events_push);
+
+#if KEY_EVENTS_TIMER == 0
+  tc0_get_config(&timer);
+  timer.tccr0a.wgm0l = TC0_TCCR0A_M2_CTC;
+  timer.tccr0b.wgm0h = 0;
+  timer.tccr0b.cs0 = clk;
+  timer.tcnt0 = 0;
+  timer.ocr0a = top;
+  timer.timsk0.ocie0a = 1;
+  timer.tifr0.reg = (1<<OCF0A); /* writing 1 clears a pending match */
+  tc0_set_config(&timer);
+#else
+  tc2_get_config(&timer);
+  timer.tccr2a.wgm2l = TC2_TCCR2A_M2_CTC;
+  timer.tccr2b.wgm2h = 0;
+  timer.tccr2b.cs2 = clk;
+  timer.tcnt2 = 0;
+  timer.ocr2a = top;
+  timer.timsk2.ocie2a = 1;
+  timer.tifr2.reg = (1<<OCF2A); /* writing 1 clears a pending match */
+  tc2_set_config(&timer);
+#endif
+
+}/* end key_events_init() */
+
+/*
+ * key_events_stop()
+ *
+ * Stop the scan interrupt.  Events already in the ring can still be read.
+ */
+void key_events_stop(void)
+{
+
+#if KEY_EVENTS_TIMER == 0
+  TIMSK0 &= ~(1<<OCIE0A);
+#else
+  TIMSK2 &= ~(1<<OCIE2A);
+#endif
+
+}/* end key_events_stop() */
+
+/*
+ * key_events_get()
+ *
+ * Take the oldest event from the ring.  Returns 1 if there was one, 0 if the
+ * ring was empty.
+ */
+uint8_t key_events_get(KEY_EVENT_TYPE *event)
+{
+  uint8_t tail;
+
+  tail = keyEventTail;
+  if(tail == keyEventHead)
+  {
+    return(0);
+  }
+
+  *event = keyEventQueue[tail];
+  keyEventTail = (tail + 1) & (KEY_EVENTS_QUEUE_LENGTH - 1);
+
+  return(1);
+
+}/* end key_events_get() */
+
+/*
+ * key_events_pending()
+ *
+ * Returns the number of events waiting in the ring.
+ */
+uint8_t key_events_pending(void)
+{
+
+  return((keyEventHead - keyEventTail) & (KEY_EVENTS_QUEUE_LENGTH - 1));
+
+}/* end key_events_pending() */
+
+/*
+ * key_events_get_overflows()
+ *
+ * Returns the number of events lost because the ring was full, since the last
+ * call.
+ */
+uint8_t key_events_get_overflows(void)
+{
+  uint8_t sreg, count;
+
+  sreg = SREG;
+  cli();
+  count = keyEventOverflows;
+  keyEventOverflows = 0;
+  SREG = sreg;
+
+  return(count);
+
+}/* end key_events_get_overflows() */
+
+/*
+ * key_events_get_time()
+ *
+ * Returns the number of scans run so far, the time base of the events.
+ */
+uint16_t key_events_get_time(void)
+{
+  uint8_t sreg;
+  uint16_t time;
+
+  sreg = SREG;
+  cli();
+  time = keyEventTime;
+  SREG = sreg;
+
+  return(time);
+
+}/* end key_events_get_time() */
@@ -0,0 +1,124 @@
+/*
+ * keyEvents.h
+ *
+ * Created: 2026-10-14
+ * Author : Craig Hollinger
+ *
+ * Public interface for background keypad scanning.  The scan function of the
+ * matrix keypad (either engine) or multiplexed pushbutton driver, set by
+ * KEY_EVENTS_DRIVER, is run from a Timer/Counter 0 or 2 compare match
+ * interrupt, set by KEY_EVENTS_TIMER.  Only that driver is linked in.  Each
+ * key that is pressed, held or released puts an event, with the scan count as
+ * a time stamp, into a small ring that the application drains when it has
+ * time.  No key is lost while the main loop is busy, as long as the ring
+ * doesn't fill.
+ *
+ * The ring has a single producer (the timer interrupt) and a single consumer
+ * (the application), so no interrupts are held off to read it.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#ifndef _KEYEVENTS_H_
+#define _KEYEVENTS_H_ 1
+
+#include <stdint.h>
+
+/* Timer/Counter used for the scan interrupt, 0 or 2. */
+#ifndef KEY_EVENTS_TIMER
+#define KEY_EVENTS_TIMER 2
+#endif
+
+/* Drivers that can be scanned. */
+#define KEY_EVENTS_MATRIX    0 /* matrixKeypad, code is the user's key code */
+#define KEY_EVENTS_PBMX      1 /* pbmxkeys, code is the key's bit in the port */
+#define KEY_EVENTS_MATRIX_VC 2 /* matrixKeypadVC, code is the user's key code */
+
+/* Driver scanned, one of the above. */
+#ifndef KEY_EVENTS_DRIVER
+#define KEY_EVENTS_DRIVER KEY_EVENTS_MATRIX
+#endif
+
+/* Number of events the ring holds, must be a power of 2. */
+#ifndef KEY_EVENTS_QUEUE_LENGTH
+#define KEY_EVENTS_QUEUE_LENGTH 8
+#endif
+
+/* Types of event, also passed to the driver callbacks. */
+enum
+{
+  KEY_EVENT_PRESSED = 1, /* key debounced closed */
+  KEY_EVENT_HELD,        /* key closed for the hold time */
+  KEY_EVENT_RELEASED,    /* key debounced open */
+  KEY_EVENT_MAX
+};
+
+/* One key event.
+ *
+ * type: KEY_EVENT_PRESSED, KEY_EVENT_HELD or KEY_EVENT_RELEASED
+ * code: the key
+ * time: number of scans run when the event happened, wraps around
+ */
+typedef struct
+{
+  uint8_t type;
+  uint8_t code;
+  uint16_t time;
+
+} KEY_EVENT_TYPE;
+
+/*
+ * key_events_init()
+ *
+ * Start scanning the KEY_EVENTS_DRIVER keypad driver in the background.  The
+ * driver must be initialized first.  The timer is put in CTC mode with clock select clk
+ * (TC0_TCCR0B_CLK_... or TC2_TCCR2B_CLK_...) and OCRxA = top, so it
+ * interrupts at F_CPU / prescale / (top + 1).  Pick 1ms for the matrix
+ * keypads and 10ms for pbmxkeys, the rates their debounce and hold times are
+ * based on.
+ *
+ * Once started, read the keys only with key_events_get(), not with the
+ * driver's own flag functions.
+ */
+void key_events_init(uint8_t clk, uint8_t top);
+
+/*
+ * key_events_stop()
+ *
+ * Stop the scan interrupt.  Events already in the ring can still be read.
+ */
+void key_events_stop(void);
+
+/*
+ * key_events_get()
+ *
+ * Take the oldest event from the ring.  Returns 1 if there was one, 0 if the
+ * ring was empty.
+ */
+uint8_t key_events_get(KEY_EVENT_TYPE *event);
+
+/*
+ * key_events_pending()
+ *
+ * Returns the number of events waiting in the ring.
+ */
+uint8_t key_events_pending(void);
+
+/*
+ * key_events_get_overflows()
+ *
+ * Returns the number of events lost because the ring was full, since the last
+ * call.
+ */
+uint8_t key_events_get_overflows(void);
+
+/*
+ * key_events_get_time()
+ *
+ * Returns the number of scans run so far, the time base of the events.
+ */
+uint16_t key_events_get_time(void);
+
+#endif /* _KEYEVENTS_H_ */
@@ -24,6 +24,7 @@
  */ 
 #include <avr/io.h>
 #include "keypad/matrixKeypad.h"
+#include "keypad/keyEvents.h"
 
 /* flags to indicate detected keys */
 #define KEY_PRESSED_FLAG (0b00000001)
@@ -53,12 +54,39 @@ typedef struct
 /* an array of key structures */
 KEY_STRUCT_TYPE key[MATRIX_KEYPAD_MAX_KEYS];
 
+/* The IO ports and masks, constants if they are fixed when this is compiled
+   (see matrixKeypad.h), otherwise set by matrix_keypad_init(). */
+#ifdef MATRIX_KEYPAD_ROW_PORT
+
+#define KEYPAD_CAT(a, b) a##b
+#define KEYPAD_REG(a, b) KEYPAD_CAT(a, b)
+
+#define ROW_PORT KEYPAD_REG(PORT, MATRIX_KEYPAD_ROW_PORT)
+#define ROW_DDR  KEYPAD_REG(DDR, MATRIX_KEYPAD_ROW_PORT)
+#define ROW_PIN  KEYPAD_REG(PIN, MATRIX_KEYPAD_ROW_PORT)
+#define COL_PORT KEYPAD_REG(PORT, MATRIX_KEYPAD_COL_PORT)
+#define COL_DDR  KEYPAD_REG(DDR, MATRIX_KEYPAD_COL_PORT)
+#define ROW_MASK MATRIX_KEYPAD_ROW_MASK
+#define COL_MASK MATRIX_KEYPAD_COL_MASK
+
+#else
+
 /* pointers to the IO ports the rows and columns are connected to */
 volatile uint8_t *rowPORT, *colPORT, *rowDDR, *colDDR, *rowPIN;
 
 /* bit masks indicating which port pins are connected to a row or column */
 uint8_t rowMask, colMask;
 
+#define ROW_PORT (*rowPORT)
+#define ROW_DDR  (*rowDDR)
+#define ROW_PIN  (*rowPIN)
+#define COL_PORT (*colPORT)
+#define COL_DDR  (*colDDR)
+#define ROW_MASK rowMask
+#define COL_MASK colMask
+
+#endif /* MATRIX_KEYPAD_ROW_PORT */
+
 /* number of rows and columns in the matrix */
 uint8_t numRows, numCols;
 
@@ -68,6 +96,9 @@ uint8_t keyDebounceTime = DEBOUNCE_TIME;
 /* key hold time, used to reset each key's hold timer */
 uint16_t keyHoldTime = HOLD_TIME;
 
+/* called with the key code and a KEY_EVENT_... value when a key changes */
+void (*keyCallback)(uint8_t code, uint8_t event) = 0;
+
 /*
  * matrix_keypad)init()
  *
@@ -78,6 +109,7 @@ uint16_t keyHoldTime = HOLD_TIME;
  *                 are connected
  * rowMsk, colMsk: set bits indicate which IO pins are connected to a keypad
  *                 row or column
+ *                 (these four are ignored if the ports are fixed)
  * keyCodes:       pointer to an array of unique codes, one for each key
  * rows, cols:     number of rows and columns
  */
@@ -88,6 +120,12 @@ void matrix_keypad_init(volatile uint8_t *rowPt, uint8_t rowMsk,
 {
   uint8_t i;
 
+#ifdef MATRIX_KEYPAD_ROW_PORT
+  (void)rowPt;
+  (void)rowMsk;
+  (void)colPt;
+  (void)colMsk;
+#else
 /* setup pointers to row and column DDR and PIN registers */
   rowPORT = rowPt;
   colPORT = colPt;
@@ -95,18 +133,19 @@ void matrix_keypad_init(volatile uint8_t *rowPt, uint8_t rowMsk,
   colDDR = colPt - 1;
   rowPIN = rowPt - 2;
 
-/* initialize number of rows and columns */
-  numRows = rows;
-  numCols = cols;
-
 /* initialize row and column masks */
   rowMask = rowMsk;
   colMask = colMsk;
+#endif
+
+/* initialize number of rows and columns */
+  numRows = rows;
+  numCols = cols;
 
 /* The rows will be read while the columns are driven low one at a time.  Setup
    the row pins to be inputs with pull-ups enabled. */
-  *rowDDR &= ~rowMsk;
-  *rowPORT |= rowMsk; /* enable internal pull up resistors */
+  ROW_DDR &= ~ROW_MASK;
+  ROW_PORT |= ROW_MASK; /* enable internal pull up resistors */
 
 /* initialize the variables for each of the keys */
   for(i = 0; i < (cols * rows); i++)
@@ -146,17 +185,17 @@ uint8_t matrix_keypad_scan_keys(void)
   for(col = 0; col < numCols; col++)
   {
     /* find next active keypad column */
-    while((colMask & colMskTemp) == 0)
+    while((COL_MASK & colMskTemp) == 0)
     {
       colMskTemp <<= 1;
       if(--col_i == 0)
       {
         return(0);
       }
-    }/* end while((colMask & colMskTemp) == 0) */
+    }/* end while((COL_MASK & colMskTemp) == 0) */
 
-    *colDDR |= colMskTemp; /* make column pin output */
-    *colPORT &= ~colMskTemp; /* make column pin low */
+    COL_DDR |= colMskTemp; /* make column pin output */
+    COL_PORT &= ~colMskTemp; /* make column pin low */
 
     rowMskTemp = 1;
     row_i = 8;
@@ -165,17 +204,17 @@ uint8_t matrix_keypad_scan_keys(void)
     for(row = 0; row < numRows; row++)
     {
       /* find next active keypad row pin */
-      while((rowMask & rowMskTemp) == 0)
+      while((ROW_MASK & rowMskTemp) == 0)
       {
         rowMskTemp <<= 1;
         if(--row_i == 0)
         {
           return(0);
         }
-      }/* end while((rowMask & rowMskTemp) == 0) */
+      }/* end while((ROW_MASK & rowMskTemp) == 0) */
 
       keyIndex = row * numCols + col;
-      curRowPin = *rowPIN & rowMskTemp;
+      curRowPin = ROW_PIN & rowMskTemp;
 
       /* **** Check the key state ****
        *
@@ -214,6 +253,10 @@ uint8_t matrix_keypad_scan_keys(void)
               key[keyIndex].flags |= (KEY_PRESSED_FLAG | KEY_CHANGED_FLAG);
               validKey = 1;
               key[keyIndex].holdTimer = keyHoldTime;
+              if(keyCallback != 0)
+              {
+                keyCallback(key[keyIndex].code, KEY_EVENT_PRESSED);
+              }
             }
           }
           else
@@ -239,6 +282,10 @@ uint8_t matrix_keypad_scan_keys(void)
               key[keyIndex].state = KEYPAD_HELD;
               key[keyIndex].flags |= (KEY_HELD_FLAG | KEY_CHANGED_FLAG);
               validKey = 1;
+              if(keyCallback != 0)
+              {
+                keyCallback(key[keyIndex].code, KEY_EVENT_HELD);
+              }
 
             }/* end if(--key[keyIndex].holdTimer == 0) */
           }
@@ -280,6 +327,10 @@ uint8_t matrix_keypad_scan_keys(void)
             {
               key[keyIndex].state = KEYPAD_IDLE;
               key[keyIndex].flags |= KEY_CHANGED_FLAG;
+              if(keyCallback != 0)
+              {
+                keyCallback(key[keyIndex].code, KEY_EVENT_RELEASED);
+              }
             }
           }/* end if(curRowPin != 0) */
           break;
@@ -295,8 +346,8 @@ uint8_t matrix_keypad_scan_keys(void)
 
     }/* end for(row = 0; row < numRows; row++) */
 
-    *colPORT |= colMskTemp;/* make column pin high */
-    *colDDR &= ~colMskTemp;/* make port pin input */
+    COL_PORT |= colMskTemp;/* make column pin high */
+    COL_DDR &= ~colMskTemp;/* make port pin input */
     colMskTemp <<= 1; /* look for next active column */
     col_i--;
 
@@ -419,3 +470,16 @@ uint8_t matrix_keypad_get_status(char *keyStr)
   return(changed);
 
 }/* end matrix_keypad_get_pressed_status() */
+
+/*
+ * matrix_keypad_set_callback()
+ *
+ * Set a function to be called from matrix_keypad_scan_keys() each time a key
+ * is pressed, held or released.  It is passed the key's code and one of the
+ * KEY_EVENT_... values in keyEvents.h.  Use 0 for no callback.
+ */
+void matrix_keypad_set_callback(void (*callback)(uint8_t code, uint8_t event))
+{
+  keyCallback = callback;
+
+}/* end matrix_keypad_set_callback() */
@@ -26,6 +26,18 @@
 /* maximum number of keys that can be processed */
 #define MATRIX_KEYPAD_MAX_KEYS (16)
 
+/* The keypad ports and pins can be fixed when the driver is compiled instead
+ * of being passed to matrix_keypad_init(), by defining the port letters and
+ * the masks, for example:
+ *
+ *   -DMATRIX_KEYPAD_ROW_PORT=D -DMATRIX_KEYPAD_ROW_MASK=0xf0
+ *   -DMATRIX_KEYPAD_COL_PORT=B -DMATRIX_KEYPAD_COL_MASK=0x0f
+ *
+ * The scan then uses the port registers and masks as constants rather than
+ * going through pointers.  The port and mask arguments of matrix_keypad_init()
+ * are ignored.  matrixKeypadVC.c takes the same defines.
+ */
+
 /* These times will be determined by how often the key scan process is called,
  * 1ms works but 10ms works too.
  */
@@ -56,5 +68,6 @@ uint8_t matrix_keypad_get_held_keys(char * keyStr);
 void matrix_keypad_set_hold_time(uint16_t time);
 void matrix_keypad_set_debounce_time(uint8_t time);
 uint8_t matrix_keypad_get_status(char *keyStr);
+void matrix_keypad_set_callback(void (*callback)(uint8_t code, uint8_t event));
 
 #endif /* _MATRIXKEYPAD_H_ */
@@ -0,0 +1,373 @@
+/*
+ * matrixKeypadVC.c
+ *
+ * Created: 2026-10-14
+ * Author : Craig Hollinger
+ *
+ * This file contains a bit-parallel driver for reading the keys of a matrix
+ * keypad.  The column lines are driven low one at a time and the row port is
+ * read once for each.  The rows of that column are then debounced all at once
+ * with a 2-bit vertical counter: bit n of vcCnt0[col] and vcCnt1[col] count
+ * how many scans in a row key (n, col) has read different from its debounced
+ * state.  When the count wraps the key's state toggles, any scan that agrees
+ * with the state resets the count.
+ *
+ * Keys are kept in the row port's bit positions, so row n of a column is the
+ * n'th set bit of the row mask.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#include <avr/io.h>
+#include "keypad/matrixKeypadVC.h"
+#include "keypad/keyEvents.h"
+
+/* **** Local variables **** */
+
+/* The IO ports and masks, constants if they are fixed when this is compiled
+   (see matrixKeypad.h), otherwise set by matrix_keypad_vc_init(). */
+#ifdef MATRIX_KEYPAD_ROW_PORT
+
+#define KEYPAD_CAT(a, b) a##b
+#define KEYPAD_REG(a, b) KEYPAD_CAT(a, b)
+
+#define VC_ROW_PORT KEYPAD_REG(PORT, MATRIX_KEYPAD_ROW_PORT)
+#define VC_ROW_DDR  KEYPAD_REG(DDR, MATRIX_KEYPAD_ROW_PORT)
+#define VC_ROW_PIN  KEYPAD_REG(PIN, MATRIX_KEYPAD_ROW_PORT)
+#define VC_COL_PORT KEYPAD_REG(PORT, MATRIX_KEYPAD_COL_PORT)
+#define VC_COL_DDR  KEYPAD_REG(DDR, MATRIX_KEYPAD_COL_PORT)
+#define VC_ROW_MASK MATRIX_KEYPAD_ROW_MASK
+
+#else
+
+/* pointers to the IO ports the rows and columns are connected to */
+volatile uint8_t *vcRowPORT, *vcColPORT, *vcRowDDR, *vcColDDR, *vcRowPIN;
+
+/* bit mask of the row pins */
+uint8_t vcRowMask;
+
+#define VC_ROW_PORT (*vcRowPORT)
+#define VC_ROW_DDR  (*vcRowDDR)
+#define VC_ROW_PIN  (*vcRowPIN)
+#define VC_COL_PORT (*vcColPORT)
+#define VC_COL_DDR  (*vcColDDR)
+#define VC_ROW_MASK vcRowMask
+
+#endif /* MATRIX_KEYPAD_ROW_PORT */
+
+/* the pin of each column in scan order */
+uint8_t vcColBit[MATRIX_KEYPAD_VC_MAX_COLS];
+
+/* number of rows and columns in the matrix */
+uint8_t vcNumRows, vcNumCols;
+
+/* user supplied key codes, row * cols + col */
+char *vcKeyCodes;
+
+/* Per column, one bit per row:
+ *
+ * vcCnt0, vcCnt1: vertical debounce counter
+ * vcState       : debounced state, 1 = pressed
+ * vcPressed     : pressed since matrix_keypad_vc_get_pressed_keys()
+ * vcHeld        : held since matrix_keypad_vc_get_held_keys()
+ * vcHeldState   : already flagged held during this press
+ */
+uint8_t vcCnt0[MATRIX_KEYPAD_VC_MAX_COLS],
+        vcCnt1[MATRIX_KEYPAD_VC_MAX_COLS],
+        vcState[MATRIX_KEYPAD_VC_MAX_COLS],
+        vcPressed[MATRIX_KEYPAD_VC_MAX_COLS],
+        vcHeld[MATRIX_KEYPAD_VC_MAX_COLS],
+        vcHeldState[MATRIX_KEYPAD_VC_MAX_COLS];
+
+/* shared hold timer, restarted when any key is pressed */
+uint16_t vcHoldTime = MATRIX_KEYPAD_VC_HOLD_TIME,
+         vcHoldTimer = MATRIX_KEYPAD_VC_HOLD_TIME;
+
+/* called with the key code and a KEY_EVENT_... value when a key changes */
+void (*vcCallback)(uint8_t code, uint8_t event) = 0;
+
+/*
+ * matrix_keypad_vc_event()
+ *
+ * Report the keys set in bits of column col to the callback.
+ */
+void matrix_keypad_vc_event(uint8_t col, uint8_t bits, uint8_t event)
+{
+  uint8_t row, rowMskTemp;
+
+  row = 0;
+  for(rowMskTemp = 1; rowMskTemp != 0; rowMskTemp <<= 1)
+  {
+    if((VC_ROW_MASK & rowMskTemp) != 0)
+    {
+      if((bits & rowMskTemp) != 0)
+      {
+        vcCallback(vcKeyCodes[row * vcNumCols + col], event);
+      }
+      row++;
+    }
+  }/* end for(rowMskTemp = 1; rowMskTemp != 0; rowMskTemp <<= 1) */
+
+}/* end matrix_keypad_vc_event() */
+
+/*
+ * matrix_keypad_vc_get_keys()
+ *
+ * Write the codes of the keys set in flags[] to keyStr as a zero terminated
+ * string and clear the flags.  Returns 1 if there were any.
+ */
+uint8_t matrix_keypad_vc_get_keys(uint8_t *flags, char *keyStr)
+{
+  uint8_t row, col, j, bits, rowMskTemp;
+
+  j = 0;
+  for(col = 0; col < vcNumCols; col++)
+  {
+    bits = flags[col];
+    flags[col] = 0;
+    if(bits == 0)
+    {
+      continue;
+    }
+
+    row = 0;
+    for(rowMskTemp = 1; rowMskTemp != 0; rowMskTemp <<= 1)
+    {
+      if((VC_ROW_MASK & rowMskTemp) != 0)
+      {
+        if((bits & rowMskTemp) != 0)
+        {
+          keyStr[j++] = vcKeyCodes[row * vcNumCols + col];
+        }
+        row++;
+      }
+    }/* end for(rowMskTemp = 1; rowMskTemp != 0; rowMskTemp <<= 1) */
+  }/* end for(col = 0; col < vcNumCols; col++) */
+
+  keyStr[j] = 0;
+
+  return(j != 0);
+
+}/* end matrix_keypad_vc_get_keys() */
+
+/*
+ * matrix_keypad_vc_init()
+ *
+ * Initialize the keypad scanning process.  Setup the IO ports and clear the
+ * state of all the keys.
+ *
+ * rowPt, colPt:   pointers to the IO ports where keypad row and column lines
+ *                 are connected
+ * rowMsk, colMsk: set bits indicate which IO pins are connected to a keypad
+ *                 row or column
+ *                 (these four are ignored if the ports are fixed)
+ * keyCodes:       pointer to an array of unique codes, one for each key, it
+ *                 is used in place so must stay valid
+ * rows, cols:     number of rows and columns
+ */
+void matrix_keypad_vc_init(volatile uint8_t *rowPt, uint8_t rowMsk,
+                           volatile uint8_t *colPt, uint8_t colMsk,
+                           char *keyCodes,
+                           uint8_t rows, uint8_t cols)
+{
+  uint8_t col, colMskTemp;
+
+#ifdef MATRIX_KEYPAD_ROW_PORT
+  (void)rowPt;
+  (void)rowMsk;
+  (void)colPt;
+  colMsk = MATRIX_KEYPAD_COL_MASK;
+#else
+/* setup pointers to row and column DDR and PIN registers */
+  vcRowPORT = rowPt;
+  vcColPORT = colPt;
+  vcRowDDR = rowPt - 1;
+  vcColDDR = colPt - 1;
+  vcRowPIN = rowPt - 2;
+
+  vcRowMask = rowMsk;
+#endif
+  vcNumRows = rows;
+  vcKeyCodes = keyCodes;
+
+/* find the column pins once, so the scan doesn't have to search for them */
+  col = 0;
+  for(colMskTemp = 1; colMskTemp != 0 && col < cols &&
+      col < MATRIX_KEYPAD_VC_MAX_COLS; colMskTemp <<= 1)
+  {
+    if((colMsk & colMskTemp) != 0)
+    {
+      vcColBit[col++] = colMskTemp;
+    }
+  }
+  vcNumCols = col;
+
+/* The rows will be read while the columns are driven low one at a time.  Setup
+   the row pins to be inputs with pull-ups enabled. */
+  VC_ROW_DDR &= ~VC_ROW_MASK;
+  VC_ROW_PORT |= VC_ROW_MASK; /* enable internal pull up resistors */
+
+  for(col = 0; col < MATRIX_KEYPAD_VC_MAX_COLS; col++)
+  {
+    vcCnt0[col] = 0;
+    vcCnt1[col] = 0;
+    vcState[col] = 0;
+    vcPressed[col] = 0;
+    vcHeld[col] = 0;
+    vcHeldState[col] = 0;
+  }
+  vcHoldTimer = vcHoldTime;
+
+}/* end matrix_keypad_vc_init() */
+
+/*
+ * matrix_keypad_vc_scan_keys()
+ *
+ * Drive each column low in turn, read the row port and debounce all the keys
+ * of that column.  Call at a regular interval, 1ms is assumed.  Returns 1 if a
+ * key has been pressed or held by this scan.
+ */
+uint8_t matrix_keypad_vc_scan_keys(void)
+{
+  uint8_t col, colMskTemp, sample, delta, toggle, pressed, down,
+          validKey;
+
+  validKey = 0;
+  pressed = 0;
+  down = 0;
+
+  for(col = 0; col < vcNumCols; col++)
+  {
+    colMskTemp = vcColBit[col];
+    VC_COL_DDR |= colMskTemp; /* make column pin output */
+    VC_COL_PORT &= ~colMskTemp; /* make column pin low */
+    __asm__ __volatile__ ("nop"); /* let the input synchronizer catch up */
+    sample = ~VC_ROW_PIN & VC_ROW_MASK;
+    VC_COL_PORT |= colMskTemp;/* make column pin high */
+    VC_COL_DDR &= ~colMskTemp;/* make port pin input */
+
+    /* count scans where the key differs from its state, toggle on the 4th */
+    delta = sample ^ vcState[col];
+    vcCnt1[col] = (vcCnt1[col] ^ vcCnt0[col]) & delta;
+    vcCnt0[col] = ~vcCnt0[col] & delta;
+    toggle = delta & ~(vcCnt0[col] | vcCnt1[col]);
+    vcState[col] ^= toggle;
+
+    if(toggle != 0)
+    {
+      vcPressed[col] |= toggle & vcState[col];
+      vcHeldState[col] &= vcState[col];
+      pressed |= toggle & vcState[col];
+      if(vcCallback != 0)
+      {
+        matrix_keypad_vc_event(col, toggle & vcState[col], KEY_EVENT_PRESSED);
+        matrix_keypad_vc_event(col, toggle & ~vcState[col], KEY_EVENT_RELEASED);
+      }
+    }/* end if(toggle != 0) */
+
+    down |= vcState[col] & ~vcHeldState[col];
+
+  }/* end for(col = 0; col < vcNumCols; col++) */
+
+  /* any new press restarts the hold timer for all the keys */
+  if(pressed != 0 || down == 0)
+  {
+    vcHoldTimer = vcHoldTime;
+  }
+  else if(--vcHoldTimer == 0)
+  {
+    vcHoldTimer = vcHoldTime;
+    for(col = 0; col < vcNumCols; col++)
+    {
+      down = vcState[col] & ~vcHeldState[col];
+      vcHeld[col] |= down;
+      vcHeldState[col] |= down;
+      if(vcCallback != 0 && down != 0)
+      {
+        matrix_keypad_vc_event(col, down, KEY_EVENT_HELD);
+      }
+    }
+    validKey = 1;
+  }/* end if(pressed != 0 || down == 0) */
+
+  if(pressed != 0)
+  {
+    validKey = 1;
+  }
+
+  return(validKey);
+
+}/* end matrix_keypad_vc_scan_keys() */
+
+/*
+ * matrix_keypad_vc_get_pressed_keys()
+ *
+ * Write the codes of the keys pressed since the last call to keyStr as a zero
+ * terminated string.  keyStr must be big enough for all the keys plus one.
+ * Returns 1 if any key was pressed.
+ */
+uint8_t matrix_keypad_vc_get_pressed_keys(char *keyStr)
+{
+
+  return(matrix_keypad_vc_get_keys(vcPressed, keyStr));
+
+}/* end matrix_keypad_vc_get_pressed_keys() */
+
+/*
+ * matrix_keypad_vc_get_held_keys()
+ *
+ * Write the codes of the keys held since the last call to keyStr as a zero
+ * terminated string.  keyStr must be big enough for all the keys plus one.
+ * Returns 1 if any key was held.
+ */
+uint8_t matrix_keypad_vc_get_held_keys(char *keyStr)
+{
+
+  return(matrix_keypad_vc_get_keys(vcHeld, keyStr));
+
+}/* end matrix_keypad_vc_get_held_keys() */
+
+/*
+ * matrix_keypad_vc_get_column()
+ *
+ * Return the debounced state of the keys in column col, one bit per row in
+ * the row port's bit positions, 1 = pressed.
+ */
+uint8_t matrix_keypad_vc_get_column(uint8_t col)
+{
+
+  if(col >= vcNumCols)
+  {
+    return(0);
+  }
+
+  return(vcState[col]);
+
+}/* end matrix_keypad_vc_get_column() */
+
+/*
+ * matrix_keypad_vc_set_hold_time()
+ *
+ * Set the key hold time in multiples of the interval that
+ * matrix_keypad_vc_scan_keys() is called.
+ */
+void matrix_keypad_vc_set_hold_time(uint16_t time)
+{
+  vcHoldTime = time;
+
+}/* end matrix_keypad_vc_set_hold_time() */
+
+/*
+ * matrix_keypad_vc_set_callback()
+ *
+ * Set a function to be called from matrix_keypad_vc_scan_keys() each time a
+ * key is pressed, held or released.  It is passed the key's code and one of
+ * the KEY_EVENT_... values in keyEvents.h.  Use 0 for no callback.
+ */
+void matrix_keypad_vc_set_callback(void (*callback)(uint8_t code, uint8_t event))
+{
+  vcCallback = callback;
+
+}/* end matrix_keypad_vc_set_callback() */
@@ -0,0 +1,45 @@
+/*
+ * matrixKeypadVC.h
+ *
+ * Created: 2026-10-14
+ * Author : Craig Hollinger
+ *
+ * Public interface for a bit-parallel driver for reading the keys of a matrix
+ * keypad.  It is wired and used the same way as matrixKeypad, but the row
+ * port is read once per column and all the rows of a column are debounced
+ * together with vertical counters.  The state of every key is a bit in a
+ * per-column byte, so a 4x4 pad needs about 20 bytes of RAM instead of 96.
+ *
+ * A key changes state after it has read the same for 4 scans in a row.  The
+ * hold timer is shared: keys that stay pressed for the hold time without any
+ * other key being pressed are flagged held together.
+ *
+ * Up to 8 rows and 8 columns.  If binary codes are used, the zero code cannot
+ * be used to identify a key.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#ifndef _MATRIXKEYPADVC_H_
+#define _MATRIXKEYPADVC_H_ 1
+
+/* maximum number of columns that can be processed */
+#define MATRIX_KEYPAD_VC_MAX_COLS (8)
+
+/* Number of scans to determine if a key is held, assumes 1ms refresh rate. */
+#define MATRIX_KEYPAD_VC_HOLD_TIME (1000)
+
+void matrix_keypad_vc_init(volatile uint8_t *rowPt, uint8_t rowMsk,
+                           volatile uint8_t *colPt, uint8_t colMsk,
+                           char *keyCodes,
+                           uint8_t rows, uint8_t cols);
+uint8_t matrix_keypad_vc_scan_keys(void);
+uint8_t matrix_keypad_vc_get_pressed_keys(char *keyStr);
+uint8_t matrix_keypad_vc_get_held_keys(char *keyStr);
+uint8_t matrix_keypad_vc_get_column(uint8_t col);
+void matrix_keypad_vc_set_hold_time(uint16_t time);
+void matrix_keypad_vc_set_callback(void (*callback)(uint8_t code, uint8_t event));
+
+#endif /* _MATRIXKEYPADVC_H_ */
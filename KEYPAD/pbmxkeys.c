@@ -18,6 +18,7 @@
 
 #include  <avr/io.h>
 #include  <keypad/pbmxkeys.h>
+#include  <keypad/keyEvents.h>
 
 /*
  These are the states the keypad process can be in.
@@ -53,6 +54,12 @@ unsigned char PBKeysMask,
 volatile uint8_t PBKeyHeldFlgs;
 volatile uint8_t PBKeyPrsdFlgs;
 
+/*
+ Called with the key code and a KEY_EVENT_... value when a key changes.
+*/
+
+void (*PBKeyCallback)(uint8_t code, uint8_t event) = 0;
+
 /*
  * pbmxkeys_init()
  *
@@ -134,6 +141,10 @@ void  pbmxkeys_run(void)
       if((~(*PBKeysPIN) & PBKeysMask) == PBKeyCode)
       {
         PBKeyState = PBKeyPressed;  /* the key was pressed */
+        if(PBKeyCallback != 0)
+        {
+          PBKeyCallback(PBKeyCode, KEY_EVENT_PRESSED);
+        }
       }
       else
       {
@@ -159,6 +170,10 @@ void  pbmxkeys_run(void)
           PBKeyHeldTimer = PBKEYHOLDTIME;
           PBKeyState = PBKeyHeld;
           PBKeyHeldFlgs |= PBKeyCode; /* set the key held flag */
+          if(PBKeyCallback != 0)
+          {
+            PBKeyCallback(PBKeyCode, KEY_EVENT_HELD);
+          }
         } // end if(--PBKeyHeldTimer == 0)
       } // end if((~(*PBKeysPIN) & PBKeysMask) == PBKeyCode)
       else
@@ -201,6 +216,10 @@ void  pbmxkeys_run(void)
         PBKeyHeldTimer = PBKEYHOLDTIME;
         PBKeyState = PBKeyNotProcess;
         PBKeyPrsdFlgs |= PBKeyCode;
+        if(PBKeyCallback != 0)
+        {
+          PBKeyCallback(PBKeyCode, KEY_EVENT_RELEASED);
+        }
       }/* end if(!((~(*PBKeysPIN) & PBKeysMask) == PBKeyCode)) */
 
       break;
@@ -222,6 +241,10 @@ void  pbmxkeys_run(void)
       else
       {
         PBKeyState = PBKeyNotProcess;
+        if(PBKeyCallback != 0)
+        {
+          PBKeyCallback(PBKeyCode, KEY_EVENT_RELEASED);
+        }
       }
 
       break;
@@ -282,3 +305,17 @@ unsigned char pbmxkeys_get_flags(void)
   return(flags);
 
 }/* end pbmxkeys_get_flags() */
+
+/*
+ * pbmxkeys_set_callback()
+ *
+ * Set a function to be called from pbmxkeys_run() each time a key is pressed,
+ * held or released.  It is passed the key's bit in the IO port and one of the
+ * KEY_EVENT_... values in keyEvents.h.  Use 0 for no callback.
+ */
+void pbmxkeys_set_callback(void (*callback)(uint8_t code, uint8_t event))
+{
+
+  PBKeyCallback = callback;
+
+}/* end pbmxkeys_set_callback() */
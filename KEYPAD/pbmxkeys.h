@@ -33,5 +33,6 @@ void pbmxkeys_init(volatile uint8_t *keyPort, unsigned char keyMask);
 void pbmxkeys_run(void);
 void pbmxkeys_clear(void);
 unsigned char pbmxkeys_get_flags(void);
+void pbmxkeys_set_callback(void (*callback)(uint8_t code, uint8_t event));
 
 #endif /* _PBMXKEYS_H_ */
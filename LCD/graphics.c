@@ -21,6 +21,15 @@
  * will be found in the module associated with the display.  Displays will have
  * different interfaces to the microcontroller: I2C, SPI, UART, parallel, etc.
  *
+ * For each page (row of bytes) of the frame, the range of columns changed since
+ * the last upload is kept.  The display module can then send just the parts of
+ * the frame that have changed.
+ *
+ * The frame is normally allocated by graphics_init() with malloc().  If
+ * GRAPHICS_FRAME_WIDTH and GRAPHICS_FRAME_HEIGHT are defined (see graphics.h)
+ * it is a static array instead, and the frame dimensions are constants so the
+ * compiler can use shifts and fixed strides for them.
+ *
  * The font for text characters is contained in its own module (font5x7.c) and
  * is interfaced with font5x7.h.  If a different font is desired, a different
  * font module can be used and this file modified accordingly.
@@ -32,24 +41,53 @@
  */
 #include <avr/io.h>
 #include <stdlib.h>
+#include <string.h>
 #include <avr/pgmspace.h>
 #include "graphics/graphics.h"
 #include "graphics/font5x7.h"
+#include "prof/prof.h"
 
 /* This points to the RAM area that would store a copy of the display.  This
    area needs to be big enough to store the data for the chosen display. */
 uint8_t *graphics_frame = 0;
 
+/* With GRAPHICS_BUFFERS 2, the frame that was last handed to the display by
+   graphics_swap() while graphics_frame is drawn into. */
+uint8_t *graphics_front = 0;
+
+/* Dirty region of each page (8 pixel high row of bytes) of the frame: the
+   first and last columns changed since the page was last sent to the display.
+   A page is clean when min > max.  These are allocated ahead of the frame. */
+uint8_t *graphics_dirty_min = 0,
+        *graphics_dirty_max = 0;
+
+#ifdef GRAPHICS_FRAME_WIDTH
+/* The dirty regions and the frame(s), placed at build time. */
+uint8_t graphics_frame_buffer[2 * GRAPHICS_FRAME_PAGES + GRAPHICS_BUFFERS * GRAPHICS_FRAME_SIZE];
+
+/* The frame dimensions are constants. */
+#define graphics_max_x GRAPHICS_FRAME_WIDTH
+#define graphics_max_y GRAPHICS_FRAME_HEIGHT
+#else
+uint8_t graphics_max_x = 0,
+        graphics_max_y = 0;
+#endif /* GRAPHICS_FRAME_WIDTH */
+
 /* Local variables.  Their names should be enough description. */
 uint8_t graphics_cursor_x = 0,
         graphics_cursor_y = 0,
-        graphics_max_x = 0,
-        graphics_max_y = 0,
         graphics_text_size = 1,
         fg_colour = GRAPHICS_COLOUR_WHITE,
         bg_colour = GRAPHICS_COLOUR_BLACK,
         graphics_rotation = GRAPHICS_ROTATION_0;
 
+/* Clip rectangle, inclusive.  Nothing is drawn outside it.  It is the whole
+   frame unless graphics_set_clip() is used. */
+uint8_t graphics_clip_x0 = 0,
+        graphics_clip_y0 = 0,
+        graphics_clip_x1 = 0,
+        graphics_clip_y1 = 0;
+
 /*
  * graphics_init()
  *
@@ -59,26 +97,60 @@ uint8_t graphics_cursor_x = 0,
  * It is up to the user to ensure there is enough RAM in the microcontroller
  * to contain all the bytes needed to represent the chosen display.  For the
  * best security, the calling function should check the returned value.  If
- * zero, then malloc could not allocate enough memory and if the pointer is used
- * the program would likely crash.
+ * not zero, then malloc could not allocate enough memory and if the pointer is
+ * used the program would likely crash.
+ *
+ * With a static frame (GRAPHICS_FRAME_WIDTH defined) nothing is allocated, and
+ * 1 is returned if max_x and max_y aren't the size the frame was built for.
  */
 uint8_t graphics_init(uint8_t max_x, uint8_t max_y)
 {
-  graphics_frame = (uint8_t *)malloc(max_x * max_y / 8);
+#ifdef GRAPHICS_FRAME_WIDTH
+
+/* the static frame only fits the display it was built for */
+  if((max_x != GRAPHICS_FRAME_WIDTH) || (max_y != GRAPHICS_FRAME_HEIGHT))
+  {
+    return(1);
+  }
+
+  graphics_dirty_min = graphics_frame_buffer;
+
+#else
+  uint16_t size = (uint16_t)max_x * ((max_y + 7) / 8);
 
-  if(graphics_frame == 0){
+/* the dirty regions of each page and the frame(s) in one chunk */
+  graphics_dirty_min = (uint8_t *)malloc(2 * ((max_y + 7) / 8) +
+                                         GRAPHICS_BUFFERS * size);
+
+  if(graphics_dirty_min == 0){
     return(1);
   }
 
   graphics_max_x = max_x;
   graphics_max_y = max_y;
+
+#endif /* GRAPHICS_FRAME_WIDTH */
+
+  graphics_dirty_max = graphics_dirty_min + ((graphics_max_y + 7) / 8);
+  graphics_frame = graphics_dirty_max + ((graphics_max_y + 7) / 8);
+#if GRAPHICS_BUFFERS == 2
+  graphics_front = graphics_frame + graphics_frame_size();
+#else
+  graphics_front = graphics_frame;
+#endif
+
   graphics_cursor_x = 0;
   graphics_cursor_y = 0;
   graphics_text_size = 1;
   fg_colour = GRAPHICS_COLOUR_WHITE;
   bg_colour = GRAPHICS_COLOUR_BLACK;
+  graphics_reset_clip();
 
+  graphics_clean();
   graphics_clear();
+#if GRAPHICS_BUFFERS == 2
+  memcpy(graphics_front, graphics_frame, graphics_frame_size());
+#endif
 
   return(0);
 
@@ -91,19 +163,67 @@ uint8_t graphics_init(uint8_t max_x, uint8_t max_y)
  */
 void graphics_exit(void)
 {
-  if(graphics_frame != 0){
-    free(graphics_frame);
+#ifndef GRAPHICS_FRAME_WIDTH
+  if(graphics_dirty_min != 0){
+    free(graphics_dirty_min);
   }
+#endif
 
   graphics_frame = 0;
+  graphics_front = 0;
+  graphics_dirty_min = 0;
+  graphics_dirty_max = 0;
 
 }/* end graphics_exit() */
 
+/*
+ * graphics_frame_size()
+ *
+ * Return the number of bytes in one frame.
+ */
+uint16_t graphics_frame_size(void)
+{
+
+  return((uint16_t)graphics_max_x * ((graphics_max_y + 7) / 8));
+
+}/* end graphics_frame_size() */
+
+/*
+ * graphics_swap()
+ *
+ * Hand the frame that has just been drawn to the display module and return a
+ * pointer to it.  With GRAPHICS_BUFFERS 2 the two frames are swapped: the
+ * returned one must be left alone until the display has finished with it, and
+ * drawing carries on in the other, which starts as a copy so nothing is lost.
+ * With one buffer this is the same as graphics_get_frame().
+ */
+uint8_t *graphics_swap(void)
+{
+#if GRAPHICS_BUFFERS == 2
+  uint8_t *frame;
+
+  if(graphics_frame == 0)
+  {
+    return(0);
+  }
+
+  frame = graphics_frame;
+  graphics_frame = graphics_front;
+  graphics_front = frame;
+  memcpy(graphics_frame, graphics_front, graphics_frame_size());
+
+  return(graphics_front);
+#else
+  return(graphics_frame);
+#endif
+
+}/* end graphics_swap() */
+
 /*
  * graphics_get_frame()
  *
  * Returns a pointer to the area of RAM containing the pixel data of the
- * display.
+ * display.  With GRAPHICS_BUFFERS 2 this is the frame being drawn into.
  */
 uint8_t *graphics_get_frame(void)
 {
@@ -126,23 +246,197 @@ void swap(uint8_t *a, uint8_t *b)
 }
 
 /*
- * graphics_clear()
+ * graphics_mark_dirty()
  *
- * Write the background colour to the local graphics memory.
+ * Mark the area from column x0 to x1 and row y0 to y1 (inclusive) as changed,
+ * so that it will be sent to the display by the next partial update.  Anything
+ * drawn with the functions here is marked already, this is only needed if the
+ * frame is changed directly through graphics_get_frame().
  */
-void graphics_clear(void)
+void graphics_mark_dirty(uint8_t x0, uint8_t x1, uint8_t y0, uint8_t y1)
 {
+  uint8_t page;
+
+  if(graphics_frame == 0)
+  {
+    return;
+  }
+
+  if(x0 > x1)
+  {
+    swap(&x0, &x1);
+  }
+  if(y0 > y1)
+  {
+    swap(&y0, &y1);
+  }
+  if((x0 >= graphics_max_x) || (y0 >= graphics_max_y))
+  {
+    return;
+  }
+  if(x1 >= graphics_max_x)
+  {
+    x1 = graphics_max_x - 1;
+  }
+  if(y1 >= graphics_max_y)
+  {
+    y1 = graphics_max_y - 1;
+  }
 
-  if(graphics_frame != 0)
+  for(page = y0 / 8; page <= y1 / 8; page++)
   {
-    for(uint16_t i = 0; i < (graphics_max_x * graphics_max_y / 8); i++)
+    if(x0 < graphics_dirty_min[page])
     {
-      graphics_frame[i] = bg_colour;
+      graphics_dirty_min[page] = x0;
     }
-  }  
+    if(x1 > graphics_dirty_max[page])
+    {
+      graphics_dirty_max[page] = x1;
+    }
+  }/* end for(page = y0 / 8; page <= y1 / 8; page++) */
+
+}/* end graphics_mark_dirty() */
+
+/*
+ * graphics_get_dirty()
+ *
+ * Get the dirty region of one page of the frame.  If any of the page has
+ * changed, put the first and last changed columns in x0 and x1 and return 1.
+ * Return 0 if the page hasn't changed.
+ */
+uint8_t graphics_get_dirty(uint8_t page, uint8_t *x0, uint8_t *x1)
+{
+
+  if((graphics_frame == 0) || (page >= ((graphics_max_y + 7) / 8)) ||
+     (graphics_dirty_min[page] > graphics_dirty_max[page]))
+  {
+    return(0);
+  }
+
+  *x0 = graphics_dirty_min[page];
+  *x1 = graphics_dirty_max[page];
+
+  return(1);
+
+}/* end graphics_get_dirty() */
+
+/*
+ * graphics_clean()
+ *
+ * Mark every page of the frame as unchanged.  Called by the display module once
+ * the frame has been sent.
+ */
+void graphics_clean(void)
+{
+  uint8_t page;
+
+  if(graphics_frame == 0)
+  {
+    return;
+  }
+
+  for(page = 0; page < ((graphics_max_y + 7) / 8); page++)
+  {
+    graphics_dirty_min[page] = 0xff;
+    graphics_dirty_max[page] = 0;
+  }
+
+}/* end graphics_clean() */
+
+/*
+ * graphics_clear()
+ *
+ * Write the background colour to the local graphics memory.  The whole frame
+ * is cleared, the clip rectangle doesn't apply.
+ */
+void graphics_clear(void)
+{
+  uint8_t x0, y0, x1, y1;
+
+  x0 = graphics_clip_x0;
+  y0 = graphics_clip_y0;
+  x1 = graphics_clip_x1;
+  y1 = graphics_clip_y1;
+
+  graphics_reset_clip();
+  graphics_fill_span(0, graphics_max_x - 1, 0, graphics_max_y - 1, bg_colour);
+
+  graphics_clip_x0 = x0;
+  graphics_clip_y0 = y0;
+  graphics_clip_x1 = x1;
+  graphics_clip_y1 = y1;
 
 }/* end graphics_clear() */
 
+/*
+ * graphics_set_clip()
+ *
+ * Limit all drawing to the rectangle with opposite corners x0, y0 and x1, y1
+ * (both included).  The rectangle is limited to the frame.  Lines, spans,
+ * circles and text are trimmed to the rectangle before they are drawn, so the
+ * parts outside it cost next to nothing.
+ */
+void graphics_set_clip(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
+{
+
+  if(x0 > x1)
+  {
+    swap(&x0, &x1);
+  }
+  if(y0 > y1)
+  {
+    swap(&y0, &y1);
+  }
+  if(x1 >= graphics_max_x)
+  {
+    x1 = graphics_max_x - 1;
+  }
+  if(y1 >= graphics_max_y)
+  {
+    y1 = graphics_max_y - 1;
+  }
+
+  graphics_clip_x0 = x0;
+  graphics_clip_y0 = y0;
+  graphics_clip_x1 = x1;
+  graphics_clip_y1 = y1;
+
+}/* end graphics_set_clip() */
+
+/*
+ * graphics_reset_clip()
+ *
+ * Set the clip rectangle back to the whole frame.
+ */
+void graphics_reset_clip(void)
+{
+
+  graphics_clip_x0 = 0;
+  graphics_clip_y0 = 0;
+  graphics_clip_x1 = graphics_max_x - 1;
+  graphics_clip_y1 = graphics_max_y - 1;
+
+}/* end graphics_reset_clip() */
+
+/*
+ * graphics_clip_reject()
+ *
+ * Return 1 if the box with corners x0, y0 and x1, y1 (x0 <= x1, y0 <= y1) is
+ * entirely outside the clip rectangle, so a shape inside it can be skipped.
+ */
+uint8_t graphics_clip_reject(int16_t x0, int16_t y0, int16_t x1, int16_t y1)
+{
+
+  if((x1 < graphics_clip_x0) || (x0 > graphics_clip_x1) ||
+     (y1 < graphics_clip_y0) || (y0 > graphics_clip_y1))
+  {
+    return(1);
+  }
+
+  return(0);
+
+}/* end graphics_clip_reject() */
+
 /*
  * graphics_set_cursor()
  *
@@ -263,29 +557,362 @@ uint8_t graphics_get_max_y(void)
  */
 void plot_pixel(uint8_t x, uint8_t y, uint8_t colour)
 {
-  if((x >= graphics_max_x) || (y >= graphics_max_y) ||
-     (graphics_frame == 0) || (colour >= GRAPHICS_ROTATION_MAX))
+  if((x < graphics_clip_x0) || (x > graphics_clip_x1) ||
+     (y < graphics_clip_y0) || (y > graphics_clip_y1) ||
+     (graphics_frame == 0) || (colour >= GRAPHICS_COLOUR_MAX))
   {
     return;
   }
+
+/* mark the column of this page as changed */
+  if(x < graphics_dirty_min[y / 8])
+  {
+    graphics_dirty_min[y / 8] = x;
+  }
+  if(x > graphics_dirty_max[y / 8])
+  {
+    graphics_dirty_max[y / 8] = x;
+  }
+
   switch(colour)
   {
     case GRAPHICS_COLOUR_BLACK:
       graphics_frame[(y / 8 * graphics_max_x) + x] &= ~(1 << (y & 0b00000111));
       break;
 
-    case GRAPHICS_COLOUR_WHITE:
-      graphics_frame[(y / 8 * graphics_max_x) + x] |= (1 << (y & 0b00000111));
-      break;
+    case GRAPHICS_COLOUR_WHITE:
+      graphics_frame[(y / 8 * graphics_max_x) + x] |= (1 << (y & 0b00000111));
+      break;
+
+    case GRAPHICS_COLOUR_INVERSE:
+      graphics_frame[(y / 8 * graphics_max_x) + x] ^= (1 << (y & 0b00000111));
+      break;
+
+    default:
+      break;
+  }    
+}/* end plot_pixel() */
+
+/*
+ * graphics_fill_span()
+ *
+ * Fill the area from column x0 to x1 and row y0 to y1 (inclusive) with colour.
+ * The area is trimmed to the clip rectangle.
+ *
+ * The frame is made of pages of bytes, each holding 8 pixels in a column.  The
+ * pages the area covers are worked out once, the top and bottom pages get a
+ * mask for the bits inside the area and the pages in between are whole bytes.
+ * Each page is then one pass along a row of bytes, with memset() for whole
+ * bytes of black or white.
+ */
+void graphics_fill_span(uint8_t x0, uint8_t x1, uint8_t y0, uint8_t y1, uint8_t colour)
+{
+  uint8_t page, last, mask, width, i, *p;
+
+  if(x0 > x1)
+  {
+    swap(&x0, &x1);
+  }
+  if(y0 > y1)
+  {
+    swap(&y0, &y1);
+  }
+  if(x0 < graphics_clip_x0)
+  {
+    x0 = graphics_clip_x0;
+  }
+  if(x1 > graphics_clip_x1)
+  {
+    x1 = graphics_clip_x1;
+  }
+  if(y0 < graphics_clip_y0)
+  {
+    y0 = graphics_clip_y0;
+  }
+  if(y1 > graphics_clip_y1)
+  {
+    y1 = graphics_clip_y1;
+  }
+  if((graphics_frame == 0) || (colour >= GRAPHICS_COLOUR_MAX) ||
+     (x0 > x1) || (y0 > y1))
+  {
+    return;
+  }
+
+  graphics_mark_dirty(x0, x1, y0, y1);
+
+  width = x1 - x0 + 1;
+  last = y1 / 8;
+
+  for(page = y0 / 8; page <= last; page++)
+  {
+  /* bits of this page inside the area */
+    mask = 0xff;
+    if(page == (y0 / 8))
+    {
+      mask &= 0xff << (y0 & 0b00000111);
+    }
+    if(page == last)
+    {
+      mask &= 0xff >> (7 - (y1 & 0b00000111));
+    }
+
+    p = &graphics_frame[(uint16_t)page * graphics_max_x + x0];
+
+    switch(colour)
+    {
+      case GRAPHICS_COLOUR_BLACK:
+        if(mask == 0xff)
+        {
+          memset(p, 0x00, width);
+        }
+        else
+        {
+          mask = ~mask;
+          for(i = 0; i < width; i++)
+          {
+            p[i] &= mask;
+          }
+        }
+        break;
+
+      case GRAPHICS_COLOUR_WHITE:
+        if(mask == 0xff)
+        {
+          memset(p, 0xff, width);
+        }
+        else
+        {
+          for(i = 0; i < width; i++)
+          {
+            p[i] |= mask;
+          }
+        }
+        break;
+
+      case GRAPHICS_COLOUR_INVERSE:
+        for(i = 0; i < width; i++)
+        {
+          p[i] ^= mask;
+        }
+        break;
+
+      default:
+        break;
+    }/* end switch(colour) */
+
+  }/* end for(page = y0 / 8; page <= last; page++) */
+
+}/* end graphics_fill_span() */
+
+/*
+ * graphics_draw_hline()
+ *
+ * Draw a horizontal line from x0 to x1 on row y.
+ */
+void graphics_draw_hline(uint8_t x0, uint8_t x1, uint8_t y)
+{
+
+  graphics_fill_span(x0, x1, y, y, fg_colour);
+
+}/* end graphics_draw_hline() */
+
+/*
+ * graphics_draw_vline()
+ *
+ * Draw a vertical line from y0 to y1 in column x.
+ */
+void graphics_draw_vline(uint8_t x, uint8_t y0, uint8_t y1)
+{
+
+  graphics_fill_span(x, x, y0, y1, fg_colour);
+
+}/* end graphics_draw_vline() */
+
+/*
+ * graphics_fill_rect()
+ *
+ * Fill the rectangle with opposite corners x0, y0 and x1, y1 (both included)
+ * with the foreground colour.
+ */
+void graphics_fill_rect(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
+{
+
+  graphics_fill_span(x0, x1, y0, y1, fg_colour);
+
+}/* end graphics_fill_rect() */
+
+/* Font bytes expanded for text sizes 2 and 3, looked up a nibble at a time:
+   each bit of the nibble is repeated 2 or 3 times. */
+const uint8_t graphics_expand2[16] PROGMEM =
+{
+  0x00, 0x03, 0x0c, 0x0f, 0x30, 0x33, 0x3c, 0x3f,
+  0xc0, 0xc3, 0xcc, 0xcf, 0xf0, 0xf3, 0xfc, 0xff
+};
+const uint16_t graphics_expand3[16] PROGMEM =
+{
+  0x000, 0x007, 0x038, 0x03f, 0x1c0, 0x1c7, 0x1f8, 0x1ff,
+  0xe00, 0xe07, 0xe38, 0xe3f, 0xfc0, 0xfc7, 0xff8, 0xfff
+};
+
+/*
+ * graphics_mask_byte()
+ *
+ * Apply colour to the bits of one frame byte that are set in mask.
+ */
+void graphics_mask_byte(uint8_t *p, uint8_t mask, uint8_t colour)
+{
+
+  switch(colour)
+  {
+    case GRAPHICS_COLOUR_BLACK:
+      *p &= ~mask;
+      break;
+
+    case GRAPHICS_COLOUR_WHITE:
+      *p |= mask;
+      break;
+
+    case GRAPHICS_COLOUR_INVERSE:
+      *p ^= mask;
+      break;
+
+    default:
+      break;
+  }/* end switch(colour) */
+
+}/* end graphics_mask_byte() */
+
+/*
+ * graphics_text_column()
+ *
+ * Draw one column of a text character straight into the frame.  The lowest
+ * height bits of bits go in column x starting at row y, set bits in the
+ * foreground colour and clear bits in the background colour.  The column is
+ * shifted down across as many pages as needed; when y is a multiple of 8 and
+ * the colours are white on black each page is a plain byte store.  Rows
+ * outside the clip rectangle are masked off, the column must be inside it.
+ */
+void graphics_text_column(uint8_t x, uint8_t y, uint32_t bits, uint8_t height)
+{
+  uint32_t cover;
+  uint8_t page, pages, *p;
+  int16_t top, bottom;
+
+  page = y / 8;
+  pages = graphics_clip_y1 / 8 + 1;
+  bits <<= (y & 0b00000111);
+  cover = ((1UL << height) - 1) << (y & 0b00000111);
+
+/* rows of the clip rectangle, counted from the top of the first page */
+  top = graphics_clip_y0 - (page * 8);
+  bottom = graphics_clip_y1 - (page * 8);
+  if(bottom < 0)
+  {
+    return;
+  }
+  if(top > 0)
+  {
+    cover &= ~((1UL << top) - 1);
+  }
+  if(bottom < 31)
+  {
+    cover &= (2UL << bottom) - 1;
+  }
+  p = &graphics_frame[(uint16_t)page * graphics_max_x + x];
+
+  while((cover != 0) && (page < pages))
+  {
+    if(((uint8_t)cover == 0xff) && (fg_colour == GRAPHICS_COLOUR_WHITE) &&
+       (bg_colour == GRAPHICS_COLOUR_BLACK))
+    {
+      *p = (uint8_t)bits;
+    }
+    else
+    {
+      graphics_mask_byte(p, (uint8_t)bits & (uint8_t)cover, fg_colour);
+      graphics_mask_byte(p, ~(uint8_t)bits & (uint8_t)cover, bg_colour);
+    }
+
+    bits >>= 8;
+    cover >>= 8;
+    page++;
+    p += graphics_max_x;
+  }/* end while((cover != 0) && (page < pages)) */
+
+}/* end graphics_text_column() */
+
+/*
+ * graphics_putChar_fast()
+ *
+ * graphics_putChar() for rotation 0 and text sizes 1 to 3.  Each font byte is
+ * one column of the character, so rather than plotting each pixel the column
+ * (expanded for the text size) is written to the frame a byte at a time by
+ * graphics_text_column().  c has already been adjusted to index font5x7[][].
+ */
+void graphics_putChar_fast(unsigned char c)
+{
+  uint8_t i, j, character, height;
+  uint16_t x, first;
+  uint32_t bits;
+
+  height = 8 * graphics_text_size;
+  x = graphics_cursor_x;
+  first = graphics_clip_x0;
+
+  if((graphics_frame != 0) && (graphics_cursor_y <= graphics_clip_y1) &&
+     ((graphics_cursor_y + height) > graphics_clip_y0))
+  {
+  /* five font columns then a blank one for separation */
+    for(i = 0; i < 6; i++)
+    {
+      character = 0;
+      if(i < 5)
+      {
+        character = pgm_read_byte_near((PGM_P)&font5x7[c][i]);
+      }
+
+      switch(graphics_text_size)
+      {
+        case 2:
+          bits = pgm_read_byte_near(&graphics_expand2[character & 0x0f]) |
+                 ((uint16_t)pgm_read_byte_near(&graphics_expand2[character >> 4]) << 8);
+          break;
+        case 3:
+          bits = pgm_read_word_near(&graphics_expand3[character & 0x0f]) |
+                 ((uint32_t)pgm_read_word_near(&graphics_expand3[character >> 4]) << 12);
+          break;
+        default:
+          bits = character;
+          break;
+      }/* end switch(graphics_text_size) */
+
+      for(j = 0; (j < graphics_text_size) && (x <= graphics_clip_x1); j++, x++)
+      {
+        if(x >= graphics_clip_x0)
+        {
+          graphics_text_column(x, graphics_cursor_y, bits, height);
+        }
+      }
+    }/* end for(i = 0; i < 6; i++) */
 
-    case GRAPHICS_COLOUR_INVERSE:
-      graphics_frame[(y / 8 * graphics_max_x) + x] ^= (1 << (y & 0b00000111));
-      break;
+  /* x is one past the last column drawn, mark from the first one */
+    if(first < graphics_cursor_x)
+    {
+      first = graphics_cursor_x;
+    }
+    if(x > first)
+    {
+      graphics_mark_dirty(first, x - 1, graphics_cursor_y,
+                          ((graphics_cursor_y + height - 1) > 0xff) ?
+                          0xff : (graphics_cursor_y + height - 1));
+    }
+  }
 
-    default:
-      break;
-  }    
-}/* end plot_pixel() */
+/* advance the x pixel location in anticipation of writing a string */
+  graphics_cursor_x += 6 * graphics_text_size;
+
+}/* end graphics_putChar_fast() */
 
 /*
  * graphics_putChar()
@@ -299,6 +926,9 @@ void plot_pixel(uint8_t x, uint8_t y, uint8_t colour)
  * Also, the local variables graphics_cursor_x and y are updated as this
  * function exits so that the putStr functions can write the string with
  * correctly spaced characters.
+ *
+ * Unrotated text up to size 3 is drawn a column at a time by
+ * graphics_putChar_fast(), the other rotations and sizes a pixel at a time.
  */
 void graphics_putChar(unsigned char c)
 {
@@ -310,12 +940,21 @@ void graphics_putChar(unsigned char c)
     return;
   }
 
+  PROF_BEGIN(PROF_ID_PUTCHAR);
   x = graphics_cursor_x;
   y = graphics_cursor_y;
 
 /* adjust c to skip non-printing characters */
   c -= 0x20;
 
+  if((graphics_rotation == GRAPHICS_ROTATION_0) &&
+     (graphics_text_size >= 1) && (graphics_text_size <= 3))
+  {
+    graphics_putChar_fast(c);
+    PROF_END(PROF_ID_PUTCHAR);
+    return;
+  }
+
 /* this loop is for each of the bytes making up the font */
   for (i = 0; i < 5; i++)
   {
@@ -469,6 +1108,7 @@ void graphics_putChar(unsigned char c)
     default:
       break;
   }/* end switch(graphics_rotation) */
+  PROF_END(PROF_ID_PUTCHAR);
 
 }/* end graphics_putChar() */
 
@@ -510,34 +1150,114 @@ void graphics_putStrP(const char *addr)
 }/* end graphics_putStrP() */
 
 /*
- * graphics_draw_line()
- *
- * This function is based on Bresenham's Algorithm as described in Wikipedia
- * https://en.wikipedia.org/wiki/Bresenham%27s_line_algorithm.
- * The description is incomplete as there are 8 different ways a line can be
- * drawn and the algorithm presented only works with one.  Xiaolin Wu's line
- * algorithm, also from Wikipedia
- * https://en.wikipedia.org/wiki/Xiaolin_Wu%27s_line_algorithm,
- * manipulates the endpoints of the line in the beginning of the function to
- * account for these scenarios.
+ * graphics_clip_code()
  *
- * The code here adapts both algorithms and simplifies Xiaolin Wu's by not
- * drawing the additional pixels drawn with intensities varying according to
- * their distance from the line.
+ * Cohen-Sutherland outcode of a point: bit 0 left of the clip rectangle, bit 1
+ * right, bit 2 above, bit 3 below.  0 if the point is inside.
+ */
+uint8_t graphics_clip_code(int16_t x, int16_t y)
+{
+  uint8_t code = 0;
+
+  if(x < graphics_clip_x0)
+  {
+    code |= 0b0001;
+  }
+  else if(x > graphics_clip_x1)
+  {
+    code |= 0b0010;
+  }
+  if(y < graphics_clip_y0)
+  {
+    code |= 0b0100;
+  }
+  else if(y > graphics_clip_y1)
+  {
+    code |= 0b1000;
+  }
+
+  return(code);
+
+}/* end graphics_clip_code() */
+
+/*
+ * graphics_line()
  *
- * The origin of the Cartesian plane the line is drawn on is assumed to be in
- * the upper left corner.  The x coordinate increases to the right and the 
- * y coordinate increases downward.
+ * graphics_draw_line() with signed coordinates that can be off the frame.
  *
- * x0, y0: start coordinates
- * x1, y1: end coordinates
+ * The line is first trimmed to the clip rectangle with the Cohen-Sutherland
+ * algorithm: while either end is outside, it is moved to where the line
+ * crosses the edge it is outside of.  A line that misses the rectangle
+ * altogether is dropped without drawing anything, and the part that's left
+ * always has coordinates on the frame.
  */
-void graphics_draw_line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
+void graphics_line(int16_t x0, int16_t y0, int16_t x1, int16_t y1)
 {
-  uint8_t steep;
+  uint8_t steep, code0, code1, code;
   int16_t dx, dy,
           err,
-          ystep;
+          ystep,
+          x, y;
+
+  code0 = graphics_clip_code(x0, y0);
+  code1 = graphics_clip_code(x1, y1);
+
+  while((code0 | code1) != 0)
+  {
+  /* both ends on the same outside side, nothing to draw */
+    if((code0 & code1) != 0)
+    {
+      return;
+    }
+
+    code = (code0 != 0) ? code0 : code1;
+
+    if(code & 0b0100)
+    {
+      y = graphics_clip_y0;
+      x = x0 + (int32_t)(x1 - x0) * (y - y0) / (y1 - y0);
+    }
+    else if(code & 0b1000)
+    {
+      y = graphics_clip_y1;
+      x = x0 + (int32_t)(x1 - x0) * (y - y0) / (y1 - y0);
+    }
+    else if(code & 0b0001)
+    {
+      x = graphics_clip_x0;
+      y = y0 + (int32_t)(y1 - y0) * (x - x0) / (x1 - x0);
+    }
+    else
+    {
+      x = graphics_clip_x1;
+      y = y0 + (int32_t)(y1 - y0) * (x - x0) / (x1 - x0);
+    }
+
+    if(code == code0)
+    {
+      x0 = x;
+      y0 = y;
+      code0 = graphics_clip_code(x0, y0);
+    }
+    else
+    {
+      x1 = x;
+      y1 = y;
+      code1 = graphics_clip_code(x1, y1);
+    }
+  }/* end while((code0 | code1) != 0) */
+
+/* horizontal and vertical lines don't need Bresenham */
+  if(y0 == y1)
+  {
+    graphics_draw_hline(x0, x1, y0);
+    return;
+  }
+  if(x0 == x1)
+  {
+    graphics_draw_vline(x0, y0, y1);
+    return;
+  }
 
   if(abs(y1 - y0) > abs(x1 - x0))
   {
@@ -550,14 +1270,22 @@ void graphics_draw_line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
 
   if (steep == 1)
   {
-    swap(&x0, &y0);
-    swap(&x1, &y1);
+    x = x0;
+    x0 = y0;
+    y0 = x;
+    x = x1;
+    x1 = y1;
+    y1 = x;
   }
 
   if(x0 > x1)
   {
-    swap(&x0, &x1);
-    swap(&y0, &y1);
+    x = x0;
+    x0 = x1;
+    x1 = x;
+    y = y0;
+    y0 = y1;
+    y1 = y;
   }/* end if(x0 > x1) */
 
   dx = x1 - x0;
@@ -594,8 +1322,82 @@ void graphics_draw_line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
 
   }/* end for (; x0 <= x1; x0++) */
 
+}/* end graphics_line() */
+
+/*
+ * graphics_draw_line()
+ *
+ * This function is based on Bresenham's Algorithm as described in Wikipedia
+ * https://en.wikipedia.org/wiki/Bresenham%27s_line_algorithm.
+ * The description is incomplete as there are 8 different ways a line can be
+ * drawn and the algorithm presented only works with one.  Xiaolin Wu's line
+ * algorithm, also from Wikipedia
+ * https://en.wikipedia.org/wiki/Xiaolin_Wu%27s_line_algorithm,
+ * manipulates the endpoints of the line in the beginning of the function to
+ * account for these scenarios.
+ *
+ * The code here adapts both algorithms and simplifies Xiaolin Wu's by not
+ * drawing the additional pixels drawn with intensities varying according to
+ * their distance from the line.
+ *
+ * The origin of the Cartesian plane the line is drawn on is assumed to be in
+ * the upper left corner.  The x coordinate increases to the right and the 
+ * y coordinate increases downward.
+ *
+ * x0, y0: start coordinates
+ * x1, y1: end coordinates
+ */
+void graphics_draw_line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
+{
+
+  graphics_line(x0, y0, x1, y1);
+
 }/* end graphics_draw_line() */
 
+/*
+ * graphics_vspan()
+ *
+ * Draw a vertical line of colour fg_colour in column x from row y0 to y1.  The
+ * coordinates can be off the frame (e.g. negative for a shape near the edge),
+ * the line is trimmed to the clip rectangle.
+ */
+void graphics_vspan(int16_t x, int16_t y0, int16_t y1)
+{
+
+  if(graphics_clip_reject(x, y0, x, y1))
+  {
+    return;
+  }
+  if(y0 < graphics_clip_y0)
+  {
+    y0 = graphics_clip_y0;
+  }
+  if(y1 > graphics_clip_y1)
+  {
+    y1 = graphics_clip_y1;
+  }
+
+  graphics_fill_span(x, x, y0, y1, fg_colour);
+
+}/* end graphics_vspan() */
+
+/*
+ * graphics_plot()
+ *
+ * Plot a pixel of colour fg_colour, the coordinates can be off the frame.
+ */
+void graphics_plot(int16_t x, int16_t y)
+{
+
+  if(graphics_clip_reject(x, y, x, y))
+  {
+    return;
+  }
+
+  plot_pixel(x, y, fg_colour);
+
+}/* end graphics_plot() */
+
 /*
  * graphics_draw_circle()
  *
@@ -611,16 +1413,21 @@ void graphics_draw_circle(uint8_t x0, uint8_t y0, uint8_t r)
           ddF_x, ddF_y,
           x, y;
 
+  if(graphics_clip_reject(x0 - r, y0 - r, x0 + r, y0 + r))
+  {
+    return;
+  }
+
   f = 1 - r;
   ddF_x = 1;
   ddF_y = -2 * r;
   x = 0;
   y = r;
   
-  plot_pixel(x0, y0 + r, fg_colour);
-  plot_pixel(x0, y0 - r, fg_colour);
-  plot_pixel(x0 + r, y0, fg_colour);
-  plot_pixel(x0 - r, y0, fg_colour);
+  graphics_plot(x0, y0 + r);
+  graphics_plot(x0, y0 - r);
+  graphics_plot(x0 + r, y0);
+  graphics_plot(x0 - r, y0);
 
   while(x < y)
   {
@@ -635,33 +1442,238 @@ void graphics_draw_circle(uint8_t x0, uint8_t y0, uint8_t r)
     ddF_x += 2;
     f += ddF_x;
   
-    plot_pixel(x0 + x, y0 + y, fg_colour);
-    plot_pixel(x0 - x, y0 + y, fg_colour);
-    plot_pixel(x0 + x, y0 - y, fg_colour);
-    plot_pixel(x0 - x, y0 - y, fg_colour);
-    plot_pixel(x0 + y, y0 + x, fg_colour);
-    plot_pixel(x0 - y, y0 + x, fg_colour);
-    plot_pixel(x0 + y, y0 - x, fg_colour);
-    plot_pixel(x0 - y, y0 - x, fg_colour);
+    graphics_plot(x0 + x, y0 + y);
+    graphics_plot(x0 - x, y0 + y);
+    graphics_plot(x0 + x, y0 - y);
+    graphics_plot(x0 - x, y0 - y);
+    graphics_plot(x0 + y, y0 + x);
+    graphics_plot(x0 - y, y0 + x);
+    graphics_plot(x0 + y, y0 - x);
+    graphics_plot(x0 - y, y0 - x);
 
   }/* end while(x < y) */
 
 }/* end graphics_draw_circle() */
 
+/*
+ * graphics_circle_quarters()
+ *
+ * Draw the quarters of a circle outline of radius r with center at x0, y0
+ * that are selected by corners: bit 0 top left, bit 1 top right, bit 2 bottom
+ * right, bit 3 bottom left.  The four points on the axes are not drawn, they
+ * are left to the caller.
+ */
+void graphics_circle_quarters(int16_t x0, int16_t y0, int16_t r, uint8_t corners)
+{
+  int16_t f = 1 - r,
+          ddF_x = 1,
+          ddF_y = -2 * r,
+          x = 0,
+          y = r;
+
+  while(x < y)
+  {
+    if(f >= 0)
+    {
+      y--;
+      ddF_y += 2;
+      f += ddF_y;
+    }
+    x++;
+    ddF_x += 2;
+    f += ddF_x;
+
+    if(corners & 0b0001)
+    {
+      graphics_plot(x0 - y, y0 - x);
+      graphics_plot(x0 - x, y0 - y);
+    }
+    if(corners & 0b0010)
+    {
+      graphics_plot(x0 + x, y0 - y);
+      graphics_plot(x0 + y, y0 - x);
+    }
+    if(corners & 0b0100)
+    {
+      graphics_plot(x0 + x, y0 + y);
+      graphics_plot(x0 + y, y0 + x);
+    }
+    if(corners & 0b1000)
+    {
+      graphics_plot(x0 - y, y0 + x);
+      graphics_plot(x0 - x, y0 + y);
+    }
+  }/* end while(x < y) */
+
+}/* end graphics_circle_quarters() */
+
+/*
+ * graphics_circle_fill_halves()
+ *
+ * Fill the right (bit 0 of sides) and/or left (bit 1) half of a circle of
+ * radius r with center at x0, y0, not including the center column.  Each
+ * column is stretched down by stretch rows, for rounded rectangles.
+ *
+ * This is the midpoint circle algorithm again, but at each step whole columns
+ * between the top and bottom of the circle are filled with the span kernel.
+ * Every column is filled exactly once, so this works with the inverse colour
+ * too.  Columns are used rather than rows because the frame is packed 8
+ * vertical pixels to a byte.
+ */
+void graphics_circle_fill_halves(int16_t x0, int16_t y0, int16_t r, uint8_t sides, int16_t stretch)
+{
+  int16_t f = 1 - r,
+          ddF_x = 1,
+          ddF_y = -2 * r,
+          x = 0,
+          y = r,
+          px = x,
+          py = y;
+
+  while(x < y)
+  {
+    if(f >= 0)
+    {
+      y--;
+      ddF_y += 2;
+      f += ddF_y;
+    }
+    x++;
+    ddF_x += 2;
+    f += ddF_x;
+
+  /* columns near the center, one per step */
+    if(x < (y + 1))
+    {
+      if(sides & 0b01)
+      {
+        graphics_vspan(x0 + x, y0 - y, y0 + y + stretch);
+      }
+      if(sides & 0b10)
+      {
+        graphics_vspan(x0 - x, y0 - y, y0 + y + stretch);
+      }
+    }
+
+  /* columns near the sides, only when y has moved on */
+    if(y != py)
+    {
+      if(sides & 0b01)
+      {
+        graphics_vspan(x0 + py, y0 - px, y0 + px + stretch);
+      }
+      if(sides & 0b10)
+      {
+        graphics_vspan(x0 - py, y0 - px, y0 + px + stretch);
+      }
+      py = y;
+    }
+    px = x;
+
+  }/* end while(x < y) */
+
+}/* end graphics_circle_fill_halves() */
+
 /*
  * graphics_draw_filled_circle()
  *
- * This method doesn't draw a completely filled-in circle.  Still a work in
- * progress.
+ * Draw a filled circle of radius r with center at x0, y0.  The circle is made
+ * of vertical spans, one for each column, so there are no holes.
  */
 void graphics_draw_filled_circle(uint8_t x0, uint8_t y0, uint8_t r)
 {
-  for(uint8_t i = 0; i <= r; i++)
+
+  if(graphics_clip_reject(x0 - r, y0 - r, x0 + r, y0 + r))
   {
-    graphics_draw_circle(x0, y0, i);
+    return;
   }
+
+  graphics_vspan(x0, (int16_t)y0 - r, (int16_t)y0 + r);
+  graphics_circle_fill_halves(x0, y0, r, 0b11, 0);
+
 }/* end graphics_draw_filled_circle() */
 
+/*
+ * graphics_round_rect_radius()
+ *
+ * Sort the corners of a rectangle so x0, y0 is the top left, and limit the
+ * corner radius r to half the shorter side.  Returns the radius to use.
+ */
+uint8_t graphics_round_rect_radius(uint8_t *x0, uint8_t *y0, uint8_t *x1, uint8_t *y1, uint8_t r)
+{
+
+  if(*x0 > *x1)
+  {
+    swap(x0, x1);
+  }
+  if(*y0 > *y1)
+  {
+    swap(y0, y1);
+  }
+  if(r > ((*x1 - *x0) / 2))
+  {
+    r = (*x1 - *x0) / 2;
+  }
+  if(r > ((*y1 - *y0) / 2))
+  {
+    r = (*y1 - *y0) / 2;
+  }
+
+  return(r);
+
+}/* end graphics_round_rect_radius() */
+
+/*
+ * graphics_draw_round_rectangle()
+ *
+ * Draw a rectangle with opposite corners x0, y0 and x1, y1 and the corners
+ * rounded to radius r.
+ */
+void graphics_draw_round_rectangle(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint8_t r)
+{
+
+  r = graphics_round_rect_radius(&x0, &y0, &x1, &y1, r);
+  if(graphics_clip_reject(x0, y0, x1, y1))
+  {
+    return;
+  }
+
+/* straight edges */
+  graphics_draw_hline(x0 + r, x1 - r, y0);
+  graphics_draw_hline(x0 + r, x1 - r, y1);
+  graphics_draw_vline(x0, y0 + r, y1 - r);
+  graphics_draw_vline(x1, y0 + r, y1 - r);
+
+/* corners */
+  graphics_circle_quarters(x0 + r, y0 + r, r, 0b0001);
+  graphics_circle_quarters(x1 - r, y0 + r, r, 0b0010);
+  graphics_circle_quarters(x1 - r, y1 - r, r, 0b0100);
+  graphics_circle_quarters(x0 + r, y1 - r, r, 0b1000);
+
+}/* end graphics_draw_round_rectangle() */
+
+/*
+ * graphics_draw_filled_round_rectangle()
+ *
+ * Draw a filled rectangle with opposite corners x0, y0 and x1, y1 and the
+ * corners rounded to radius r.  The middle is one span fill, the rounded ends
+ * are half circles stretched to the height of the rectangle.
+ */
+void graphics_draw_filled_round_rectangle(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint8_t r)
+{
+
+  r = graphics_round_rect_radius(&x0, &y0, &x1, &y1, r);
+  if(graphics_clip_reject(x0, y0, x1, y1))
+  {
+    return;
+  }
+
+  graphics_fill_span(x0 + r, x1 - r, y0, y1, fg_colour);
+  graphics_circle_fill_halves(x1 - r, y0 + r, r, 0b01, (y1 - y0) - 2 * r);
+  graphics_circle_fill_halves(x0 + r, y0 + r, r, 0b10, (y1 - y0) - 2 * r);
+
+}/* end graphics_draw_filled_round_rectangle() */
+
 /*
  * graphics_draw_rectangle()
  *
@@ -670,10 +1682,10 @@ void graphics_draw_filled_circle(uint8_t x0, uint8_t y0, uint8_t r)
  */
 void graphics_draw_rectangle(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
 {
-  graphics_draw_line(x0, y0, x1, y0);
-  graphics_draw_line(x1, y0, x1, y1);
-  graphics_draw_line(x1, y1, x0, y1);
-  graphics_draw_line(x0, y1, x0, y0);
+  graphics_draw_hline(x0, x1, y0);
+  graphics_draw_vline(x1, y0, y1);
+  graphics_draw_hline(x0, x1, y1);
+  graphics_draw_vline(x0, y0, y1);
 
 }/* end graphics_draw_rectangle() */
 
@@ -681,26 +1693,12 @@ void graphics_draw_rectangle(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
  * graphics_draw_filled_rectangle()
  *
  * Draw a filled rectangle with the coordinates given.  Each pair of coordinates
- * is an opposite corner of the rectangle.  Draw a series of lines from top to
- * bottom of rectangle.
+ * is an opposite corner of the rectangle, both corners are included as they are
+ * in graphics_draw_rectangle().
  */
 void graphics_draw_filled_rectangle(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
- {
-    uint8_t i, len;
-
-    if(y0 > y1)
-    {
-      swap(&y0, &y1);
-
-    }/* end if(y0 > y1) */
+{
 
-    len = y1 - y0;
-   
-    for(i = 0; i < len; i++)
-    {
-      graphics_draw_line(x0, (y0 + i), x1, (y0 + i));
+  graphics_fill_span(x0, x1, y0, y1, fg_colour);
 
-    }/* end for(i = 0; i < len; i++) */
- 
- }/* end graphics_draw_filled_rectangle() */
- 
+}/* end graphics_draw_filled_rectangle() */
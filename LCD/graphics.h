@@ -32,6 +32,26 @@
 #ifndef _GRAPHICS_H_
 #define _GRAPHICS_H_ 1
 
+/* To have the frame placed in a static array at build time rather than
+   allocated by graphics_init(), define both of these to the size of the
+   display, e.g. -DGRAPHICS_FRAME_WIDTH=128 -DGRAPHICS_FRAME_HEIGHT=64.  The RAM
+   used then shows up in avr-size, and graphics_init() only accepts that size. */
+#if defined(GRAPHICS_FRAME_WIDTH) && defined(GRAPHICS_FRAME_HEIGHT)
+#define GRAPHICS_FRAME_PAGES ((GRAPHICS_FRAME_HEIGHT + 7) / 8)
+#define GRAPHICS_FRAME_SIZE ((uint16_t)GRAPHICS_FRAME_WIDTH * GRAPHICS_FRAME_PAGES)
+#elif defined(GRAPHICS_FRAME_WIDTH) || defined(GRAPHICS_FRAME_HEIGHT)
+#error "define both GRAPHICS_FRAME_WIDTH and GRAPHICS_FRAME_HEIGHT"
+#endif
+
+/* Number of frames, 1 or 2.  With 2, graphics_swap() lets the display module
+   send one frame in the background while the next is drawn in the other. */
+#ifndef GRAPHICS_BUFFERS
+#define GRAPHICS_BUFFERS 1
+#endif
+#if (GRAPHICS_BUFFERS != 1) && (GRAPHICS_BUFFERS != 2)
+#error "GRAPHICS_BUFFERS must be 1 or 2"
+#endif
+
 /* Colours of the display pixels.  Since this is a monochrome display, the only
    colours are black (dark) or white (lit).  Inverse just toggles the pixel. */
 enum
@@ -61,8 +81,11 @@ enum
  * It is up to the user to ensure there is enough RAM in the microcontroller
  * to contain all the bytes needed to represent the chosen display.  For the
  * best security, the calling function should check the returned value.  If
- * zero, then malloc could not allocate enough memory and if the pointer is used
- * the program would likely crash.
+ * not zero, then malloc could not allocate enough memory and if the pointer is
+ * used the program would likely crash.
+ *
+ * With a static frame (GRAPHICS_FRAME_WIDTH defined) nothing is allocated, and
+ * 1 is returned if max_x and max_y aren't the size the frame was built for.
  */
 uint8_t graphics_init(uint8_t max_x, uint8_t max_y);
 
@@ -76,7 +99,8 @@ void graphics_exit(void);
 /*
  * graphics_clear()
  *
- * Write the background colour to the local graphics memory.
+ * Write the background colour to the local graphics memory.  The whole frame
+ * is cleared, the clip rectangle doesn't apply.
  */
 void graphics_clear(void);
 
@@ -84,10 +108,72 @@ void graphics_clear(void);
  * graphics_get_frame()
  *
  * Returns a pointer to the area of RAM containing the pixel data of the
- * display.
+ * display.  With GRAPHICS_BUFFERS 2 this is the frame being drawn into.
  */
 uint8_t *graphics_get_frame(void);
 
+/*
+ * graphics_frame_size()
+ *
+ * Return the number of bytes in one frame.
+ */
+uint16_t graphics_frame_size(void);
+
+/*
+ * graphics_swap()
+ *
+ * Hand the frame that has just been drawn to the display module and return a
+ * pointer to it.  With GRAPHICS_BUFFERS 2 the two frames are swapped: the
+ * returned one must be left alone until the display has finished with it, and
+ * drawing carries on in the other, which starts as a copy so nothing is lost.
+ * With one buffer this is the same as graphics_get_frame().
+ */
+uint8_t *graphics_swap(void);
+
+/*
+ * graphics_mark_dirty()
+ *
+ * Mark the area from column x0 to x1 and row y0 to y1 (inclusive) as changed,
+ * so that it will be sent to the display by the next partial update.  Anything
+ * drawn with the functions here is marked already, this is only needed if the
+ * frame is changed directly through graphics_get_frame().
+ */
+void graphics_mark_dirty(uint8_t x0, uint8_t x1, uint8_t y0, uint8_t y1);
+
+/*
+ * graphics_get_dirty()
+ *
+ * Get the dirty region of one page of the frame.  If any of the page has
+ * changed, put the first and last changed columns in x0 and x1 and return 1.
+ * Return 0 if the page hasn't changed.
+ */
+uint8_t graphics_get_dirty(uint8_t page, uint8_t *x0, uint8_t *x1);
+
+/*
+ * graphics_clean()
+ *
+ * Mark every page of the frame as unchanged.  Called by the display module once
+ * the frame has been sent.
+ */
+void graphics_clean(void);
+
+/*
+ * graphics_set_clip()
+ *
+ * Limit all drawing to the rectangle with opposite corners x0, y0 and x1, y1
+ * (both included).  The rectangle is limited to the frame.  Lines, spans,
+ * circles and text are trimmed to the rectangle before they are drawn, so the
+ * parts outside it cost next to nothing.  graphics_clear() ignores it.
+ */
+void graphics_set_clip(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+
+/*
+ * graphics_reset_clip()
+ *
+ * Set the clip rectangle back to the whole frame.
+ */
+void graphics_reset_clip(void);
+
 /*
  * graphics_set_cursor()
  *
@@ -131,14 +217,14 @@ void graphics_set_bg_colour(uint8_t colour);
  *
  * Return the value of the maximum x dimension of the display.
  */
-uint8_t graphics_get_max_x(void)
+uint8_t graphics_get_max_x(void);
 
 /*
  * graphics_get_max_y()
  *
  * Return the value of the maximum y dimension of the display.
  */
-uint8_t graphics_get_max_y(void)
+uint8_t graphics_get_max_y(void);
 
 /*
  * graphics_putChar()
@@ -152,6 +238,9 @@ uint8_t graphics_get_max_y(void)
  * Also, the local variables graphics_cursor_x and y are updated as this
  * function exits so that the putStr functions can write the string with
  * correctly spaced characters.
+ *
+ * Unrotated text up to size 3 is drawn a column at a time, which is much faster
+ * than the pixel at a time used for the other rotations and sizes.
  */
 void graphics_putChar(unsigned char c);
 
@@ -198,6 +287,15 @@ void graphics_putStrP(const char *addr);
  */
 void graphics_draw_line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
 
+/*
+ * graphics_line()
+ *
+ * graphics_draw_line() with signed coordinates, the ends can be off the frame.
+ * The line is trimmed to the clip rectangle (Cohen-Sutherland) before it is
+ * drawn, so it doesn't wrap around the edges.
+ */
+void graphics_line(int16_t x0, int16_t y0, int16_t x1, int16_t y1);
+
 /*
  * graphics_draw_circle()
  *
@@ -212,11 +310,27 @@ void graphics_draw_circle(uint8_t x0, uint8_t y0, uint8_t r);
 /*
  * graphics_draw_filled_circle()
  *
- * This method doesn't draw a completely filled-in circle.  Still a work in
- * progress.
+ * Draw a filled circle of radius r with center at x0, y0.  The circle is made
+ * of vertical spans, one for each column, so there are no holes.
  */
 void graphics_draw_filled_circle(uint8_t x0, uint8_t y0, uint8_t r);
 
+/*
+ * graphics_draw_round_rectangle()
+ *
+ * Draw a rectangle with opposite corners x0, y0 and x1, y1 and the corners
+ * rounded to radius r.
+ */
+void graphics_draw_round_rectangle(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint8_t r);
+
+/*
+ * graphics_draw_filled_round_rectangle()
+ *
+ * Draw a filled rectangle with opposite corners x0, y0 and x1, y1 and the
+ * corners rounded to radius r.
+ */
+void graphics_draw_filled_round_rectangle(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint8_t r);
+
 /*
  * graphics_draw_rectangle()
  *
@@ -229,9 +343,40 @@ void graphics_draw_rectangle(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
  * graphics_draw_filled_rectangle()
  *
  * Draw a filled rectangle with the coordinates given.  Each pair of coordinates
- * is an opposite corner of the rectangle.  Draw a series of lines from top to
- * bottom of rectangle.
+ * is an opposite corner of the rectangle, both corners are included as they are
+ * in graphics_draw_rectangle().
  */
 void graphics_draw_filled_rectangle(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
 
+/*
+ * graphics_fill_span()
+ *
+ * Fill the area from column x0 to x1 and row y0 to y1 (inclusive) with colour.
+ * The area is clipped to the frame.  Whole bytes of the frame are written at a
+ * time, so this is much faster than plotting the pixels one by one.
+ */
+void graphics_fill_span(uint8_t x0, uint8_t x1, uint8_t y0, uint8_t y1, uint8_t colour);
+
+/*
+ * graphics_draw_hline()
+ *
+ * Draw a horizontal line from x0 to x1 on row y.
+ */
+void graphics_draw_hline(uint8_t x0, uint8_t x1, uint8_t y);
+
+/*
+ * graphics_draw_vline()
+ *
+ * Draw a vertical line from y0 to y1 in column x.
+ */
+void graphics_draw_vline(uint8_t x, uint8_t y0, uint8_t y1);
+
+/*
+ * graphics_fill_rect()
+ *
+ * Fill the rectangle with opposite corners x0, y0 and x1, y1 (both included)
+ * with the foreground colour.
+ */
+void graphics_fill_rect(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+
 #endif
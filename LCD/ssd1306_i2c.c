@@ -12,8 +12,11 @@
  * to be modified.
  *
  * Displays of this type come with different interfaces to a microcontroller:
- * I2C, SPI, UART, parallel, etc.  This code assumes the display interfaces is
- * the I2C bus. 
+ * I2C, SPI, UART, parallel, etc.  Everything sent to the display goes through
+ * a transport, a pair of functions that send command bytes and data bytes.
+ * The I2C transport is used by default, ssd1306_spi.c provides one for the
+ * 4-wire SPI interface.  Apart from the transport, the same functions (init,
+ * text, scrolling, graphics update) work for both.
  *
  * The text font comes from the file 'font5x7.c' which places the data in FLASH
  * memory.
@@ -25,15 +28,19 @@
  */
 #include <avr/io.h>
 #include <avr/pgmspace.h>
+#include <avr/interrupt.h>
 #include "i2c/i2c.h"
 #include "graphics/font5x7.h"
 #include "graphics/graphics.h"
 #include "ssd1306/ssd1306_i2c.h"
+#include "prof/prof.h"
 
-/*
- * Device slave address
- */
-#define SSD1306SlaveAdrs    0x3c
+/* A static graphics frame must be the size of this display. */
+#if defined(GRAPHICS_FRAME_WIDTH) && \
+    ((GRAPHICS_FRAME_WIDTH != SSD1306_GRAPHICS_MAX_X) || \
+     (GRAPHICS_FRAME_HEIGHT != SSD1306_GRAPHICS_MAX_Y))
+#error "GRAPHICS_FRAME_WIDTH/HEIGHT don't match the ssd1306 display"
+#endif
 
 /* Set the display contrast.  The second byte contains the contrast level -
  * increasing value increases the contrast.
@@ -223,102 +230,293 @@
 #define SSD1306_I2C_COMMAND  0b00000000
 #define SSD1306_I2C_CONTINUE 0b10000000
 
-/* ssd1306_i2c_command()
+/*
+ * ssd1306_i2c_send_command()
  *
- * Send a command to the display.
+ * I2C transport: send len command bytes from buf to the display at slave
+ * address adrs.  Returns the I2C result.
  */
-void ssd1306_command(uint8_t cmd)
+uint8_t ssd1306_i2c_send_command(uint8_t adrs, uint8_t len, uint8_t *buf)
 {
-  i2c_start();
-  i2c_putchar((SSD1306SlaveAdrs<<1) & 0b11111110);
-  i2c_putchar(SSD1306_I2C_COMMAND);
-  i2c_putchar(cmd);
-  i2c_stop();
-}
+
+  return(i2c_write(adrs, len, SSD1306_I2C_COMMAND, buf));
+
+}/* end ssd1306_i2c_send_command() */
 
 /*
- * ssd1306_i2c_init()
+ * ssd1306_i2c_send_data()
  *
- * Startup the I2C interface.  Initialize the display LCD controller.
+ * I2C transport: send len bytes of display data from buf to the display at
+ * slave address adrs, or len bytes of 0 if buf is 0.  A transaction can only
+ * carry 255 bytes and one address byte, so the bytes are sent one at a time
+ * with the bus claimed from the transaction engine.  Returns the I2C result.
+ */
+uint8_t ssd1306_i2c_send_data(uint8_t adrs, uint16_t len, const uint8_t *buf)
+{
+  uint16_t i;
+  uint8_t err;
+
+  i2c_claim();
+  err = i2c_start();
+  if(err == I2C_OK)
+  {
+    err = i2c_putchar((adrs<<1) & 0b11111110);
+  }
+  if(err == I2C_OK)
+  {
+    err = i2c_putchar(SSD1306_I2C_DATA);
+  }
+  for(i = 0; (i < len) && (err == I2C_OK); i++)
+  {
+    err = i2c_putchar((buf != 0) ? buf[i] : 0);
+  }
+  err = i2c_stop(); /* the first error since i2c_start() */
+  i2c_release();
+
+  return(err);
+
+}/* end ssd1306_i2c_send_data() */
+
+/*
+ * ssd1306_i2c_send_command_data()
  *
- * The initialization sequence for the controller is taken directly from the
- * manual and sets all registers to their reset values.
+ * I2C transport: send clen command bytes from cmd then len bytes of display
+ * data from buf (or 0s if buf is 0), all in one I2C transfer to the display at
+ * slave address adrs.  Each command byte goes behind its own control byte with
+ * the continuation bit set, then a data control byte starts the data.  Sent
+ * with the bus claimed like ssd1306_i2c_send_data(), returns the I2C result.
  */
-void ssd1306_i2c_init(void)
+uint8_t ssd1306_i2c_send_command_data(uint8_t adrs, uint8_t clen, uint8_t *cmd,
+                                      uint16_t len, const uint8_t *buf)
 {
-  uint8_t buf[2];
+  uint16_t i;
+  uint8_t err;
 
-/* set Mux Ratio to reset value */
-  buf[0] = SSD1306_SET_MUX_RATIO;
-  buf[1] = SSD1306_SET_MUX_RATIO_RESET;
-  i2c_write(SSD1306SlaveAdrs, 2, SSD1306_I2C_COMMAND, buf);
+  i2c_claim();
+  err = i2c_start();
+  if(err == I2C_OK)
+  {
+    err = i2c_putchar((adrs<<1) & 0b11111110);
+  }
+  for(i = 0; (i < clen) && (err == I2C_OK); i++)
+  {
+    err = i2c_putchar(SSD1306_I2C_CONTINUE | SSD1306_I2C_COMMAND);
+    if(err == I2C_OK)
+    {
+      err = i2c_putchar(cmd[i]);
+    }
+  }
+  if(err == I2C_OK)
+  {
+    err = i2c_putchar(SSD1306_I2C_DATA);
+  }
+  for(i = 0; (i < len) && (err == I2C_OK); i++)
+  {
+    err = i2c_putchar((buf != 0) ? buf[i] : 0);
+  }
+  err = i2c_stop(); /* the first error since i2c_start() */
+  i2c_release();
+
+  return(err);
+
+}/* end ssd1306_i2c_send_command_data() */
+
+/* The I2C transports, one for each display in SSD1306_I2C_DISPLAYS, with its
+   slave address built into its functions.  ssd1306_i2c_transport is used
+   unless ssd1306_set_transport() picks another. */
+#define SSD1306_I2C_TRANSPORT(name, slave) \
+  uint8_t name##_command(uint8_t len, uint8_t *buf) \
+  { \
+    return(ssd1306_i2c_send_command(slave, len, buf)); \
+  } \
+  uint8_t name##_data(uint16_t len, const uint8_t *buf) \
+  { \
+    return(ssd1306_i2c_send_data(slave, len, buf)); \
+  } \
+  uint8_t name##_command_data(uint8_t clen, uint8_t *cmd, \
+                              uint16_t len, const uint8_t *buf) \
+  { \
+    return(ssd1306_i2c_send_command_data(slave, clen, cmd, len, buf)); \
+  } \
+  const SSD1306_TRANSPORT_TYPE name = \
+  { \
+    name##_command, \
+    name##_data, \
+    name##_command_data, \
+    slave \
+  };
+
+SSD1306_I2C_DISPLAYS(SSD1306_I2C_TRANSPORT)
+
+/* Transport used by all the functions below. */
+const SSD1306_TRANSPORT_TYPE *ssd1306_transport = &ssd1306_i2c_transport;
 
-/* set Display Offset to reset value */
-  buf[0] = SSD1306_DSPL_OFFSET;
-  buf[1] = SSD1306_DSPL_OFFSET_RESET;
-  i2c_write(SSD1306SlaveAdrs, 2, SSD1306_I2C_COMMAND, buf);
+/*
+ * ssd1306_set_transport()
+ *
+ * Select how commands and data get to the display.  Call this before
+ * ssd1306_i2c_init().
+ */
+void ssd1306_set_transport(const SSD1306_TRANSPORT_TYPE *transport)
+{
 
-/* set Display Start Line to reset value */
-  buf[0] = SSD1306_SET_START_LINE + SSD1306_SET_START_LINE_RESET;
-  i2c_write(SSD1306SlaveAdrs, 1, SSD1306_I2C_COMMAND, buf);
+  ssd1306_transport = transport;
 
-/* set Segment Re-map to reset value, flips display left to right
-   Doesn't affect data already in RAM, takes effect on next write to display */
-  buf[0] = SSD1306_SEG_REMAP_0; // reset value
-//  buf[0] = SSD1306_SEG_REMAP_127;
-  i2c_write(SSD1306SlaveAdrs, 1, SSD1306_I2C_COMMAND, buf);
+}/* end ssd1306_set_transport() */
 
-/* set COM Scan Direction to reset value, flips display vertically */
-  buf[0] = SSD1306_SET_COM_SCAN_NORM; // normal display (reset), top at ribbon
-//  buf[0] = SSD1306_SET_COM_SCAN_RMAP; // flips display, top at pins
-  i2c_write(SSD1306SlaveAdrs, 1, SSD1306_I2C_COMMAND, buf);
+/* Address window to be set ahead of the next display data, so that moving the
+   write position costs no extra transfer.  Only sent if ssd1306_window_pending
+   is set. */
+uint8_t ssd1306_window[6] =
+{
+  SSD1306_SET_COL_ADRS, 0, SSD1306_GRAPHICS_MAX_X - 1,
+  SSD1306_SET_PAGE_ADRS, 0, SSD1306_PAGE_MAX - 1
+};
+uint8_t ssd1306_window_pending = 0;
 
-/* set COM Pins Configuration to reset value */
-  buf[0] = SSD1306_SET_COM_CONFIG;
-  buf[1] = SSD1306_SET_COM_CONFIG_ALT;
-  i2c_write(SSD1306SlaveAdrs, 2, SSD1306_I2C_COMMAND, buf);
+/*
+ * ssd1306_set_window()
+ *
+ * Set the column and page address window that display data will be written
+ * to.  Nothing is sent now, the commands go in the same transfer as the next
+ * display data (see ssd1306_send_data()).
+ */
+void ssd1306_set_window(uint8_t col0, uint8_t col1, uint8_t page0, uint8_t page1)
+{
 
-/* set Display Contrast to reset value */
-  buf[0] = SSD1306_SET_CONTRAST;
-  buf[1] = SSD1306_SET_CONTRAST_RESET;
-  i2c_write(SSD1306SlaveAdrs, 2, SSD1306_I2C_COMMAND, buf);
+  ssd1306_window[1] = col0;
+  ssd1306_window[2] = col1;
+  ssd1306_window[4] = page0;
+  ssd1306_window[5] = page1;
+  ssd1306_window_pending = 1;
 
-/* set Display On/RAM to reset value */
-  buf[0] = SSD1306_ENTIRE_DSPL_RAM;
-  i2c_write(SSD1306SlaveAdrs, 1, SSD1306_I2C_COMMAND, buf);
+}/* end ssd1306_set_window() */
 
-/* set Display Normal/Inverse to reset value */
-  buf[0] = SSD1306_DISPLAY_NORM;
-  i2c_write(SSD1306SlaveAdrs, 1, SSD1306_I2C_COMMAND, buf);
+/*
+ * ssd1306_send_data()
+ *
+ * Send len bytes of display data from buf (or 0s if buf is 0), preceded in the
+ * same transfer by the address window if it has been changed.  Returns the
+ * transport's result, if it failed the window is sent again next time.
+ */
+uint8_t ssd1306_send_data(uint16_t len, const uint8_t *buf)
+{
+  uint8_t err;
 
-/* set Oscillator Frequency to reset value */
-  buf[0] = SSD1306_SET_CLOCK_FREQ;
-  buf[1] = SSD1306_SET_CLOCK_FREQ_RESET;
-  i2c_write(SSD1306SlaveAdrs, 2, SSD1306_I2C_COMMAND, buf);
+  if(ssd1306_window_pending)
+  {
+    err = ssd1306_transport->command_data(sizeof(ssd1306_window),
+                                          ssd1306_window, len, buf);
+    ssd1306_window_pending = (err != 0);
+  }
+  else
+  {
+    err = ssd1306_transport->data(len, buf);
+  }
 
-/* enable the Charge Pump */
-  buf[0] = SSD1306_CHARGE_PUMP;
-  buf[1] = SSD1306_CHARGE_PUMP_EN;
-  i2c_write(SSD1306SlaveAdrs, 2, SSD1306_I2C_COMMAND, buf);
+  return(err);
 
-/* turn On the display */
-  buf[0] = SSD1306_DISPLAY_ON;
-  i2c_write(SSD1306SlaveAdrs, 1, SSD1306_I2C_COMMAND, buf);
+}/* end ssd1306_send_data() */
 
-/* set the Memory Address Mode to Horizontal Mode */
-  buf[0] = SSD1306_MEM_ADRS_MODE;
-  buf[1] = SSD1306_MEM_ADRS_MODE_HORZ;
-  i2c_write(SSD1306SlaveAdrs, 2, SSD1306_I2C_COMMAND, buf);
+/*
+ * ssd1306_command_list()
+ *
+ * Send len command bytes from buf in RAM as one transfer.  Returns the
+ * transport's result.
+ */
+uint8_t ssd1306_command_list(uint8_t len, uint8_t *buf)
+{
+
+  return(ssd1306_transport->command(len, buf));
+
+}/* end ssd1306_command_list() */
+
+/*
+ * ssd1306_command_list_P()
+ *
+ * Send len command bytes from addr in program memory.  They are copied to RAM
+ * SSD1306_COMMAND_CHUNK bytes at a time, and each chunk is one transfer.
+ * Stops at the first chunk that fails and returns the transport's result.
+ */
+uint8_t ssd1306_command_list_P(uint8_t len, const uint8_t *addr)
+{
+  uint8_t buf[SSD1306_COMMAND_CHUNK], n, i, err = 0;
+
+  while((len > 0) && (err == 0))
+  {
+    n = (len > SSD1306_COMMAND_CHUNK) ? SSD1306_COMMAND_CHUNK : len;
+    for(i = 0; i < n; i++)
+    {
+      buf[i] = pgm_read_byte_near(addr++);
+    }
+    err = ssd1306_transport->command(n, buf);
+    len -= n;
+  }/* end while((len > 0) && (err == 0)) */
+
+  return(err);
+
+}/* end ssd1306_command_list_P() */
+
+/* ssd1306_i2c_command()
+ *
+ * Send a command to the display.  Returns the transport's result.
+ */
+uint8_t ssd1306_command(uint8_t cmd)
+{
+
+  return(ssd1306_transport->command(1, &cmd));
 
+}
+
+/* Initialization sequence for the controller, taken directly from the manual
+   and setting all registers to their reset values, sent in one transfer. */
+const uint8_t ssd1306_init_commands[] PROGMEM =
+{
+/* set Mux Ratio to reset value */
+  SSD1306_SET_MUX_RATIO, SSD1306_SET_MUX_RATIO_RESET,
+/* set Display Offset to reset value */
+  SSD1306_DSPL_OFFSET, SSD1306_DSPL_OFFSET_RESET,
+/* set Display Start Line to reset value */
+  SSD1306_SET_START_LINE + SSD1306_SET_START_LINE_RESET,
+/* set Segment Re-map to reset value, SSD1306_SEG_REMAP_127 flips the display
+   left to right (takes effect on the next write to the display) */
+  SSD1306_SEG_REMAP_0,
+/* set COM Scan Direction to reset value, normal display with the top at the
+   ribbon, SSD1306_SET_COM_SCAN_RMAP flips it vertically */
+  SSD1306_SET_COM_SCAN_NORM,
+/* set COM Pins Configuration to reset value */
+  SSD1306_SET_COM_CONFIG, SSD1306_SET_COM_CONFIG_ALT,
+/* set Display Contrast to reset value */
+  SSD1306_SET_CONTRAST, SSD1306_SET_CONTRAST_RESET,
+/* set Display On/RAM to reset value */
+  SSD1306_ENTIRE_DSPL_RAM,
+/* set Display Normal/Inverse to reset value */
+  SSD1306_DISPLAY_NORM,
+/* set Oscillator Frequency to reset value */
+  SSD1306_SET_CLOCK_FREQ, SSD1306_SET_CLOCK_FREQ_RESET,
+/* enable the Charge Pump */
+  SSD1306_CHARGE_PUMP, SSD1306_CHARGE_PUMP_EN,
+/* turn On the display */
+  SSD1306_DISPLAY_ON,
+/* set the Memory Address Mode to Horizontal Mode */
+  SSD1306_MEM_ADRS_MODE, SSD1306_MEM_ADRS_MODE_HORZ,
 /* set the Page and Column Address pointers */
-	buf[0] = SSD1306_SET_COL_ADRS;
-	buf[1] = 0;
-	buf[2] = SSD1306_GRAPHICS_MAX_X - 1;
-	i2c_write(SSD1306SlaveAdrs, 3, SSD1306_I2C_COMMAND, buf);
-	buf[0] = SSD1306_SET_PAGE_ADRS;
-	buf[1] = 0;
-	buf[2] = (SSD1306_GRAPHICS_MAX_Y / 8) - 1;
-	i2c_write(SSD1306SlaveAdrs, 3, SSD1306_I2C_COMMAND, buf);
+  SSD1306_SET_COL_ADRS, 0, SSD1306_GRAPHICS_MAX_X - 1,
+  SSD1306_SET_PAGE_ADRS, 0, SSD1306_PAGE_MAX - 1
+};
+
+/*
+ * ssd1306_i2c_init()
+ *
+ * Startup the I2C interface.  Initialize the display LCD controller.
+ *
+ * The initialization sequence for the controller is in
+ * ssd1306_init_commands[].
+ */
+void ssd1306_i2c_init(void)
+{
+
+  ssd1306_command_list_P(sizeof(ssd1306_init_commands), ssd1306_init_commands);
 
 /* clear the display memory and reset the row and column pointers */
   ssd1306_i2c_clear();
@@ -360,7 +558,7 @@ void ssd1306_i2c_putChar(unsigned char c)
     buf[i] = pgm_read_byte_near((PGM_P)&font5x7[c][i]);
   }
   buf[i] = 0;
-  i2c_write(SSD1306SlaveAdrs, 6, SSD1306_I2C_DATA, buf);
+  ssd1306_send_data(6, buf);
 
 }/* end ssd1306_i2c_putChar() */
 
@@ -371,10 +569,11 @@ void ssd1306_i2c_putChar(unsigned char c)
  * assumed to be character positions not exact pixel locations: the
  * display is 21 characters wide and has up to 8 character rows depending on the
  * display type.
+ *
+ * The new position is sent with the next character.
  */
 void ssd1306_i2c_set_text_cursor(uint8_t col, uint8_t row)
 {
-  uint8_t buf[3];
 
 /* Ensure the new position will be on the display. If not, exit. */
   if((col >= SSD1306_TEXT_MAX_X) || (row >= SSD1306_TEXT_MAX_Y))
@@ -385,14 +584,7 @@ void ssd1306_i2c_set_text_cursor(uint8_t col, uint8_t row)
   col *= 6;
 
 /* set the Page and Column Address pointers */
-	buf[0] = SSD1306_SET_COL_ADRS;
-	buf[1] = col;
-	buf[2] = SSD1306_GRAPHICS_MAX_X - 1;
-	i2c_write(SSD1306SlaveAdrs, 3, SSD1306_I2C_COMMAND, buf);
-	buf[0] = SSD1306_SET_PAGE_ADRS;
-	buf[1] = row;
-	buf[2] = (SSD1306_GRAPHICS_MAX_Y / 8) - 1;
-	i2c_write(SSD1306SlaveAdrs, 3, SSD1306_I2C_COMMAND, buf);
+  ssd1306_set_window(col, SSD1306_GRAPHICS_MAX_X - 1, row, SSD1306_PAGE_MAX - 1);
 
 }/* end ssd1306_i2c_set_text_cursor() */
 
@@ -401,40 +593,17 @@ void ssd1306_i2c_set_text_cursor(uint8_t col, uint8_t row)
  *
  * Clear the LCD controller buffer by writing 0 to each RAM location. Reset the
  * row and column address pointers to 0 when done.
+ *
+ * The address window is sent in the same transfer as the data.  Writing the
+ * whole window leaves the pointers back at 0, so they don't need resetting.
  */
 void ssd1306_i2c_clear(void)
 {
-	uint8_t buf[3];
 
-	/* set the Page and Column Address pointers */
-  buf[0] = SSD1306_SET_COL_ADRS;
-  buf[1] = 0;
-  buf[2] = SSD1306_GRAPHICS_MAX_X - 1;
-  i2c_write(SSD1306SlaveAdrs, 3, SSD1306_I2C_COMMAND, buf);
-	buf[0] = SSD1306_SET_PAGE_ADRS;
-	buf[1] = 0;
-	buf[2] = (SSD1306_GRAPHICS_MAX_Y / 8) - 1;
-  i2c_write(SSD1306SlaveAdrs, 3, SSD1306_I2C_COMMAND, buf);
+  ssd1306_set_window(0, SSD1306_GRAPHICS_MAX_X - 1, 0, SSD1306_PAGE_MAX - 1);
 
   /* fill display RAM with 0 */
-  i2c_start();
-  i2c_putchar((SSD1306SlaveAdrs<<1) & 0b11111110);
-  i2c_putchar(SSD1306_I2C_DATA);
-	for(uint16_t i = 0; i < (SSD1306_GRAPHICS_MAX_X * SSD1306_GRAPHICS_MAX_Y / 8); i++)
-  {
-  	i2c_putchar(0);
-	}
-  i2c_stop();
-
-  /* reset the address pointers */
-  buf[0] = SSD1306_SET_COL_ADRS;
-  buf[1] = 0;
-  buf[2] = SSD1306_GRAPHICS_MAX_X - 1;
-  i2c_write(SSD1306SlaveAdrs, 3, SSD1306_I2C_COMMAND, buf);
-  buf[0] = SSD1306_SET_PAGE_ADRS;
-  buf[1] = 0;
-  buf[2] = (SSD1306_GRAPHICS_MAX_Y / 8) - 1;
-  i2c_write(SSD1306SlaveAdrs, 3, SSD1306_I2C_COMMAND, buf);
+  ssd1306_send_data(SSD1306_GRAPHICS_MAX_X * SSD1306_GRAPHICS_MAX_Y / 8, 0);
 
 }/* end ssd1306_i2c_clear() */
 
@@ -448,7 +617,7 @@ void ssd1306_i2c_dspl_on(void)
   uint8_t buf;
   
   buf = SSD1306_DISPLAY_ON;
-  i2c_write(SSD1306SlaveAdrs, 1, SSD1306_I2C_COMMAND, &buf);
+  ssd1306_transport->command(1, &buf);
 
 }/* end ssd1306_i2c_dspl_on() */
 
@@ -462,7 +631,7 @@ void ssd1306_i2c_dspl_off(void)
   uint8_t buf;
   
   buf = SSD1306_DISPLAY_OFF;
-  i2c_write(SSD1306SlaveAdrs, 1, SSD1306_I2C_COMMAND, &buf);
+  ssd1306_transport->command(1, &buf);
 
 }/* end ssd1306_i2c_dspl_off() */
 
@@ -477,7 +646,7 @@ void ssd1306_i2c_dspl_inv(void)
   uint8_t buf;
   
   buf = SSD1306_DISPLAY_INV;
-  i2c_write(SSD1306SlaveAdrs, 1, SSD1306_I2C_COMMAND, &buf);
+  ssd1306_transport->command(1, &buf);
 
 }/* end ssd1306_i2c_dspl_inv() */
 
@@ -491,7 +660,7 @@ void ssd1306_i2c_dspl_norm(void)
   uint8_t buf;
   
   buf = SSD1306_DISPLAY_NORM;
-  i2c_write(SSD1306SlaveAdrs, 1, SSD1306_I2C_COMMAND, &buf);
+  ssd1306_transport->command(1, &buf);
 
 }/* end ssd1306_i2c_dspl_norm() */
 
@@ -506,9 +675,9 @@ void ssd1306_i2c_flip_normal(void)
   uint8_t buf;
 
   buf = SSD1306_SEG_REMAP_0; // reset value
-  i2c_write(SSD1306SlaveAdrs, 1, SSD1306_I2C_COMMAND, &buf);
+  ssd1306_transport->command(1, &buf);
   buf = SSD1306_SET_COM_SCAN_NORM; // normal display (reset), top at ribbon
-  i2c_write(SSD1306SlaveAdrs, 1, SSD1306_I2C_COMMAND, &buf);
+  ssd1306_transport->command(1, &buf);
 
 }/* end ssd1306_i2c_flip_normal() */
 
@@ -523,9 +692,9 @@ void ssd1306_i2c_flip_vertical(void)
   uint8_t buf;
 
   buf = SSD1306_SEG_REMAP_127;
-  i2c_write(SSD1306SlaveAdrs, 1, SSD1306_I2C_COMMAND, &buf);
+  ssd1306_transport->command(1, &buf);
   buf = SSD1306_SET_COM_SCAN_RMAP;
-  i2c_write(SSD1306SlaveAdrs, 1, SSD1306_I2C_COMMAND, &buf);
+  ssd1306_transport->command(1, &buf);
 
 }/* end ssd1306_i2c_flip_vertical() */
 
@@ -559,7 +728,7 @@ void set_horiz_scroll(uint8_t cmd, uint8_t top, uint8_t bot, uint8_t speed)
   buf[4] = bot;
   buf[5] = 0;
   buf[6] = 0xff;
-  i2c_write(SSD1306SlaveAdrs, 7, SSD1306_I2C_COMMAND, buf);
+  ssd1306_transport->command(7, buf);
 
 }/* end set_horiz_scroll() */
 
@@ -627,7 +796,7 @@ void set_vert_horiz_scroll(uint8_t cmd, uint8_t top, uint8_t bot, uint8_t speed,
   buf[3] = speed;
   buf[4] = bot;
   buf[5] = offset;
-  i2c_write(SSD1306SlaveAdrs, 6, SSD1306_I2C_COMMAND, buf);
+  ssd1306_transport->command(6, buf);
 
 }/* end set_vert_horiz_scroll() */
 
@@ -674,7 +843,7 @@ void ssd1306_start_scroll(void)
 {
   uint8_t buf = SSD1306_START_SCROLL;
   
-  i2c_write(SSD1306SlaveAdrs, 1, SSD1306_I2C_COMMAND, &buf);
+  ssd1306_transport->command(1, &buf);
 
 }/* end ssd1306_start_scroll() */
 
@@ -690,7 +859,7 @@ void ssd1306_stop_scroll(void)
 {
   uint8_t buf = SSD1306_STOP_SCROLL;
   
-  i2c_write(SSD1306SlaveAdrs, 1, SSD1306_I2C_COMMAND, &buf);
+  ssd1306_transport->command(1, &buf);
 
 }/* end ssd1306_stop_scroll() */
 
@@ -738,47 +907,299 @@ void ssd1306_i2c_putStr_P(const char *addr)
 /*
  * graphics_i2c_update()
  *
- * Send the entire local graphics memory to the display.
+ * Send the entire local graphics memory to the display.  The address window
+ * goes in the same transfer, and writing all of it leaves the pointers back
+ * at 0.  Returns the transport's result, the frame is left dirty if it failed.
+ */
+uint8_t ssd1306_i2c_graphics_update(void)
+{
+  uint8_t *graphics_frame, err;
+
+  graphics_frame = graphics_get_frame();
+
+  if(graphics_frame == 0)
+  {
+    return(0);
+  }
+
+  PROF_BEGIN(PROF_ID_SSD1306_UPDATE);
+  ssd1306_set_window(0, SSD1306_GRAPHICS_MAX_X - 1, 0, SSD1306_PAGE_MAX - 1);
+  err = ssd1306_send_data(SSD1306_GRAPHICS_MAX_X * SSD1306_GRAPHICS_MAX_Y / 8,
+                          graphics_frame);
+  if(err == 0)
+  {
+    graphics_clean();
+  }
+  PROF_END(PROF_ID_SSD1306_UPDATE);
+
+  return(err);
+
+}/* end graphics_i2c_update() */
+
+
+/*
+ * ssd1306_i2c_graphics_update_dirty()
+ *
+ * Send only the parts of the local graphics memory that have changed since the
+ * last update.  For each page with changes, the address window is set to the
+ * changed columns of that page and just those bytes are sent, in the same
+ * transfer.  Returns the transport's result, stopping at the first error.
  */
-void ssd1306_i2c_graphics_update(void)
+uint8_t ssd1306_i2c_graphics_update_dirty(void)
 {
-	uint8_t buf[3],
+  uint8_t page, x0, x1, sent = 0, err = 0,
           *graphics_frame;
 
   graphics_frame = graphics_get_frame();
 
   if(graphics_frame == 0)
   {
+    return(0);
+  }
+
+  for(page = 0; (page < SSD1306_PAGE_MAX) && (err == 0); page++)
+  {
+    if(graphics_get_dirty(page, &x0, &x1))
+    {
+      ssd1306_set_window(x0, x1, page, page);
+      err = ssd1306_send_data(x1 - x0 + 1,
+                              &graphics_frame[page * SSD1306_GRAPHICS_MAX_X + x0]);
+      sent = 1;
+    }
+  }/* end for(page = 0; (page < SSD1306_PAGE_MAX) && (err == 0); page++) */
+
+/* on an error everything is left dirty to be sent again */
+  if(err == 0)
+  {
+    graphics_clean();
+  }
+
+/* reset the address pointers, this goes with the next data sent */
+  if(sent)
+  {
+    ssd1306_set_window(0, SSD1306_GRAPHICS_MAX_X - 1, 0, SSD1306_PAGE_MAX - 1);
+  }
+
+  return(err);
+
+}/* end ssd1306_i2c_graphics_update_dirty() */
+
+/* Background update state.  One transaction sets the address window of a page
+   and the next sends the page, the callback of each page queues the next
+   pair. */
+I2C_TRANSACTION_TYPE ssd1306_async_cmd,
+                     ssd1306_async_data;
+uint8_t ssd1306_async_window[6],
+        ssd1306_async_page = 0;
+uint8_t *ssd1306_async_frame = 0;
+volatile uint8_t ssd1306_async_busy = 0;
+void (*ssd1306_async_done)(uint8_t status) = 0;
+
+/*
+ * ssd1306_async_finish()
+ *
+ * End the background update, called from the TWI interrupt.
+ */
+void ssd1306_async_finish(uint8_t status)
+{
+
+  ssd1306_async_busy = 0;
+  if(ssd1306_async_done != 0)
+  {
+    ssd1306_async_done(status);
+  }
+
+}/* end ssd1306_async_finish() */
+
+/*
+ * ssd1306_async_reset_done()
+ *
+ * Callback of the final command that puts the address window back to the
+ * whole display.
+ */
+void ssd1306_async_reset_done(I2C_TRANSACTION_TYPE *trans)
+{
+
+  ssd1306_async_finish(trans->status);
+
+}/* end ssd1306_async_reset_done() */
+
+/*
+ * ssd1306_async_post()
+ *
+ * Queue the next pair of transactions of the background update: the address
+ * window and data of ssd1306_async_page, or once every page has been sent, a
+ * command to put the address window back to the whole display.  Returns
+ * I2C_BUSY if the I2C queue hasn't room for all of them, then nothing has been
+ * queued, otherwise 0.
+ */
+uint8_t ssd1306_async_post(void)
+{
+  uint8_t sreg;
+
+  ssd1306_async_window[0] = SSD1306_SET_COL_ADRS;
+  ssd1306_async_window[1] = 0;
+  ssd1306_async_window[2] = SSD1306_GRAPHICS_MAX_X - 1;
+  ssd1306_async_window[3] = SSD1306_SET_PAGE_ADRS;
+  ssd1306_async_window[5] = SSD1306_PAGE_MAX - 1;
+
+  if(ssd1306_async_page >= SSD1306_PAGE_MAX)
+  {
+    ssd1306_async_window[4] = 0;
+    ssd1306_async_cmd.callback = ssd1306_async_reset_done;
+
+    return(i2c_transaction(&ssd1306_async_cmd));
+  }
+
+  ssd1306_async_window[4] = ssd1306_async_page;
+  ssd1306_async_cmd.callback = 0;
+  ssd1306_async_data.buf =
+    &ssd1306_async_frame[ssd1306_async_page * SSD1306_GRAPHICS_MAX_X];
+
+/* both or neither, another driver can post from an interrupt in between */
+  sreg = SREG;
+  cli();
+  if(i2c_queue_free() < 2)
+  {
+    SREG = sreg;
+    return(I2C_BUSY);
+  }
+  i2c_transaction(&ssd1306_async_cmd);
+  i2c_transaction(&ssd1306_async_data);
+  SREG = sreg;
+
+  return(0);
+
+}/* end ssd1306_async_post() */
+
+/*
+ * ssd1306_async_page_done()
+ *
+ * Callback of each page of the background update: queue the next page, or
+ * give up on the first error.
+ */
+void ssd1306_async_page_done(I2C_TRANSACTION_TYPE *trans)
+{
+
+  if(ssd1306_async_cmd.status != I2C_OK)
+  {
+    ssd1306_async_finish(ssd1306_async_cmd.status);
+    return;
+  }
+  if(trans->status != I2C_OK)
+  {
+    ssd1306_async_finish(trans->status);
     return;
   }
 
-/* set the Page and Column Address pointers */
-  buf[0] = SSD1306_SET_COL_ADRS;
-  buf[1] = 0;
-  buf[2] = SSD1306_GRAPHICS_MAX_X - 1;
-  i2c_write(SSD1306SlaveAdrs, 3, SSD1306_I2C_COMMAND, buf);
-  buf[0] = SSD1306_SET_PAGE_ADRS;
-  buf[1] = 0;
-  buf[2] = (SSD1306_GRAPHICS_MAX_Y / 8) - 1;
-  i2c_write(SSD1306SlaveAdrs, 3, SSD1306_I2C_COMMAND, buf);
+  ssd1306_async_page++;
+  if(ssd1306_async_post() != 0)
+  {
+    ssd1306_async_finish(I2C_BUSY);
+  }
+
+}/* end ssd1306_async_page_done() */
 
-  i2c_start();
-  i2c_putchar((SSD1306SlaveAdrs<<1) & 0b11111110);
-  i2c_putchar(SSD1306_I2C_DATA);
-  for(uint16_t i = 0; i < (SSD1306_GRAPHICS_MAX_X * SSD1306_GRAPHICS_MAX_Y / 8); i++)
+/*
+ * ssd1306_i2c_graphics_update_async()
+ *
+ * Start sending the entire local graphics memory to the display in the
+ * background and return straight away.  Once the first page is queued the
+ * frame is taken with graphics_swap(), so with GRAPHICS_BUFFERS 2 the next
+ * frame can be drawn while this one is on the wire.  With one buffer, anything
+ * drawn before the update finishes may or may not make it to the display this
+ * time.
+ *
+ * Each page goes in its own I2C transaction, queued by the TWI interrupt as
+ * the one before it finishes.  When the whole frame has been sent (or on the
+ * first error) done is called from the interrupt with an I2C result code.
+ * That is the moment to start the next update.  done can be 0.
+ *
+ * Returns 0 if the update was started, or SSD1306_BUSY if an update is already
+ * running or the I2C queue hasn't room for the first page.  Then nothing is
+ * changed, nothing is queued and done won't be called for this one.  Don't use
+ * the other ssd1306 functions until the update has finished.
+ *
+ * With a transport other than I2C the frame is sent before this returns,
+ * then done is called.
+ */
+uint8_t ssd1306_i2c_graphics_update_async(void (*done)(uint8_t status))
+{
+  uint8_t page;
+
+  if(ssd1306_async_busy)
   {
-      i2c_putchar(graphics_frame[i]);
-	}
-  i2c_stop();
+    return(SSD1306_BUSY);
+  }
 
-/* reset the address pointers */
-  buf[0] = SSD1306_SET_COL_ADRS;
-  buf[1] = 0;
-  buf[2] = SSD1306_GRAPHICS_MAX_X - 1;
-  i2c_write(SSD1306SlaveAdrs, 3, SSD1306_I2C_COMMAND, buf);
-  buf[0] = SSD1306_SET_PAGE_ADRS;
-  buf[1] = 0;
-  buf[2] = (SSD1306_GRAPHICS_MAX_Y / 8) - 1;
-  i2c_write(SSD1306SlaveAdrs, 3, SSD1306_I2C_COMMAND, buf);
+/* not I2C, send it now */
+  if(ssd1306_transport->adrs == 0)
+  {
+    ssd1306_async_frame = graphics_swap();
+    if(ssd1306_async_frame == 0)
+    {
+      return(0);
+    }
+    graphics_clean();
+    ssd1306_async_done = done;
+
+    ssd1306_set_window(0, SSD1306_GRAPHICS_MAX_X - 1, 0, SSD1306_PAGE_MAX - 1);
+    for(page = 0; page < SSD1306_PAGE_MAX; page++)
+    {
+      ssd1306_send_data(SSD1306_GRAPHICS_MAX_X,
+                        &ssd1306_async_frame[page * SSD1306_GRAPHICS_MAX_X]);
+    }
+    ssd1306_async_finish(I2C_OK);
+
+    return(0);
+  }
 
-}/* end graphics_i2c_update() */
+/* The frame being drawn now is the one graphics_swap() hands over, and the
+   copy it makes doesn't change it, so it can be queued first.  The frames are
+   only swapped and cleaned once it has been queued. */
+  ssd1306_async_frame = graphics_get_frame();
+  if(ssd1306_async_frame == 0)
+  {
+    return(0);
+  }
+
+  ssd1306_async_cmd.slvAdrs = ssd1306_transport->adrs;
+  ssd1306_async_cmd.adrs = SSD1306_I2C_COMMAND;
+  ssd1306_async_cmd.len = sizeof(ssd1306_async_window);
+  ssd1306_async_cmd.dir = I2C_DIR_WRITE;
+  ssd1306_async_cmd.buf = ssd1306_async_window;
+
+  ssd1306_async_data.slvAdrs = ssd1306_transport->adrs;
+  ssd1306_async_data.adrs = SSD1306_I2C_DATA;
+  ssd1306_async_data.len = SSD1306_GRAPHICS_MAX_X;
+  ssd1306_async_data.dir = I2C_DIR_WRITE;
+  ssd1306_async_data.callback = ssd1306_async_page_done;
+
+  ssd1306_async_page = 0;
+  ssd1306_async_done = done;
+  ssd1306_async_busy = 1;
+
+  if(ssd1306_async_post() != 0)
+  {
+    ssd1306_async_busy = 0;
+    return(SSD1306_BUSY);
+  }
+
+  graphics_swap();
+  graphics_clean();
+
+  return(0);
+
+}/* end ssd1306_i2c_graphics_update_async() */
+
+/*
+ * ssd1306_i2c_graphics_busy()
+ *
+ * Return non-zero while a background update is running.
+ */
+uint8_t ssd1306_i2c_graphics_busy(void)
+{
+
+  return(ssd1306_async_busy);
+
+}/* end ssd1306_i2c_graphics_busy() */
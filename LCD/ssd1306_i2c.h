@@ -14,8 +14,8 @@
  * to be modified.
  *
  * Displays of this type come with different interfaces to a microcontroller:
- * I2C, SPI, UART, parallel, etc.  This code assumes the display interfaces is
- * the I2C bus.
+ * I2C, SPI, UART, parallel, etc.  The I2C interface is used by default, others
+ * can be selected with ssd1306_set_transport() (see ssd1306_spi.h).
  *
  * This file is free software; you can redistribute it and/or modify
  * it under the terms of either the GNU General Public License version 3
@@ -37,6 +37,9 @@
 #define SSD1306_TEXT_MAX_X (SSD1306_GRAPHICS_MAX_X / 6)
 #define SSD1306_TEXT_MAX_Y (SSD1306_GRAPHICS_MAX_Y / 8)
 
+/* Returned by ssd1306_i2c_graphics_update_async() when it can't start. */
+#define SSD1306_BUSY 1
+
 /* Display scrolling parameters. */
 #define SSD1306_SCROLL_SPEED_2    0x07
 #define SSD1306_SCROLL_SPEED_3    0x04
@@ -47,6 +50,75 @@
 #define SSD1306_SCROLL_SPEED_128  0x02
 #define SSD1306_SCROLL_SPEED_256  0x03
 
+/* Most command bytes ssd1306_command_list_P() sends in one transfer. */
+#ifndef SSD1306_COMMAND_CHUNK
+#define SSD1306_COMMAND_CHUNK 32
+#endif
+
+/* Functions that get commands and data to the display.
+ *
+ * command     : send len command bytes from buf
+ * data        : send len bytes of display RAM data from buf, or len bytes of 0
+ *               if buf is 0
+ * command_data: send clen command bytes from cmd followed by len bytes of data
+ *               as above, in one transfer if the interface allows
+ *
+ * Each returns I2C_OK (0) or an I2C error code.
+ *
+ * adrs        : I2C slave address of the display, 0 if it isn't on I2C
+ */
+typedef struct
+{
+  uint8_t (*command)(uint8_t len, uint8_t *buf);
+  uint8_t (*data)(uint16_t len, const uint8_t *buf);
+  uint8_t (*command_data)(uint8_t clen, uint8_t *cmd, uint16_t len,
+                          const uint8_t *buf);
+  uint8_t adrs;
+
+} SSD1306_TRANSPORT_TYPE;
+
+/* The displays on the I2C bus, an I2C transport with the given name and slave
+ * address is made for each.  ssd1306_i2c_transport is the default and must be
+ * in the list, a second display is driven by selecting its transport with
+ * ssd1306_set_transport() and calling ssd1306_i2c_init() again.  Define this
+ * before the header to change the list.
+ */
+#ifndef SSD1306_I2C_DISPLAYS
+#define SSD1306_I2C_DISPLAYS(X) \
+  X(ssd1306_i2c_transport,    0x3c) \
+  X(ssd1306_i2c_transport_3d, 0x3d)
+#endif
+
+/* The I2C transports. */
+#define SSD1306_I2C_EXTERN(name, slave) \
+  extern const SSD1306_TRANSPORT_TYPE name;
+SSD1306_I2C_DISPLAYS(SSD1306_I2C_EXTERN)
+
+/*
+ * ssd1306_set_transport()
+ *
+ * Select how commands and data get to the display.  Call this before
+ * ssd1306_i2c_init().
+ */
+void ssd1306_set_transport(const SSD1306_TRANSPORT_TYPE *transport);
+
+/*
+ * ssd1306_command_list()
+ *
+ * Send len command bytes from buf in RAM as one transfer.  Returns the
+ * transport's result.
+ */
+uint8_t ssd1306_command_list(uint8_t len, uint8_t *buf);
+
+/*
+ * ssd1306_command_list_P()
+ *
+ * Send len command bytes from addr in program memory.  They are copied to RAM
+ * SSD1306_COMMAND_CHUNK bytes at a time, and each chunk is one transfer.
+ * Stops at the first chunk that fails and returns the transport's result.
+ */
+uint8_t ssd1306_command_list_P(uint8_t len, const uint8_t *addr);
+
 /*
  * ssd1306_i2c_init()
  *
@@ -91,6 +163,8 @@ void ssd1306_i2c_putChar(unsigned char c);
  * assumed to be character positions not exact pixel locations: the display is
  * 21 characters wide and has up to 8 character rows depending on the display
  * type.
+ *
+ * The new position is sent with the next character.
  */
 void ssd1306_i2c_set_text_cursor(uint8_t col, uint8_t row);
 
@@ -230,8 +304,45 @@ void ssd1306_i2c_putStr_P(const char *addr);
 /*
  * graphics_i2c_update()
  *
- * Send the entire local graphics memory to the display.
+ * Send the entire local graphics memory to the display.  Returns the
+ * transport's result, the frame stays dirty if it failed.
+ */
+uint8_t ssd1306_i2c_graphics_update(void);
+
+/*
+ * ssd1306_i2c_graphics_update_dirty()
+ *
+ * Send only the parts of the local graphics memory that have changed since the
+ * last update.  For each page with changes, the address window is set to the
+ * changed columns of that page and just those bytes are sent.  Returns the
+ * transport's result, stopping at the first error with the frame left dirty.
+ */
+uint8_t ssd1306_i2c_graphics_update_dirty(void);
+
+/*
+ * ssd1306_i2c_graphics_update_async()
+ *
+ * Start sending the entire local graphics memory to the display in the
+ * background and return straight away.  The frame is taken with
+ * graphics_swap(), so with GRAPHICS_BUFFERS 2 the next frame can be drawn while
+ * this one is on the wire.  Each page goes in its own I2C transaction.
+ *
+ * When the whole frame has been sent (or on the first error) done is called
+ * from the TWI interrupt with an I2C result code, this is the moment to start
+ * the next update.  done can be 0.
+ *
+ * Returns 0 if the update was started, or SSD1306_BUSY if an update is already
+ * running or the I2C queue is full, then nothing is changed or queued.  Don't
+ * use the other ssd1306 functions until the update has finished.  With a
+ * transport other than I2C the frame is sent before this returns.
+ */
+uint8_t ssd1306_i2c_graphics_update_async(void (*done)(uint8_t status));
+
+/*
+ * ssd1306_i2c_graphics_busy()
+ *
+ * Return non-zero while a background update is running.
  */
-void ssd1306_i2c_graphics_update(void);
+uint8_t ssd1306_i2c_graphics_busy(void);
 
 #endif
@@ -0,0 +1,144 @@
+/*
+ * File:       ssd1306_spi.c
+ * Date:       October 14, 2026
+ * Author:     Craig Hollinger
+ *
+ * 4-wire SPI transport for the ssd1306 display driver in ssd1306_i2c.c.
+ *
+ * On the SPI interface the D/C pin tells the display whether the bytes clocked
+ * in are commands (low) or display data (high), there are no control bytes
+ * like on the I2C bus.  CS is held low for the whole of each block of bytes.
+ * The display accepts a clock of up to 10MHz, so F_CPU/2 is used.  The bus is
+ * claimed for each block, so an interrupt driven transfer another driver
+ * started with spi_transfer_async() is finished first and none can start in
+ * the middle of one.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#include <avr/io.h>
+#include "spi/spi.h"
+#include "ssd1306/ssd1306_i2c.h"
+#include "ssd1306/ssd1306_spi.h"
+
+/* Pins used for D/C and CS. */
+volatile uint8_t *ssd1306_spi_dc_port = 0,
+                 *ssd1306_spi_cs_port = 0;
+uint8_t ssd1306_spi_dc_mask = 0,
+        ssd1306_spi_cs_mask = 0;
+
+/*
+ * ssd1306_spi_send_command()
+ *
+ * SPI transport: send len command bytes from buf to the display.  SPI can't
+ * fail, this and the other SPI transport functions always return 0.
+ */
+uint8_t ssd1306_spi_send_command(uint8_t len, uint8_t *buf)
+{
+
+  spi_claim();
+  *ssd1306_spi_dc_port &= ~ssd1306_spi_dc_mask;/* command */
+  *ssd1306_spi_cs_port &= ~ssd1306_spi_cs_mask;
+
+  spi_transfer_buffer(buf, 0, len);
+
+  *ssd1306_spi_cs_port |= ssd1306_spi_cs_mask;
+  spi_release();
+
+  return(0);
+
+}/* end ssd1306_spi_send_command() */
+
+/*
+ * ssd1306_spi_send_data()
+ *
+ * SPI transport: send len bytes of display data from buf to the display, or
+ * len bytes of 0 if buf is 0.
+ */
+uint8_t ssd1306_spi_send_data(uint16_t len, const uint8_t *buf)
+{
+  uint16_t i;
+
+  spi_claim();
+  *ssd1306_spi_dc_port |= ssd1306_spi_dc_mask;/* data */
+  *ssd1306_spi_cs_port &= ~ssd1306_spi_cs_mask;
+
+  if(buf != 0)
+  {
+    spi_transfer_buffer(buf, 0, len);
+  }
+  else
+  {
+    for(i = 0; i < len; i++)
+    {
+      spi_transfer(0);
+    }
+  }
+
+  *ssd1306_spi_cs_port |= ssd1306_spi_cs_mask;
+  spi_release();
+
+  return(0);
+
+}/* end ssd1306_spi_send_data() */
+
+/*
+ * ssd1306_spi_send_command_data()
+ *
+ * SPI transport: send clen command bytes from cmd then len bytes of display
+ * data from buf (or 0s if buf is 0).
+ */
+uint8_t ssd1306_spi_send_command_data(uint8_t clen, uint8_t *cmd,
+                                      uint16_t len, const uint8_t *buf)
+{
+
+  ssd1306_spi_send_command(clen, cmd);
+
+  return(ssd1306_spi_send_data(len, buf));
+
+}/* end ssd1306_spi_send_command_data() */
+
+/* The SPI transport. */
+const SSD1306_TRANSPORT_TYPE ssd1306_spi_transport =
+{
+  ssd1306_spi_send_command,
+  ssd1306_spi_send_data,
+  ssd1306_spi_send_command_data,
+  0
+};
+
+/*
+ * ssd1306_spi_init()
+ *
+ * Startup the SPI interface at F_CPU/2, select the SPI transport and
+ * initialize the display controller with ssd1306_i2c_init().
+ *
+ * dcPort, dcMask: PORT register and bit mask of the pin wired to D/C
+ * csPort, csMask: PORT register and bit mask of the pin wired to CS
+ */
+void ssd1306_spi_init(volatile uint8_t *dcPort, uint8_t dcMask,
+                      volatile uint8_t *csPort, uint8_t csMask)
+{
+
+  ssd1306_spi_dc_port = dcPort;
+  ssd1306_spi_dc_mask = dcMask;
+  ssd1306_spi_cs_port = csPort;
+  ssd1306_spi_cs_mask = csMask;
+
+/* CS high (deselected) and both pins outputs, the DDR register is just below
+   the PORT register */
+  *csPort |= csMask;
+  *(csPort - 1) |= csMask;
+  *dcPort |= dcMask;
+  *(dcPort - 1) |= dcMask;
+
+/* the display samples on the rising edge of SCK, MSB first: mode 0 */
+  spi_init(SPI_SPCR_SPE | SPI_SPCR_MSTR | SPI_SPCR_DORD_MSB | SPI_SPCR_MODE0 |
+           SPI_SPCR_DIV2, SPI_SPSR_SPI2X);
+
+  ssd1306_set_transport(&ssd1306_spi_transport);
+  ssd1306_i2c_init();
+
+}/* end ssd1306_spi_init() */
@@ -0,0 +1,46 @@
+/*
+ * File:       ssd1306_spi.h
+ * Date:       October 14, 2026
+ * Author:     Craig Hollinger
+ *
+ * Public interface for ssd1306_spi.c, the 4-wire SPI transport for the ssd1306
+ * display driver.
+ *
+ * Once ssd1306_spi_init() has been called, all of the ssd1306_i2c_...()
+ * functions (text, scrolling, graphics update) talk to the display over SPI
+ * instead of I2C.  The graphics frame buffer is shared, graphics.c doesn't care
+ * which transport is in use.
+ *
+ * Wiring: SCK (PB5) to D0, MOSI (PB3) to D1, plus two port pins for D/C and
+ * CS.  The display RES pin must be pulsed low by the caller or tied to the
+ * processor reset.  PB2 (SS) is set to output by spi_init(), it can be used as
+ * the CS pin.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#ifndef _SSD1306_SPI_H_
+#define _SSD1306_SPI_H_ 1
+
+#include "ssd1306/ssd1306_i2c.h"
+
+/* The SPI transport. */
+extern const SSD1306_TRANSPORT_TYPE ssd1306_spi_transport;
+
+/*
+ * ssd1306_spi_init()
+ *
+ * Startup the SPI interface at F_CPU/2, select the SPI transport and
+ * initialize the display controller with ssd1306_i2c_init().
+ *
+ * dcPort, dcMask: PORT register and bit mask of the pin wired to D/C
+ * csPort, csMask: PORT register and bit mask of the pin wired to CS
+ *
+ * e.g. ssd1306_spi_init(&PORTB, _BV(PORTB1), &PORTB, _BV(PORTB2));
+ */
+void ssd1306_spi_init(volatile uint8_t *dcPort, uint8_t dcMask,
+                      volatile uint8_t *csPort, uint8_t csMask);
+
+#endif /* _SSD1306_SPI_H_ */
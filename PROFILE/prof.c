@@ -0,0 +1,242 @@
+/*
+ * File:    prof.c
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Cycle counting profiler on Timer/Counter 1.
+ *
+ * TC1 runs in normal mode with no prescale.  The overflow interrupt counts
+ * the upper 16 bits, prof_cycles() puts the two together and allows for an
+ * overflow that has happened but not been serviced yet.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <stdlib.h>
+#include "timer/tc1.h"
+#include "uart/uart.h"
+#include "prof/prof.h"
+
+#ifdef PROF_ENABLE
+
+volatile uint16_t prof_overflows = 0;
+uint32_t prof_overhead = 0;
+PROF_ENTRY_TYPE prof_table[PROF_MAX_IDS];
+
+/*
+ * TC1 overflow interrupt
+ *
+ * Count the upper 16 bits of the cycle count.
+ */
+ISR(TIMER1_OVF_vect)
+{
+
+  prof_overflows++;
+
+}/* end ISR(TIMER1_OVF_vect) */
+
+/*
+ * prof_cycles()
+ *
+ * Return the 32-bit cycle count.
+ */
+uint32_t prof_cycles(void)
+{
+  uint8_t sreg;
+  uint16_t lo, hi;
+
+  sreg = SREG;
+  cli();
+  lo = TCNT1;
+  hi = prof_overflows;
+  if((TIFR1 & _BV(TOV1)) && (lo < 0x8000))
+  {
+    hi++;
+  }
+  SREG = sreg;
+
+  return(((uint32_t)hi << 16) | lo);
+
+}/* end prof_cycles() */
+
+/*
+ * prof_begin()
+ *
+ * Start timing id.
+ */
+void prof_begin(uint8_t id)
+{
+
+  if(id < PROF_MAX_IDS)
+  {
+    prof_table[id].start = prof_cycles();
+  }
+
+}/* end prof_begin() */
+
+/*
+ * prof_end()
+ *
+ * Stop timing id and add the run to its entry.
+ */
+void prof_end(uint8_t id)
+{
+  uint32_t now, time;
+  PROF_ENTRY_TYPE *entry;
+
+  now = prof_cycles();
+  if(id >= PROF_MAX_IDS)
+  {
+    return;
+  }
+
+  entry = &prof_table[id];
+  time = now - entry->start;
+  time = (time > prof_overhead) ? time - prof_overhead : 0;
+
+  if(entry->count < 0xffff)
+  {
+    entry->count++;
+    entry->total += time;
+  }
+  if(time < entry->min)
+  {
+    entry->min = time;
+  }
+  if(time > entry->max)
+  {
+    entry->max = time;
+  }
+
+}/* end prof_end() */
+
+/*
+ * prof_reset()
+ *
+ * Clear the table.
+ */
+void prof_reset(void)
+{
+  uint8_t sreg, id;
+
+  sreg = SREG;
+  cli();
+  for(id = 0; id < PROF_MAX_IDS; id++)
+  {
+    prof_table[id].total = 0;
+    prof_table[id].min = 0xffffffff;
+    prof_table[id].max = 0;
+    prof_table[id].count = 0;
+  }
+  SREG = sreg;
+
+}/* end prof_reset() */
+
+/*
+ * prof_init()
+ *
+ * Start TC1 free running at F_CPU, clear the table and measure the cost of a
+ * PROF_BEGIN()/PROF_END() pair.
+ */
+void prof_init(void)
+{
+  Timer_Counter1 timer;
+  PROF_ENTRY_TYPE entry;
+
+  tc1_get_config(&timer);
+  timer.tccr1a.reg = 0; /* normal mode, outputs disconnected */
+  timer.tccr1b.reg = 0;
+  timer.tccr1b.cs1 = TC1_TCCR1B_CLK_PRSC1;
+  timer.tcnt1.tcnt1_reg = 0;
+  timer.timsk1.reg = 0;
+  timer.timsk1.toie1 = 1;
+  timer.tifr1.reg = _BV(TOV1); /* writing 1 clears a pending overflow */
+  prof_overflows = 0;
+  tc1_set_config(&timer);
+
+  /* time an empty pair, the least it can take */
+  prof_overhead = 0;
+  prof_reset();
+  PROF_BEGIN(0);
+  PROF_END(0);
+  PROF_BEGIN(0);
+  PROF_END(0);
+  prof_get(0, &entry);
+  prof_overhead = entry.min;
+  prof_reset();
+
+}/* end prof_init() */
+
+/*
+ * prof_get()
+ *
+ * Copy the table entry for id to entry.
+ */
+void prof_get(uint8_t id, PROF_ENTRY_TYPE *entry)
+{
+  uint8_t sreg;
+
+  if(id >= PROF_MAX_IDS)
+  {
+    return;
+  }
+
+  sreg = SREG;
+  cli();
+  *entry = prof_table[id];
+  SREG = sreg;
+
+}/* end prof_get() */
+
+/*
+ * prof_put_number()
+ *
+ * Print an unsigned number followed by a space.
+ */
+void prof_put_number(uint32_t n)
+{
+  char buf[12];
+
+  ultoa(n, buf, 10);
+  uart_putstr(buf);
+  uart_putchar(' ');
+
+}/* end prof_put_number() */
+
+/*
+ * prof_dump()
+ *
+ * Print one line for each id that has run: id, count, min, max, average and
+ * total cycles.
+ */
+void prof_dump(void)
+{
+  uint8_t id;
+  PROF_ENTRY_TYPE entry;
+
+  uart_putstr_P(PSTR("id count min max avg total\r\n"));
+  for(id = 0; id < PROF_MAX_IDS; id++)
+  {
+    prof_get(id, &entry);
+    if(entry.count == 0)
+    {
+      continue;
+    }
+
+    prof_put_number(id);
+    prof_put_number(entry.count);
+    prof_put_number(entry.min);
+    prof_put_number(entry.max);
+    prof_put_number(entry.total / entry.count);
+    prof_put_number(entry.total);
+    uart_putstr_P(PSTR("\r\n"));
+  }
+
+}/* end prof_dump() */
+
+#endif /* PROF_ENABLE */
@@ -0,0 +1,129 @@
+/*
+ * File:    prof.h
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Cycle counting profiler on Timer/Counter 1.
+ *
+ * TC1 free-runs at F_CPU and its overflow interrupt extends it to 32 bits.
+ * PROF_BEGIN(id) and PROF_END(id) around a piece of code add the cycles it
+ * took to a table entry for id: number of runs, shortest, longest and total.
+ * prof_dump() prints the table out the UART.
+ *
+ * The profiler is only built when PROF_ENABLE is defined (-DPROF_ENABLE for
+ * the whole program).  Without it the macros and functions below are empty,
+ * and TC1 is left alone.
+ *
+ * Each id can only be timed by one piece of code at a time.  Code in an ISR
+ * and the code it interrupts must use different ids.  Time spent in other
+ * interrupts is counted in the code they interrupt.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#ifndef _PROF_H_
+#define _PROF_H_ 1
+
+#include <stdint.h>
+
+/* Number of entries in the table. */
+#ifndef PROF_MAX_IDS
+#define PROF_MAX_IDS 12
+#endif
+
+/* Ids used by the drivers, the application can use PROF_ID_USER and up. */
+enum
+{
+  PROF_ID_TWI_ISR,         /* ISR(TWI_vect) */
+  PROF_ID_SPI_ISR,         /* ISR(SPI_STC_vect) */
+  PROF_ID_UART_UDRE_ISR,   /* ISR(USART_UDRE_vect) */
+  PROF_ID_PUTCHAR,         /* graphics_putChar() */
+  PROF_ID_SSD1306_UPDATE,  /* ssd1306_i2c_graphics_update() */
+  PROF_ID_USER
+};
+
+#ifdef PROF_ENABLE
+
+/* One table entry, all times in CPU cycles.
+ *
+ * start: TC1 time of the last PROF_BEGIN()
+ * total: sum of all the runs
+ * min  : shortest run
+ * max  : longest run
+ * count: number of runs, total stops with it at 0xffff
+ */
+typedef struct
+{
+  uint32_t start;
+  uint32_t total;
+  uint32_t min;
+  uint32_t max;
+  uint16_t count;
+
+} PROF_ENTRY_TYPE;
+
+#define PROF_BEGIN(id) prof_begin(id)
+#define PROF_END(id)   prof_end(id)
+
+/*
+ * prof_init()
+ *
+ * Start TC1 free running at F_CPU, clear the table and measure the cost of a
+ * PROF_BEGIN()/PROF_END() pair, which is taken off every run.  Global
+ * interrupts must be enabled.
+ */
+void prof_init(void);
+
+/*
+ * prof_cycles()
+ *
+ * Return the 32-bit cycle count.  Wraps after 2^32 cycles (about 4.5 minutes
+ * at 16MHz).
+ */
+uint32_t prof_cycles(void);
+
+/*
+ * prof_begin()
+ * prof_end()
+ *
+ * Start and stop timing id, used by PROF_BEGIN() and PROF_END().
+ */
+void prof_begin(uint8_t id);
+void prof_end(uint8_t id);
+
+/*
+ * prof_get()
+ *
+ * Copy the table entry for id to entry, with interrupts held off so it is
+ * consistent.
+ */
+void prof_get(uint8_t id, PROF_ENTRY_TYPE *entry);
+
+/*
+ * prof_reset()
+ *
+ * Clear the table.
+ */
+void prof_reset(void);
+
+/*
+ * prof_dump()
+ *
+ * Print one line for each id that has run: id, count, min, max, average and
+ * total cycles.  Uses the blocking UART output functions.
+ */
+void prof_dump(void);
+
+#else /* PROF_ENABLE */
+
+#define PROF_BEGIN(id)
+#define PROF_END(id)
+#define prof_init()
+#define prof_reset()
+#define prof_dump()
+
+#endif /* PROF_ENABLE */
+
+#endif /* _PROF_H_ */
@@ -0,0 +1,159 @@
+/*
+ * File:    trace.c
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Binary event trace.
+ *
+ * Writers can be any ISR or the main line, so trace_write() holds off
+ * interrupts for the few instructions it takes to fill a record and move the
+ * head.  trace_drain() is the only reader, it copies records out from the
+ * tail with interrupts on and only then moves the tail, so a writer never
+ * overwrites a record that is still being sent.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "timer/tc1.h"
+#include "uart/telemetry.h"
+#include "prof/trace.h"
+
+#ifdef TRACE_ENABLE
+
+#if (TRACE_LENGTH & (TRACE_LENGTH - 1)) != 0 || TRACE_LENGTH > 128
+#error "TRACE_LENGTH must be a power of 2, no more than 128"
+#endif
+
+/* bytes in a record, and the most records in one frame */
+#define TRACE_RECORD_SIZE 5
+#define TRACE_PER_FRAME   ((TELEMETRY_MAX_PAYLOAD - 2) / TRACE_RECORD_SIZE)
+
+/* One record. */
+typedef struct
+{
+  uint16_t time;
+  uint8_t id;
+  uint16_t arg;
+
+} __attribute__((packed)) TRACE_RECORD_TYPE;
+
+TRACE_RECORD_TYPE trace_ring[TRACE_LENGTH];
+volatile uint8_t trace_head = 0,
+                 trace_tail = 0,
+                 trace_lost = 0;
+
+/*
+ * trace_init()
+ *
+ * Empty the ring, and start TC1 if a clock is given.
+ */
+void trace_init(uint8_t clk)
+{
+  uint8_t sreg;
+  Timer_Counter1 timer;
+
+  if(clk != TC1_TCCR1B_CLK_NONE)
+  {
+    tc1_get_config(&timer);
+    timer.tccr1a.reg = 0; /* normal mode, outputs disconnected */
+    timer.tccr1b.reg = 0;
+    timer.tccr1b.cs1 = clk;
+    tc1_set_config(&timer);
+  }
+
+  sreg = SREG;
+  cli();
+  trace_head = 0;
+  trace_tail = 0;
+  trace_lost = 0;
+  SREG = sreg;
+
+}/* end trace_init() */
+
+/*
+ * trace_write()
+ *
+ * Put a record in the ring.
+ */
+void trace_write(uint8_t id, uint16_t arg)
+{
+  uint8_t sreg, head;
+  TRACE_RECORD_TYPE *rec;
+
+  sreg = SREG;
+  cli();
+  head = trace_head;
+  if(((head + 1) & (TRACE_LENGTH - 1)) == trace_tail)
+  {
+    if(trace_lost != 0xff)
+    {
+      trace_lost++;
+    }
+  }
+  else
+  {
+    rec = &trace_ring[head];
+    rec->time = TCNT1;
+    rec->id = id;
+    rec->arg = arg;
+    trace_head = (head + 1) & (TRACE_LENGTH - 1);
+  }
+  SREG = sreg;
+
+}/* end trace_write() */
+
+/*
+ * trace_drain()
+ *
+ * Send as many records as fit in one telemetry frame.
+ */
+uint8_t trace_drain(void)
+{
+  uint8_t sreg, tail, count, lost, i;
+  TRACE_RECORD_TYPE *rec;
+
+  tail = trace_tail;
+  count = (trace_head - tail) & (TRACE_LENGTH - 1);
+  if(count == 0)
+  {
+    return(0);
+  }
+  if(count > TRACE_PER_FRAME)
+  {
+    count = TRACE_PER_FRAME;
+  }
+
+  if(telemetry_begin(TRACE_FRAME_TYPE, 2 + count * TRACE_RECORD_SIZE) != TELEMETRY_OK)
+  {
+    return(0);
+  }
+
+  sreg = SREG;
+  cli();
+  lost = trace_lost;
+  trace_lost = 0;
+  SREG = sreg;
+
+  telemetry_put(lost);
+  telemetry_put(count);
+  for(i = 0; i < count; i++)
+  {
+    rec = &trace_ring[(tail + i) & (TRACE_LENGTH - 1)];
+    telemetry_put_int16(rec->time);
+    telemetry_put(rec->id);
+    telemetry_put_int16(rec->arg);
+  }
+  telemetry_end();
+
+  /* only now can the records be reused */
+  trace_tail = (tail + count) & (TRACE_LENGTH - 1);
+
+  return(count);
+
+}/* end trace_drain() */
+
+#endif /* TRACE_ENABLE */
@@ -0,0 +1,106 @@
+/*
+ * File:    trace.h
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Binary event trace.
+ *
+ * TRACE(id, arg) puts a record of the TC1 count, an event id and a 16-bit
+ * argument into a ring, from an ISR or from the main line.  trace_drain(),
+ * called from the main loop, sends the records out in telemetry frames so a
+ * host can put together bus timelines, ISR latency and jitter.
+ *
+ * Each frame's payload is:
+ *
+ *   byte | contents
+ *   ---------------------------------------------------------------
+ *     0  | records lost since the last frame (ring full), stops at 255
+ *     1  | number of records that follow
+ *    2-  | records, 5 bytes each: TC1 count (2), id (1), arg (2), all
+ *        | low byte first
+ *
+ * The time stamp is the raw TC1 count, it wraps every 65536 timer clocks.
+ *
+ * The trace is only built when TRACE_ENABLE is defined.  Without it TRACE()
+ * and the functions below are empty.  TRACE_MASK picks which ids are built
+ * in, one bit per id.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#ifndef _TRACE_H_
+#define _TRACE_H_ 1
+
+#include <stdint.h>
+
+/* Number of records the ring holds, must be a power of 2, no more than 128. */
+#ifndef TRACE_LENGTH
+#define TRACE_LENGTH 64
+#endif
+
+/* Telemetry frame type of the trace frames. */
+#ifndef TRACE_FRAME_TYPE
+#define TRACE_FRAME_TYPE 'T'
+#endif
+
+/* Events traced by the drivers, the application can use TRACE_ID_USER up to
+   15. */
+enum
+{
+  TRACE_ID_TWI_ISR,     /* ISR(TWI_vect), arg = TW_STATUS */
+  TRACE_ID_I2C_RETRY,   /* slave didn't answer, trying again, arg = address */
+  TRACE_ID_I2C_ERROR,   /* transaction failed, arg = address << 8 | result */
+  TRACE_ID_SPI_ISR,     /* ISR(SPI_STC_vect), arg = byte index */
+  TRACE_ID_UART_UDRE,   /* ISR(USART_UDRE_vect), arg = transmit ring tail */
+  TRACE_ID_USER
+};
+
+/* Ids built in, one bit per id.  The UART transmit interrupt is left out by
+   default: trace_drain() sends through it, so each frame would trace itself
+   into the next. */
+#ifndef TRACE_MASK
+#define TRACE_MASK (0xffff & ~(1 << TRACE_ID_UART_UDRE))
+#endif
+
+#ifdef TRACE_ENABLE
+
+#define TRACE(id, arg) do { if((TRACE_MASK >> (id)) & 1) trace_write(id, arg); } while(0)
+
+/*
+ * trace_init()
+ *
+ * Empty the ring.  If clk is not TC1_TCCR1B_CLK_NONE, TC1 is started free
+ * running with that clock select for the time stamps.  Use
+ * TC1_TCCR1B_CLK_NONE when TC1 is already running, from prof_init() for
+ * instance.
+ */
+void trace_init(uint8_t clk);
+
+/*
+ * trace_write()
+ *
+ * Put a record in the ring, used by TRACE().  If the ring is full the record
+ * is counted as lost.
+ */
+void trace_write(uint8_t id, uint16_t arg);
+
+/*
+ * trace_drain()
+ *
+ * Send as many records as fit in one telemetry frame.  Returns the number
+ * sent, 0 if the ring was empty or the UART had no room (the records are kept
+ * for next time).
+ */
+uint8_t trace_drain(void);
+
+#else /* TRACE_ENABLE */
+
+#define TRACE(id, arg)
+#define trace_init(clk)
+#define trace_drain() 0
+
+#endif /* TRACE_ENABLE */
+
+#endif /* _TRACE_H_ */
@@ -0,0 +1,36 @@
+/*
+ * File:    interrupt.h
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * <avr/interrupt.h> for the host simulation.
+ *
+ * ISR(vector) defines the handler the simulator calls for that vector.  The
+ * ISR_BLOCK/ISR_NOBLOCK attributes are accepted and ignored, a handler always
+ * runs with interrupts off unless it turns them on.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#ifndef _SIM_AVR_INTERRUPT_H_
+#define _SIM_AVR_INTERRUPT_H_ 1
+
+#include <avr/io.h>
+
+/* Turn global interrupts on or off, sei() runs any that are pending. */
+void sim_sei(void);
+void sim_cli(void);
+
+#define sei() sim_sei()
+#define cli() sim_cli()
+
+#define ISR_BLOCK
+#define ISR_NOBLOCK
+#define ISR_NAKED
+
+#define ISR(vector, ...) void vector(void); void vector(void)
+#define EMPTY_INTERRUPT(vector) void vector(void); void vector(void) { }
+
+#endif /* _SIM_AVR_INTERRUPT_H_ */
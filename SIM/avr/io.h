@@ -0,0 +1,629 @@
+/*
+ * File:    io.h
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * <avr/io.h> for the host simulation, ATmega328P registers and bits.
+ *
+ * Each register is an access through the simulator.  The ports and most
+ * registers are plain memory at their data space addresses, so pointers to
+ * them (&PORTB) and the PIN/DDR/PORT layout work as on the part.  The
+ * registers where an access does something (TWCR, SPDR, UDR0, UCSR0A and the
+ * interrupt flag registers) are read and written through a 16-bit cell with
+ * bit 8 set when it is handed out.  A write stores a byte and clears bit 8,
+ * so the simulator can tell a write from a read even when the byte written
+ * is the same as the one there.  A read-modify-write that leaves the value
+ * unchanged is taken as a read.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#ifndef _SIM_AVR_IO_H_
+#define _SIM_AVR_IO_H_ 1
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+#define bit_is_set(sfr, bit) ((sfr) & _BV(bit))
+#define bit_is_clear(sfr, bit) (!((sfr) & _BV(bit)))
+#define loop_until_bit_is_set(sfr, bit) do { } while(bit_is_clear(sfr, bit))
+#define loop_until_bit_is_clear(sfr, bit) do { } while(bit_is_set(sfr, bit))
+
+/* Register access, each one takes SIM_ACCESS_CYCLES and brings the models up
+   to date.  sim_io() and sim_io16() return the register itself, sim_reg() a
+   cell the simulator looks at on the next access. */
+volatile uint8_t *sim_io(uint8_t adrs);
+volatile uint16_t *sim_io16(uint8_t adrs);
+volatile uint16_t *sim_reg(uint8_t adrs);
+
+#define SIM_IO8(adrs)  (*sim_io(adrs))
+#define SIM_IO16(adrs) (*sim_io16(adrs))
+#define SIM_REG8(adrs) (*sim_reg(adrs))
+
+/* Data space addresses. */
+#define SIM_ADRS_PINB   0x23
+#define SIM_ADRS_DDRB   0x24
+#define SIM_ADRS_PORTB  0x25
+#define SIM_ADRS_PINC   0x26
+#define SIM_ADRS_DDRC   0x27
+#define SIM_ADRS_PORTC  0x28
+#define SIM_ADRS_PIND   0x29
+#define SIM_ADRS_DDRD   0x2a
+#define SIM_ADRS_PORTD  0x2b
+#define SIM_ADRS_TIFR0  0x35
+#define SIM_ADRS_TIFR1  0x36
+#define SIM_ADRS_TIFR2  0x37
+#define SIM_ADRS_PCIFR  0x3b
+#define SIM_ADRS_EIFR   0x3c
+#define SIM_ADRS_EIMSK  0x3d
+#define SIM_ADRS_GPIOR0 0x3e
+#define SIM_ADRS_GTCCR  0x43
+#define SIM_ADRS_TCCR0A 0x44
+#define SIM_ADRS_TCCR0B 0x45
+#define SIM_ADRS_TCNT0  0x46
+#define SIM_ADRS_OCR0A  0x47
+#define SIM_ADRS_OCR0B  0x48
+#define SIM_ADRS_GPIOR1 0x4a
+#define SIM_ADRS_GPIOR2 0x4b
+#define SIM_ADRS_SPCR   0x4c
+#define SIM_ADRS_SPSR   0x4d
+#define SIM_ADRS_SPDR   0x4e
+#define SIM_ADRS_SMCR   0x53
+#define SIM_ADRS_MCUSR  0x54
+#define SIM_ADRS_MCUCR  0x55
+#define SIM_ADRS_SPL    0x5d
+#define SIM_ADRS_SPH    0x5e
+#define SIM_ADRS_SREG   0x5f
+#define SIM_ADRS_WDTCSR 0x60
+#define SIM_ADRS_CLKPR  0x61
+#define SIM_ADRS_PRR    0x64
+#define SIM_ADRS_PCICR  0x68
+#define SIM_ADRS_EICRA  0x69
+#define SIM_ADRS_PCMSK0 0x6b
+#define SIM_ADRS_PCMSK1 0x6c
+#define SIM_ADRS_PCMSK2 0x6d
+#define SIM_ADRS_TIMSK0 0x6e
+#define SIM_ADRS_TIMSK1 0x6f
+#define SIM_ADRS_TIMSK2 0x70
+#define SIM_ADRS_TCCR1A 0x80
+#define SIM_ADRS_TCCR1B 0x81
+#define SIM_ADRS_TCCR1C 0x82
+#define SIM_ADRS_TCNT1  0x84
+#define SIM_ADRS_TCNT1L 0x84
+#define SIM_ADRS_TCNT1H 0x85
+#define SIM_ADRS_ICR1   0x86
+#define SIM_ADRS_ICR1L  0x86
+#define SIM_ADRS_ICR1H  0x87
+#define SIM_ADRS_OCR1A  0x88
+#define SIM_ADRS_OCR1AL 0x88
+#define SIM_ADRS_OCR1AH 0x89
+#define SIM_ADRS_OCR1B  0x8a
+#define SIM_ADRS_OCR1BL 0x8a
+#define SIM_ADRS_OCR1BH 0x8b
+#define SIM_ADRS_TCCR2A 0xb0
+#define SIM_ADRS_TCCR2B 0xb1
+#define SIM_ADRS_TCNT2  0xb2
+#define SIM_ADRS_OCR2A  0xb3
+#define SIM_ADRS_OCR2B  0xb4
+#define SIM_ADRS_ASSR   0xb6
+#define SIM_ADRS_TWBR   0xb8
+#define SIM_ADRS_TWSR   0xb9
+#define SIM_ADRS_TWAR   0xba
+#define SIM_ADRS_TWDR   0xbb
+#define SIM_ADRS_TWCR   0xbc
+#define SIM_ADRS_TWAMR  0xbd
+#define SIM_ADRS_UCSR0A 0xc0
+#define SIM_ADRS_UCSR0B 0xc1
+#define SIM_ADRS_UCSR0C 0xc2
+#define SIM_ADRS_UBRR0  0xc4
+#define SIM_ADRS_UBRR0L 0xc4
+#define SIM_ADRS_UBRR0H 0xc5
+#define SIM_ADRS_UDR0   0xc6
+
+/* Registers. */
+#define PINB   SIM_IO8(SIM_ADRS_PINB)
+#define DDRB   SIM_IO8(SIM_ADRS_DDRB)
+#define PORTB  SIM_IO8(SIM_ADRS_PORTB)
+#define PINC   SIM_IO8(SIM_ADRS_PINC)
+#define DDRC   SIM_IO8(SIM_ADRS_DDRC)
+#define PORTC  SIM_IO8(SIM_ADRS_PORTC)
+#define PIND   SIM_IO8(SIM_ADRS_PIND)
+#define DDRD   SIM_IO8(SIM_ADRS_DDRD)
+#define PORTD  SIM_IO8(SIM_ADRS_PORTD)
+#define TIFR0  SIM_REG8(SIM_ADRS_TIFR0)
+#define TIFR1  SIM_REG8(SIM_ADRS_TIFR1)
+#define TIFR2  SIM_REG8(SIM_ADRS_TIFR2)
+#define PCIFR  SIM_REG8(SIM_ADRS_PCIFR)
+#define EIFR   SIM_REG8(SIM_ADRS_EIFR)
+#define EIMSK  SIM_IO8(SIM_ADRS_EIMSK)
+#define GPIOR0 SIM_IO8(SIM_ADRS_GPIOR0)
+#define GTCCR  SIM_IO8(SIM_ADRS_GTCCR)
+#define TCCR0A SIM_IO8(SIM_ADRS_TCCR0A)
+#define TCCR0B SIM_IO8(SIM_ADRS_TCCR0B)
+#define TCNT0  SIM_IO8(SIM_ADRS_TCNT0)
+#define OCR0A  SIM_IO8(SIM_ADRS_OCR0A)
+#define OCR0B  SIM_IO8(SIM_ADRS_OCR0B)
+#define GPIOR1 SIM_IO8(SIM_ADRS_GPIOR1)
+#define GPIOR2 SIM_IO8(SIM_ADRS_GPIOR2)
+#define SPCR   SIM_IO8(SIM_ADRS_SPCR)
+#define SPSR   SIM_IO8(SIM_ADRS_SPSR)
+#define SPDR   SIM_REG8(SIM_ADRS_SPDR)
+#define SMCR   SIM_IO8(SIM_ADRS_SMCR)
+#define MCUSR  SIM_IO8(SIM_ADRS_MCUSR)
+#define MCUCR  SIM_IO8(SIM_ADRS_MCUCR)
+#define SPL    SIM_IO8(SIM_ADRS_SPL)
+#define SPH    SIM_IO8(SIM_ADRS_SPH)
+#define SREG   SIM_IO8(SIM_ADRS_SREG)
+#define WDTCSR SIM_IO8(SIM_ADRS_WDTCSR)
+#define CLKPR  SIM_IO8(SIM_ADRS_CLKPR)
+#define PRR    SIM_IO8(SIM_ADRS_PRR)
+#define PCICR  SIM_IO8(SIM_ADRS_PCICR)
+#define EICRA  SIM_IO8(SIM_ADRS_EICRA)
+#define PCMSK0 SIM_IO8(SIM_ADRS_PCMSK0)
+#define PCMSK1 SIM_IO8(SIM_ADRS_PCMSK1)
+#define PCMSK2 SIM_IO8(SIM_ADRS_PCMSK2)
+#define TIMSK0 SIM_IO8(SIM_ADRS_TIMSK0)
+#define TIMSK1 SIM_IO8(SIM_ADRS_TIMSK1)
+#define TIMSK2 SIM_IO8(SIM_ADRS_TIMSK2)
+#define TCCR1A SIM_IO8(SIM_ADRS_TCCR1A)
+#define TCCR1B SIM_IO8(SIM_ADRS_TCCR1B)
+#define TCCR1C SIM_IO8(SIM_ADRS_TCCR1C)
+#define TCNT1  SIM_IO16(SIM_ADRS_TCNT1)
+#define TCNT1L SIM_IO8(SIM_ADRS_TCNT1L)
+#define TCNT1H SIM_IO8(SIM_ADRS_TCNT1H)
+#define ICR1   SIM_IO16(SIM_ADRS_ICR1)
+#define ICR1L  SIM_IO8(SIM_ADRS_ICR1L)
+#define ICR1H  SIM_IO8(SIM_ADRS_ICR1H)
+#define OCR1A  SIM_IO16(SIM_ADRS_OCR1A)
+#define OCR1AL SIM_IO8(SIM_ADRS_OCR1AL)
+#define OCR1AH SIM_IO8(SIM_ADRS_OCR1AH)
+#define OCR1B  SIM_IO16(SIM_ADRS_OCR1B)
+#define OCR1BL SIM_IO8(SIM_ADRS_OCR1BL)
+#define OCR1BH SIM_IO8(SIM_ADRS_OCR1BH)
+#define TCCR2A SIM_IO8(SIM_ADRS_TCCR2A)
+#define TCCR2B SIM_IO8(SIM_ADRS_TCCR2B)
+#define TCNT2  SIM_IO8(SIM_ADRS_TCNT2)
+#define OCR2A  SIM_IO8(SIM_ADRS_OCR2A)
+#define OCR2B  SIM_IO8(SIM_ADRS_OCR2B)
+#define ASSR   SIM_IO8(SIM_ADRS_ASSR)
+#define TWBR   SIM_IO8(SIM_ADRS_TWBR)
+#define TWSR   SIM_IO8(SIM_ADRS_TWSR)
+#define TWAR   SIM_IO8(SIM_ADRS_TWAR)
+#define TWDR   SIM_IO8(SIM_ADRS_TWDR)
+#define TWCR   SIM_REG8(SIM_ADRS_TWCR)
+#define TWAMR  SIM_IO8(SIM_ADRS_TWAMR)
+#define UCSR0A SIM_REG8(SIM_ADRS_UCSR0A)
+#define UCSR0B SIM_IO8(SIM_ADRS_UCSR0B)
+#define UCSR0C SIM_IO8(SIM_ADRS_UCSR0C)
+#define UBRR0  SIM_IO16(SIM_ADRS_UBRR0)
+#define UBRR0L SIM_IO8(SIM_ADRS_UBRR0L)
+#define UBRR0H SIM_IO8(SIM_ADRS_UBRR0H)
+#define UDR0   SIM_REG8(SIM_ADRS_UDR0)
+
+/* PINB */
+#define PINB0    0
+#define PINB1    1
+#define PINB2    2
+#define PINB3    3
+#define PINB4    4
+#define PINB5    5
+#define PINB6    6
+#define PINB7    7
+
+/* DDRB */
+#define DDB0     0
+#define DDB1     1
+#define DDB2     2
+#define DDB3     3
+#define DDB4     4
+#define DDB5     5
+#define DDB6     6
+#define DDB7     7
+
+/* PORTB */
+#define PORTB0   0
+#define PORTB1   1
+#define PORTB2   2
+#define PORTB3   3
+#define PORTB4   4
+#define PORTB5   5
+#define PORTB6   6
+#define PORTB7   7
+
+/* PINC */
+#define PINC0    0
+#define PINC1    1
+#define PINC2    2
+#define PINC3    3
+#define PINC4    4
+#define PINC5    5
+#define PINC6    6
+
+/* DDRC */
+#define DDC0     0
+#define DDC1     1
+#define DDC2     2
+#define DDC3     3
+#define DDC4     4
+#define DDC5     5
+#define DDC6     6
+
+/* PORTC */
+#define PORTC0   0
+#define PORTC1   1
+#define PORTC2   2
+#define PORTC3   3
+#define PORTC4   4
+#define PORTC5   5
+#define PORTC6   6
+
+/* PIND */
+#define PIND0    0
+#define PIND1    1
+#define PIND2    2
+#define PIND3    3
+#define PIND4    4
+#define PIND5    5
+#define PIND6    6
+#define PIND7    7
+
+/* DDRD */
+#define DDD0     0
+#define DDD1     1
+#define DDD2     2
+#define DDD3     3
+#define DDD4     4
+#define DDD5     5
+#define DDD6     6
+#define DDD7     7
+
+/* PORTD */
+#define PORTD0   0
+#define PORTD1   1
+#define PORTD2   2
+#define PORTD3   3
+#define PORTD4   4
+#define PORTD5   5
+#define PORTD6   6
+#define PORTD7   7
+
+/* port pins */
+#define PB0      0
+#define PB1      1
+#define PB2      2
+#define PB3      3
+#define PB4      4
+#define PB5      5
+#define PB6      6
+#define PB7      7
+
+/* port pins */
+#define PC0      0
+#define PC1      1
+#define PC2      2
+#define PC3      3
+#define PC4      4
+#define PC5      5
+#define PC6      6
+
+/* port pins */
+#define PD0      0
+#define PD1      1
+#define PD2      2
+#define PD3      3
+#define PD4      4
+#define PD5      5
+#define PD6      6
+#define PD7      7
+
+/* TIFR0 */
+#define TOV0     0
+#define OCF0A    1
+#define OCF0B    2
+
+/* TIFR1 */
+#define TOV1     0
+#define OCF1A    1
+#define OCF1B    2
+#define ICF1     5
+
+/* TIFR2 */
+#define TOV2     0
+#define OCF2A    1
+#define OCF2B    2
+
+/* PCIFR */
+#define PCIF0    0
+#define PCIF1    1
+#define PCIF2    2
+
+/* EIFR */
+#define INTF0    0
+#define INTF1    1
+
+/* EIMSK */
+#define INT0     0
+#define INT1     1
+
+/* GTCCR */
+#define PSRSYNC  0
+#define PSRASY   1
+#define TSM      7
+
+/* TCCR0A */
+#define WGM00    0
+#define WGM01    1
+#define COM0B0   4
+#define COM0B1   5
+#define COM0A0   6
+#define COM0A1   7
+
+/* TCCR0B */
+#define CS00     0
+#define CS01     1
+#define CS02     2
+#define WGM02    3
+#define FOC0B    6
+#define FOC0A    7
+
+/* SPCR */
+#define SPR0     0
+#define SPR1     1
+#define CPHA     2
+#define CPOL     3
+#define MSTR     4
+#define DORD     5
+#define SPE      6
+#define SPIE     7
+
+/* SPSR */
+#define SPI2X    0
+#define WCOL     6
+#define SPIF     7
+
+/* SMCR */
+#define SE       0
+#define SM0      1
+#define SM1      2
+#define SM2      3
+
+/* MCUSR */
+#define PORF     0
+#define EXTRF    1
+#define BORF     2
+#define WDRF     3
+
+/* MCUCR */
+#define IVCE     0
+#define IVSEL    1
+#define PUD      4
+#define BODSE    5
+#define BODS     6
+
+/* SREG */
+#define SREG_C   0
+#define SREG_Z   1
+#define SREG_N   2
+#define SREG_V   3
+#define SREG_S   4
+#define SREG_H   5
+#define SREG_T   6
+#define SREG_I   7
+
+/* WDTCSR */
+#define WDP0     0
+#define WDP1     1
+#define WDP2     2
+#define WDE      3
+#define WDCE     4
+#define WDP3     5
+#define WDIE     6
+#define WDIF     7
+
+/* CLKPR */
+#define CLKPS0   0
+#define CLKPS1   1
+#define CLKPS2   2
+#define CLKPS3   3
+#define CLKPCE   7
+
+/* PRR */
+#define PRADC    0
+#define PRUSART0 1
+#define PRSPI    2
+#define PRTIM1   3
+#define PRTIM0   5
+#define PRTIM2   6
+#define PRTWI    7
+
+/* PCICR */
+#define PCIE0    0
+#define PCIE1    1
+#define PCIE2    2
+
+/* EICRA */
+#define ISC00    0
+#define ISC01    1
+#define ISC10    2
+#define ISC11    3
+
+/* PCMSK0 */
+#define PCINT0   0
+#define PCINT1   1
+#define PCINT2   2
+#define PCINT3   3
+#define PCINT4   4
+#define PCINT5   5
+#define PCINT6   6
+#define PCINT7   7
+
+/* PCMSK1 */
+#define PCINT8   0
+#define PCINT9   1
+#define PCINT10  2
+#define PCINT11  3
+#define PCINT12  4
+#define PCINT13  5
+#define PCINT14  6
+
+/* PCMSK2 */
+#define PCINT16  0
+#define PCINT17  1
+#define PCINT18  2
+#define PCINT19  3
+#define PCINT20  4
+#define PCINT21  5
+#define PCINT22  6
+#define PCINT23  7
+
+/* TIMSK0 */
+#define TOIE0    0
+#define OCIE0A   1
+#define OCIE0B   2
+
+/* TIMSK1 */
+#define TOIE1    0
+#define OCIE1A   1
+#define OCIE1B   2
+#define ICIE1    5
+
+/* TIMSK2 */
+#define TOIE2    0
+#define OCIE2A   1
+#define OCIE2B   2
+
+/* TCCR1A */
+#define WGM10    0
+#define WGM11    1
+#define COM1B0   4
+#define COM1B1   5
+#define COM1A0   6
+#define COM1A1   7
+
+/* TCCR1B */
+#define CS10     0
+#define CS11     1
+#define CS12     2
+#define WGM12    3
+#define WGM13    4
+#define ICES1    6
+#define ICNC1    7
+
+/* TCCR1C */
+#define FOC1B    6
+#define FOC1A    7
+
+/* TCCR2A */
+#define WGM20    0
+#define WGM21    1
+#define COM2B0   4
+#define COM2B1   5
+#define COM2A0   6
+#define COM2A1   7
+
+/* TCCR2B */
+#define CS20     0
+#define CS21     1
+#define CS22     2
+#define WGM22    3
+#define FOC2B    6
+#define FOC2A    7
+
+/* ASSR */
+#define TCR2BUB  0
+#define TCR2AUB  1
+#define OCR2BUB  2
+#define OCR2AUB  3
+#define TCN2UB   4
+#define AS2      5
+#define EXCLK    6
+
+/* TWSR */
+#define TWPS0    0
+#define TWPS1    1
+#define TWS3     3
+#define TWS4     4
+#define TWS5     5
+#define TWS6     6
+#define TWS7     7
+
+/* TWAR */
+#define TWGCE    0
+#define TWA0     1
+#define TWA1     2
+#define TWA2     3
+#define TWA3     4
+#define TWA4     5
+#define TWA5     6
+#define TWA6     7
+
+/* TWCR */
+#define TWIE     0
+#define TWEN     2
+#define TWWC     3
+#define TWSTO    4
+#define TWSTA    5
+#define TWEA     6
+#define TWINT    7
+
+/* UCSR0A */
+#define MPCM0    0
+#define U2X0     1
+#define UPE0     2
+#define DOR0     3
+#define FE0      4
+#define UDRE0    5
+#define TXC0     6
+#define RXC0     7
+
+/* UCSR0B */
+#define TXB80    0
+#define RXB80    1
+#define UCSZ02   2
+#define TXEN0    3
+#define RXEN0    4
+#define UDRIE0   5
+#define TXCIE0   6
+#define RXCIE0   7
+
+/* UCSR0C */
+#define UCPOL0   0
+#define UCSZ00   1
+#define UCSZ01   2
+#define USBS0    3
+#define UPM00    4
+#define UPM01    5
+#define UMSEL00  6
+#define UMSEL01  7
+
+/* Interrupt vectors, sim_vector_n is vector n. */
+#define INT0_vect           sim_vector_1
+#define INT1_vect           sim_vector_2
+#define PCINT0_vect         sim_vector_3
+#define PCINT1_vect         sim_vector_4
+#define PCINT2_vect         sim_vector_5
+#define WDT_vect            sim_vector_6
+#define TIMER2_COMPA_vect   sim_vector_7
+#define TIMER2_COMPB_vect   sim_vector_8
+#define TIMER2_OVF_vect     sim_vector_9
+#define TIMER1_CAPT_vect    sim_vector_10
+#define TIMER1_COMPA_vect   sim_vector_11
+#define TIMER1_COMPB_vect   sim_vector_12
+#define TIMER1_OVF_vect     sim_vector_13
+#define TIMER0_COMPA_vect   sim_vector_14
+#define TIMER0_COMPB_vect   sim_vector_15
+#define TIMER0_OVF_vect     sim_vector_16
+#define SPI_STC_vect        sim_vector_17
+#define USART_RX_vect       sim_vector_18
+#define USART_UDRE_vect     sim_vector_19
+#define USART_TX_vect       sim_vector_20
+#define ADC_vect            sim_vector_21
+#define EE_READY_vect       sim_vector_22
+#define ANALOG_COMP_vect    sim_vector_23
+#define TWI_vect            sim_vector_24
+#define SPM_READY_vect      sim_vector_25
+#define _VECTORS_SIZE       26
+
+#endif /* _SIM_AVR_IO_H_ */
@@ -0,0 +1,45 @@
+/*
+ * File:    pgmspace.h
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * <avr/pgmspace.h> for the host simulation.  The host has one address space,
+ * so program memory is plain const data and the _P functions are the plain
+ * ones.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#ifndef _SIM_AVR_PGMSPACE_H_
+#define _SIM_AVR_PGMSPACE_H_ 1
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+
+typedef const char *PGM_P;
+typedef const void *PGM_VOID_P;
+
+#define pgm_read_byte_near(adrs)  (*(const uint8_t *)(adrs))
+#define pgm_read_word_near(adrs)  (*(const uint16_t *)(adrs))
+#define pgm_read_dword_near(adrs) (*(const uint32_t *)(adrs))
+#define pgm_read_ptr_near(adrs)   (*(void * const *)(adrs))
+
+#define pgm_read_byte(adrs)  pgm_read_byte_near(adrs)
+#define pgm_read_word(adrs)  pgm_read_word_near(adrs)
+#define pgm_read_dword(adrs) pgm_read_dword_near(adrs)
+#define pgm_read_ptr(adrs)   pgm_read_ptr_near(adrs)
+
+#define memcpy_P(dst, src, len) memcpy(dst, src, len)
+#define memcmp_P(a, b, len)     memcmp(a, b, len)
+#define strcpy_P(dst, src)      strcpy(dst, src)
+#define strcat_P(dst, src)      strcat(dst, src)
+#define strncpy_P(dst, src, n)  strncpy(dst, src, n)
+#define strcmp_P(a, b)          strcmp(a, b)
+#define strlen_P(s)             strlen(s)
+
+#endif /* _SIM_AVR_PGMSPACE_H_ */
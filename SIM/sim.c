@@ -0,0 +1,600 @@
+/*
+ * File:    sim.c
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Host simulation, the clock, register accesses and interrupts.
+ *
+ * Every register access first looks at the cells handed out by the accesses
+ * before it, then moves the clock on by SIM_ACCESS_CYCLES.  Moving the clock
+ * steps each model and then runs the highest priority interrupt that is
+ * enabled and pending, if global interrupts are on.
+ *
+ * A cell is given one more access to be written before it is taken as read,
+ * because in an expression like TWCR = TWCR | x the access for the left side
+ * can be made before the one for the right.  A write is passed to its model
+ * as soon as it is seen.  An interrupt handler has its own cells, and all of
+ * them are settled when it returns.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim_models.h"
+
+/* Cells each level can have out at once. */
+#define SIM_CELLS 4
+
+/* Deepest nesting of interrupts, the main line is level 0. */
+#define SIM_LEVELS 4
+
+/* A register access that has been handed out.
+ *
+ * value  : what the program reads and writes
+ * preload: what value was set to, bit 8 set
+ * adrs   : the register, 0 if the cell is free
+ * age    : accesses seen since it was handed out
+ * seq    : order it was handed out in
+ */
+typedef struct
+{
+  volatile uint16_t value;
+  uint16_t preload;
+  uint8_t adrs;
+  uint8_t age;
+  uint32_t seq;
+
+} SIM_CELL_TYPE;
+
+/* Where a vector's flag and enable bits are.  A flag address of 0 is a
+   vector that's never raised.  clear is 1 if running the vector clears the
+   flag. */
+typedef struct
+{
+  uint8_t flagAdrs;
+  uint8_t flagBit;
+  uint8_t enableAdrs;
+  uint8_t enableBit;
+  uint8_t clear;
+
+} SIM_VECTOR_TYPE;
+
+volatile uint8_t sim_regs[0x100] __attribute__((aligned(2)));
+uint64_t sim_now = 0;
+SIM_STATS_TYPE sim_stats;
+
+SIM_CELL_TYPE sim_cells[SIM_LEVELS][SIM_CELLS];
+uint8_t sim_level = 0;
+uint32_t sim_seq = 0;
+
+void sim_advance(uint32_t cycles, uint64_t *counter);
+
+/* Vectors in priority order, the index is the vector number. */
+const SIM_VECTOR_TYPE sim_vector_bits[_VECTORS_SIZE] =
+{
+  {0, 0, 0, 0, 0},                                         /* reset */
+  {SIM_ADRS_EIFR, INTF0, SIM_ADRS_EIMSK, INT0, 1},
+  {SIM_ADRS_EIFR, INTF1, SIM_ADRS_EIMSK, INT1, 1},
+  {SIM_ADRS_PCIFR, PCIF0, SIM_ADRS_PCICR, PCIE0, 1},
+  {SIM_ADRS_PCIFR, PCIF1, SIM_ADRS_PCICR, PCIE1, 1},
+  {SIM_ADRS_PCIFR, PCIF2, SIM_ADRS_PCICR, PCIE2, 1},
+  {0, 0, 0, 0, 0},                                         /* WDT */
+  {SIM_ADRS_TIFR2, OCF2A, SIM_ADRS_TIMSK2, OCIE2A, 1},
+  {SIM_ADRS_TIFR2, OCF2B, SIM_ADRS_TIMSK2, OCIE2B, 1},
+  {SIM_ADRS_TIFR2, TOV2, SIM_ADRS_TIMSK2, TOIE2, 1},
+  {SIM_ADRS_TIFR1, ICF1, SIM_ADRS_TIMSK1, ICIE1, 1},
+  {SIM_ADRS_TIFR1, OCF1A, SIM_ADRS_TIMSK1, OCIE1A, 1},
+  {SIM_ADRS_TIFR1, OCF1B, SIM_ADRS_TIMSK1, OCIE1B, 1},
+  {SIM_ADRS_TIFR1, TOV1, SIM_ADRS_TIMSK1, TOIE1, 1},
+  {SIM_ADRS_TIFR0, OCF0A, SIM_ADRS_TIMSK0, OCIE0A, 1},
+  {SIM_ADRS_TIFR0, OCF0B, SIM_ADRS_TIMSK0, OCIE0B, 1},
+  {SIM_ADRS_TIFR0, TOV0, SIM_ADRS_TIMSK0, TOIE0, 1},
+  {SIM_ADRS_SPSR, SPIF, SIM_ADRS_SPCR, SPIE, 1},
+  {SIM_ADRS_UCSR0A, RXC0, SIM_ADRS_UCSR0B, RXCIE0, 0},
+  {SIM_ADRS_UCSR0A, UDRE0, SIM_ADRS_UCSR0B, UDRIE0, 0},
+  {SIM_ADRS_UCSR0A, TXC0, SIM_ADRS_UCSR0B, TXCIE0, 1},
+  {0, 0, 0, 0, 0},                                         /* ADC */
+  {0, 0, 0, 0, 0},                                         /* EE_READY */
+  {0, 0, 0, 0, 0},                                         /* ANALOG_COMP */
+  {SIM_ADRS_TWCR, TWINT, SIM_ADRS_TWCR, TWIE, 0},
+  {0, 0, 0, 0, 0}                                          /* SPM_READY */
+};
+
+/*
+ * sim_bad_interrupt()
+ *
+ * Run for an interrupt the program has enabled without giving it a handler,
+ * on the part this would reset it.
+ */
+void sim_bad_interrupt(void)
+{
+
+  fprintf(stderr, "sim: interrupt enabled with no handler at cycle %llu\n",
+          (unsigned long long)sim_now);
+  abort();
+
+}/* end sim_bad_interrupt() */
+
+/* Handlers not defined by the program. */
+#define SIM_WEAK_VECTOR(n) \
+  void sim_vector_##n(void) __attribute__((weak, alias("sim_bad_interrupt")))
+
+SIM_WEAK_VECTOR(1);  SIM_WEAK_VECTOR(2);  SIM_WEAK_VECTOR(3);
+SIM_WEAK_VECTOR(4);  SIM_WEAK_VECTOR(5);  SIM_WEAK_VECTOR(6);
+SIM_WEAK_VECTOR(7);  SIM_WEAK_VECTOR(8);  SIM_WEAK_VECTOR(9);
+SIM_WEAK_VECTOR(10); SIM_WEAK_VECTOR(11); SIM_WEAK_VECTOR(12);
+SIM_WEAK_VECTOR(13); SIM_WEAK_VECTOR(14); SIM_WEAK_VECTOR(15);
+SIM_WEAK_VECTOR(16); SIM_WEAK_VECTOR(17); SIM_WEAK_VECTOR(18);
+SIM_WEAK_VECTOR(19); SIM_WEAK_VECTOR(20); SIM_WEAK_VECTOR(21);
+SIM_WEAK_VECTOR(22); SIM_WEAK_VECTOR(23); SIM_WEAK_VECTOR(24);
+SIM_WEAK_VECTOR(25);
+
+void (* const sim_vectors[_VECTORS_SIZE])(void) =
+{
+  0,             sim_vector_1,  sim_vector_2,  sim_vector_3,  sim_vector_4,
+  sim_vector_5,  sim_vector_6,  sim_vector_7,  sim_vector_8,  sim_vector_9,
+  sim_vector_10, sim_vector_11, sim_vector_12, sim_vector_13, sim_vector_14,
+  sim_vector_15, sim_vector_16, sim_vector_17, sim_vector_18, sim_vector_19,
+  sim_vector_20, sim_vector_21, sim_vector_22, sim_vector_23, sim_vector_24,
+  sim_vector_25
+};
+
+/*
+ * sim_reg_value()
+ *
+ * Return what a read of a register gives, without the side effects.
+ */
+uint8_t sim_reg_value(uint8_t adrs)
+{
+
+  if(adrs == SIM_ADRS_UDR0)
+  {
+    return(sim_uart_data());
+  }
+
+  return(sim_regs[adrs]);
+
+}/* end sim_reg_value() */
+
+/*
+ * sim_reg_write()
+ *
+ * Pass a write to a register's model.
+ */
+void sim_reg_write(uint8_t adrs, uint8_t value)
+{
+
+  switch(adrs)
+  {
+    case SIM_ADRS_TWCR:
+      sim_twi_write_control(value);
+      break;
+    case SIM_ADRS_SPDR:
+      sim_spi_write(value);
+      break;
+    case SIM_ADRS_UDR0:
+      sim_uart_write(value);
+      break;
+    case SIM_ADRS_UCSR0A:
+      sim_uart_write_status(value);
+      break;
+    default:
+    /* the interrupt flag registers, writing a 1 clears a flag */
+      sim_regs[adrs] &= ~value;
+      break;
+  }
+
+}/* end sim_reg_write() */
+
+/*
+ * sim_reg_read()
+ *
+ * Pass a read of a register to its model.
+ */
+void sim_reg_read(uint8_t adrs)
+{
+
+  if(adrs == SIM_ADRS_UDR0)
+  {
+    sim_uart_read();
+  }
+  else if(adrs == SIM_ADRS_SPDR)
+  {
+    sim_spi_read();
+  }
+
+}/* end sim_reg_read() */
+
+/*
+ * sim_commit()
+ *
+ * Look at the cells out at this level, oldest first.  Written cells are
+ * passed on, unchanged cells are taken as read once they have seen an access
+ * (or at once if force is 1).
+ */
+void sim_commit(uint8_t force)
+{
+  uint8_t i, oldest, adrs;
+  uint8_t done[SIM_CELLS] = {0};
+  SIM_CELL_TYPE *cells = sim_cells[sim_level], *cell;
+
+  for(;;)
+  {
+  /* find the oldest cell not looked at yet */
+    oldest = SIM_CELLS;
+    for(i = 0; i < SIM_CELLS; i++)
+    {
+      if((cells[i].adrs != 0) && (done[i] == 0) &&
+         ((oldest == SIM_CELLS) || (cells[i].seq < cells[oldest].seq)))
+      {
+        oldest = i;
+      }
+    }
+    if(oldest == SIM_CELLS)
+    {
+      break;
+    }
+    done[oldest] = 1;
+    cell = &cells[oldest];
+    adrs = cell->adrs;
+
+    if(cell->value != cell->preload)
+    {
+      cell->adrs = 0;
+      sim_reg_write(adrs, (uint8_t)cell->value);
+    }
+    else if((force != 0) || (cell->age != 0))
+    {
+      cell->adrs = 0;
+      sim_reg_read(adrs);
+    }
+    else
+    {
+      cell->age++;
+    }
+  }
+
+}/* end sim_commit() */
+
+/*
+ * sim_pending()
+ *
+ * Return the highest priority interrupt that is enabled and pending, 0 if
+ * none are.
+ */
+uint8_t sim_pending(void)
+{
+  uint8_t v;
+  const SIM_VECTOR_TYPE *bits;
+
+  for(v = 1; v < _VECTORS_SIZE; v++)
+  {
+    bits = &sim_vector_bits[v];
+    if((bits->flagAdrs != 0) &&
+       (sim_regs[bits->flagAdrs] & _BV(bits->flagBit)) &&
+       (sim_regs[bits->enableAdrs] & _BV(bits->enableBit)))
+    {
+      return(v);
+    }
+  }
+
+  return(0);
+
+}/* end sim_pending() */
+
+/*
+ * sim_interrupt()
+ *
+ * Run the highest priority pending interrupt if global interrupts are on.
+ * The handler runs at the next level with interrupts off, as on the part,
+ * and its cells are all settled when it returns.
+ */
+void sim_interrupt(void)
+{
+  uint8_t v;
+  const SIM_VECTOR_TYPE *bits;
+
+  if(((sim_regs[SIM_ADRS_SREG] & _BV(SREG_I)) == 0) ||
+     (sim_level >= SIM_LEVELS - 1))
+  {
+    return;
+  }
+
+  v = sim_pending();
+  if(v == 0)
+  {
+    return;
+  }
+
+  bits = &sim_vector_bits[v];
+  if(bits->clear)
+  {
+    sim_regs[bits->flagAdrs] &= ~_BV(bits->flagBit);
+  }
+
+  sim_regs[SIM_ADRS_SREG] &= ~_BV(SREG_I);
+  sim_level++;
+  sim_advance(SIM_ISR_CYCLES, &sim_stats.isr);
+
+  sim_vectors[v]();
+
+  sim_commit(1);
+  sim_level--;
+  sim_regs[SIM_ADRS_SREG] |= _BV(SREG_I); /* reti */
+
+}/* end sim_interrupt() */
+
+/*
+ * sim_advance()
+ *
+ * Move the clock on, a slice at a time, stepping the models and running
+ * interrupts after each slice.  counter is the statistic charged.
+ */
+void sim_advance(uint32_t cycles, uint64_t *counter)
+{
+  uint32_t slice;
+
+  while(cycles != 0)
+  {
+    slice = (cycles > SIM_SLICE_CYCLES) ? SIM_SLICE_CYCLES : cycles;
+    cycles -= slice;
+    sim_now += slice;
+    *(sim_level ? &sim_stats.isr : counter) += slice;
+
+    sim_timer_step(slice);
+    sim_spi_step();
+    sim_uart_step();
+    sim_twi_step();
+    sim_sensors_step();
+    sim_gpio_step();
+
+    sim_interrupt();
+  }
+
+}/* end sim_advance() */
+
+/*
+ * sim_access()
+ *
+ * What every register access does first.
+ */
+void sim_access(void)
+{
+
+  sim_commit(0);
+  sim_advance(SIM_ACCESS_CYCLES, &sim_stats.main);
+
+}/* end sim_access() */
+
+/*
+ * sim_io()
+ * sim_io16()
+ *
+ * Access a register that is plain memory.
+ */
+volatile uint8_t *sim_io(uint8_t adrs)
+{
+
+  sim_access();
+  return(&sim_regs[adrs]);
+
+}/* end sim_io() */
+
+volatile uint16_t *sim_io16(uint8_t adrs)
+{
+
+  sim_access();
+  return((volatile uint16_t *)&sim_regs[adrs]);
+
+}/* end sim_io16() */
+
+/*
+ * sim_reg()
+ *
+ * Access a register through a cell.
+ */
+volatile uint16_t *sim_reg(uint8_t adrs)
+{
+  uint8_t i, oldest;
+  SIM_CELL_TYPE *cells, *cell;
+
+  sim_access();
+
+/* a free cell, or make one by settling all of them */
+  cells = sim_cells[sim_level];
+  for(i = 0; (i < SIM_CELLS) && (cells[i].adrs != 0); i++)
+  {
+  }
+  if(i == SIM_CELLS)
+  {
+    sim_commit(1);
+    i = 0;
+  }
+  oldest = i;
+
+  cell = &cells[oldest];
+  cell->adrs = adrs;
+  cell->age = 0;
+  cell->seq = sim_seq++;
+  cell->preload = 0x100 | sim_reg_value(adrs);
+  cell->value = cell->preload;
+
+  return(&cell->value);
+
+}/* end sim_reg() */
+
+/*
+ * sim_sei()
+ * sim_cli()
+ *
+ * Turn global interrupts on or off.
+ */
+void sim_sei(void)
+{
+
+  sim_access();
+  sim_regs[SIM_ADRS_SREG] |= _BV(SREG_I);
+  sim_interrupt();
+
+}/* end sim_sei() */
+
+void sim_cli(void)
+{
+
+  sim_access();
+  sim_regs[SIM_ADRS_SREG] &= ~_BV(SREG_I);
+
+}/* end sim_cli() */
+
+/*
+ * sim_init()
+ *
+ * Put every register and model back to its reset state.
+ */
+void sim_init(void)
+{
+
+  memset((void *)sim_regs, 0, sizeof(sim_regs));
+  memset(sim_cells, 0, sizeof(sim_cells));
+  memset(&sim_stats, 0, sizeof(sim_stats));
+  sim_level = 0;
+  sim_now = 0;
+
+  sim_gpio_reset();
+  sim_timer_reset();
+  sim_spi_reset();
+  sim_uart_reset();
+  sim_twi_reset();
+  sim_sensors_reset();
+  sim_ssd1306_reset();
+
+}/* end sim_init() */
+
+/*
+ * sim_cycles()
+ * sim_micros()
+ *
+ * Return the simulated time.
+ */
+uint64_t sim_cycles(void)
+{
+
+  return(sim_now);
+
+}/* end sim_cycles() */
+
+uint64_t sim_micros(void)
+{
+
+  return(sim_now / (F_CPU / 1000000UL));
+
+}/* end sim_micros() */
+
+/*
+ * sim_run()
+ *
+ * Let cycles pass with the CPU idle.
+ */
+void sim_run(uint32_t cycles)
+{
+
+  sim_commit(1);
+  sim_advance(cycles, &sim_stats.idle);
+
+}/* end sim_run() */
+
+/*
+ * sim_cpu()
+ *
+ * Let cycles pass with the CPU busy.
+ */
+void sim_cpu(uint32_t cycles)
+{
+
+  sim_commit(1);
+  sim_advance(cycles, &sim_stats.main);
+
+}/* end sim_cpu() */
+
+/*
+ * sim_get_stats()
+ * sim_clear_stats()
+ *
+ * Copy or zero where the simulated time went.
+ */
+void sim_get_stats(SIM_STATS_TYPE *stats)
+{
+
+  *stats = sim_stats;
+
+}/* end sim_get_stats() */
+
+void sim_clear_stats(void)
+{
+
+  memset(&sim_stats, 0, sizeof(sim_stats));
+
+}/* end sim_clear_stats() */
+
+/*
+ * ultoa()
+ * ltoa()
+ * utoa()
+ * itoa()
+ *
+ * avr-libc's number to string conversions.
+ */
+char *ultoa(unsigned long val, char *s, int radix)
+{
+  char buf[8 * sizeof(long) + 1];
+  uint8_t i = 0, j = 0, digit;
+
+  do
+  {
+    digit = val % radix;
+    buf[i++] = (digit < 10) ? '0' + digit : 'a' + digit - 10;
+    val /= radix;
+  }
+  while(val != 0);
+
+  while(i != 0)
+  {
+    s[j++] = buf[--i];
+  }
+  s[j] = 0;
+
+  return(s);
+
+}/* end ultoa() */
+
+char *ltoa(long val, char *s, int radix)
+{
+
+  if((val < 0) && (radix == 10))
+  {
+    s[0] = '-';
+    ultoa(-(unsigned long)val, s + 1, radix);
+    return(s);
+  }
+
+  return(ultoa((unsigned long)val, s, radix));
+
+}/* end ltoa() */
+
+char *utoa(unsigned int val, char *s, int radix)
+{
+
+  return(ultoa(val, s, radix));
+
+}/* end utoa() */
+
+char *itoa(int val, char *s, int radix)
+{
+
+  return(ltoa(val, s, radix));
+
+}/* end itoa() */
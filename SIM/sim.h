@@ -0,0 +1,267 @@
+/*
+ * File:    sim.h
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Host simulation of an ATmega328 and the parts on its buses.
+ *
+ * The drivers are compiled for the host against the avr/ and util/ headers in
+ * this directory instead of avr-libc's.  Every peripheral register in
+ * avr/io.h is an access through the simulator.  Each access costs
+ * SIM_ACCESS_CYCLES of simulated time, and on each access the peripherals are
+ * brought up to date and any interrupt that is due is run.  So a driver
+ * waiting on a status bit sees it change after the right number of cycles,
+ * and an interrupt driven driver has its ISRs called between register
+ * accesses, much as the CPU would.
+ *
+ * Modelled peripherals:
+ *
+ *   I/O ports B, C and D, INT0/INT1 and the pin change interrupts
+ *   Timer/Counters 0, 1 and 2 (clocked from the prescaler, normal, CTC and
+ *     fast PWM counting, overflow and compare interrupts)
+ *   SPI master, 8 * divisor cycles a byte
+ *   USART0, sending and receiving at the programmed baud rate
+ *   TWI master, 9 SCL periods a byte plus START and STOP, so 22.5us a byte
+ *     at 400kHz
+ *
+ * and on the buses:
+ *
+ *   ADXL345 at 0x53, HMC5883 at 0x1e (with its DRDY pin), ITG3205 at 0x68
+ *   SSD1306 displays at 0x3c and 0x3d, and one on the SPI bus
+ *
+ * Code that only runs on the CPU takes no simulated time, a wait that
+ * doesn't touch a register (spinning on a flag set by an ISR) must call
+ * sim_run() or it never ends.  While a driver is busy it is the register
+ * accesses that move time along, so bus times come out right even though
+ * the CPU time in between is estimated.
+ *
+ * A read-modify-write of a flag register that leaves it as it was, such as
+ * UCSR0A |= _BV(TXC0) with TXC0 already set, is taken as a read, so it
+ * doesn't clear the flag.  Clear flags with a plain assignment, which is the
+ * right way on the part too.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#ifndef _SIM_H_
+#define _SIM_H_ 1
+
+#include <stdint.h>
+
+/* Simulated cycles taken by one register access. */
+#ifndef SIM_ACCESS_CYCLES
+#define SIM_ACCESS_CYCLES 2
+#endif
+
+/* Simulated cycles taken to enter and leave an interrupt, on top of the
+   accesses made by the handler. */
+#ifndef SIM_ISR_CYCLES
+#define SIM_ISR_CYCLES 20
+#endif
+
+/* Ports, for sim_gpio_drive() and sim_hmc5883_drdy_pin(). */
+enum
+{
+  SIM_PORTB,
+  SIM_PORTC,
+  SIM_PORTD
+};
+
+/* SSD1306 instances, for sim_ssd1306_ram(). */
+enum
+{
+  SIM_SSD1306_I2C_3C,
+  SIM_SSD1306_I2C_3D,
+  SIM_SSD1306_SPI,
+  SIM_SSD1306_COUNT
+};
+
+/* Bytes of display RAM in each SSD1306, 128 columns by 8 pages. */
+#define SIM_SSD1306_RAM_SIZE 1024
+
+/* Where the simulated time went, in cycles.
+ *
+ * main : taken by register accesses and delays from the main line
+ * isr  : taken by interrupt handlers, including their entry and exit
+ * idle : passed in sim_run() with nothing to do, CPU time that was free
+ */
+typedef struct
+{
+  uint64_t main;
+  uint64_t isr;
+  uint64_t idle;
+
+} SIM_STATS_TYPE;
+
+/* Counts kept by the SSD1306 models.
+ *
+ * commands: command bytes received, arguments included
+ * data    : display RAM bytes received
+ */
+typedef struct
+{
+  uint32_t commands;
+  uint32_t data;
+
+} SIM_SSD1306_STATS_TYPE;
+
+/*
+ * sim_init()
+ *
+ * Put every register and model back to its reset state, zero the clock and
+ * the statistics.  Call before any driver init function.
+ */
+void sim_init(void);
+
+/*
+ * sim_cycles()
+ *
+ * Return the simulated time in CPU cycles.
+ */
+uint64_t sim_cycles(void);
+
+/*
+ * sim_micros()
+ *
+ * Return the simulated time in us.
+ */
+uint64_t sim_micros(void);
+
+/*
+ * sim_run()
+ *
+ * Let cycles pass with the CPU idle, running any interrupts that come due.
+ * Use this in any wait that doesn't read a register.
+ */
+void sim_run(uint32_t cycles);
+
+/*
+ * sim_cpu()
+ *
+ * Let cycles pass with the CPU busy, to charge for work done between register
+ * accesses.
+ */
+void sim_cpu(uint32_t cycles);
+
+/*
+ * sim_get_stats()
+ * sim_clear_stats()
+ *
+ * Copy or zero where the simulated time went.
+ */
+void sim_get_stats(SIM_STATS_TYPE *stats);
+void sim_clear_stats(void);
+
+/*
+ * sim_gpio_drive()
+ *
+ * Drive the pins in mask of a port from outside with the levels in value, as
+ * a switch or sensor pin would.  Pins that are outputs still read as the
+ * PORT register.  Pins not driven read as their pull-up setting.
+ */
+void sim_gpio_drive(uint8_t port, uint8_t mask, uint8_t value);
+
+/*
+ * sim_twi_present()
+ *
+ * Connect (present = 1) or disconnect a slave, a disconnected slave doesn't
+ * acknowledge its address.  All the slaves are connected by sim_init().
+ */
+void sim_twi_present(uint8_t adrs, uint8_t present);
+
+/*
+ * sim_twi_hold_sda()
+ *
+ * Make a slave hold SDA low until SCL has been clocked by hand (as
+ * i2c_recover() does) clocks times, 0 to let go at once.  While it is held
+ * the TWI can't make a START.
+ */
+void sim_twi_hold_sda(uint8_t clocks);
+
+/*
+ * sim_twi_bytes()
+ *
+ * Return the number of bytes (addresses included) moved on the I2C bus since
+ * sim_init().
+ */
+uint32_t sim_twi_bytes(void);
+
+/*
+ * sim_spi_set_device()
+ *
+ * Set a function called for every byte the SPI master sends, it returns the
+ * byte received.  0 for none, the master then receives 0xff.
+ */
+void sim_spi_set_device(uint8_t (*transfer)(uint8_t tx));
+
+/*
+ * sim_uart_set_sink()
+ *
+ * Set a function called with every byte as the USART finishes sending it, 0
+ * for none.
+ */
+void sim_uart_set_sink(void (*sink)(uint8_t c));
+
+/*
+ * sim_uart_receive()
+ *
+ * Queue len bytes to arrive on RXD, one after the other at the programmed
+ * baud rate.  Returns the number queued, there is room for 256.
+ */
+uint16_t sim_uart_receive(const uint8_t *buf, uint16_t len);
+
+/*
+ * sim_uart_sent()
+ *
+ * Return the number of bytes the USART has finished sending since
+ * sim_init().
+ */
+uint32_t sim_uart_sent(void);
+
+/*
+ * sim_adxl345_set()
+ * sim_hmc5883_set()
+ * sim_itg3205_set()
+ *
+ * Set the readings the sensors give, in their own raw units.  The HMC5883
+ * only shows a new reading at its next measurement.
+ */
+void sim_adxl345_set(int16_t x, int16_t y, int16_t z);
+void sim_hmc5883_set(int16_t x, int16_t y, int16_t z);
+void sim_itg3205_set(int16_t temp, int16_t x, int16_t y, int16_t z);
+
+/*
+ * sim_hmc5883_drdy_pin()
+ *
+ * Wire the HMC5883 DRDY output to a port pin, PD2 (INT0) after sim_init().
+ * DRDY is high, and pulses low for 250us when a measurement is ready.
+ */
+void sim_hmc5883_drdy_pin(uint8_t port, uint8_t bit);
+
+/*
+ * sim_ssd1306_spi_pins()
+ *
+ * Wire the SPI SSD1306 D/C and CS inputs to port pins, PB1 and PB2 after
+ * sim_init().
+ */
+void sim_ssd1306_spi_pins(uint8_t dcPort, uint8_t dcBit,
+                          uint8_t csPort, uint8_t csBit);
+
+/*
+ * sim_ssd1306_ram()
+ *
+ * Return the display RAM of an SSD1306, SIM_SSD1306_RAM_SIZE bytes, page 0
+ * first and column 0 first in each page.
+ */
+const uint8_t *sim_ssd1306_ram(uint8_t n);
+
+/*
+ * sim_ssd1306_get_stats()
+ *
+ * Copy the counts of an SSD1306 to stats, then clear them.
+ */
+void sim_ssd1306_get_stats(uint8_t n, SIM_SSD1306_STATS_TYPE *stats);
+
+#endif /* _SIM_H_ */
@@ -0,0 +1,135 @@
+/*
+ * File:    sim_gpio.c
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Host simulation of I/O ports B, C and D, INT0/INT1 and the pin change
+ * interrupts.
+ *
+ * A pin that is an output reads as its PORT bit.  An input reads as the
+ * level driven onto it from outside (sim_gpio_drive()), or as its pull-up
+ * setting if nothing drives it.  The PIN registers are worked out after
+ * every slice, and the changes raise the external and pin change interrupt
+ * flags.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#include "sim_models.h"
+
+/* Pins driven from outside, and their levels. */
+uint8_t sim_gpio_mask[3], sim_gpio_value[3];
+
+/* PIN, DDR and PORT of each port are at 3 * port from PINB. */
+#define SIM_GPIO_PIN(port)  (SIM_ADRS_PINB + 3 * (port))
+#define SIM_GPIO_DDR(port)  (SIM_ADRS_DDRB + 3 * (port))
+#define SIM_GPIO_PORT(port) (SIM_ADRS_PORTB + 3 * (port))
+
+/* PCMSKn of each port. */
+const uint8_t sim_gpio_pcmsk[3] =
+{
+  SIM_ADRS_PCMSK0, SIM_ADRS_PCMSK1, SIM_ADRS_PCMSK2
+};
+
+/*
+ * sim_gpio_reset()
+ *
+ * Nothing driven from outside.
+ */
+void sim_gpio_reset(void)
+{
+  uint8_t port;
+
+  for(port = 0; port < 3; port++)
+  {
+    sim_gpio_mask[port] = 0;
+    sim_gpio_value[port] = 0;
+  }
+
+}/* end sim_gpio_reset() */
+
+/*
+ * sim_gpio_drive()
+ *
+ * Drive pins of a port from outside.
+ */
+void sim_gpio_drive(uint8_t port, uint8_t mask, uint8_t value)
+{
+
+  if(port > SIM_PORTD)
+  {
+    return;
+  }
+
+  sim_gpio_mask[port] |= mask;
+  sim_gpio_value[port] = (sim_gpio_value[port] & ~mask) | (value & mask);
+
+}/* end sim_gpio_drive() */
+
+/*
+ * sim_gpio_port_bit()
+ *
+ * Return 1 if a PORT register bit is set, for the models that read pins
+ * driven by the CPU.
+ */
+uint8_t sim_gpio_port_bit(uint8_t port, uint8_t bit)
+{
+
+  return((sim_regs[SIM_GPIO_PORT(port)] >> bit) & 1);
+
+}/* end sim_gpio_port_bit() */
+
+/*
+ * sim_gpio_sense()
+ *
+ * Raise an INTn flag if its pin has done what EICRA asks for, sense is the
+ * two ISCn bits.
+ */
+void sim_gpio_sense(uint8_t sense, uint8_t was, uint8_t is, uint8_t flag)
+{
+
+  if(((sense == 0) && (is == 0)) ||
+     ((sense == 1) && (is != was)) ||
+     ((sense == 2) && (was != 0) && (is == 0)) ||
+     ((sense == 3) && (was == 0) && (is != 0)))
+  {
+    sim_regs[SIM_ADRS_EIFR] |= _BV(flag);
+  }
+
+}/* end sim_gpio_sense() */
+
+/*
+ * sim_gpio_step()
+ *
+ * Work out the PIN registers and raise the interrupt flags.
+ */
+void sim_gpio_step(void)
+{
+  uint8_t port, ddr, out, pin, was, eicra;
+
+  for(port = 0; port < 3; port++)
+  {
+    ddr = sim_regs[SIM_GPIO_DDR(port)];
+    out = sim_regs[SIM_GPIO_PORT(port)];
+    pin = (ddr & out) |
+          (~ddr & sim_gpio_mask[port] & sim_gpio_value[port]) |
+          (~ddr & ~sim_gpio_mask[port] & out);
+    was = sim_regs[SIM_GPIO_PIN(port)];
+    sim_regs[SIM_GPIO_PIN(port)] = pin;
+
+    if((was ^ pin) & sim_regs[sim_gpio_pcmsk[port]])
+    {
+      sim_regs[SIM_ADRS_PCIFR] |= _BV(port);
+    }
+
+    if(port == SIM_PORTD)
+    {
+      eicra = sim_regs[SIM_ADRS_EICRA];
+      sim_gpio_sense(eicra & 3, was & _BV(PD2), pin & _BV(PD2), INTF0);
+      sim_gpio_sense((eicra >> 2) & 3, was & _BV(PD3), pin & _BV(PD3), INTF1);
+    }
+  }
+
+}/* end sim_gpio_step() */
@@ -0,0 +1,103 @@
+/*
+ * File:    sim_models.h
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * What the parts of the simulator share between themselves, not for use by
+ * the programs being simulated.
+ *
+ * The registers live in sim_regs[] at their data space addresses.  The
+ * models work on sim_regs[] directly, never through the register macros in
+ * avr/io.h, which would move the clock.  Each model has a reset function
+ * called from sim_init() and a step function called after every slice of
+ * simulated time.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#ifndef _SIM_MODELS_H_
+#define _SIM_MODELS_H_ 1
+
+#include <stdint.h>
+#include <avr/io.h>
+#include "sim.h"
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+/* Largest slice of time between model steps, so events aren't seen more
+   than this many cycles late. */
+#define SIM_SLICE_CYCLES 8
+
+/* Most slaves on the I2C bus. */
+#define SIM_TWI_MAX_SLAVES 8
+
+/* The registers. */
+extern volatile uint8_t sim_regs[0x100];
+
+/* The clock, in cycles. */
+extern uint64_t sim_now;
+
+/* An I2C slave.
+ *
+ * adrs   : 7-bit address
+ * present: 0 if it doesn't answer
+ * start  : called when it acknowledges its address, read = 1 for a read
+ * write  : called with each byte written to it, returns 1 to acknowledge
+ * read   : called for each byte read from it
+ * stop   : called on a STOP, or a repeated START to another slave
+ * dev    : passed to the functions above
+ */
+typedef struct
+{
+  uint8_t adrs;
+  uint8_t present;
+  void (*start)(void *dev, uint8_t read);
+  uint8_t (*write)(void *dev, uint8_t data);
+  uint8_t (*read)(void *dev);
+  void (*stop)(void *dev);
+  void *dev;
+
+} SIM_TWI_SLAVE_TYPE;
+
+/* sim_gpio.c: pins, INT0/INT1 and pin change interrupts */
+void sim_gpio_reset(void);
+void sim_gpio_step(void);
+uint8_t sim_gpio_port_bit(uint8_t port, uint8_t bit);
+
+/* sim_timer.c: Timer/Counters 0, 1 and 2 */
+void sim_timer_reset(void);
+void sim_timer_step(uint32_t cycles);
+
+/* sim_spi.c */
+void sim_spi_reset(void);
+void sim_spi_step(void);
+void sim_spi_write(uint8_t data);
+void sim_spi_read(void);
+
+/* sim_uart.c */
+void sim_uart_reset(void);
+void sim_uart_step(void);
+void sim_uart_write(uint8_t data);
+void sim_uart_read(void);
+uint8_t sim_uart_data(void);
+void sim_uart_write_status(uint8_t value);
+
+/* sim_twi.c */
+void sim_twi_reset(void);
+void sim_twi_step(void);
+void sim_twi_write_control(uint8_t value);
+void sim_twi_attach(SIM_TWI_SLAVE_TYPE *slave);
+
+/* sim_sensors.c: ADXL345, HMC5883 and ITG3205 */
+void sim_sensors_reset(void);
+void sim_sensors_step(void);
+
+/* sim_ssd1306.c */
+void sim_ssd1306_reset(void);
+void sim_ssd1306_spi_byte(uint8_t data);
+
+#endif /* _SIM_MODELS_H_ */
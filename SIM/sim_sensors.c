@@ -0,0 +1,416 @@
+/*
+ * File:    sim_sensors.c
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Host simulation of the ADXL345, HMC5883 and ITG3205 on the I2C bus.
+ *
+ * Each is a bank of registers.  The first byte written after the address is
+ * the register pointer, the rest are written from there, and reads carry on
+ * from the pointer, moving it on after each byte as the part does.
+ *
+ *   ADXL345  0x53  DEVID 0xe5, X/Y/Z low byte first from 0x32, DATA_READY
+ *                  in INT_SOURCE set by a new reading and cleared by reading
+ *                  the data
+ *   HMC5883  0x1e  ID "H43", X/Z/Y high byte first from 0x03, the pointer
+ *                  goes from 0x08 back to 0x03 and from 0x0c to 0x00.
+ *                  Measures at the CRA rate in continuous mode, or once
+ *                  (after 6ms) in single mode, setting RDY and pulsing DRDY
+ *   ITG3205  0x68  WHO_AM_I 0x68, TEMP then X/Y/Z high byte first from 0x1b,
+ *                  RAW_DATA_RDY in INT_STATUS set by a new reading and
+ *                  cleared by reading INT_STATUS
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#include <string.h>
+#include "sim_models.h"
+
+/* Largest register bank. */
+#define SIM_SENSOR_REGS 0x40
+
+/* A register bank device.
+ *
+ * slave: its place on the bus
+ * reg  : the registers
+ * size : how many there are
+ * ptr  : register pointer
+ * first: 1 if the next byte written is the pointer
+ * next : returns the pointer after a read of register r, 0 to just add 1
+ * read : called after a read of register r, 0 for none
+ */
+typedef struct
+{
+  SIM_TWI_SLAVE_TYPE slave;
+  uint8_t reg[SIM_SENSOR_REGS];
+  uint8_t size;
+  uint8_t ptr;
+  uint8_t first;
+  uint8_t (*next)(uint8_t r);
+  void (*read)(uint8_t r);
+
+} SIM_SENSOR_TYPE;
+
+SIM_SENSOR_TYPE sim_adxl345, sim_hmc5883, sim_itg3205;
+
+/* HMC5883 reading waiting for the next measurement, when that is, its DRDY
+   pin and when DRDY goes back high. */
+int16_t sim_hmc5883_value[3];
+uint64_t sim_hmc5883_due = 0,
+         sim_hmc5883_drdy_end = 0;
+uint8_t sim_hmc5883_port = SIM_PORTD,
+        sim_hmc5883_bit = PD2;
+
+/* HMC5883 measurement periods for the CRA rates, in us. */
+const uint32_t sim_hmc5883_period[8] =
+{
+  1333333, 666667, 333333, 133333, 66667, 33333, 13333, 13333
+};
+
+/* ms for a single HMC5883 measurement */
+#define SIM_HMC5883_SINGLE_MS 6
+
+/* us DRDY is low for */
+#define SIM_HMC5883_DRDY_US 250
+
+#define SIM_US(us) ((uint64_t)(us) * (F_CPU / 1000000UL))
+
+/*
+ * sim_sensor_start()
+ * sim_sensor_write()
+ * sim_sensor_read()
+ * sim_sensor_stop()
+ *
+ * The I2C slave functions of a register bank.
+ */
+void sim_sensor_start(void *dev, uint8_t read)
+{
+  SIM_SENSOR_TYPE *s = dev;
+
+  s->first = (read == 0);
+
+}/* end sim_sensor_start() */
+
+uint8_t sim_sensor_write(void *dev, uint8_t data)
+{
+  SIM_SENSOR_TYPE *s = dev;
+
+  if(s->first)
+  {
+    s->first = 0;
+    s->ptr = data;
+  }
+  else
+  {
+    if(s->ptr < s->size)
+    {
+      s->reg[s->ptr] = data;
+    }
+    s->ptr++;
+  }
+
+  return(1);
+
+}/* end sim_sensor_write() */
+
+uint8_t sim_sensor_read(void *dev)
+{
+  SIM_SENSOR_TYPE *s = dev;
+  uint8_t r = s->ptr, data;
+
+  data = (r < s->size) ? s->reg[r] : 0;
+  if(s->read)
+  {
+    s->read(r);
+  }
+  s->ptr = s->next ? s->next(r) : r + 1;
+
+  return(data);
+
+}/* end sim_sensor_read() */
+
+void sim_sensor_stop(void *dev)
+{
+
+  (void)dev;
+
+}/* end sim_sensor_stop() */
+
+/*
+ * sim_sensor_init()
+ *
+ * Clear a register bank and put it on the bus.
+ */
+void sim_sensor_init(SIM_SENSOR_TYPE *s, uint8_t adrs, uint8_t size)
+{
+
+  memset(s, 0, sizeof(*s));
+  s->size = size;
+  s->slave.adrs = adrs;
+  s->slave.start = sim_sensor_start;
+  s->slave.write = sim_sensor_write;
+  s->slave.read = sim_sensor_read;
+  s->slave.stop = sim_sensor_stop;
+  s->slave.dev = s;
+  sim_twi_attach(&s->slave);
+
+}/* end sim_sensor_init() */
+
+/*
+ * sim_put_be()
+ * sim_put_le()
+ *
+ * Put a reading in two registers, high or low byte first.
+ */
+void sim_put_be(uint8_t *reg, int16_t value)
+{
+
+  reg[0] = (uint8_t)((uint16_t)value >> 8);
+  reg[1] = (uint8_t)value;
+
+}/* end sim_put_be() */
+
+void sim_put_le(uint8_t *reg, int16_t value)
+{
+
+  reg[0] = (uint8_t)value;
+  reg[1] = (uint8_t)((uint16_t)value >> 8);
+
+}/* end sim_put_le() */
+
+/*
+ * sim_adxl345_read()
+ *
+ * Reading the data clears DATA_READY.
+ */
+void sim_adxl345_read(uint8_t r)
+{
+
+  if((r >= 0x32) && (r <= 0x37))
+  {
+    sim_adxl345.reg[0x30] &= ~0x80;
+  }
+
+}/* end sim_adxl345_read() */
+
+/*
+ * sim_adxl345_set()
+ *
+ * New ADXL345 reading.
+ */
+void sim_adxl345_set(int16_t x, int16_t y, int16_t z)
+{
+
+  sim_put_le(&sim_adxl345.reg[0x32], x);
+  sim_put_le(&sim_adxl345.reg[0x34], y);
+  sim_put_le(&sim_adxl345.reg[0x36], z);
+  sim_adxl345.reg[0x30] |= 0x80; /* DATA_READY */
+
+}/* end sim_adxl345_set() */
+
+/*
+ * sim_hmc5883_next()
+ *
+ * The HMC5883 pointer goes round the data registers, and round the whole
+ * bank.
+ */
+uint8_t sim_hmc5883_next(uint8_t r)
+{
+
+  if(r == 0x08)
+  {
+    return(0x03);
+  }
+  if(r >= 0x0c)
+  {
+    return(0x00);
+  }
+
+  return(r + 1);
+
+}/* end sim_hmc5883_next() */
+
+/*
+ * sim_hmc5883_set()
+ *
+ * HMC5883 reading for the next measurement.
+ */
+void sim_hmc5883_set(int16_t x, int16_t y, int16_t z)
+{
+
+  sim_hmc5883_value[0] = x;
+  sim_hmc5883_value[1] = y;
+  sim_hmc5883_value[2] = z;
+
+}/* end sim_hmc5883_set() */
+
+/*
+ * sim_hmc5883_drdy_pin()
+ *
+ * Wire DRDY to a pin.
+ */
+void sim_hmc5883_drdy_pin(uint8_t port, uint8_t bit)
+{
+
+  sim_hmc5883_port = port;
+  sim_hmc5883_bit = bit;
+  sim_gpio_drive(port, _BV(bit), _BV(bit));
+
+}/* end sim_hmc5883_drdy_pin() */
+
+/*
+ * sim_hmc5883_measure()
+ *
+ * Put the waiting reading in the data registers, set RDY and pull DRDY low.
+ */
+void sim_hmc5883_measure(void)
+{
+
+  sim_put_be(&sim_hmc5883.reg[0x03], sim_hmc5883_value[0]);
+  sim_put_be(&sim_hmc5883.reg[0x05], sim_hmc5883_value[2]);
+  sim_put_be(&sim_hmc5883.reg[0x07], sim_hmc5883_value[1]);
+  sim_hmc5883.reg[0x09] |= 0x01; /* RDY */
+  sim_gpio_drive(sim_hmc5883_port, _BV(sim_hmc5883_bit), 0);
+  sim_hmc5883_drdy_end = sim_now + SIM_US(SIM_HMC5883_DRDY_US);
+
+}/* end sim_hmc5883_measure() */
+
+/*
+ * sim_hmc5883_write()
+ *
+ * A write to the HMC5883 restarts its measurements when it reaches the mode
+ * register.
+ */
+uint8_t sim_hmc5883_write(void *dev, uint8_t data)
+{
+  uint8_t r = sim_hmc5883.ptr,
+          first = sim_hmc5883.first;
+
+  sim_sensor_write(dev, data);
+  if((first == 0) && (r == 0x02))
+  {
+    if((data & 3) == 0)
+    {
+      sim_hmc5883_due = sim_now +
+        SIM_US(sim_hmc5883_period[(sim_hmc5883.reg[0x00] >> 2) & 7]);
+    }
+    else if((data & 3) == 1)
+    {
+      sim_hmc5883_due = sim_now + SIM_US(SIM_HMC5883_SINGLE_MS * 1000UL);
+    }
+    else
+    {
+      sim_hmc5883_due = 0; /* idle */
+    }
+  }
+
+  return(1);
+
+}/* end sim_hmc5883_write() */
+
+/*
+ * sim_itg3205_read()
+ *
+ * Reading INT_STATUS clears RAW_DATA_RDY.
+ */
+void sim_itg3205_read(uint8_t r)
+{
+
+  if(r == 0x1a)
+  {
+    sim_itg3205.reg[0x1a] &= ~0x01;
+  }
+
+}/* end sim_itg3205_read() */
+
+/*
+ * sim_itg3205_set()
+ *
+ * New ITG3205 reading.
+ */
+void sim_itg3205_set(int16_t temp, int16_t x, int16_t y, int16_t z)
+{
+
+  sim_put_be(&sim_itg3205.reg[0x1b], temp);
+  sim_put_be(&sim_itg3205.reg[0x1d], x);
+  sim_put_be(&sim_itg3205.reg[0x1f], y);
+  sim_put_be(&sim_itg3205.reg[0x21], z);
+  sim_itg3205.reg[0x1a] |= 0x01; /* RAW_DATA_RDY */
+
+}/* end sim_itg3205_set() */
+
+/*
+ * sim_sensors_reset()
+ *
+ * Reset values, 1g down on the accelerometer, the magnetometer pointing
+ * north and the gyro still at 25C.
+ */
+void sim_sensors_reset(void)
+{
+
+  sim_sensor_init(&sim_adxl345, 0x53, 0x3a);
+  sim_adxl345.reg[0x00] = 0xe5; /* DEVID */
+  sim_adxl345.reg[0x2c] = 0x0a; /* BW_RATE */
+  sim_adxl345.reg[0x30] = 0x02; /* INT_SOURCE */
+  sim_adxl345.read = sim_adxl345_read;
+  sim_adxl345_set(0, 0, 256);
+
+  sim_sensor_init(&sim_hmc5883, 0x1e, 0x0d);
+  sim_hmc5883.reg[0x00] = 0x10; /* CRA, 15Hz */
+  sim_hmc5883.reg[0x01] = 0x20; /* CRB */
+  sim_hmc5883.reg[0x02] = 0x01; /* MODE, single */
+  sim_hmc5883.reg[0x0a] = 'H';
+  sim_hmc5883.reg[0x0b] = '4';
+  sim_hmc5883.reg[0x0c] = '3';
+  sim_hmc5883.next = sim_hmc5883_next;
+  sim_hmc5883.slave.write = sim_hmc5883_write;
+  sim_hmc5883_due = 0;
+  sim_hmc5883_drdy_end = 0;
+  sim_hmc5883_set(400, 0, -300);
+  sim_hmc5883_drdy_pin(SIM_PORTD, PD2);
+
+  sim_sensor_init(&sim_itg3205, 0x68, 0x3f);
+  sim_itg3205.reg[0x00] = 0x68; /* WHO_AM_I */
+  sim_itg3205.read = sim_itg3205_read;
+  sim_itg3205_set(-16000, 0, 0, 0);
+
+}/* end sim_sensors_reset() */
+
+/*
+ * sim_sensors_step()
+ *
+ * Make the HMC5883 measurements when they're due, and end the DRDY pulse.
+ */
+void sim_sensors_step(void)
+{
+  uint8_t mode;
+
+  if((sim_hmc5883_drdy_end != 0) && (sim_now >= sim_hmc5883_drdy_end))
+  {
+    sim_hmc5883_drdy_end = 0;
+    sim_gpio_drive(sim_hmc5883_port, _BV(sim_hmc5883_bit),
+                   _BV(sim_hmc5883_bit));
+  }
+
+  if((sim_hmc5883_due != 0) && (sim_now >= sim_hmc5883_due))
+  {
+    sim_hmc5883_measure();
+    mode = sim_hmc5883.reg[0x02] & 3;
+    if(mode == 0)
+    {
+      sim_hmc5883_due +=
+        SIM_US(sim_hmc5883_period[(sim_hmc5883.reg[0x00] >> 2) & 7]);
+    }
+    else
+    {
+      sim_hmc5883_due = 0;
+      if(mode == 1)
+      {
+        sim_hmc5883.reg[0x02] |= 3; /* idle after a single measurement */
+      }
+    }
+  }
+
+}/* end sim_sensors_step() */
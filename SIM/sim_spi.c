@@ -0,0 +1,116 @@
+/*
+ * File:    sim_spi.c
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Host simulation of the SPI in master mode.
+ *
+ * A write to SPDR starts a byte that takes 8 SCK periods, the byte received
+ * for it comes from the device set by sim_spi_set_device() and the SSD1306
+ * model.  SPIF is cleared by the next access to SPDR, which stands in for
+ * the read of SPSR then SPDR the part asks for.  Slave mode isn't modelled.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#include "sim_models.h"
+
+uint8_t (*sim_spi_device)(uint8_t tx) = 0;
+uint8_t sim_spi_busy = 0,      /* 1 while a byte is being sent */
+        sim_spi_received = 0;  /* what goes in SPDR when it's done */
+uint64_t sim_spi_done = 0;     /* when it's done */
+
+/* SCK divisor for each SPR1:SPR0, halved by SPI2X. */
+const uint8_t sim_spi_divisor[4] = {4, 16, 64, 128};
+
+/*
+ * sim_spi_reset()
+ *
+ * Nothing being sent.
+ */
+void sim_spi_reset(void)
+{
+
+  sim_spi_busy = 0;
+  sim_spi_received = 0;
+  sim_spi_done = 0;
+
+}/* end sim_spi_reset() */
+
+/*
+ * sim_spi_set_device()
+ *
+ * Set the function that answers each byte.
+ */
+void sim_spi_set_device(uint8_t (*transfer)(uint8_t tx))
+{
+
+  sim_spi_device = transfer;
+
+}/* end sim_spi_set_device() */
+
+/*
+ * sim_spi_write()
+ *
+ * A byte written to SPDR.
+ */
+void sim_spi_write(uint8_t data)
+{
+  uint8_t spcr = sim_regs[SIM_ADRS_SPCR];
+  uint16_t divisor;
+
+  if(sim_spi_busy)
+  {
+    sim_regs[SIM_ADRS_SPSR] |= _BV(WCOL);
+    return;
+  }
+
+  sim_regs[SIM_ADRS_SPSR] &= ~(_BV(SPIF) | _BV(WCOL));
+  if(((spcr & _BV(SPE)) == 0) || ((spcr & _BV(MSTR)) == 0))
+  {
+    return;
+  }
+
+  divisor = sim_spi_divisor[spcr & (_BV(SPR1) | _BV(SPR0))];
+  if(sim_regs[SIM_ADRS_SPSR] & _BV(SPI2X))
+  {
+    divisor >>= 1;
+  }
+
+  sim_ssd1306_spi_byte(data);
+  sim_spi_received = sim_spi_device ? sim_spi_device(data) : 0xff;
+  sim_spi_busy = 1;
+  sim_spi_done = sim_now + 8 * divisor;
+
+}/* end sim_spi_write() */
+
+/*
+ * sim_spi_read()
+ *
+ * SPDR read.
+ */
+void sim_spi_read(void)
+{
+
+  sim_regs[SIM_ADRS_SPSR] &= ~(_BV(SPIF) | _BV(WCOL));
+
+}/* end sim_spi_read() */
+
+/*
+ * sim_spi_step()
+ *
+ * Finish the byte being sent when its time is up.
+ */
+void sim_spi_step(void)
+{
+
+  if(sim_spi_busy && (sim_now >= sim_spi_done))
+  {
+    sim_spi_busy = 0;
+    sim_regs[SIM_ADRS_SPDR] = sim_spi_received;
+    sim_regs[SIM_ADRS_SPSR] |= _BV(SPIF);
+  }
+
+}/* end sim_spi_step() */
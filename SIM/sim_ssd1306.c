@@ -0,0 +1,372 @@
+/*
+ * File:    sim_ssd1306.c
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Host simulation of SSD1306 128x64 OLED controllers, two on the I2C bus at
+ * 0x3c and 0x3d, and one on the SPI bus.
+ *
+ * The model keeps the display RAM and the addressing commands: the memory
+ * addressing mode (0x20), the column and page windows (0x21, 0x22) and the
+ * page mode start address (0x00-0x1f, 0xb0-0xb7).  Other commands are
+ * counted and their arguments skipped.
+ *
+ * On I2C each transfer starts with a control byte: Co = 0 makes the rest
+ * commands (D/C = 0) or data (D/C = 1), Co = 1 sends one byte and another
+ * control byte.  On SPI a byte is taken while CS is low, and is data if D/C
+ * is high.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#include <string.h>
+#include "sim_models.h"
+
+/* What an I2C byte is, from the control byte. */
+enum
+{
+  SIM_SSD1306_CONTROL,
+  SIM_SSD1306_COMMANDS,
+  SIM_SSD1306_DATA,
+  SIM_SSD1306_ONE_COMMAND,
+  SIM_SSD1306_ONE_DATA
+};
+
+/* One controller.
+ *
+ * slave      : its place on the I2C bus
+ * ram        : display RAM
+ * mode       : addressing mode, 0 horizontal, 1 vertical, 2 page
+ * colStart.. : the column and page windows
+ * col, page  : where the next data byte goes
+ * cmd        : the command being received
+ * args       : arguments it still needs
+ * state      : what the next I2C byte is
+ * stats      : counts
+ */
+typedef struct
+{
+  SIM_TWI_SLAVE_TYPE slave;
+  uint8_t ram[SIM_SSD1306_RAM_SIZE];
+  uint8_t mode;
+  uint8_t colStart;
+  uint8_t colEnd;
+  uint8_t pageStart;
+  uint8_t pageEnd;
+  uint8_t col;
+  uint8_t page;
+  uint8_t cmd[7];
+  uint8_t cmdLen;
+  uint8_t args;
+  uint8_t state;
+  SIM_SSD1306_STATS_TYPE stats;
+
+} SIM_SSD1306_TYPE;
+
+SIM_SSD1306_TYPE sim_ssd1306[SIM_SSD1306_COUNT];
+
+/* SPI D/C and CS pins. */
+uint8_t sim_ssd1306_dc_port, sim_ssd1306_dc_bit,
+        sim_ssd1306_cs_port, sim_ssd1306_cs_bit;
+
+/*
+ * sim_ssd1306_args()
+ *
+ * Return the number of argument bytes that follow a command.
+ */
+uint8_t sim_ssd1306_args(uint8_t cmd)
+{
+
+  switch(cmd)
+  {
+    case 0x20: case 0x81: case 0x8d: case 0xa8: case 0xd3: case 0xd5:
+    case 0xd9: case 0xda: case 0xdb:
+      return(1);
+    case 0x21: case 0x22: case 0xa3:
+      return(2);
+    case 0x29: case 0x2a:
+      return(5);
+    case 0x26: case 0x27:
+      return(6);
+    default:
+      return(0);
+  }
+
+}/* end sim_ssd1306_args() */
+
+/*
+ * sim_ssd1306_run()
+ *
+ * Carry out a command once all of it has arrived.
+ */
+void sim_ssd1306_run(SIM_SSD1306_TYPE *d)
+{
+  uint8_t cmd = d->cmd[0];
+
+  if(cmd == 0x20)
+  {
+    d->mode = d->cmd[1] & 3;
+  }
+  else if(cmd == 0x21)
+  {
+    d->colStart = d->cmd[1] & 0x7f;
+    d->colEnd = d->cmd[2] & 0x7f;
+    d->col = d->colStart;
+  }
+  else if(cmd == 0x22)
+  {
+    d->pageStart = d->cmd[1] & 7;
+    d->pageEnd = d->cmd[2] & 7;
+    d->page = d->pageStart;
+  }
+  else if(cmd <= 0x0f)
+  {
+    d->col = (d->col & 0xf0) | cmd;
+  }
+  else if(cmd <= 0x1f)
+  {
+    d->col = ((cmd & 0x07) << 4) | (d->col & 0x0f);
+  }
+  else if((cmd >= 0xb0) && (cmd <= 0xb7))
+  {
+    d->page = cmd & 7;
+  }
+
+}/* end sim_ssd1306_run() */
+
+/*
+ * sim_ssd1306_command()
+ *
+ * Take a command byte.
+ */
+void sim_ssd1306_command(SIM_SSD1306_TYPE *d, uint8_t c)
+{
+
+  d->stats.commands++;
+  if(d->args == 0)
+  {
+    d->cmdLen = 0;
+    d->args = sim_ssd1306_args(c);
+  }
+  else
+  {
+    d->args--;
+  }
+  d->cmd[d->cmdLen++] = c;
+
+  if(d->args == 0)
+  {
+    sim_ssd1306_run(d);
+  }
+
+}/* end sim_ssd1306_command() */
+
+/*
+ * sim_ssd1306_data()
+ *
+ * Take a display RAM byte and move the address on for the addressing mode.
+ */
+void sim_ssd1306_data(SIM_SSD1306_TYPE *d, uint8_t c)
+{
+
+  d->stats.data++;
+  d->ram[(uint16_t)d->page * 128 + d->col] = c;
+
+  if(d->mode == 0)
+  {
+  /* horizontal, along the columns then to the next page */
+    if(d->col++ >= d->colEnd)
+    {
+      d->col = d->colStart;
+      d->page = (d->page >= d->pageEnd) ? d->pageStart : d->page + 1;
+    }
+  }
+  else if(d->mode == 1)
+  {
+  /* vertical, down the pages then to the next column */
+    if(d->page++ >= d->pageEnd)
+    {
+      d->page = d->pageStart;
+      d->col = (d->col >= d->colEnd) ? d->colStart : d->col + 1;
+    }
+  }
+  else
+  {
+  /* page, along the page and round */
+    d->col = (d->col + 1) & 0x7f;
+  }
+
+}/* end sim_ssd1306_data() */
+
+/*
+ * sim_ssd1306_start()
+ * sim_ssd1306_write()
+ * sim_ssd1306_read()
+ * sim_ssd1306_stop()
+ *
+ * The I2C slave functions.
+ */
+void sim_ssd1306_start(void *dev, uint8_t read)
+{
+  SIM_SSD1306_TYPE *d = dev;
+
+  (void)read;
+  d->state = SIM_SSD1306_CONTROL;
+
+}/* end sim_ssd1306_start() */
+
+uint8_t sim_ssd1306_write(void *dev, uint8_t data)
+{
+  SIM_SSD1306_TYPE *d = dev;
+
+  switch(d->state)
+  {
+    case SIM_SSD1306_CONTROL:
+      if(data & 0x80)
+      {
+        d->state = (data & 0x40) ? SIM_SSD1306_ONE_DATA :
+                                   SIM_SSD1306_ONE_COMMAND;
+      }
+      else
+      {
+        d->state = (data & 0x40) ? SIM_SSD1306_DATA : SIM_SSD1306_COMMANDS;
+      }
+      break;
+    case SIM_SSD1306_COMMANDS:
+      sim_ssd1306_command(d, data);
+      break;
+    case SIM_SSD1306_DATA:
+      sim_ssd1306_data(d, data);
+      break;
+    case SIM_SSD1306_ONE_COMMAND:
+      sim_ssd1306_command(d, data);
+      d->state = SIM_SSD1306_CONTROL;
+      break;
+    default:
+      sim_ssd1306_data(d, data);
+      d->state = SIM_SSD1306_CONTROL;
+      break;
+  }
+
+  return(1);
+
+}/* end sim_ssd1306_write() */
+
+uint8_t sim_ssd1306_read(void *dev)
+{
+
+  (void)dev;
+  return(0x00); /* status, display on and ready */
+
+}/* end sim_ssd1306_read() */
+
+void sim_ssd1306_stop(void *dev)
+{
+
+  (void)dev;
+
+}/* end sim_ssd1306_stop() */
+
+/*
+ * sim_ssd1306_spi_pins()
+ *
+ * Wire the SPI controller's D/C and CS to pins.
+ */
+void sim_ssd1306_spi_pins(uint8_t dcPort, uint8_t dcBit,
+                          uint8_t csPort, uint8_t csBit)
+{
+
+  sim_ssd1306_dc_port = dcPort;
+  sim_ssd1306_dc_bit = dcBit;
+  sim_ssd1306_cs_port = csPort;
+  sim_ssd1306_cs_bit = csBit;
+
+}/* end sim_ssd1306_spi_pins() */
+
+/*
+ * sim_ssd1306_spi_byte()
+ *
+ * A byte on the SPI bus, taken if CS is low.
+ */
+void sim_ssd1306_spi_byte(uint8_t data)
+{
+  SIM_SSD1306_TYPE *d = &sim_ssd1306[SIM_SSD1306_SPI];
+
+  if(sim_gpio_port_bit(sim_ssd1306_cs_port, sim_ssd1306_cs_bit))
+  {
+    return;
+  }
+
+  if(sim_gpio_port_bit(sim_ssd1306_dc_port, sim_ssd1306_dc_bit))
+  {
+    sim_ssd1306_data(d, data);
+  }
+  else
+  {
+    sim_ssd1306_command(d, data);
+  }
+
+}/* end sim_ssd1306_spi_byte() */
+
+/*
+ * sim_ssd1306_reset()
+ *
+ * Reset state, display RAM cleared and page addressing.
+ */
+void sim_ssd1306_reset(void)
+{
+  uint8_t n;
+  SIM_SSD1306_TYPE *d;
+
+  for(n = 0; n < SIM_SSD1306_COUNT; n++)
+  {
+    d = &sim_ssd1306[n];
+    memset(d, 0, sizeof(*d));
+    d->mode = 2;
+    d->colEnd = 127;
+    d->pageEnd = 7;
+
+    if(n != SIM_SSD1306_SPI)
+    {
+      d->slave.adrs = 0x3c + n;
+      d->slave.start = sim_ssd1306_start;
+      d->slave.write = sim_ssd1306_write;
+      d->slave.read = sim_ssd1306_read;
+      d->slave.stop = sim_ssd1306_stop;
+      d->slave.dev = d;
+      sim_twi_attach(&d->slave);
+    }
+  }
+
+  sim_ssd1306_spi_pins(SIM_PORTB, PB1, SIM_PORTB, PB2);
+
+}/* end sim_ssd1306_reset() */
+
+/*
+ * sim_ssd1306_ram()
+ *
+ * Return a controller's display RAM.
+ */
+const uint8_t *sim_ssd1306_ram(uint8_t n)
+{
+
+  return(sim_ssd1306[n % SIM_SSD1306_COUNT].ram);
+
+}/* end sim_ssd1306_ram() */
+
+/*
+ * sim_ssd1306_get_stats()
+ *
+ * Copy a controller's counts, then clear them.
+ */
+void sim_ssd1306_get_stats(uint8_t n, SIM_SSD1306_STATS_TYPE *stats)
+{
+  SIM_SSD1306_TYPE *d = &sim_ssd1306[n % SIM_SSD1306_COUNT];
+
+  *stats = d->stats;
+  d->stats.commands = 0;
+  d->stats.data = 0;
+
+}/* end sim_ssd1306_get_stats() */
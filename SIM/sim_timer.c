@@ -0,0 +1,248 @@
+/*
+ * File:    sim_timer.c
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Host simulation of Timer/Counters 0, 1 and 2.
+ *
+ * Each timer counts the CPU clock through its prescaler, up to its TOP and
+ * back to 0, raising the overflow and compare match flags.  As on the part,
+ * a match flag is raised on the timer clock after the count equals the
+ * compare register, so in CTC mode as the count goes back to 0.  The phase
+ * correct PWM modes are counted as their fast PWM equals (up only, so at
+ * twice the rate), and the external clock inputs and the TC2 asynchronous
+ * clock don't count at all.  The output compare pins are not driven.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#include "sim_models.h"
+
+/* Where a timer's registers are.
+ *
+ * tccra, tccrb: control registers
+ * tcnt        : count, 16 bits if wide is 1
+ * ocra, ocrb  : compare registers, 16 bits if wide is 1
+ * tifr        : interrupt flags
+ * presc       : prescale of each clock select, 0 for not counting
+ */
+typedef struct
+{
+  uint8_t tccra;
+  uint8_t tccrb;
+  uint8_t tcnt;
+  uint8_t ocra;
+  uint8_t ocrb;
+  uint8_t tifr;
+  uint8_t wide;
+  uint16_t presc[8];
+
+} SIM_TIMER_TYPE;
+
+const SIM_TIMER_TYPE sim_timers[3] =
+{
+  {SIM_ADRS_TCCR0A, SIM_ADRS_TCCR0B, SIM_ADRS_TCNT0, SIM_ADRS_OCR0A,
+   SIM_ADRS_OCR0B, SIM_ADRS_TIFR0, 0, {0, 1, 8, 64, 256, 1024, 0, 0}},
+  {SIM_ADRS_TCCR1A, SIM_ADRS_TCCR1B, SIM_ADRS_TCNT1, SIM_ADRS_OCR1A,
+   SIM_ADRS_OCR1B, SIM_ADRS_TIFR1, 1, {0, 1, 8, 64, 256, 1024, 0, 0}},
+  {SIM_ADRS_TCCR2A, SIM_ADRS_TCCR2B, SIM_ADRS_TCNT2, SIM_ADRS_OCR2A,
+   SIM_ADRS_OCR2B, SIM_ADRS_TIFR2, 0, {0, 1, 8, 32, 64, 128, 256, 1024}}
+};
+
+/* Cycles counted towards the next timer clock. */
+uint16_t sim_timer_acc[3];
+
+/*
+ * sim_timer_reg()
+ * sim_timer_set_reg()
+ *
+ * Read or write an 8 or 16 bit timer register.
+ */
+uint16_t sim_timer_reg(uint8_t adrs, uint8_t wide)
+{
+
+  if(wide)
+  {
+    return(sim_regs[adrs] | ((uint16_t)sim_regs[adrs + 1] << 8));
+  }
+
+  return(sim_regs[adrs]);
+
+}/* end sim_timer_reg() */
+
+void sim_timer_set_reg(uint8_t adrs, uint8_t wide, uint16_t value)
+{
+
+  sim_regs[adrs] = (uint8_t)value;
+  if(wide)
+  {
+    sim_regs[adrs + 1] = (uint8_t)(value >> 8);
+  }
+
+}/* end sim_timer_set_reg() */
+
+/*
+ * sim_timer_top()
+ *
+ * Return a timer's TOP for its mode, and set *ctc to 1 for the modes where
+ * the overflow flag is only raised at MAX.
+ */
+uint16_t sim_timer_top(uint8_t n, uint8_t *ctc)
+{
+  const SIM_TIMER_TYPE *t = &sim_timers[n];
+  uint8_t wgm;
+
+  *ctc = 0;
+  if(t->wide)
+  {
+    wgm = (sim_regs[t->tccra] & 3) | ((sim_regs[t->tccrb] >> 1) & 0x0c);
+    switch(wgm)
+    {
+      case 1:
+      case 5:
+        return(0x00ff);
+      case 2:
+      case 6:
+        return(0x01ff);
+      case 3:
+      case 7:
+        return(0x03ff);
+      case 4:
+        *ctc = 1;
+        return(sim_timer_reg(SIM_ADRS_OCR1A, 1));
+      case 9:
+      case 11:
+      case 15:
+        return(sim_timer_reg(SIM_ADRS_OCR1A, 1));
+      case 12:
+        *ctc = 1;
+        return(sim_timer_reg(SIM_ADRS_ICR1, 1));
+      case 8:
+      case 10:
+      case 14:
+        return(sim_timer_reg(SIM_ADRS_ICR1, 1));
+      default:
+        return(0xffff);
+    }
+  }
+
+  wgm = (sim_regs[t->tccra] & 3) | ((sim_regs[t->tccrb] >> 1) & 0x04);
+  switch(wgm)
+  {
+    case 2:
+      *ctc = 1;
+      return(sim_regs[t->ocra]);
+    case 5:
+    case 7:
+      return(sim_regs[t->ocra]);
+    default:
+      return(0x00ff);
+  }
+
+}/* end sim_timer_top() */
+
+/*
+ * sim_timer_count()
+ *
+ * Count a timer on by ticks timer clocks.  A compare register is matched by
+ * the clock that moves the count off its value.
+ */
+void sim_timer_count(uint8_t n, uint32_t ticks)
+{
+  const SIM_TIMER_TYPE *t = &sim_timers[n];
+  uint8_t ctc, flags = 0;
+  uint16_t top, max, ocra, ocrb;
+  uint32_t cnt, end;
+
+  max = t->wide ? 0xffff : 0x00ff;
+  top = sim_timer_top(n, &ctc);
+  ocra = sim_timer_reg(t->ocra, t->wide);
+  ocrb = sim_timer_reg(t->ocrb, t->wide);
+  cnt = sim_timer_reg(t->tcnt, t->wide);
+
+  while(ticks != 0)
+  {
+  /* a count above TOP (TOP moved under it) runs on to MAX */
+    end = (cnt > top) ? max : top;
+
+    if(cnt + ticks <= end)
+    {
+      flags |= ((ocra >= cnt) && (ocra < cnt + ticks)) ? _BV(OCF0A) : 0;
+      flags |= ((ocrb >= cnt) && (ocrb < cnt + ticks)) ? _BV(OCF0B) : 0;
+      cnt += ticks;
+      break;
+    }
+
+  /* up to the end and round to 0 */
+    if((ocra >= cnt) && (ocra <= end))
+    {
+      flags |= _BV(OCF0A);
+    }
+    if((ocrb >= cnt) && (ocrb <= end))
+    {
+      flags |= _BV(OCF0B);
+    }
+    if((ctc == 0) || (end == max))
+    {
+      flags |= _BV(TOV0);
+    }
+    if((n == 1) && (end == top) && (ctc != 0) &&
+       (((sim_regs[t->tccrb] >> 3) & 3) == 3))
+    {
+      sim_regs[t->tifr] |= _BV(ICF1); /* CTC with TOP in ICR1 */
+    }
+    ticks -= end - cnt + 1;
+    cnt = 0;
+  }
+
+  sim_timer_set_reg(t->tcnt, t->wide, (uint16_t)cnt);
+  sim_regs[t->tifr] |= flags; /* OCFnA, OCFnB and TOVn are bits 1, 2, 0 */
+
+}/* end sim_timer_count() */
+
+/*
+ * sim_timer_reset()
+ *
+ * Timers stopped.
+ */
+void sim_timer_reset(void)
+{
+  uint8_t n;
+
+  for(n = 0; n < 3; n++)
+  {
+    sim_timer_acc[n] = 0;
+  }
+
+}/* end sim_timer_reset() */
+
+/*
+ * sim_timer_step()
+ *
+ * Count each running timer on by the timer clocks in cycles CPU clocks.
+ */
+void sim_timer_step(uint32_t cycles)
+{
+  uint8_t n;
+  uint16_t presc;
+  uint32_t acc;
+
+  for(n = 0; n < 3; n++)
+  {
+    presc = sim_timers[n].presc[sim_regs[sim_timers[n].tccrb] & 7];
+    if(presc == 0)
+    {
+      continue;
+    }
+
+    acc = sim_timer_acc[n] + cycles;
+    sim_timer_acc[n] = acc % presc;
+    if(acc >= presc)
+    {
+      sim_timer_count(n, acc / presc);
+    }
+  }
+
+}/* end sim_timer_step() */
@@ -0,0 +1,378 @@
+/*
+ * File:    sim_twi.c
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Host simulation of the TWI in master mode, and the I2C bus.
+ *
+ * Writing TWCR with TWINT set starts the next step, which finishes after its
+ * time on the bus with TWINT set and the status in TWSR:
+ *
+ *   START or repeated START   1 SCL period
+ *   address, data byte        9 SCL periods (8 bits and the acknowledge)
+ *   STOP                      1 SCL period, TWSTO clears, TWINT stays clear
+ *
+ * The SCL period is 16 + 2 * TWBR * 4^TWPS cycles, so a byte is 22.5us at
+ * 400kHz.  Arbitration, slave mode and clock stretching aren't modelled.
+ *
+ * SDA and SCL (PC4, PC5) read high through the bus pull-ups, unless
+ * sim_twi_hold_sda() has a slave holding SDA low.  Then no START can be made
+ * until SCL has been pulsed by hand (DDRC5 set then cleared with the TWI
+ * off) as many times as asked for.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#include <util/twi.h>
+#include "sim_models.h"
+
+/* What the TWI is doing. */
+enum
+{
+  SIM_TWI_NONE,
+  SIM_TWI_START,
+  SIM_TWI_STOP,
+  SIM_TWI_ADDRESS,
+  SIM_TWI_SEND,
+  SIM_TWI_RECEIVE
+};
+
+/* Where the master is in a transfer. */
+enum
+{
+  SIM_TWI_IDLE,       /* bus free */
+  SIM_TWI_STARTED,    /* START sent, address next */
+  SIM_TWI_SENDING,    /* addressed a slave to write */
+  SIM_TWI_RECEIVING,  /* addressed a slave to read */
+  SIM_TWI_OWNED       /* bus held, nobody addressed */
+};
+
+SIM_TWI_SLAVE_TYPE *sim_twi_slaves[SIM_TWI_MAX_SLAVES];
+uint8_t sim_twi_count = 0;
+
+SIM_TWI_SLAVE_TYPE *sim_twi_slave = 0; /* the one addressed */
+uint8_t sim_twi_op = SIM_TWI_NONE,
+        sim_twi_phase = SIM_TWI_IDLE,
+        sim_twi_held = 0,              /* SCL pulses until SDA is let go */
+        sim_twi_scl = 0;               /* DDRC5 at the last step */
+uint64_t sim_twi_done = 0;             /* when the step being made is done */
+uint32_t sim_twi_byte_count = 0;
+
+/*
+ * sim_twi_reset()
+ *
+ * No slaves, the bus free and pulled up.
+ */
+void sim_twi_reset(void)
+{
+
+  sim_regs[SIM_ADRS_TWSR] = TW_NO_INFO;
+  sim_regs[SIM_ADRS_TWDR] = 0xff;
+  sim_twi_count = 0;
+  sim_twi_slave = 0;
+  sim_twi_op = SIM_TWI_NONE;
+  sim_twi_phase = SIM_TWI_IDLE;
+  sim_twi_held = 0;
+  sim_twi_scl = 0;
+  sim_twi_byte_count = 0;
+  sim_gpio_drive(SIM_PORTC, _BV(PC4) | _BV(PC5), _BV(PC4) | _BV(PC5));
+
+}/* end sim_twi_reset() */
+
+/*
+ * sim_twi_attach()
+ *
+ * Put a slave on the bus.
+ */
+void sim_twi_attach(SIM_TWI_SLAVE_TYPE *slave)
+{
+
+  if(sim_twi_count < SIM_TWI_MAX_SLAVES)
+  {
+    slave->present = 1;
+    sim_twi_slaves[sim_twi_count++] = slave;
+  }
+
+}/* end sim_twi_attach() */
+
+/*
+ * sim_twi_present()
+ *
+ * Connect or disconnect a slave.
+ */
+void sim_twi_present(uint8_t adrs, uint8_t present)
+{
+  uint8_t i;
+
+  for(i = 0; i < sim_twi_count; i++)
+  {
+    if(sim_twi_slaves[i]->adrs == adrs)
+    {
+      sim_twi_slaves[i]->present = present;
+    }
+  }
+
+}/* end sim_twi_present() */
+
+/*
+ * sim_twi_hold_sda()
+ *
+ * Hold SDA low until SCL has been pulsed clocks times.
+ */
+void sim_twi_hold_sda(uint8_t clocks)
+{
+
+  sim_twi_held = clocks;
+  sim_gpio_drive(SIM_PORTC, _BV(PC4), clocks ? 0 : _BV(PC4));
+
+}/* end sim_twi_hold_sda() */
+
+/*
+ * sim_twi_bytes()
+ *
+ * Return the bytes moved on the bus.
+ */
+uint32_t sim_twi_bytes(void)
+{
+
+  return(sim_twi_byte_count);
+
+}/* end sim_twi_bytes() */
+
+/*
+ * sim_twi_period()
+ *
+ * Return the cycles in an SCL period.
+ */
+uint32_t sim_twi_period(void)
+{
+
+  return(16 + 2 * (uint32_t)sim_regs[SIM_ADRS_TWBR] *
+         (1UL << (2 * (sim_regs[SIM_ADRS_TWSR] & 3))));
+
+}/* end sim_twi_period() */
+
+/*
+ * sim_twi_release()
+ *
+ * Tell the slave addressed it is finished with.
+ */
+void sim_twi_release(void)
+{
+
+  if(sim_twi_slave != 0)
+  {
+    sim_twi_slave->stop(sim_twi_slave->dev);
+    sim_twi_slave = 0;
+  }
+
+}/* end sim_twi_release() */
+
+/*
+ * sim_twi_write_control()
+ *
+ * A write to TWCR.
+ */
+void sim_twi_write_control(uint8_t value)
+{
+  uint8_t twint = sim_regs[SIM_ADRS_TWCR] & _BV(TWINT);
+
+  if((value & _BV(TWEN)) == 0)
+  {
+  /* TWI off, the transfer is dropped */
+    sim_regs[SIM_ADRS_TWCR] = value & ~_BV(TWINT);
+    sim_twi_release();
+    sim_twi_op = SIM_TWI_NONE;
+    sim_twi_phase = SIM_TWI_IDLE;
+    return;
+  }
+
+  if((value & _BV(TWINT)) == 0)
+  {
+  /* just the enables, TWINT stays as it is */
+    sim_regs[SIM_ADRS_TWCR] = (value & ~_BV(TWINT)) | twint;
+    return;
+  }
+
+/* TWINT written as 1, clear it and start the next step */
+  sim_regs[SIM_ADRS_TWCR] = value & ~_BV(TWINT);
+
+  if(value & _BV(TWSTO))
+  {
+    sim_twi_op = SIM_TWI_STOP;
+  }
+  else if(value & _BV(TWSTA))
+  {
+    sim_twi_op = SIM_TWI_START;
+  }
+  else if(sim_twi_phase == SIM_TWI_STARTED)
+  {
+    sim_twi_op = SIM_TWI_ADDRESS;
+  }
+  else if(sim_twi_phase == SIM_TWI_SENDING)
+  {
+    sim_twi_op = SIM_TWI_SEND;
+  }
+  else if(sim_twi_phase == SIM_TWI_RECEIVING)
+  {
+    sim_twi_op = SIM_TWI_RECEIVE;
+  }
+  else
+  {
+    sim_twi_op = SIM_TWI_NONE;
+    return;
+  }
+
+  if((sim_twi_op == SIM_TWI_START) || (sim_twi_op == SIM_TWI_STOP))
+  {
+    sim_twi_done = sim_now + sim_twi_period();
+  }
+  else
+  {
+    sim_twi_done = sim_now + 9 * sim_twi_period();
+  }
+
+}/* end sim_twi_write_control() */
+
+/*
+ * sim_twi_find()
+ *
+ * Return the slave at an address that is present, 0 if there isn't one.
+ */
+SIM_TWI_SLAVE_TYPE *sim_twi_find(uint8_t adrs)
+{
+  uint8_t i;
+
+  for(i = 0; i < sim_twi_count; i++)
+  {
+    if((sim_twi_slaves[i]->adrs == adrs) && sim_twi_slaves[i]->present)
+    {
+      return(sim_twi_slaves[i]);
+    }
+  }
+
+  return(0);
+
+}/* end sim_twi_find() */
+
+/*
+ * sim_twi_finish()
+ *
+ * Finish the step being made, status goes in TWSR.
+ */
+void sim_twi_finish(void)
+{
+  uint8_t status = TW_NO_INFO,
+          data = sim_regs[SIM_ADRS_TWDR],
+          read;
+
+  switch(sim_twi_op)
+  {
+    case SIM_TWI_START:
+      status = (sim_twi_phase == SIM_TWI_IDLE) ? TW_START : TW_REP_START;
+      sim_twi_release();
+      sim_twi_phase = SIM_TWI_STARTED;
+      break;
+
+    case SIM_TWI_STOP:
+      sim_twi_release();
+      sim_twi_phase = SIM_TWI_IDLE;
+      sim_regs[SIM_ADRS_TWCR] &= ~_BV(TWSTO);
+      sim_twi_op = SIM_TWI_NONE;
+      if(sim_regs[SIM_ADRS_TWCR] & _BV(TWSTA))
+      {
+      /* STOP then START */
+        sim_twi_op = SIM_TWI_START;
+        sim_twi_done = sim_now + sim_twi_period();
+      }
+      return;  /* no TWINT for a STOP */
+
+    case SIM_TWI_ADDRESS:
+      read = data & TW_READ;
+      sim_twi_byte_count++;
+      sim_twi_slave = sim_twi_find(data >> 1);
+      if(sim_twi_slave != 0)
+      {
+        sim_twi_slave->start(sim_twi_slave->dev, read);
+        status = read ? TW_MR_SLA_ACK : TW_MT_SLA_ACK;
+        sim_twi_phase = read ? SIM_TWI_RECEIVING : SIM_TWI_SENDING;
+      }
+      else
+      {
+        status = read ? TW_MR_SLA_NACK : TW_MT_SLA_NACK;
+        sim_twi_phase = SIM_TWI_OWNED;
+      }
+      break;
+
+    case SIM_TWI_SEND:
+      sim_twi_byte_count++;
+      if(sim_twi_slave->write(sim_twi_slave->dev, data))
+      {
+        status = TW_MT_DATA_ACK;
+      }
+      else
+      {
+        status = TW_MT_DATA_NACK;
+        sim_twi_phase = SIM_TWI_OWNED;
+      }
+      break;
+
+    case SIM_TWI_RECEIVE:
+      sim_twi_byte_count++;
+      sim_regs[SIM_ADRS_TWDR] = sim_twi_slave->read(sim_twi_slave->dev);
+      if(sim_regs[SIM_ADRS_TWCR] & _BV(TWEA))
+      {
+        status = TW_MR_DATA_ACK;
+      }
+      else
+      {
+        status = TW_MR_DATA_NACK;
+        sim_twi_phase = SIM_TWI_OWNED;
+      }
+      break;
+
+    default:
+      return;
+  }
+
+  sim_twi_op = SIM_TWI_NONE;
+  sim_regs[SIM_ADRS_TWSR] = status | (sim_regs[SIM_ADRS_TWSR] & 3);
+  sim_regs[SIM_ADRS_TWCR] |= _BV(TWINT);
+
+}/* end sim_twi_finish() */
+
+/*
+ * sim_twi_step()
+ *
+ * Finish the step being made when its time is up, and count the SCL pulses
+ * made by hand while SDA is held.
+ */
+void sim_twi_step(void)
+{
+  uint8_t scl = sim_regs[SIM_ADRS_DDRC] & _BV(DDC5);
+
+  if(sim_twi_held != 0)
+  {
+    if(((sim_regs[SIM_ADRS_TWCR] & _BV(TWEN)) == 0) &&
+       (sim_twi_scl != 0) && (scl == 0))
+    {
+      sim_twi_hold_sda(sim_twi_held - 1);
+    }
+    sim_twi_scl = scl;
+
+    if(sim_twi_op == SIM_TWI_START)
+    {
+      sim_twi_done = sim_now + sim_twi_period(); /* waits for the bus */
+    }
+    return;
+  }
+  sim_twi_scl = scl;
+
+  if((sim_twi_op != SIM_TWI_NONE) && (sim_now >= sim_twi_done))
+  {
+    sim_twi_finish();
+  }
+
+}/* end sim_twi_step() */
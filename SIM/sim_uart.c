@@ -0,0 +1,271 @@
+/*
+ * File:    sim_uart.c
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Host simulation of USART0 in asynchronous mode.
+ *
+ * The transmitter has the part's data register and shift register, so UDRE0
+ * drops while one byte is being sent and another is waiting.  A frame takes
+ * (start + data + parity + stop bits) * 16 * (UBRR0 + 1) cycles, 8 instead of
+ * 16 with U2X0.  Bytes from sim_uart_receive() arrive a frame apart into the
+ * two byte receive FIFO, one arriving with the FIFO full is lost and sets
+ * DOR0 until UDR0 is read.  Frame and parity errors aren't made.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#include "sim_models.h"
+
+void (*sim_uart_sink)(uint8_t c) = 0;
+
+/* transmitter */
+uint8_t sim_uart_shifting = 0, /* 1 while a byte is being sent */
+        sim_uart_shift,        /* the byte being sent */
+        sim_uart_waiting = 0,  /* 1 if a byte is waiting in UDR0 */
+        sim_uart_data_reg;     /* the byte waiting */
+uint64_t sim_uart_tx_done;     /* when the byte being sent is done */
+uint32_t sim_uart_tx_count = 0;
+
+/* receiver */
+uint8_t sim_uart_rx_queue[256],
+        sim_uart_rx_head = 0,  /* bytes still to arrive */
+        sim_uart_rx_tail = 0,
+        sim_uart_rx_fifo[2],   /* ones that have, for UDR0 */
+        sim_uart_rx_count = 0;
+uint16_t sim_uart_rx_left = 0;
+uint64_t sim_uart_rx_next = 0; /* when the next one is in */
+
+/*
+ * sim_uart_frame()
+ *
+ * Return the cycles a frame takes at the programmed settings.
+ */
+uint32_t sim_uart_frame(void)
+{
+  uint8_t ucsrc = sim_regs[SIM_ADRS_UCSR0C];
+  uint32_t bits, ubrr;
+
+  bits = 1 + 5 + ((ucsrc >> UCSZ00) & 3) + 1;
+  if(sim_regs[SIM_ADRS_UCSR0B] & _BV(UCSZ02))
+  {
+    bits = 1 + 9 + 1;
+  }
+  if(ucsrc & _BV(UPM01))
+  {
+    bits++;
+  }
+  if(ucsrc & _BV(USBS0))
+  {
+    bits++;
+  }
+
+  ubrr = (sim_regs[SIM_ADRS_UBRR0L] | ((sim_regs[SIM_ADRS_UBRR0H] & 0x0f) << 8))
+         + 1;
+
+  return(bits * ubrr * ((sim_regs[SIM_ADRS_UCSR0A] & _BV(U2X0)) ? 8 : 16));
+
+}/* end sim_uart_frame() */
+
+/*
+ * sim_uart_reset()
+ *
+ * Nothing being sent or received.
+ */
+void sim_uart_reset(void)
+{
+
+  sim_regs[SIM_ADRS_UCSR0A] = _BV(UDRE0);
+  sim_regs[SIM_ADRS_UCSR0C] = _BV(UCSZ01) | _BV(UCSZ00);
+  sim_uart_shifting = 0;
+  sim_uart_waiting = 0;
+  sim_uart_tx_count = 0;
+  sim_uart_rx_head = 0;
+  sim_uart_rx_tail = 0;
+  sim_uart_rx_left = 0;
+  sim_uart_rx_count = 0;
+
+}/* end sim_uart_reset() */
+
+/*
+ * sim_uart_set_sink()
+ *
+ * Set the function given each byte sent.
+ */
+void sim_uart_set_sink(void (*sink)(uint8_t c))
+{
+
+  sim_uart_sink = sink;
+
+}/* end sim_uart_set_sink() */
+
+/*
+ * sim_uart_sent()
+ *
+ * Return the bytes sent.
+ */
+uint32_t sim_uart_sent(void)
+{
+
+  return(sim_uart_tx_count);
+
+}/* end sim_uart_sent() */
+
+/*
+ * sim_uart_receive()
+ *
+ * Queue bytes to arrive.
+ */
+uint16_t sim_uart_receive(const uint8_t *buf, uint16_t len)
+{
+  uint16_t i;
+
+  if(sim_uart_rx_left == 0)
+  {
+    sim_uart_rx_next = sim_now + sim_uart_frame();
+  }
+
+  for(i = 0; (i < len) && (sim_uart_rx_left < 256); i++)
+  {
+    sim_uart_rx_queue[sim_uart_rx_head++] = buf[i];
+    sim_uart_rx_left++;
+  }
+
+  return(i);
+
+}/* end sim_uart_receive() */
+
+/*
+ * sim_uart_write()
+ *
+ * A byte written to UDR0, ignored if UDRE0 is clear.
+ */
+void sim_uart_write(uint8_t data)
+{
+
+  if((sim_regs[SIM_ADRS_UCSR0B] & _BV(TXEN0)) == 0)
+  {
+    return;
+  }
+
+  if(sim_uart_shifting == 0)
+  {
+    sim_uart_shifting = 1;
+    sim_uart_shift = data;
+    sim_uart_tx_done = sim_now + sim_uart_frame();
+  }
+  else if(sim_uart_waiting == 0)
+  {
+    sim_uart_waiting = 1;
+    sim_uart_data_reg = data;
+    sim_regs[SIM_ADRS_UCSR0A] &= ~_BV(UDRE0);
+  }
+
+}/* end sim_uart_write() */
+
+/*
+ * sim_uart_data()
+ *
+ * Return what a read of UDR0 gives.
+ */
+uint8_t sim_uart_data(void)
+{
+
+  return(sim_uart_rx_fifo[0]);
+
+}/* end sim_uart_data() */
+
+/*
+ * sim_uart_read()
+ *
+ * UDR0 read, take the byte out of the FIFO.
+ */
+void sim_uart_read(void)
+{
+
+  if(sim_uart_rx_count != 0)
+  {
+    sim_uart_rx_fifo[0] = sim_uart_rx_fifo[1];
+    sim_uart_rx_count--;
+  }
+  sim_regs[SIM_ADRS_UCSR0A] &= ~_BV(DOR0);
+  if(sim_uart_rx_count == 0)
+  {
+    sim_regs[SIM_ADRS_UCSR0A] &= ~_BV(RXC0);
+  }
+
+}/* end sim_uart_read() */
+
+/*
+ * sim_uart_write_status()
+ *
+ * A write to UCSR0A, U2X0 and MPCM0 are kept and a 1 clears TXC0.
+ */
+void sim_uart_write_status(uint8_t value)
+{
+  uint8_t ucsra = sim_regs[SIM_ADRS_UCSR0A];
+
+  ucsra = (ucsra & ~(_BV(U2X0) | _BV(MPCM0))) |
+          (value & (_BV(U2X0) | _BV(MPCM0)));
+  if(value & _BV(TXC0))
+  {
+    ucsra &= ~_BV(TXC0);
+  }
+  sim_regs[SIM_ADRS_UCSR0A] = ucsra;
+
+}/* end sim_uart_write_status() */
+
+/*
+ * sim_uart_step()
+ *
+ * Finish the byte being sent and take in the one arriving when their times
+ * are up.
+ */
+void sim_uart_step(void)
+{
+
+  if(sim_uart_shifting && (sim_now >= sim_uart_tx_done))
+  {
+    sim_uart_tx_count++;
+    if(sim_uart_sink)
+    {
+      sim_uart_sink(sim_uart_shift);
+    }
+
+    if(sim_uart_waiting)
+    {
+      sim_uart_waiting = 0;
+      sim_uart_shift = sim_uart_data_reg;
+      sim_uart_tx_done += sim_uart_frame();
+      sim_regs[SIM_ADRS_UCSR0A] |= _BV(UDRE0);
+    }
+    else
+    {
+      sim_uart_shifting = 0;
+      sim_regs[SIM_ADRS_UCSR0A] |= _BV(TXC0);
+    }
+  }
+
+  if((sim_uart_rx_left != 0) && (sim_now >= sim_uart_rx_next))
+  {
+    if(sim_regs[SIM_ADRS_UCSR0B] & _BV(RXEN0))
+    {
+      if(sim_uart_rx_count < 2)
+      {
+        sim_uart_rx_fifo[sim_uart_rx_count++] =
+          sim_uart_rx_queue[sim_uart_rx_tail];
+        sim_regs[SIM_ADRS_UCSR0A] |= _BV(RXC0);
+      }
+      else
+      {
+        sim_regs[SIM_ADRS_UCSR0A] |= _BV(DOR0);
+      }
+    }
+    sim_uart_rx_tail++;
+    sim_uart_rx_left--;
+    sim_uart_rx_next += sim_uart_frame();
+  }
+
+}/* end sim_uart_step() */
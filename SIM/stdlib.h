@@ -0,0 +1,24 @@
+/*
+ * File:    stdlib.h
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * The host <stdlib.h> plus the avr-libc number to string conversions the
+ * drivers use.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#ifndef _SIM_STDLIB_H_
+#define _SIM_STDLIB_H_ 1
+
+#include_next <stdlib.h>
+
+char *itoa(int val, char *s, int radix);
+char *utoa(unsigned int val, char *s, int radix);
+char *ltoa(long val, char *s, int radix);
+char *ultoa(unsigned long val, char *s, int radix);
+
+#endif /* _SIM_STDLIB_H_ */
@@ -0,0 +1,97 @@
+/*
+ * File:    crc16.h
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * <util/crc16.h> for the host simulation, the C versions of avr-libc's
+ * inline assembler CRC updates.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#ifndef _SIM_UTIL_CRC16_H_
+#define _SIM_UTIL_CRC16_H_ 1
+
+#include <stdint.h>
+
+/* Polynomial 0xa001 (x^16 + x^15 + x^2 + 1), reflected. */
+static inline uint16_t _crc16_update(uint16_t crc, uint8_t a)
+{
+  uint8_t i;
+
+  crc ^= a;
+  for(i = 0; i < 8; i++)
+  {
+    if(crc & 1)
+    {
+      crc = (crc >> 1) ^ 0xa001;
+    }
+    else
+    {
+      crc = (crc >> 1);
+    }
+  }
+
+  return(crc);
+
+}/* end _crc16_update() */
+
+/* Polynomial 0x1021 (x^16 + x^12 + x^5 + 1), XMODEM. */
+static inline uint16_t _crc_xmodem_update(uint16_t crc, uint8_t data)
+{
+  uint8_t i;
+
+  crc = crc ^ ((uint16_t)data << 8);
+  for(i = 0; i < 8; i++)
+  {
+    if(crc & 0x8000)
+    {
+      crc = (crc << 1) ^ 0x1021;
+    }
+    else
+    {
+      crc <<= 1;
+    }
+  }
+
+  return(crc);
+
+}/* end _crc_xmodem_update() */
+
+/* Polynomial 0x8408, CCITT reflected. */
+static inline uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data)
+{
+
+  data ^= (uint8_t)crc;
+  data ^= data << 4;
+
+  return((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^
+         ((uint16_t)data << 3));
+
+}/* end _crc_ccitt_update() */
+
+/* Polynomial 0x8c (x^8 + x^5 + x^4 + 1), Dallas iButton. */
+static inline uint8_t _crc_ibutton_update(uint8_t crc, uint8_t data)
+{
+  uint8_t i;
+
+  crc = crc ^ data;
+  for(i = 0; i < 8; i++)
+  {
+    if(crc & 0x01)
+    {
+      crc = (crc >> 1) ^ 0x8c;
+    }
+    else
+    {
+      crc >>= 1;
+    }
+  }
+
+  return(crc);
+
+}/* end _crc_ibutton_update() */
+
+#endif /* _SIM_UTIL_CRC16_H_ */
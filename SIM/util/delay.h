@@ -0,0 +1,31 @@
+/*
+ * File:    delay.h
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * <util/delay.h> for the host simulation, the delays pass simulated time.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#ifndef _SIM_UTIL_DELAY_H_
+#define _SIM_UTIL_DELAY_H_ 1
+
+#include <stdint.h>
+
+#ifndef F_CPU
+#warning "F_CPU not defined for <util/delay.h>"
+#define F_CPU 1000000UL
+#endif
+
+/* Let cycles pass with the CPU busy. */
+void sim_cpu(uint32_t cycles);
+
+#define _delay_us(us) sim_cpu((uint32_t)((double)(us) * (F_CPU / 1000000.0)))
+#define _delay_ms(ms) sim_cpu((uint32_t)((double)(ms) * (F_CPU / 1000.0)))
+#define _delay_loop_1(count) sim_cpu(3UL * ((count) ? (count) : 256))
+#define _delay_loop_2(count) sim_cpu(4UL * ((count) ? (count) : 65536UL))
+
+#endif /* _SIM_UTIL_DELAY_H_ */
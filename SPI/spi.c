@@ -7,13 +7,29 @@
  *
  * Simple drivers for the SPI peripheral.  Used only in SPI Master mode.
  *
+ * spi_transfer() sends one byte and waits for it.  spi_transfer_buffer() sends
+ * a whole buffer, loading each byte the moment the previous one is done so the
+ * bus is kept as busy as possible.  spi_transfer_async() sends a buffer using
+ * the SPI Serial Transfer Complete interrupt and returns straight away, the
+ * chip select is handled and a function is called when it is done.
+ * spi_claim() and spi_release() go around blocking transfers made while
+ * another driver may be using spi_transfer_async().
+ *
  * This file is free software; you can redistribute it and/or modify it under
  * the terms of either the GNU General Public License version 3 or the GNU
  * Lesser General Public License version 3, both as published by the Free
  * Software Foundation.
  */
 #include <avr/io.h>
-#include "spi\spi.h"
+#include <avr/interrupt.h>
+#include "spi/spi.h"
+#include "prof/prof.h"
+#include "prof/trace.h"
+
+/* Local variables for the interrupt driven transfer. */
+SPI_TRANSFER_TYPE * volatile spi_current = 0;/* transfer being run */
+volatile uint16_t spi_index = 0;/* count of bytes transferred */
+volatile uint8_t spi_claimed = 0;/* 1 while spi_claim() has the bus */
 
 /*
  * spi_init()
@@ -149,4 +165,237 @@ void spi_disableInterrupt()
 
 }/* end spi_disableInterrupt() */
 
+/*
+ * spi_transfer_buffer()
+ *
+ * Send len bytes from tx while receiving len bytes into rx.  Either can be 0:
+ * with no tx 0xff is sent, with no rx the received data is thrown away.  This
+ * blocks until the last byte is clocked in.
+ *
+ * The SPI has no transmit buffer, so the next byte is fetched while the current
+ * one is being shifted out and written to SPDR as soon as SPIF is set.  The gap
+ * between bytes is then only the few cycles to read and write SPDR.
+ */
+void spi_transfer_buffer(const uint8_t *tx, uint8_t *rx, uint16_t len)
+{
+  uint16_t i;
+  uint8_t next, in;
+
+  if(len == 0)
+  {
+    return;
+  }
+
+  SPDR = (tx != 0) ? tx[0] : 0xff;
+
+  for(i = 1; i < len; i++)
+  {
+    next = (tx != 0) ? tx[i] : 0xff;
+
+    while ((SPSR & _BV(SPIF)) == 0);/* wait until transmission finishes */
+    in = SPDR;
+    SPDR = next;
+
+    if(rx != 0)
+    {
+      rx[i - 1] = in;
+    }
+  }/* end for(i = 1; i < len; i++) */
+
+  while ((SPSR & _BV(SPIF)) == 0);
+  in = SPDR;
+  if(rx != 0)
+  {
+    rx[len - 1] = in;
+  }
+
+}/* end spi_transfer_buffer() */
+
+/*
+ * spi_cs_low()
+ * spi_cs_high()
+ *
+ * Select and deselect the chip of a transfer, if it has a chip select.
+ */
+void spi_cs_low(SPI_TRANSFER_TYPE *xfer)
+{
+
+  if(xfer->csPort != 0)
+  {
+    *xfer->csPort &= ~xfer->csMask;
+  }
+
+}/* end spi_cs_low() */
+
+void spi_cs_high(SPI_TRANSFER_TYPE *xfer)
+{
+
+  if(xfer->csPort != 0)
+  {
+    *xfer->csPort |= xfer->csMask;
+  }
+
+}/* end spi_cs_high() */
+
+/*
+ * spi_transfer_async()
+ *
+ * Start the transfer described by xfer and return without waiting for it to
+ * finish.  The chip select (if any) is taken low, each byte is handled by the
+ * SPI interrupt, then the chip select is taken high again, status is set to
+ * SPI_DONE and the callback (if not 0) is called from the interrupt.  The
+ * callback can start another transfer.
+ *
+ * Returns SPI_BUSY without doing anything if a transfer is already running or
+ * the bus is claimed, otherwise SPI_DONE.  Global interrupts must be enabled.
+ *
+ * Each byte costs an interrupt, so at the fastest clock rates this takes more
+ * CPU time than spi_transfer_buffer().  It pays off at slower clock rates or
+ * when the CPU has other work to do while the data is sent.
+ */
+uint8_t spi_transfer_async(SPI_TRANSFER_TYPE *xfer)
+{
+  uint8_t sreg = SREG;
+
+  cli();
+
+  if((spi_current != 0) || (spi_claimed != 0))
+  {
+    SREG = sreg;
+    return(SPI_BUSY);
+  }
+
+  if(xfer->len == 0)
+  {
+    SREG = sreg;
+    xfer->status = SPI_DONE;
+    if(xfer->callback != 0)
+    {
+      xfer->callback(xfer);
+    }
+    return(SPI_DONE);
+  }
+
+  spi_current = xfer;
+  spi_index = 0;
+  xfer->status = SPI_BUSY;
+
+  spi_cs_low(xfer);
+  SPCR |= _BV(SPIE);
+  SPDR = (xfer->tx != 0) ? xfer->tx[0] : 0xff;
+
+  SREG = sreg;
+
+  return(SPI_DONE);
+
+}/* end spi_transfer_async() */
+
+/*
+ * spi_busy()
+ *
+ * Return non-zero if an interrupt driven transfer is running.
+ */
+uint8_t spi_busy(void)
+{
+
+  return(spi_current != 0);
+
+}/* end spi_busy() */
+
+/*
+ * spi_claim()
+ * spi_release()
+ *
+ * spi_claim() waits for an interrupt driven transfer to finish, then keeps
+ * spi_transfer_async() off the bus (it returns SPI_BUSY) until spi_release(),
+ * so spi_transfer() and spi_transfer_buffer() can be used without one
+ * starting part way through.  If global interrupts are disabled the transfer
+ * being waited for is stepped from here.
+ */
+void spi_claim(void)
+{
+  uint8_t sreg;
+
+  for(;;)
+  {
+    sreg = SREG;
+    cli();
+    if(spi_current == 0)
+    {
+      spi_claimed = 1;
+      SREG = sreg;
+      break;
+    }
+    SREG = sreg;
+
+    if(((sreg & _BV(SREG_I)) == 0) && (SPSR & _BV(SPIF)))
+    {
+      spi_service();
+    }
+  }/* end for(;;) */
+
+}/* end spi_claim() */
+
+void spi_release(void)
+{
+
+  spi_claimed = 0;
+
+}/* end spi_release() */
+
+/*
+ * spi_service()
+ *
+ * Save the byte received and send the next one.  After the last byte, finish
+ * the transfer.  Called from the SPI interrupt, or from spi_claim() when
+ * global interrupts are disabled.
+ */
+void spi_service(void)
+{
+  SPI_TRANSFER_TYPE *xfer = spi_current;
+  uint16_t i = spi_index;
+  uint8_t in;
+
+  if(xfer == 0)
+  {
+    SPCR &= ~_BV(SPIE);
+    return;
+  }
+
+  TRACE(TRACE_ID_SPI_ISR, i);
+  in = SPDR;
+  if(xfer->rx != 0)
+  {
+    xfer->rx[i] = in;
+  }
+
+  if(++i < xfer->len)
+  {
+    SPDR = (xfer->tx != 0) ? xfer->tx[i] : 0xff;
+    spi_index = i;
+  }
+  else
+  {
+    SPCR &= ~_BV(SPIE);
+    spi_cs_high(xfer);
+    spi_current = 0;
+    xfer->status = SPI_DONE;
+    if(xfer->callback != 0)
+    {
+      xfer->callback(xfer);
+    }
+  }/* end if(++i < xfer->len) */
+
+}/* end spi_service() */
+
+/*
+ * SPI Serial Transfer Complete interrupt
+ */
+ISR(SPI_STC_vect)
+{
+
+  PROF_BEGIN(PROF_ID_SPI_ISR);
+  spi_service();
+  PROF_END(PROF_ID_SPI_ISR);
 
+}/* end ISR(SPI_STC_vect) */
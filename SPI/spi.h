@@ -51,6 +51,35 @@
 #define SPI_DBLSPD_TRUE 1
 #define SPI_DBLSPD_FALSE  0
 
+/* these are returned by spi_transfer_async() and left in the status field of a
+   transfer */
+#define SPI_DONE 0
+#define SPI_BUSY 1
+
+/* Descriptor for an interrupt driven transfer, see spi_transfer_async().  The
+ * descriptor and buffers must stay valid until the transfer has finished.
+ *
+ * tx      : data to send, or 0 to send 0xff
+ * rx      : where to put the data received, or 0 to throw it away
+ * len     : number of bytes to transfer
+ * csPort  : PORT register of the chip select pin (e.g. &PORTB), or 0 if the
+ *           caller handles chip select
+ * csMask  : bit mask of the chip select pin in csPort
+ * callback: called from the interrupt when the transfer has finished, can be 0
+ * status  : SPI_BUSY while the transfer is running, then SPI_DONE
+ */
+typedef struct SPI_TRANSFER
+{
+  const uint8_t *tx;
+  uint8_t *rx;
+  uint16_t len;
+  volatile uint8_t *csPort;
+  uint8_t csMask;
+  void (*callback)(struct SPI_TRANSFER *xfer);
+  volatile uint8_t status;
+
+} SPI_TRANSFER_TYPE;
+
 uint8_t spi_transfer(uint8_t c);
 void spi_enableInterrupt();
 void spi_disableInterrupt();
@@ -59,5 +88,11 @@ void spi_end();
 void spi_bitOrder(uint8_t order);
 void spi_dataMode(uint8_t mode);
 void spi_clockRate(uint8_t rate, uint8_t speed);
+void spi_transfer_buffer(const uint8_t *tx, uint8_t *rx, uint16_t len);
+uint8_t spi_transfer_async(SPI_TRANSFER_TYPE *xfer);
+uint8_t spi_busy(void);
+void spi_claim(void);
+void spi_release(void);
+void spi_service(void);
 
 #endif /* _SPI_H_ */
@@ -0,0 +1,345 @@
+/*
+ * systick.c
+ *
+ * Created: 2026-10-14
+ *  Author: Craig Hollinger
+ *
+ * A 1ms system tick and cooperative scheduler.  The timer runs in CTC mode
+ * with a prescale of 64 (256 above 16.384MHz), so at 16MHz it counts 0 to 249
+ * each ms.  The tick is exact when F_CPU is a multiple of the timer clock's
+ * kHz.  The tick interrupt only counts milliseconds (and calls the hook), the
+ * tasks run from systick_run() with interrupts on.
+ *
+ * The 32-bit ms count can't be read in one instruction on the AVR, the readers
+ * hold off interrupts while they copy it.  systick_micros() adds the timer
+ * count, allowing for a compare match that has happened but not been serviced
+ * yet.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <timer/tc0.h>
+#include <timer/tc2.h>
+#include <timer/systick.h>
+
+/* timer counts per ms, at a prescale of 64 or if that's too many, 256 */
+#if (F_CPU / 64000UL) <= 256
+#define SYSTICK_PRESCALE 64
+#else
+#define SYSTICK_PRESCALE 256
+#endif
+
+#define SYSTICK_COUNTS (F_CPU / (SYSTICK_PRESCALE * 1000UL))
+
+#if SYSTICK_COUNTS > 256 || SYSTICK_COUNTS < 2
+#error "systick needs F_CPU between 128kHz and 65.536MHz"
+#endif
+
+#if SYSTICK_TIMER == 0
+#define SYSTICK_vect  TIMER0_COMPA_vect
+#define SYSTICK_TCNT  TCNT0
+#define SYSTICK_TIFR  TIFR0
+#define SYSTICK_OCF   OCF0A
+#if SYSTICK_PRESCALE == 64
+#define SYSTICK_CLK   TC0_TCCR0B_CLK_PRSC64
+#else
+#define SYSTICK_CLK   TC0_TCCR0B_CLK_PRSC256
+#endif
+#elif SYSTICK_TIMER == 2
+#define SYSTICK_vect  TIMER2_COMPA_vect
+#define SYSTICK_TCNT  TCNT2
+#define SYSTICK_TIFR  TIFR2
+#define SYSTICK_OCF   OCF2A
+#if SYSTICK_PRESCALE == 64
+#define SYSTICK_CLK   TC2_TCCR2B_CLK_PRSC64
+#else
+#define SYSTICK_CLK   TC2_TCCR2B_CLK_PRSC256
+#endif
+#else
+#error "SYSTICK_TIMER must be 0 or 2"
+#endif
+
+volatile uint32_t systickMillis = 0;
+void (*systickHook)(void) = 0;
+
+SYSTICK_TASK_TYPE systickTask[SYSTICK_MAX_TASKS];
+
+/* ISR(SYSTICK_vect)
+ *
+ * Count one ms.
+ */
+ISR(SYSTICK_vect)
+{
+
+  systickMillis++;
+  if(systickHook != 0)
+  {
+    systickHook();
+  }
+
+}/* end ISR(SYSTICK_vect) */
+
+/* systick_init()
+ *
+ * Put the timer in CTC mode and interrupt every ms.
+ */
+void systick_init(void)
+{
+#if SYSTICK_TIMER == 0
+  TIMER_COUNTER0_TYPE timer;
+
+  tc0_get_config(&timer);
+  timer.tccr0a.wgm0l = TC0_TCCR0A_M2_CTC;
+  timer.tccr0a.com0a = TC0_TCCR0A_OC0A_MODE0;
+  timer.tccr0b.wgm0h = 0;
+  timer.tccr0b.cs0 = SYSTICK_CLK;
+  timer.tcnt0 = 0;
+  timer.ocr0a = SYSTICK_COUNTS - 1;
+  timer.timsk0.ocie0a = 1;
+  timer.tifr0.reg = (1<<OCF0A); /* writing 1 clears a pending match */
+  tc0_set_config(&timer);
+#else
+  TIMER_COUNTER2_TYPE timer;
+
+  tc2_get_config(&timer);
+  timer.tccr2a.wgm2l = TC2_TCCR2A_M2_CTC;
+  timer.tccr2a.com2a = TC2_TCCR2A_OC2A_MODE0;
+  timer.tccr2b.wgm2h = 0;
+  timer.tccr2b.cs2 = SYSTICK_CLK;
+  timer.tcnt2 = 0;
+  timer.ocr2a = SYSTICK_COUNTS - 1;
+  timer.timsk2.ocie2a = 1;
+  timer.tifr2.reg = (1<<OCF2A); /* writing 1 clears a pending match */
+  tc2_set_config(&timer);
+#endif
+
+}/* end systick_init() */
+
+/* systick_millis()
+ *
+ * Return the ms since systick_init().
+ */
+uint32_t systick_millis(void)
+{
+  uint8_t sreg;
+  uint32_t ms;
+
+  sreg = SREG;
+  cli();
+  ms = systickMillis;
+  SREG = sreg;
+
+  return(ms);
+
+}/* end systick_millis() */
+
+/* systick_millis16()
+ *
+ * Return the low 16 bits of the ms since systick_init().
+ */
+uint16_t systick_millis16(void)
+{
+  uint8_t sreg;
+  uint16_t ms;
+
+  sreg = SREG;
+  cli();
+  ms = (uint16_t)systickMillis;
+  SREG = sreg;
+
+  return(ms);
+
+}/* end systick_millis16() */
+
+/* systick_micros()
+ *
+ * Return the us since systick_init().  If the timer has just wrapped and the
+ * interrupt hasn't counted it yet, the ms count is one behind.
+ */
+uint32_t systick_micros(void)
+{
+  uint8_t sreg, count;
+  uint32_t ms;
+
+  sreg = SREG;
+  cli();
+  ms = systickMillis;
+  count = SYSTICK_TCNT;
+  if((SYSTICK_TIFR & (1<<SYSTICK_OCF)) && count < (SYSTICK_COUNTS - 1))
+  {
+    ms++;
+  }
+  SREG = sreg;
+
+#if (1000 % SYSTICK_COUNTS) == 0
+  return(ms * 1000 + (uint16_t)count * (1000 / SYSTICK_COUNTS));
+#else
+  return(ms * 1000 + (uint16_t)(((uint32_t)count * 1000) / SYSTICK_COUNTS));
+#endif
+
+}/* end systick_micros() */
+
+/* systick_delay_ms()
+ *
+ * Wait for ms milliseconds.
+ */
+void systick_delay_ms(uint16_t ms)
+{
+  uint16_t start;
+
+  start = systick_millis16();
+  while((uint16_t)(systick_millis16() - start) < ms)
+  {
+  }
+
+}/* end systick_delay_ms() */
+
+/* systick_set_hook()
+ *
+ * Set a function to be called from the tick interrupt.
+ */
+void systick_set_hook(void (*hook)(void))
+{
+  uint8_t sreg;
+
+  sreg = SREG;
+  cli();
+  systickHook = hook;
+  SREG = sreg;
+
+}/* end systick_set_hook() */
+
+/* systick_add_task()
+ *
+ * Put a task in the first free slot.
+ */
+uint8_t systick_add_task(void (*run)(void), uint16_t period, uint16_t budget)
+{
+  uint8_t id;
+
+  if(run == 0 || period == 0 || period > 0x7fff)
+  {
+    return(SYSTICK_NO_TASK);
+  }
+
+  for(id = 0; id < SYSTICK_MAX_TASKS; id++)
+  {
+    if(systickTask[id].run == 0)
+    {
+      systickTask[id].period = period;
+      systickTask[id].due = systick_millis16() + period;
+      systickTask[id].budget = budget;
+      systickTask[id].maxTime = 0;
+      systickTask[id].late = 0;
+      systickTask[id].overruns = 0;
+      systickTask[id].run = run;
+      return(id);
+    }
+  }
+
+  return(SYSTICK_NO_TASK);
+
+}/* end systick_add_task() */
+
+/* systick_remove_task()
+ *
+ * Free a task's slot.
+ */
+void systick_remove_task(uint8_t id)
+{
+
+  if(id < SYSTICK_MAX_TASKS)
+  {
+    systickTask[id].run = 0;
+  }
+
+}/* end systick_remove_task() */
+
+/* systick_get_task()
+ *
+ * Copy a task, then clear its counters.
+ */
+void systick_get_task(uint8_t id, SYSTICK_TASK_TYPE *task)
+{
+
+  if(id >= SYSTICK_MAX_TASKS)
+  {
+    return;
+  }
+
+  *task = systickTask[id];
+  systickTask[id].maxTime = 0;
+  systickTask[id].late = 0;
+  systickTask[id].overruns = 0;
+
+}/* end systick_get_task() */
+
+/* systick_run()
+ *
+ * Run the tasks that are due, in slot order.  A task that is a full period or
+ * more behind skips the runs it missed.
+ */
+uint8_t systick_run(void)
+{
+  uint8_t id, count;
+  uint16_t now, behind;
+  uint32_t start, time;
+  SYSTICK_TASK_TYPE *task;
+
+  count = 0;
+  for(id = 0; id < SYSTICK_MAX_TASKS; id++)
+  {
+    task = &systickTask[id];
+    if(task->run == 0)
+    {
+      continue;
+    }
+
+    now = systick_millis16();
+    behind = now - task->due;
+    if(behind & 0x8000) /* not due yet */
+    {
+      continue;
+    }
+
+    if(behind >= task->period)
+    {
+      if(task->late < 0xff)
+      {
+        task->late++;
+      }
+      task->due = now + task->period;
+    }
+    else
+    {
+      task->due += task->period;
+    }
+
+    start = systick_micros();
+    task->run();
+    time = systick_micros() - start;
+    if(time > 0xffff)
+    {
+      time = 0xffff;
+    }
+
+    if(time > task->maxTime)
+    {
+      task->maxTime = time;
+    }
+    if(task->budget != 0 && time > task->budget && task->overruns < 0xff)
+    {
+      task->overruns++;
+    }
+    count++;
+
+  }/* end for(id = 0; id < SYSTICK_MAX_TASKS; id++) */
+
+  return(count);
+
+}/* end systick_run() */
@@ -0,0 +1,96 @@
+/*
+ * systick.h
+ *
+ * Created: 2026-10-14
+ *  Author: Craig Hollinger
+ *
+ * A 1ms system tick on Timer/Counter 0 or 2 (SYSTICK_TIMER), with millisecond
+ * and microsecond time readers and a small cooperative scheduler.
+ *
+ * Tasks are plain functions run from systick_run() in the main loop, each at
+ * its own period.  A task that is started a full period or more after it was
+ * due has missed a run, it is counted as late and put back on its schedule.
+ * A task that runs longer than its budget is counted as an overrun.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _SYSTICK_H_
+#define _SYSTICK_H_ 1
+
+#include <stdint.h>
+
+/* Timer/Counter used for the tick, 0 or 2. */
+#ifndef SYSTICK_TIMER
+#define SYSTICK_TIMER 0
+#endif
+
+/* Maximum number of scheduled tasks. */
+#ifndef SYSTICK_MAX_TASKS
+#define SYSTICK_MAX_TASKS 8
+#endif
+
+/* systick_add_task() return value when there is no room. */
+#define SYSTICK_NO_TASK 0xff
+
+/* One scheduled task.
+ *
+ * run     : the task function, 0 if the slot is free
+ * period  : ms between runs
+ * due     : low 16 bits of systick_millis() when the next run is due
+ * budget  : longest the task should run for in us, 0 for no limit
+ * maxTime : longest run so far in us
+ * late    : number of runs missed because the task was started too late
+ * overruns: number of runs longer than budget
+ */
+typedef struct
+{
+  void (*run)(void);
+  uint16_t period;
+  uint16_t due;
+  uint16_t budget;
+  uint16_t maxTime;
+  uint8_t late;
+  uint8_t overruns;
+
+} SYSTICK_TASK_TYPE;
+
+/* Start the 1ms tick.  Global interrupts must be enabled for it to count. */
+void systick_init(void);
+
+/* Return the ms since systick_init(), wraps after about 49 days. */
+uint32_t systick_millis(void);
+
+/* Return the low 16 bits of systick_millis(), cheaper for short intervals. */
+uint16_t systick_millis16(void);
+
+/* Return the us since systick_init(), to the resolution of the timer clock,
+   wraps after about 71 minutes. */
+uint32_t systick_micros(void);
+
+/* Wait for ms milliseconds. */
+void systick_delay_ms(uint16_t ms);
+
+/* Set a function to be called from the tick interrupt every ms, 0 for none.
+   Keep it short. */
+void systick_set_hook(void (*hook)(void));
+
+/* Add a task run every period ms (1 to 32767), first run period ms from now,
+   with a run time budget in us (0 for none).  Returns the task id or
+   SYSTICK_NO_TASK. */
+uint8_t systick_add_task(void (*run)(void), uint16_t period, uint16_t budget);
+
+/* Remove a task. */
+void systick_remove_task(uint8_t id);
+
+/* Copy a task's schedule and counters to task, then clear its counters. */
+void systick_get_task(uint8_t id, SYSTICK_TASK_TYPE *task);
+
+/* Run every task that is due.  Call this from the main loop as often as
+   possible.  Returns the number of tasks run. */
+uint8_t systick_run(void);
+
+#endif /* _SYSTICK_H_ */
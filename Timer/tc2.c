@@ -35,8 +35,8 @@ void tc2_get_config(TIMER_COUNTER2_TYPE *timer)
 
 /* tc2_set_config()
  *
- * Write the contents of the Timer_Counter2 structure back to the Timer/Counter
- * 2 registers.
+ * Write the contents of the TIMER_COUNTER2_TYPE structure back to the
+ * Timer/Counter 2 registers.
  */
 void tc2_set_config(TIMER_COUNTER2_TYPE *timer)
 {
@@ -202,13 +202,13 @@ typedef struct {
   TC2_OCR2B_type  ocr2b;
   TC2_TIMSK2_type timsk2;
   TC2_TIFR2_type  tifr2;
-} Timer_Counter2;
+} TIMER_COUNTER2_TYPE;
 
 /* Fill a data structure with the contents of the Timer/Counter 2 registers. */
-void tc2_get_config(Timer_Counter2 *timer);
+void tc2_get_config(TIMER_COUNTER2_TYPE *timer);
 
 /* Write the data structure back to the Timer/Counter 2 registers. */
-void tc2_set_config(Timer_Counter2 *timer);
+void tc2_set_config(TIMER_COUNTER2_TYPE *timer);
 
 /* Write the value to the OCR2A and OCR2B registers.  */
 void tc2_set_ocr2a(uint8_t val);
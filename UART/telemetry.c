@@ -0,0 +1,229 @@
+/*
+ * File:    telemetry.c
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Binary framed telemetry sent out the UART, see telemetry.h for the frame
+ * format.
+ *
+ * COBS (Consistent Overhead Byte Stuffing) replaces each 0x00 byte in the data
+ * with a code byte giving the distance to the next 0x00.  The first code byte
+ * comes before the data it describes, so its value isn't known until the
+ * following 0x00 (or 254 non-zero bytes) has been seen.  The frame is written
+ * into the UART transmit buffer but not committed until telemetry_end(), so the
+ * space for each code byte is left behind and filled in when its value is
+ * known.
+ *
+ * Only one frame can be built at a time, and not from an interrupt while the
+ * main loop might be building one.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
+#include "uart.h"
+#include "telemetry.h"
+
+/* Local variables for the frame being built. */
+uint16_t (*telemetry_tick)(void) = 0;/* supplies the timestamp */
+uint8_t telemetry_seq = 0;/* sequence number of the next frame */
+uint16_t telemetry_crc;/* CRC of the raw frame so far */
+uint8_t telemetry_code_ofs,/* offset in the UART buffer of the code byte */
+        telemetry_ofs,/* offset in the UART buffer of the next byte */
+        telemetry_code,/* value of the code byte so far */
+        telemetry_left = 0,/* payload bytes still expected */
+        telemetry_active = 0;/* 1 while a frame is being built */
+
+/*
+ * telemetry_init()
+ *
+ * Reset the sequence number and set the function that supplies the timestamp
+ * for each frame.  tick can be 0, the timestamp is then always 0.
+ */
+void telemetry_init(uint16_t (*tick)(void))
+{
+
+  telemetry_tick = tick;
+  telemetry_seq = 0;
+  telemetry_left = 0;
+  telemetry_active = 0;
+
+}/* end telemetry_init() */
+
+/*
+ * telemetry_encode()
+ *
+ * Add one raw byte to the frame: update the CRC and COBS encode it into the
+ * UART buffer.
+ */
+void telemetry_encode(uint8_t c)
+{
+
+  telemetry_crc = _crc_xmodem_update(telemetry_crc, c);
+
+  if(c == 0)
+  {
+  /* the zero ends a block, fill in its code byte and leave room for the next */
+    uart_tx_put_at(telemetry_code_ofs, telemetry_code);
+    telemetry_code_ofs = telemetry_ofs++;
+    telemetry_code = 1;
+  }
+  else
+  {
+    uart_tx_put_at(telemetry_ofs++, c);
+
+  /* a block can hold at most 254 bytes */
+    if(++telemetry_code == 0xff)
+    {
+      uart_tx_put_at(telemetry_code_ofs, telemetry_code);
+      telemetry_code_ofs = telemetry_ofs++;
+      telemetry_code = 1;
+    }
+  }/* end if(c == 0) */
+
+}/* end telemetry_encode() */
+
+/*
+ * telemetry_begin()
+ *
+ * Start a frame of the given type that will have len bytes of payload.  If
+ * there isn't room in the UART transmit buffer for the whole frame it is
+ * dropped without waiting: TELEMETRY_BUSY is returned and the sequence number
+ * still counts it, so the receiver can tell a frame is missing.  Returns
+ * TELEMETRY_OK if the frame was started.
+ */
+uint8_t telemetry_begin(uint8_t type, uint8_t len)
+{
+  uint16_t timestamp = 0;
+  uint8_t seq = telemetry_seq++;
+
+  if(len > TELEMETRY_MAX_PAYLOAD)
+  {
+    return(TELEMETRY_TOO_BIG);
+  }
+
+  if(uart_tx_free() < (len + TELEMETRY_OVERHEAD))
+  {
+    return(TELEMETRY_BUSY);
+  }
+
+  if(telemetry_tick != 0)
+  {
+    timestamp = telemetry_tick();
+  }
+
+/* the first code byte goes at the start */
+  telemetry_code_ofs = 0;
+  telemetry_ofs = 1;
+  telemetry_code = 1;
+  telemetry_crc = 0;
+  telemetry_left = len;
+  telemetry_active = 1;
+
+  telemetry_encode(type);
+  telemetry_encode(seq);
+  telemetry_encode((uint8_t)timestamp);
+  telemetry_encode((uint8_t)(timestamp >> 8));
+
+  return(TELEMETRY_OK);
+
+}/* end telemetry_begin() */
+
+/*
+ * telemetry_put()
+ * telemetry_put_data()
+ * telemetry_put_int16()
+ *
+ * Add payload to the frame started by telemetry_begin(): one byte, len bytes
+ * from buf, or one 16-bit value low byte first.  More than the len given to
+ * telemetry_begin() is ignored.
+ */
+void telemetry_put(uint8_t c)
+{
+
+  if(telemetry_left != 0)
+  {
+    telemetry_left--;
+    telemetry_encode(c);
+  }
+
+}/* end telemetry_put() */
+
+void telemetry_put_data(uint8_t len, const uint8_t *buf)
+{
+  uint8_t i;
+
+  for(i = 0; i < len; i++)
+  {
+    telemetry_put(buf[i]);
+  }
+
+}/* end telemetry_put_data() */
+
+void telemetry_put_int16(int16_t val)
+{
+
+  telemetry_put((uint8_t)val);
+  telemetry_put((uint8_t)((uint16_t)val >> 8));
+
+}/* end telemetry_put_int16() */
+
+/*
+ * telemetry_end()
+ *
+ * Add the CRC and frame delimiter and hand the frame to the UART to be sent.
+ * If less payload was given than promised the rest is padded with 0.  Does
+ * nothing if the frame was dropped by telemetry_begin().
+ */
+void telemetry_end(void)
+{
+  uint16_t crc;
+
+  if(telemetry_active == 0)
+  {
+    return;
+  }
+  telemetry_active = 0;
+
+  while(telemetry_left != 0)
+  {
+    telemetry_put(0);
+  }
+
+  crc = telemetry_crc;
+  telemetry_encode((uint8_t)crc);
+  telemetry_encode((uint8_t)(crc >> 8));
+
+/* close the last block and mark the end of the frame */
+  uart_tx_put_at(telemetry_code_ofs, telemetry_code);
+  uart_tx_put_at(telemetry_ofs++, 0);
+
+  uart_tx_commit(telemetry_ofs);
+
+}/* end telemetry_end() */
+
+/*
+ * telemetry_send()
+ *
+ * Send a frame with len bytes of payload from buf.  Returns the same codes as
+ * telemetry_begin().
+ */
+uint8_t telemetry_send(uint8_t type, uint8_t len, const uint8_t *buf)
+{
+  uint8_t err;
+
+  err = telemetry_begin(type, len);
+  if(err == TELEMETRY_OK)
+  {
+    telemetry_put_data(len, buf);
+    telemetry_end();
+  }
+
+  return(err);
+
+}/* end telemetry_send() */
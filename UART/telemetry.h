@@ -0,0 +1,98 @@
+/*
+ * File:    telemetry.h
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Binary framed telemetry sent out the UART.
+ *
+ * Each frame is the raw data below, COBS encoded so that it contains no 0x00
+ * bytes, followed by a single 0x00 byte to mark the end of the frame:
+ *
+ *   byte | contents
+ *   ---------------------------------------------------------------
+ *     0  | frame type, chosen by the caller
+ *     1  | sequence number, counts every frame including dropped ones
+ *    2-3 | timestamp from the tick function, low byte first
+ *    4-  | payload, up to TELEMETRY_MAX_PAYLOAD bytes
+ *   last | CRC-16 (XMODEM, polynomial 0x1021, start 0) of all bytes
+ *    2   | above, low byte first
+ *
+ * The frame is encoded directly into the UART transmit buffer as it is built,
+ * there is no intermediate buffer.  A frame is built with telemetry_begin(),
+ * any number of telemetry_put() calls, then telemetry_end().
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_ 1
+
+#include <stdint.h>
+
+/* Largest payload in one frame.  The whole encoded frame must fit in the UART
+   transmit buffer, so this must be no more than UART_TX_BUFFER_LENGTH - 10. */
+#ifndef TELEMETRY_MAX_PAYLOAD
+#define TELEMETRY_MAX_PAYLOAD 48
+#endif
+
+/* Bytes added to the payload: 4 header, 2 CRC, 2 COBS overhead and the frame
+   delimiter. */
+#define TELEMETRY_OVERHEAD 9
+
+/* these are returned by telemetry_begin() and telemetry_send() */
+#define TELEMETRY_OK     0
+#define TELEMETRY_BUSY   1 /* not enough room in the UART buffer, frame dropped */
+#define TELEMETRY_TOO_BIG 2 /* payload longer than TELEMETRY_MAX_PAYLOAD */
+
+/*
+ * telemetry_init()
+ *
+ * Reset the sequence number and set the function that supplies the timestamp
+ * for each frame.  tick can be 0, the timestamp is then always 0.
+ */
+void telemetry_init(uint16_t (*tick)(void));
+
+/*
+ * telemetry_begin()
+ *
+ * Start a frame of the given type that will have len bytes of payload.  If
+ * there isn't room in the UART transmit buffer for the whole frame it is
+ * dropped without waiting: TELEMETRY_BUSY is returned and the sequence number
+ * still counts it, so the receiver can tell a frame is missing.  Returns
+ * TELEMETRY_OK if the frame was started.
+ */
+uint8_t telemetry_begin(uint8_t type, uint8_t len);
+
+/*
+ * telemetry_put()
+ * telemetry_put_data()
+ * telemetry_put_int16()
+ *
+ * Add payload to the frame started by telemetry_begin(): one byte, len bytes
+ * from buf, or one 16-bit value low byte first.  More than the len given to
+ * telemetry_begin() is ignored.
+ */
+void telemetry_put(uint8_t c);
+void telemetry_put_data(uint8_t len, const uint8_t *buf);
+void telemetry_put_int16(int16_t val);
+
+/*
+ * telemetry_end()
+ *
+ * Add the CRC and frame delimiter and hand the frame to the UART to be sent.
+ * If less payload was given than promised the rest is padded with 0.  Does
+ * nothing if the frame was dropped by telemetry_begin().
+ */
+void telemetry_end(void);
+
+/*
+ * telemetry_send()
+ *
+ * Send a frame with len bytes of payload from buf.  Returns the same codes as
+ * telemetry_begin().
+ */
+uint8_t telemetry_send(uint8_t type, uint8_t len, const uint8_t *buf);
+
+#endif /* _TELEMETRY_H_ */
@@ -15,7 +15,22 @@
  * driven functions would be more efficient, but with added complexity. 
  *
  * There are now two interrupt driven transmit routines that store the string
- * locally and send it to the UART via an interrupt.
+ * locally and send it to the UART via an interrupt.  They accept as much as
+ * fits in the UART_TX_BUFFER_LENGTH byte buffer and return the count, so long
+ * messages can be streamed a piece at a time without blocking.
+ *
+ * Large or fixed buffers can be sent with uart_send() instead, the interrupt
+ * sends them straight from the caller's RAM or FLASH without copying.
+ *
+ * Received characters are stored by the USART RX Complete interrupt in a ring
+ * buffer of UART_RX_BUFFER_LENGTH bytes, so nothing is lost while the main loop
+ * is busy elsewhere.  uart_read() and uart_rx_count() take them out without
+ * blocking, uart_getchar() still waits for one.  If the receive interrupt is
+ * disabled with uart_rx_DI() the old polled behaviour is used instead.
+ *
+ * This file drives USART0 with the uart_ functions.  On parts with a second
+ * USART, uart1.c builds it again for USART1 with uart1_ functions, see
+ * UART_INSTANCE below.
  *
  * This file is free software; you can redistribute it and/or modify
  * it under the terms of either the GNU General Public License version 3
@@ -27,9 +42,44 @@
 #include <avr/pgmspace.h> /* store/retrieve data in FLASH */
 #include <avr/interrupt.h>
 #include "uart.h"
+#include "prof/prof.h"
+#include "prof/trace.h"
+
+/* The USART driven by this file, 0 unless it is built from uart1.c.  The
+   register and vector names are made from it, the bits are in the same places
+   in each USART so the USART0 bit names are used for all of them.  They are
+   all constants, nothing is looked up through a pointer at run time. */
+#ifndef UART_INSTANCE
+#define UART_INSTANCE 0
+#endif
 
-/* length of transmit buffer */
-#define TX_BUFFER_LENGTH 16
+#define UART_CAT(a, n, b) a##n##b
+#define UART_REG(a, n, b) UART_CAT(a, n, b)
+
+#define UART_UDR   UART_REG(UDR, UART_INSTANCE, )
+#define UART_UCSRA UART_REG(UCSR, UART_INSTANCE, A)
+#define UART_UCSRB UART_REG(UCSR, UART_INSTANCE, B)
+#define UART_UCSRC UART_REG(UCSR, UART_INSTANCE, C)
+#define UART_UBRRH UART_REG(UBRR, UART_INSTANCE, H)
+#define UART_UBRRL UART_REG(UBRR, UART_INSTANCE, L)
+
+/* The ATmega328 has one USART and its vectors have no number. */
+#if (UART_INSTANCE == 0) && defined(USART_RX_vect)
+#define UART_RX_vect   USART_RX_vect
+#define UART_UDRE_vect USART_UDRE_vect
+#else
+#define UART_RX_vect   UART_REG(USART, UART_INSTANCE, _RX_vect)
+#define UART_UDRE_vect UART_REG(USART, UART_INSTANCE, _UDRE_vect)
+#endif
+
+/* Mask for the transmit buffer indices, UART_TX_BUFFER_LENGTH is a power of 2. */
+#define TX_BUFFER_MASK (UART_TX_BUFFER_LENGTH - 1)
+
+/* Mask for the descriptor queue indices, UART_TX_QUEUE_LENGTH is a power of 2. */
+#define TX_QUEUE_MASK (UART_TX_QUEUE_LENGTH - 1)
+
+/* Mask for the receive buffer indices, UART_RX_BUFFER_LENGTH is a power of 2. */
+#define RX_BUFFER_MASK (UART_RX_BUFFER_LENGTH - 1)
 
 /* Local storage for USART Status */
 volatile union USART
@@ -43,22 +93,44 @@ volatile union USART
     unsigned OVERRUN_ERROR:1;
     unsigned PARITY_ERROR:1;
     unsigned TX_IN_PROGRESS:1;
-    unsigned :2;
+    unsigned RX_BUFFER_OVERFLOW:1;
+    unsigned :1;
   };
 }usart_status;
 
-/* Local variables for interrupt driven UART transmit */
-volatile uint8_t uart_buffer[TX_BUFFER_LENGTH];/* storage during transmission */
-volatile uint8_t tx_count = 0,/* count of bytes transmitted */
-                 tx_length = 0;/* number of bytes to be transmitted */
-volatile uint8_t *buf_head = uart_buffer,/* pointer to start of data in buffer */
-                 *buf_tail = uart_buffer;/* pointer to end of data in buffer */
+/* Local variables for interrupt driven UART receive.  The indices are free
+   running, the number of bytes in the buffer is rx_head - rx_tail. */
+volatile uint8_t rx_buffer[UART_RX_BUFFER_LENGTH];/* received data */
+volatile uint8_t rx_head = 0,/* where the next received byte is put */
+                 rx_tail = 0;/* where the next byte is read from */
+
+/* Count of receive errors since the last uart_get_rx_errors(). */
+volatile UART_RX_ERRORS_TYPE rx_errors;
+
+/* Local variables for interrupt driven UART transmit.  The indices are free
+   running, the number of bytes waiting to be sent is tx_head - tx_tail. */
+volatile uint8_t tx_buffer[UART_TX_BUFFER_LENGTH];/* storage during transmission */
+volatile uint8_t tx_head = 0,/* where the next byte to send is put */
+                 tx_tail = 0;/* where the interrupt takes the next byte from */
+
+/* Queue of caller owned buffers waiting to be sent by uart_send().  Each one
+   has a mark, the value of tx_head when it was queued, it is sent when tx_tail
+   gets there. */
+UART_TX_DESC_TYPE * volatile tx_desc[UART_TX_QUEUE_LENGTH];
+volatile uint8_t tx_desc_mark[UART_TX_QUEUE_LENGTH];
+volatile uint8_t tx_desc_head = 0,/* where the next descriptor is put */
+                 tx_desc_tail = 0;/* descriptor being sent */
+volatile uint16_t tx_desc_index = 0;/* next byte of the descriptor being sent */
 
 /*
  * uart_init()
  *
  * Initialize the UART using the given bit (BAUD) rate, character size, parity
  * and number of stop bits.
+ *
+ * The baud rate register is worked out here with 32-bit divisions, when the
+ * rate is a constant uart_init_ubrr(UART_UBRR(rate), ...) does it at compile
+ * time instead.
  */
 void uart_init(uint32_t rate,    /* bit rate in bits per second (BAUD) */
                uint8_t size,   /* frame size, can be 5, 6, 7, 8, or 9 bits */
@@ -66,44 +138,68 @@ void uart_init(uint32_t rate,    /* bit rate in bits per second (BAUD) */
                uint8_t stop)   /* number of stop bits, can be 1 or 2 */
 {
 
-  /* Temporary variable for Baud Rate Register. */
-  uint32_t ubrr;
+  uart_init_ubrr(UART_UBRR(rate), size, parity, stop);
+
+}/* end uart_init() */
 
-  /* clear the local error status */
+/*
+ * uart_init_ubrr()
+ *
+ * Initialize the UART the same as uart_init() with ubrr in the baud rate
+ * register, see UART_UBRR().
+ */
+void uart_init_ubrr(uint16_t ubrr, /* baud rate register value */
+                    uint8_t size,  /* frame size, can be 5, 6, 7, 8, or 9 bits */
+                    uint8_t parity,/* parity, can be none, odd or even */
+                    uint8_t stop)  /* number of stop bits, can be 1 or 2 */
+{
+
+  /* clear the local error status and the receive buffer */
   usart_status.val = 0;
+  rx_head = 0;
+  rx_tail = 0;
+  rx_errors.frame = 0;
+  rx_errors.overrun = 0;
+  rx_errors.parity = 0;
+  rx_errors.overflow = 0;
+  tx_head = 0;
+  tx_tail = 0;
+  tx_desc_head = 0;
+  tx_desc_tail = 0;
+  tx_desc_index = 0;
   
   /* Set the USART mode.  In this case it is asynchronous only. */
-  UCSR0C &= ~_BV(UMSEL00) & ~_BV(UMSEL01);
+  UART_UCSRC &= ~_BV(UMSEL00) & ~_BV(UMSEL01);
 
   /* Set the character size mode. */
   switch(size)
   {
     case USART_CHAR_SZ_FIVE: /* 5-bit */
-      UCSR0C &= ~_BV(UCSZ00) & ~_BV(UCSZ01);
-      UCSR0B &= ~_BV(UCSZ02);
+      UART_UCSRC &= ~_BV(UCSZ00) & ~_BV(UCSZ01);
+      UART_UCSRB &= ~_BV(UCSZ02);
       break;
 
     case USART_CHAR_SZ_SIX: /* 6-bit */
-      UCSR0C |= _BV(UCSZ00);
-      UCSR0C &= ~_BV(UCSZ01);
-      UCSR0B &= ~_BV(UCSZ02);
+      UART_UCSRC |= _BV(UCSZ00);
+      UART_UCSRC &= ~_BV(UCSZ01);
+      UART_UCSRB &= ~_BV(UCSZ02);
       break;
 
     case USART_CHAR_SZ_SEVEN: /* 7-bit */
-      UCSR0C &= ~_BV(UCSZ00);
-      UCSR0C |= _BV(UCSZ01);
-      UCSR0B &= ~_BV(UCSZ02);
+      UART_UCSRC &= ~_BV(UCSZ00);
+      UART_UCSRC |= _BV(UCSZ01);
+      UART_UCSRB &= ~_BV(UCSZ02);
       break;
 
     case USART_CHAR_SZ_EIGHT: /* 8-bit */
     default:
-      UCSR0C |= _BV(UCSZ00) | _BV(UCSZ01);
-      UCSR0B &= ~_BV(UCSZ02);
+      UART_UCSRC |= _BV(UCSZ00) | _BV(UCSZ01);
+      UART_UCSRB &= ~_BV(UCSZ02);
       break;
 
     case USART_CHAR_SZ_NINE: /* 9-bit */
-      UCSR0C |= _BV(UCSZ00) | _BV(UCSZ01);
-      UCSR0B |= _BV(UCSZ02);
+      UART_UCSRC |= _BV(UCSZ00) | _BV(UCSZ01);
+      UART_UCSRB |= _BV(UCSZ02);
       break;
   }/* end switch(size) */
 
@@ -112,16 +208,16 @@ void uart_init(uint32_t rate,    /* bit rate in bits per second (BAUD) */
   {
     case USART_PARITY_NONE: /* no parity */
     default:
-      UCSR0C &= ~_BV(UPM00) & ~_BV(UPM01);
+      UART_UCSRC &= ~_BV(UPM00) & ~_BV(UPM01);
       break;
 
     case USART_PARITY_EVEN: /* even parity */
-      UCSR0C &= ~_BV(UPM00);
-      UCSR0C |= _BV(UPM01);
+      UART_UCSRC &= ~_BV(UPM00);
+      UART_UCSRC |= _BV(UPM01);
       break;
 
     case USART_PARITY_ODD: /* odd parity */
-      UCSR0C |= _BV(UPM00) | _BV(UPM01);
+      UART_UCSRC |= _BV(UPM00) | _BV(UPM01);
       break;
 
   }/* end switch(parity) */
@@ -129,34 +225,29 @@ void uart_init(uint32_t rate,    /* bit rate in bits per second (BAUD) */
   /* Set the number of stop bits. */
   if(stop == USART_STOP_BIT_ONE)
   {
-    UCSR0C &= ~_BV(USBS0); /* one stop bit */
+    UART_UCSRC &= ~_BV(USBS0); /* one stop bit */
   }
   else
   {
-    UCSR0C |= _BV(USBS0); /* two Stop bits */
+    UART_UCSRC |= _BV(USBS0); /* two Stop bits */
 
   }/* end if(stop == USART_STOP_BIT_ONE) */
   
-  /* Set up the BAUD rate generator.  The additional calculation of F_CPU + ()
-     is to account for rounding. */
+  /* Set up the BAUD rate generator, UART_UBRR() allows for the 2x clock at low
+     CPU clock frequencies. */
+  UART_UBRRH = (uint8_t)(ubrr >> 8);
+  UART_UBRRL = (uint8_t)ubrr;
 #if F_CPU < 2000000UL && defined(U2X0)/* low CPU clock frequency */
-//  ubrr = (F_CPU / (8UL * rate)) - 1;
-  ubrr = ((F_CPU + (4UL * rate)) / (8UL * rate)) - 1;
-  UBRR0H = (uint8_t)(ubrr >> 8);
-  UBRR0L = (uint8_t)ubrr;
-  UCSR0A |= _BV(U2X0);             /* improve baud rate error by using 2x clk */
+  UART_UCSRA |= _BV(U2X0);             /* improve baud rate error by using 2x clk */
 #else
-//  ubrr = (F_CPU / (16UL * rate)) - 1;
-  ubrr = ((F_CPU + (8UL * rate)) / (16UL * rate)) - 1;
-  UBRR0H = (uint8_t)(ubrr >> 8);
-  UBRR0L = (uint8_t)ubrr;
-  UCSR0A &= ~_BV(U2X0);
+  UART_UCSRA &= ~_BV(U2X0);
 #endif
 
-  /* Enable the UART transmit and receive functions. */
-  UCSR0B |= (_BV(TXEN0) | _BV(RXEN0)); /* tx/rx enable */
+  /* Enable the UART transmit and receive functions and the receive
+     interrupt. */
+  UART_UCSRB |= (_BV(TXEN0) | _BV(RXEN0) | _BV(RXCIE0)); /* tx/rx enable */
   
-}/* end uart_init() */
+}/* end uart_init_ubrr() */
 
 /*
  * uart_putchar()
@@ -170,18 +261,140 @@ void uart_putchar(char c)
 {
 
 /* wait until the TX register is empty */
-  while(!(UCSR0A & _BV(UDRE0)));
+  while(!(UART_UCSRA & _BV(UDRE0)));
 
-  UDR0 = c;
+  UART_UDR = c;
 
 }/* end uart_putchar() */
 
+/*
+ * uart_rx_service()
+ *
+ * Take the received character from the UART and put it in the receive buffer.
+ * Errors are flagged in usart_status and counted in rx_errors.  A character
+ * with a frame or parity error is thrown away, as is one that arrives when the
+ * buffer is full.  Only the low 8 bits of a 9-bit character are kept.
+ */
+void uart_rx_service(void)
+{
+  uint8_t stat, c;
+
+/* the error flags must be read before UDR0 */
+  stat = UART_UCSRA;
+  if(UART_UCSRB & _BV(RXB80))
+  {
+    usart_status.RX_NINE = 1;
+  }
+  c = UART_UDR;
+
+  if(stat & _BV(DOR0))
+  {
+    usart_status.OVERRUN_ERROR = 1;
+    rx_errors.overrun++;
+  }
+  if(stat & _BV(FE0))
+  {
+    usart_status.FRAME_ERROR = 1;
+    rx_errors.frame++;
+    return;
+  }
+  if(stat & _BV(UPE0))
+  {
+    usart_status.PARITY_ERROR = 1;
+    rx_errors.parity++;
+    return;
+  }
+
+  if((uint8_t)(rx_head - rx_tail) >= UART_RX_BUFFER_LENGTH)
+  {
+    usart_status.RX_BUFFER_OVERFLOW = 1;
+    rx_errors.overflow++;
+    return;
+  }
+
+  rx_buffer[rx_head & RX_BUFFER_MASK] = c;
+  rx_head++;
+
+}/* end uart_rx_service() */
+
+/*
+ * USART RX Complete interrupt
+ *
+ * A character has been received, put it in the receive buffer.
+ */
+ISR(UART_RX_vect)
+{
+
+  uart_rx_service();
+
+}/* end ISR(UART_RX_vect) */
+
+/*
+ * uart_rx_count()
+ *
+ * Return the number of characters waiting in the receive buffer.
+ */
+uint8_t uart_rx_count(void)
+{
+
+  return(rx_head - rx_tail);
+
+}/* end uart_rx_count() */
+
+/*
+ * uart_read()
+ *
+ * Copy up to length characters from the receive buffer to buf.  This doesn't
+ * wait, it returns the number of characters copied which can be 0.
+ */
+uint8_t uart_read(uint8_t length, char buf[])
+{
+  uint8_t i, count;
+
+  count = rx_head - rx_tail;
+  if(length > count)
+  {
+    length = count;
+  }
+
+  for(i = 0; i < length; i++)
+  {
+    buf[i] = rx_buffer[rx_tail & RX_BUFFER_MASK];
+    rx_tail++;
+  }
+
+  return(length);
+
+}/* end uart_read() */
+
+/*
+ * uart_get_rx_errors()
+ *
+ * Copy the receive error counts to err then clear them.
+ */
+void uart_get_rx_errors(UART_RX_ERRORS_TYPE *err)
+{
+  uint8_t sreg = SREG;
+
+  cli();
+  *err = rx_errors;
+  rx_errors.frame = 0;
+  rx_errors.overrun = 0;
+  rx_errors.parity = 0;
+  rx_errors.overflow = 0;
+  SREG = sreg;
+
+}/* end uart_get_rx_errors() */
+
 /*
  * uart_getchar()
  *
  * Receive a character from the UART Rx.  If any errors are detected, set the
  * appropriate bits in usart_status.
  *
+ * If the receive interrupt is enabled the character is taken from the receive
+ * buffer, otherwise from the UART directly.
+ *
  * Note:
  * This function will block until a character is received, indefinitely if none
  * are received.  Best to call uart_available() first to make sure a character
@@ -189,28 +402,46 @@ void uart_putchar(char c)
  */
 char uart_getchar(void)
 {
+  char c;
+
+  if(UART_UCSRB & _BV(RXCIE0))
+  {
+  /* loop until the receive buffer has something in it, if interrupts are off
+     service the UART from here */
+    while(rx_head == rx_tail)
+    {
+      if(((SREG & _BV(SREG_I)) == 0) && (UART_UCSRA & _BV(RXC0)))
+      {
+        uart_rx_service();
+      }
+    }
+    c = rx_buffer[rx_tail & RX_BUFFER_MASK];
+    rx_tail++;
+    return(c);
+
+  }/* end if(UART_UCSRB & _BV(RXCIE0)) */
 
 /* loop until receive register is full */
-  while(!(UCSR0A & _BV(RXC0)));
+  while(!(UART_UCSRA & _BV(RXC0)));
 
 /* test for errors and update the status register */
-	if(UCSR0A & _BV(FE0))
+  if(UART_UCSRA & _BV(FE0))
   {
-	  usart_status.FRAME_ERROR = 1;
+    usart_status.FRAME_ERROR = 1;
   }
-	if(UCSR0A & _BV(DOR0))
+  if(UART_UCSRA & _BV(DOR0))
   {
-	  usart_status.OVERRUN_ERROR = 1;
+    usart_status.OVERRUN_ERROR = 1;
   }
-	if(UCSR0A & _BV(UPE0))
+  if(UART_UCSRA & _BV(UPE0))
   {
-  	usart_status.PARITY_ERROR = 1;
-	}
-  if(UCSR0B & _BV(RXB80))
+    usart_status.PARITY_ERROR = 1;
+  }
+  if(UART_UCSRB & _BV(RXB80))
   {
     usart_status.RX_NINE = 1;
   }
-  return(UDR0);
+  return(UART_UDR);
   
 }/* end uart_getchar() */
 
@@ -226,8 +457,8 @@ void uart_putstr_P(PGM_P addr)
   while((c = pgm_read_byte_near(addr++)))
   {
     /* loop until the TX register is empty */
-    while(!(UCSR0A & _BV(UDRE0)));
-    UDR0 = c;
+    while(!(UART_UCSRA & _BV(UDRE0)));
+    UART_UDR = c;
 
   }/* end while((c = pgm_read_byte_near(addr++))) */
 
@@ -246,8 +477,8 @@ void uart_putstr(char str[])
   while((c = str[i++]) != 0)
   {
     /* loop until the TX register is empty */
-    while(!(UCSR0A & _BV(UDRE0)));
-    UDR0 = c;
+    while(!(UART_UCSRA & _BV(UDRE0)));
+    UART_UDR = c;
 
   }/* end  while((c = str[i++]) != 0) */
     
@@ -261,22 +492,25 @@ void uart_putstr(char str[])
 void uart_put_UDR0(char c)
 {
   
-  UDR0 = c;
+  UART_UDR = c;
 
 }/* end uart_put_UDR0() */
 
 /*
  * uart_get_status()
  *
- * Clear usart_status then return it's value.
+ * Clear usart_status then return it's value.  Interrupts are off so a flag set
+ * by the interrupts in between isn't lost.
  */
 uint8_t uart_get_status(void)
 {
 
-  uint8_t c;
+  uint8_t c, sreg = SREG;
   
+  cli();
   c = usart_status.val;
   usart_status.val = 0;
+  SREG = sreg;
   
   return(c);
 
@@ -290,26 +524,39 @@ uint8_t uart_get_status(void)
  * but not read and there are no errors, return the available code.
  *
  * If there are no errors and no character has been received, return 0.
+ *
+ * If the receive interrupt is enabled, errors are picked up by the interrupt
+ * and are only reported by uart_get_status() and uart_get_rx_errors().  This
+ * then returns the available code if the receive buffer isn't empty.
  */
 uint8_t uart_available(void)
 {
-  
-  if(UCSR0A & _BV(FE0))
+
+  if(UART_UCSRB & _BV(RXCIE0))
+  {
+    if(rx_head != rx_tail)
+    {
+      return(UART_AVAILABLE);
+    }
+    return(0);
+  }
+
+  if(UART_UCSRA & _BV(FE0))
   {
     usart_status.FRAME_ERROR = 1;
     return(UART_FRAME_ERROR);
   }
-  if(UCSR0A & _BV(DOR0))
+  if(UART_UCSRA & _BV(DOR0))
   {
     usart_status.OVERRUN_ERROR = 1;
     return(UART_OVERRUN_ERROR);
   }
-  if(UCSR0A & _BV(UPE0))
+  if(UART_UCSRA & _BV(UPE0))
   {
     usart_status.PARITY_ERROR = 1;
     return(UART_PARITY_ERROR);
   }
-  if(UCSR0A & _BV(RXC0))
+  if(UART_UCSRA & _BV(RXC0))
   {
     return(UART_AVAILABLE);
   }
@@ -329,25 +576,25 @@ uint8_t uart_available(void)
 void uart_rx_EI(void)
 {
 
-  UCSR0B |= _BV(RXCIE0);
+  UART_UCSRB |= _BV(RXCIE0);
 }
 
 void uart_rx_DI(void)
 {
 
-  UCSR0B &= ~_BV(RXCIE0);
+  UART_UCSRB &= ~_BV(RXCIE0);
 }
 
 void uart_tx_EI(void)
 {
 
-  UCSR0B |= _BV(TXCIE0);
+  UART_UCSRB |= _BV(TXCIE0);
 }
 
 void uart_tx_DI(void)
 {
 
-  UCSR0B &= ~_BV(TXCIE0);
+  UART_UCSRB &= ~_BV(TXCIE0);
 }
 
 /*
@@ -359,7 +606,7 @@ void uart_tx_DI(void)
 uint8_t get_uart_rx_IE(void)
 {
   
-  if((UCSR0B & _BV(RXCIE0)) == 0)
+  if((UART_UCSRB & _BV(RXCIE0)) == 0)
   {
     return(0);
   }    
@@ -372,7 +619,7 @@ uint8_t get_uart_rx_IE(void)
 uint8_t get_uart_tx_IE(void)
 {
   
-  if((UCSR0B & _BV(TXCIE0)) == 0)
+  if((UART_UCSRB & _BV(TXCIE0)) == 0)
   {
     return(0);
   }    
@@ -392,7 +639,7 @@ uint8_t get_uart_tx_IE(void)
 uint8_t uart_tx_status(void)
 {
   
-  if((UCSR0A & _BV(UDRE0)) == 1)
+  if((UART_UCSRA & _BV(UDRE0)) != 0)
   {
     return(1);
   }    
@@ -404,200 +651,266 @@ uint8_t uart_tx_status(void)
 }/* end uart_tx_status() */
 
 /*
- * uart_write(), uart_write_P()
+ * uart_tx_start()
  *
- * Send the data contained in the array buf out the UART serial port using an
- * interrupt driven process.  This uses a circular buffer with two pointers:
- * head and tail.  The data to be sent out the serial port fits between head and
- * tail.  The new data starts going into the buffer starting at tail.  Head
- * points to the data to be sent to the UART.  Head and tail are allowed to wrap
- * around the end of the buffer.
+ * Enable the UART transmit buffer empty interrupt to send what is in the
+ * transmit buffer.  If it's already running this does no harm.
  *
- * uart_write() has the data to write in RAM, uart_write_P() has the data in 
- * FLASH.
+ * The interrupt changes both usart_status and UCSR0B, so they are updated here
+ * with interrupts off.
+ */
+void uart_tx_start(void)
+{
+  uint8_t sreg = SREG;
+
+  cli();
+  usart_status.TX_IN_PROGRESS = 1;
+  UART_UCSRB |= _BV(UDRIE0);
+  SREG = sreg;
+
+}/* end uart_tx_start() */
+
+/*
+ * uart_tx_free()
  *
- * This is the process:
+ * Return the number of bytes that can be added to the transmit buffer.
+ */
+uint8_t uart_tx_free(void)
+{
+
+  return((UART_TX_BUFFER_LENGTH - 1) - (uint8_t)(tx_head - tx_tail));
+
+}/* end uart_tx_free() */
+
+/*
+ * uart_tx_put_at()
+ * uart_tx_commit()
  *
- * - copy the data from the input parameter buf to a local buffer
- * - write the first byte to the UART transmit buffer
- * - enable the UART transmit buffer empty interrupt
+ * Build data in place in the transmit buffer.  uart_tx_put_at() stores c at
+ * offset bytes past the end of the data already waiting to be sent, it isn't
+ * sent yet and can be overwritten.  uart_tx_commit() then hands the first
+ * length of those bytes to the interrupt to be sent.
  *
- * If the input data is longer than the local buffer, return the length of the
- * input buffer without starting the process.  Otherwise, return 0.
+ * The caller must check uart_tx_free() first, offset and length must be less
+ * than what it returned.  Only one piece of code can be building data at a
+ * time and uart_write() must not be used until it is committed.
  */
-uint8_t uart_write(uint8_t length, char buf[])
+void uart_tx_put_at(uint8_t offset, uint8_t c)
 {
-  uint8_t i;
 
-  /* if new data is zero or won't fit in the buffer, exit */
-  if((length == 0) || (length > TX_BUFFER_LENGTH))
+  tx_buffer[(uint8_t)(tx_head + offset) & TX_BUFFER_MASK] = c;
+
+}/* end uart_tx_put_at() */
+
+void uart_tx_commit(uint8_t length)
+{
+
+  if(length != 0)
   {
-    return(255);
+    tx_head += length;
+    uart_tx_start();
   }
 
-  /* Determine if remaining space in the buffer can accommodate the new data.
-     How this is done depends on where the head and tail pointers are pointing.
+}/* end uart_tx_commit() */
 
-     existing data hasn't wrapped around end of buffer */
-  if(buf_tail > buf_head)
+/*
+ * uart_write(), uart_write_P()
+ *
+ * Send the data contained in the array buf out the UART serial port using an
+ * interrupt driven process.  The data is copied to a circular buffer of
+ * UART_TX_BUFFER_LENGTH bytes and the USART Data Register Empty interrupt sends
+ * it from there.  The buffer is indexed by two free running 8-bit counters:
+ * head is where new data goes in, tail is where the interrupt takes data out.
+ * Because the length is a power of 2 the counters only need masking to index
+ * the buffer, and head - tail is always the number of bytes in it.
+ *
+ * uart_write() has the data to write in RAM, uart_write_P() has the data in 
+ * FLASH.
+ *
+ * As much of the data as will fit in the buffer is accepted and the number of
+ * bytes accepted is returned, 0 if the buffer is full.  The caller can send the
+ * rest later starting at buf + the returned count.  These never wait.
+ */
+uint8_t uart_write(uint8_t length, char buf[])
+{
+  uint8_t i, head, free;
+
+  /* accept as much as will fit */
+  free = uart_tx_free();
+  if(length > free)
   {
-    if(length > (TX_BUFFER_LENGTH - (buf_tail - buf_head)))
-    {
-      /* too much data, exit with non-zero */
-      return(length);
-    }
-  }/* end if(buf_tail > buf_head) */
-  else
+    length = free;
+  }
+  if(length == 0)
   {
-    /* existing data has wrapped around end of the buffer */
-    if(buf_tail < buf_head)
-    {
-      if(length > (buf_head - buf_tail - 1))
-      {
-        /* too much data, exit with non-zero */
-        return(length);
-      }
-    }/* end if(buf_tail < buf_head) */
+    return(0);
   }
 
-  /* new data will fit, add new length to transmit length */
-  tx_length += length;
-
-  /* copy the new data into the buffer */
+  /* copy the new data into the buffer, the interrupt doesn't see it until
+     tx_head is updated */
+  head = tx_head;
   for(i = 0; i < length; i++)
   {
-    /* buf_tail points to space in buffer to write new data to */
-    *(buf_tail++) = (uint8_t)buf[i];
-
-    /* if buf_tail reaches end of buffer, reset it */
-    if(buf_tail > (uart_buffer + TX_BUFFER_LENGTH - 1))
-    {
-      buf_tail = uart_buffer;
-    }
-  }/* end for(i = 0; i < length; i++) */
+    tx_buffer[head++ & TX_BUFFER_MASK] = (uint8_t)buf[i];
+  }
+  tx_head = head;
 
   /* start the transmit process if it is not already running */
-  if(usart_status.TX_IN_PROGRESS == 0)
-  {
-    /* wait for UART transmit register to empty */
-    while(!(UCSR0A & _BV(UDRE0)));
-    
-    /* load first byte from the buffer and count it */
-    UDR0 = *(buf_head++);
-    tx_count++;
-    
-    /* enable the UART transmit interrupt indicate it is in progress */
-    UCSR0B |= _BV(UDRIE0);
-    usart_status.TX_IN_PROGRESS = 1;
-
-  }/* end if(usart_status.TX_IN_PROGRESS == 0) */
+  uart_tx_start();
 
-  /* successful writing to buffer, exit with zero */
-  return(0);
+  return(length);
 
 }/* end uart_write() */
 
 uint8_t uart_write_P(uint8_t length, PGM_P buf)
 {
-  uint8_t i;
-  
-  /* if new data is zero or won't fit in the buffer, exit */
-  if((length == 0) || (length > TX_BUFFER_LENGTH))
-  {
-    return(255);
-  }
+  uint8_t i, head, free;
 
-  /* Determine if remaining space in the buffer can accommodate the new data.
-     How this is done depends on where the head and tail pointers are pointing.
-   */
-  if(buf_tail > buf_head)
+  /* accept as much as will fit */
+  free = uart_tx_free();
+  if(length > free)
   {
-    /* existing data hasn't wrapped around end of buffer */
-    if(length > (TX_BUFFER_LENGTH - (buf_tail - buf_head)))
-    {
-      /* too much data, exit with non-zero */
-      return(length);
-    }
-  }/* end if(buf_tail > buf_head) */
-  else
+    length = free;
+  }
+  if(length == 0)
   {
-    /* existing data has wrapped around end of the buffer */
-    if(buf_tail < buf_head)
-    {
-      if(length > (buf_head - buf_tail - 1))
-      {
-        /* too much data, exit with non-zero */
-        return(length);
-      }
-    }/* end if(buf_tail < buf_head) */
+    return(0);
   }
 
-  /* new data will fit, add new length to transmit length */
-  tx_length += length;
-
-  /* copy the new data into the buffer */
+  /* copy the new data into the buffer, the interrupt doesn't see it until
+     tx_head is updated */
+  head = tx_head;
   for(i = 0; i < length; i++)
   {
-    *(buf_tail++) = (uint8_t)pgm_read_byte_near(buf + i);
+    tx_buffer[head++ & TX_BUFFER_MASK] = (uint8_t)pgm_read_byte_near(buf + i);
+  }
+  tx_head = head;
+
+  /* start the transmit process if it is not already running */
+  uart_tx_start();
 
-    /* if buf_tail reaches end of buffer, reset it */
-    if(buf_tail > (uart_buffer + TX_BUFFER_LENGTH - 1))
+  return(length);
+
+}/* end uart_write_P() */
+
+/*
+ * uart_send()
+ *
+ * Send len bytes straight from the caller's buffer without copying them.  The
+ * buffer is described by desc: buf and len give the data, mem says whether it
+ * is in RAM (UART_MEM_RAM) or FLASH (UART_MEM_FLASH).  The data is sent after
+ * anything already given to uart_write() or uart_send(), and before anything
+ * given to them afterwards.
+ *
+ * Up to UART_TX_QUEUE_LENGTH descriptors can be waiting at once.  Returns
+ * UART_TX_BUSY if the queue is full, otherwise 0.
+ *
+ * desc->status is UART_TX_BUSY until the last byte has been loaded into the
+ * UART, then UART_TX_DONE.  desc->callback (if not 0) is then called from the
+ * interrupt.  The descriptor and buffer must stay valid until then.
+ */
+uint8_t uart_send(UART_TX_DESC_TYPE *desc)
+{
+  uint8_t sreg;
+
+  if(desc->len == 0)
+  {
+    desc->status = UART_TX_DONE;
+    if(desc->callback != 0)
     {
-      buf_tail = uart_buffer;
+      desc->callback(desc);
     }
-  }/* end for(i = 0; i < length; i++) */
+    return(0);
+  }
 
-  /* start the transmit process if it is not already running */
-  if(usart_status.TX_IN_PROGRESS == 0)
+  sreg = SREG;
+  cli();
+
+  if((uint8_t)(tx_desc_head - tx_desc_tail) >= UART_TX_QUEUE_LENGTH)
   {
-    /* wait for UART transmit register to empty */
-    while(!(UCSR0A & _BV(UDRE0)));
-    
-    /* load first byte from the buffer and count it */
-    UDR0 = *(buf_head++);
-    tx_count++;
-    
-    /* enable the UART transmit interrupt and indicate TX is in progress */
-    UCSR0B |= _BV(UDRIE0);
-    usart_status.TX_IN_PROGRESS = 1;
+    SREG = sreg;
+    return(UART_TX_BUSY);
+  }
+
+  /* the descriptor goes out once the interrupt reaches the current end of the
+     transmit buffer */
+  desc->status = UART_TX_BUSY;
+  tx_desc[tx_desc_head & TX_QUEUE_MASK] = desc;
+  tx_desc_mark[tx_desc_head & TX_QUEUE_MASK] = tx_head;
+  tx_desc_head++;
+
+  uart_tx_start();
 
-    }/* end if(usart_status.TX_IN_PROGRESS == 0) */
+  SREG = sreg;
 
-  /* successful writing to buffer, exit with zero */
   return(0);
 
-}/* end uart_write_P() */
+}/* end uart_send() */
 
 /*
  * USART TX Buffer Empty interrupt
  *
- * If any data left in the buffer to transmit, write the next one to the
- * UART transmit buffer then increment the pointer.  Otherwise disable the
- * interrupt.
+ * Send the next byte.  Bytes come from the transmit buffer until it reaches the
+ * mark of the first waiting descriptor, then from the descriptor's buffer until
+ * it is finished.  If there is nothing to send, or that was the last byte,
+ * disable the interrupt.  The check first is needed, the interrupt can be
+ * enabled again by a change to UCSR0B after it emptied the buffer.
  */
-ISR(USART_UDRE_vect)
+ISR(UART_UDRE_vect)
 {
-  /* check if there is anything left to transmit */
-  if(tx_count < tx_length)
+  uint8_t tail = tx_tail;
+  UART_TX_DESC_TYPE *desc;
+
+  PROF_BEGIN(PROF_ID_UART_UDRE_ISR);
+  TRACE(TRACE_ID_UART_UDRE, tail);
+  if((tail == tx_head) && (tx_desc_head == tx_desc_tail))
   {
-    /* transmit a byte and count it */
-    UDR0 = *(buf_head++);
-    tx_count++;
-    
-    /* check if buf_head pointer has reached end of buffer */
-    if(buf_head > (uart_buffer + TX_BUFFER_LENGTH - 1))
+    /* the buffer is empty, stop */
+    UART_UCSRB &= ~_BV(UDRIE0);
+    usart_status.TX_IN_PROGRESS = 0;
+    PROF_END(PROF_ID_UART_UDRE_ISR);
+    return;
+  }
+
+  if((tx_desc_head != tx_desc_tail) &&
+     (tail == tx_desc_mark[tx_desc_tail & TX_QUEUE_MASK]))
+  {
+    desc = tx_desc[tx_desc_tail & TX_QUEUE_MASK];
+
+    if(desc->mem == UART_MEM_FLASH)
+    {
+      UART_UDR = pgm_read_byte_near(desc->buf + tx_desc_index);
+    }
+    else
+    {
+      UART_UDR = desc->buf[tx_desc_index];
+    }
+
+    if(++tx_desc_index == desc->len)
     {
-      /* it has, reset it to start of buffer */
-      buf_head = uart_buffer;
+      /* this descriptor is finished, move on to the next */
+      tx_desc_index = 0;
+      tx_desc_tail++;
+      desc->status = UART_TX_DONE;
+      if(desc->callback != 0)
+      {
+        desc->callback(desc);
+      }
     }
   }
   else
+  {
+    UART_UDR = tx_buffer[tail++ & TX_BUFFER_MASK];
+    tx_tail = tail;
+
+  }/* end if((tx_desc_head != tx_desc_tail) && ... */
+
+  if((tail == tx_head) && (tx_desc_head == tx_desc_tail))
   {
     /* nothing left to transmit, disable the interrupt */
-    UCSR0B &= ~_BV(UDRIE0);
-    tx_count = 0;
-    tx_length = 0;
+    UART_UCSRB &= ~_BV(UDRIE0);
     usart_status.TX_IN_PROGRESS = 0;
   }
+  PROF_END(PROF_ID_UART_UDRE_ISR);
 
-}/* end ISR(USART_UDRE_vect) */
+}/* end ISR(UART_UDRE_vect) */
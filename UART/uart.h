@@ -37,10 +37,73 @@
 #define UART_OVERRUN_ERROR 3
 #define UART_PARITY_ERROR 4
 
+/* length of the receive buffer, must be a power of 2 no bigger than 128 */
+#ifndef UART_RX_BUFFER_LENGTH
+#define UART_RX_BUFFER_LENGTH 32
+#endif
+
+/* length of the transmit buffer, must be a power of 2 (64, 128 or 256), it
+   holds one byte less than this */
+#ifndef UART_TX_BUFFER_LENGTH
+#define UART_TX_BUFFER_LENGTH 64
+#endif
+
+/* number of buffers that can be waiting in uart_send(), must be a power of 2 */
+#ifndef UART_TX_QUEUE_LENGTH
+#define UART_TX_QUEUE_LENGTH 4
+#endif
+
+/* Baud rate register value for rate bits per second, rounded to the nearest.
+   Below 2MHz the UART uses the 2x clock and it is worked out for that.  With a
+   constant rate it is a constant, uart_init_ubrr(UART_UBRR(9600), ...) sets up
+   the UART the same as uart_init(9600, ...) without dividing at run time. */
+#define UART_UBRR(rate) \
+  ((F_CPU < 2000000UL) ? \
+   (uint16_t)(((F_CPU + (4UL * (rate))) / (8UL * (rate))) - 1) : \
+   (uint16_t)(((F_CPU + (8UL * (rate))) / (16UL * (rate))) - 1))
+
+/* these are for the mem field of UART_TX_DESC_TYPE */
+#define UART_MEM_RAM   0
+#define UART_MEM_FLASH 1
+
+/* these are for uart_send() and the status field of UART_TX_DESC_TYPE */
+#define UART_TX_DONE 0
+#define UART_TX_BUSY 1
+
+/* Descriptor for a buffer sent by uart_send().
+ *
+ * buf     : address of the data in RAM or FLASH
+ * len     : number of bytes to send
+ * mem     : UART_MEM_RAM or UART_MEM_FLASH
+ * callback: called from the interrupt when the last byte has been loaded into
+ *           the UART, can be 0 if not needed
+ * status  : UART_TX_BUSY while waiting or being sent, then UART_TX_DONE
+ */
+typedef struct UART_TX_DESC
+{
+  const char *buf;
+  uint16_t len;
+  uint8_t mem;
+  void (*callback)(struct UART_TX_DESC *desc);
+  volatile uint8_t status;
+
+} UART_TX_DESC_TYPE;
+
+/* Counts of receive errors, see uart_get_rx_errors(). */
+typedef struct
+{
+  uint8_t frame;    /* characters with a frame error, thrown away */
+  uint8_t overrun;  /* times the UART overran, characters were lost */
+  uint8_t parity;   /* characters with a parity error, thrown away */
+  uint8_t overflow; /* characters lost because the receive buffer was full */
+
+} UART_RX_ERRORS_TYPE;
+
 void uart_init(uint32_t rate,  /* bit rate in bits per second (BAUD) */
                uint8_t size,   /* frame size, can be 5, 6, 7, 8, or 9 bits */
                uint8_t parity, /* parity, can be none, odd or even */
                uint8_t stop);  /* number of stop bits, can be 1 or 2 */
+void uart_init_ubrr(uint16_t ubrr, uint8_t size, uint8_t parity, uint8_t stop);
 void uart_putchar(char c);
 char uart_getchar(void);
 void uart_putstr_P(const char *c);
@@ -55,7 +118,14 @@ void uart_tx_DI(void);
 uint8_t get_uart_rx_IE(void);
 uint8_t get_uart_tx_IE(void);
 uint8_t get_uart_UDRE0(void);
+uint8_t uart_tx_free(void);
 uint8_t uart_write(uint8_t length, char buf[]);
 uint8_t uart_write_P(uint8_t length, PGM_P buf);
+uint8_t uart_send(UART_TX_DESC_TYPE *desc);
+void uart_tx_put_at(uint8_t offset, uint8_t c);
+void uart_tx_commit(uint8_t length);
+uint8_t uart_rx_count(void);
+uint8_t uart_read(uint8_t length, char buf[]);
+void uart_get_rx_errors(UART_RX_ERRORS_TYPE *err);
 
 #endif /* _UART_H_ */
@@ -0,0 +1,74 @@
+/*
+ * File:    uart1.c
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * The uart.c driver built a second time for USART1.  UART_INSTANCE picks the
+ * registers and interrupt vectors, and the names of everything uart.c defines
+ * are changed from uart_ to uart1_ so both can be linked into one program.
+ * Each USART is its own copy of the code with its registers as constants, as
+ * fast as the USART0 driver, rather than one copy working through pointers.
+ *
+ * On parts with only one USART this file is empty.
+ *
+ * Both transmit interrupts are profiled and traced with the same ids.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#include <avr/io.h>
+
+#ifdef UDR1
+
+#define UART_INSTANCE 1
+
+/* functions */
+#define uart_init           uart1_init
+#define uart_init_ubrr      uart1_init_ubrr
+#define uart_putchar        uart1_putchar
+#define uart_rx_service     uart1_rx_service
+#define uart_rx_count       uart1_rx_count
+#define uart_read           uart1_read
+#define uart_get_rx_errors  uart1_get_rx_errors
+#define uart_getchar        uart1_getchar
+#define uart_putstr_P       uart1_putstr_P
+#define uart_putstr         uart1_putstr
+#define uart_put_UDR0       uart1_put_UDR0
+#define uart_get_status     uart1_get_status
+#define uart_available      uart1_available
+#define uart_rx_EI          uart1_rx_EI
+#define uart_rx_DI          uart1_rx_DI
+#define uart_tx_EI          uart1_tx_EI
+#define uart_tx_DI          uart1_tx_DI
+#define get_uart_rx_IE      get_uart1_rx_IE
+#define get_uart_tx_IE      get_uart1_tx_IE
+#define get_uart_UDRE0      get_uart1_UDRE0
+#define uart_tx_status      uart1_tx_status
+#define uart_tx_start       uart1_tx_start
+#define uart_tx_free        uart1_tx_free
+#define uart_tx_put_at      uart1_tx_put_at
+#define uart_tx_commit      uart1_tx_commit
+#define uart_write          uart1_write
+#define uart_write_P        uart1_write_P
+#define uart_send           uart1_send
+
+/* local variables */
+#define usart_status        uart1_usart_status
+#define rx_buffer           uart1_rx_buffer
+#define rx_head             uart1_rx_head
+#define rx_tail             uart1_rx_tail
+#define rx_errors           uart1_rx_errors
+#define tx_buffer           uart1_tx_buffer
+#define tx_head             uart1_tx_head
+#define tx_tail             uart1_tx_tail
+#define tx_desc             uart1_tx_desc
+#define tx_desc_mark        uart1_tx_desc_mark
+#define tx_desc_head        uart1_tx_desc_head
+#define tx_desc_tail        uart1_tx_desc_tail
+#define tx_desc_index       uart1_tx_desc_index
+
+#include "uart.c"
+
+#endif /* UDR1 */
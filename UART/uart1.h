@@ -0,0 +1,46 @@
+/*
+ * File:    uart1.h
+ * Date:    October 14, 2026
+ * Author:  Craig Hollinger
+ *
+ * Driver routines to run the second USART (USART1) on parts that have one,
+ * the ATmega644P, ATmega1284P, ATmega1280 and ATmega2560.  They are the uart_
+ * functions in uart.h built for USART1, see there and uart.c for what they do.
+ * The buffers are separate and the same length as USART0's.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 3
+ * or the GNU Lesser General Public License version 3, both as
+ * published by the Free Software Foundation.
+ */
+#ifndef _UART1_H_
+#define _UART1_H_ 1
+
+#include "uart.h"
+
+void uart1_init(uint32_t rate, uint8_t size, uint8_t parity, uint8_t stop);
+void uart1_init_ubrr(uint16_t ubrr, uint8_t size, uint8_t parity, uint8_t stop);
+void uart1_putchar(char c);
+char uart1_getchar(void);
+void uart1_putstr_P(const char *c);
+void uart1_putstr(char str[]);
+void uart1_put_UDR0(char c);
+uint8_t uart1_get_status(void);
+uint8_t uart1_available(void);
+void uart1_rx_EI(void);
+void uart1_rx_DI(void);
+void uart1_tx_EI(void);
+void uart1_tx_DI(void);
+uint8_t get_uart1_rx_IE(void);
+uint8_t get_uart1_tx_IE(void);
+uint8_t uart1_tx_free(void);
+uint8_t uart1_write(uint8_t length, char buf[]);
+uint8_t uart1_write_P(uint8_t length, PGM_P buf);
+uint8_t uart1_send(UART_TX_DESC_TYPE *desc);
+void uart1_tx_put_at(uint8_t offset, uint8_t c);
+void uart1_tx_commit(uint8_t length);
+uint8_t uart1_rx_count(void);
+uint8_t uart1_read(uint8_t length, char buf[]);
+void uart1_get_rx_errors(UART_RX_ERRORS_TYPE *err);
+
+#endif /* _UART1_H_ */